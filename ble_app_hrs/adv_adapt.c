@@ -0,0 +1,169 @@
+/** @file
+ *
+ * @brief Advertising interval controller module.
+ */
+#include "adv_adapt.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
+/**@brief Upper bounds of the connect latency histogram buckets (in milliseconds). The last one is
+ *        the end of slow advertising, set at init. */
+static uint32_t m_edges_ms[ADV_ADAPT_BUCKET_COUNT] =
+{
+        100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000, 0
+};
+
+static ble_adv_modes_config_t m_config;                             /**< Configured advertising modes. */
+static bool                   m_active;                             /**< Advertising started and no host connected yet. */
+static uint32_t               m_start_ticks;                        /**< RTC counter value when the advertising started. */
+static uint32_t               m_hist[ADV_ADAPT_BUCKET_COUNT];       /**< Connections per latency bucket. */
+static adv_adapt_stats_t      m_stats;                              /**< Connections in the histogram. */
+
+
+/**@brief Function for estimating the radio-on time of the advertising in the histogram.
+ *
+ * @details Every connection is taken at the upper bound of its bucket. Connections after the fast
+ *          period, and advertising that ended without one, are charged the slow advertising events.
+ *
+ * @param[in] interval   Fast advertising interval (in units of 0.625 ms).
+ * @param[in] timeout_s  Fast advertising period (in seconds).
+ * @param[out] p_adv_ms  Advertising time (in milliseconds).
+ *
+ * @return Radio-on time (in microseconds).
+ */
+static uint64_t radio_us(uint32_t interval, uint32_t timeout_s, uint64_t * p_adv_ms)
+{
+        uint32_t fast_interval_us = interval * UNIT_0_625_MS;
+        uint32_t slow_interval_us = m_config.ble_adv_slow_interval * UNIT_0_625_MS;
+        uint32_t fast_ms          = timeout_s * 1000;
+        uint64_t events           = 0;
+
+        *p_adv_ms = 0;
+
+        for (uint32_t i = 0; i < ADV_ADAPT_BUCKET_COUNT; i++)
+        {
+                uint32_t latency_ms = m_edges_ms[i];
+                uint32_t in_fast_ms = MIN(latency_ms, fast_ms);
+
+                events    += (uint64_t)m_hist[i] *
+                             ((in_fast_ms * 1000ULL) / fast_interval_us + ((latency_ms - in_fast_ms) * 1000ULL) / slow_interval_us);
+                *p_adv_ms += (uint64_t)m_hist[i] * latency_ms;
+        }
+
+        events    += (uint64_t)m_stats.idle_cnt *
+                     ((fast_ms * 1000ULL) / fast_interval_us + (m_config.ble_adv_slow_timeout * 1000000ULL) / slow_interval_us);
+        *p_adv_ms += (uint64_t)m_stats.idle_cnt * (fast_ms + m_config.ble_adv_slow_timeout * 1000);
+
+        return events * ADV_ADAPT_EVENT_RADIO_US;
+}
+
+
+void adv_adapt_init(ble_adv_modes_config_t const * p_config)
+{
+        m_config = *p_config;
+        m_edges_ms[ADV_ADAPT_BUCKET_COUNT - 1] = (p_config->ble_adv_fast_timeout + p_config->ble_adv_slow_timeout) * 1000;
+}
+
+
+void adv_adapt_on_started(void)
+{
+        if (m_active)
+        {
+                return;
+        }
+
+        m_active      = true;
+        m_start_ticks = app_timer_cnt_get();
+}
+
+
+void adv_adapt_on_idle(void)
+{
+        if (m_active)
+        {
+                m_active = false;
+                m_stats.idle_cnt++;
+        }
+}
+
+
+bool adv_adapt_on_connected(uint32_t * p_latency_ms)
+{
+        uint32_t i;
+
+        if (!m_active)
+        {
+                return false;
+        }
+
+        uint32_t latency_ms = TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_start_ticks));
+
+        for (i = 0; i < ADV_ADAPT_BUCKET_COUNT - 1; i++)
+        {
+                if (latency_ms <= m_edges_ms[i])
+                {
+                        break;
+                }
+        }
+
+        m_active = false;
+        m_hist[i]++;
+        m_stats.connect_cnt++;
+
+        *p_latency_ms = latency_ms;
+        return true;
+}
+
+
+bool adv_adapt_fit(adv_adapt_fit_t * p_fit)
+{
+        uint32_t cum_cnt   = 0;
+        uint32_t timeout_s = m_config.ble_adv_fast_timeout;
+        uint32_t interval  = m_config.ble_adv_fast_interval;
+        bool     median    = false;
+
+        if (m_stats.connect_cnt < ADV_ADAPT_MIN_SAMPLES)
+        {
+                return false;
+        }
+
+        for (uint32_t i = 0; i < ADV_ADAPT_BUCKET_COUNT; i++)
+        {
+                cum_cnt += m_hist[i];
+
+                if (!median && (cum_cnt * 2 >= m_stats.connect_cnt))
+                {
+                        median   = true;
+                        interval = MSEC_TO_UNITS(m_edges_ms[i], UNIT_0_625_MS) / ADV_ADAPT_EVENTS_PER_MEDIAN;
+                }
+                if (cum_cnt * 100 >= m_stats.connect_cnt * ADV_ADAPT_PERCENTILE)
+                {
+                        timeout_s = CEIL_DIV(m_edges_ms[i], 1000);
+                        break;
+                }
+        }
+
+        interval  = MAX(interval, m_config.ble_adv_fast_interval);
+        interval  = MIN(interval, ADV_ADAPT_FAST_INTERVAL_MAX);
+        timeout_s = MAX(timeout_s, ADV_ADAPT_FAST_TIMEOUT_MIN);
+        timeout_s = MIN(timeout_s, m_config.ble_adv_fast_timeout);
+
+        uint64_t adv_ms;
+        uint64_t fixed_us = radio_us(m_config.ble_adv_fast_interval, m_config.ble_adv_fast_timeout, &adv_ms);
+        uint64_t tuned_us = radio_us(interval, timeout_s, &adv_ms);
+
+        p_fit->fast_interval     = interval;
+        p_fit->fast_timeout      = timeout_s;
+        p_fit->saved_ms_per_hour = (uint32_t)(((fixed_us - tuned_us) * 3600) / MAX(adv_ms, 1));
+
+        return true;
+}
+
+
+void adv_adapt_stats_get(adv_adapt_stats_t * p_stats)
+{
+        *p_stats = m_stats;
+}
@@ -0,0 +1,106 @@
+/** @file
+ *
+ * @defgroup adv_adapt Advertising interval controller
+ * @{
+ * @brief Fast advertising fitted to how long hosts take to connect.
+ *
+ * @details The time from the start of advertising to the connection of a host goes into a
+ *          histogram. Once it holds @ref ADV_ADAPT_MIN_SAMPLES connections, the fast advertising
+ *          period is made long enough for @ref ADV_ADAPT_PERCENTILE percent of them, and the
+ *          interval long enough to send @ref ADV_ADAPT_EVENTS_PER_MEDIAN events before the median
+ *          connection. The fitted parameters never advertise faster or longer than the configured
+ *          ones.
+ *
+ *          The module does not advertise. The application applies the parameters to the
+ *          advertising, unless @ref ADV_ADAPT_ENABLED is 0.
+ */
+#ifndef ADV_ADAPT_H__
+#define ADV_ADAPT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_advertising.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ADV_ADAPT_ENABLED              1                            /**< Set to 0 to keep the configured fast advertising parameters and only collect the connect latency histogram. */
+#define ADV_ADAPT_MIN_SAMPLES          8                            /**< Number of connections to collect before tuning the fast advertising. */
+#define ADV_ADAPT_PERCENTILE           95                           /**< Percentage of the connections the fast advertising period must cover. */
+#define ADV_ADAPT_EVENTS_PER_MEDIAN    8                            /**< Number of advertising events to send before the median connect latency. */
+#define ADV_ADAPT_FAST_TIMEOUT_MIN     2                            /**< Shortest fast advertising period (in seconds). */
+#define ADV_ADAPT_FAST_INTERVAL_MAX    MSEC_TO_UNITS(100, UNIT_0_625_MS)  /**< Longest fast advertising interval (100 ms). */
+#define ADV_ADAPT_EVENT_RADIO_US       1500                         /**< Estimated radio-on time of a connectable advertising event on three channels (in microseconds). */
+#define ADV_ADAPT_BUCKET_COUNT         10                           /**< Number of buckets of the connect latency histogram. */
+
+/**@brief Fast advertising parameters fitted to the histogram. */
+typedef struct
+{
+        uint32_t fast_interval;                                     /**< Fast advertising interval (in units of 0.625 ms). */
+        uint32_t fast_timeout;                                      /**< Fast advertising period (in seconds). */
+        uint32_t saved_ms_per_hour;                                 /**< Estimated radio-on time saved against the configured parameters (in ms per hour of advertising). */
+} adv_adapt_fit_t;
+
+/**@brief Connections in the histogram. */
+typedef struct
+{
+        uint32_t connect_cnt;                                       /**< Number of connections in the histogram. */
+        uint32_t idle_cnt;                                          /**< Number of times advertising ended without a connection. */
+} adv_adapt_stats_t;
+
+
+/**@brief Function for initializing the controller.
+ *
+ * @param[in] p_config  Configured advertising modes. The fast parameters are the fastest and
+ *                      longest the controller uses, the slow ones are charged to the connections
+ *                      after the fast period.
+ */
+void adv_adapt_init(ble_adv_modes_config_t const * p_config);
+
+
+/**@brief Function for noting the start of advertising.
+ *
+ * @details Restarts while no host connected, such as the bonding window slices or the move to slow
+ *          advertising, belong to the same advertising.
+ */
+void adv_adapt_on_started(void);
+
+
+/**@brief Function for noting the end of advertising without a connection.
+ */
+void adv_adapt_on_idle(void);
+
+
+/**@brief Function for adding a connection to the connect latency histogram.
+ *
+ * @param[out] p_latency_ms  Time from the start of advertising to the connection (in ms).
+ *
+ * @return true if the connection was added, false if it was not made to the advertising.
+ */
+bool adv_adapt_on_connected(uint32_t * p_latency_ms);
+
+
+/**@brief Function for fitting the fast advertising to the connect latency histogram.
+ *
+ * @param[out] p_fit  Fitted parameters.
+ *
+ * @return true if the histogram holds enough connections to fit, false otherwise.
+ */
+bool adv_adapt_fit(adv_adapt_fit_t * p_fit);
+
+
+/**@brief Function for getting the number of connections in the histogram.
+ *
+ * @param[out] p_stats  Statistics.
+ */
+void adv_adapt_stats_get(adv_adapt_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_ADAPT_H__
+
+/** @} */
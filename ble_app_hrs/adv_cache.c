@@ -0,0 +1,249 @@
+/** @file
+ *
+ * @brief Advertising from cached payloads module.
+ */
+#include <string.h>
+#include "adv_cache.h"
+
+
+/**@brief Payloads kept encoded. */
+typedef enum
+{
+        PAYLOAD_WHITELIST,                                          /**< Payload of advertising to the bonded hosts, not discoverable. */
+        PAYLOAD_OPEN,                                               /**< Payload of advertising to any host, general discoverable. */
+        PAYLOAD_COUNT,                                              /**< Number of payloads. */
+} payload_t;
+
+/**@brief Encoded advertising payload. */
+typedef struct
+{
+        uint8_t  data[BLE_GAP_ADV_MAX_SIZE];                        /**< Encoded advertising data. */
+        uint16_t len;                                               /**< Length of the encoded advertising data. */
+} payload_buf_t;
+
+/**@brief State of the advertising. */
+typedef struct
+{
+        adv_cache_init_t init;                                      /**< Initialization parameters. */
+        payload_buf_t    payloads[PAYLOAD_COUNT];                   /**< Encoded payloads, indexed by payload_t. */
+        uint8_t const *  p_srdata;                                  /**< Encoded scan response, NULL for none. */
+        uint16_t         srdata_len;                                /**< Length of the scan response. */
+        ble_adv_mode_t   mode;                                      /**< Mode advertising now, BLE_ADV_MODE_IDLE if none. */
+        bool             whitelist;                                 /**< Whether fast and slow advertising use the whitelist. */
+        bool             peer_addr_valid;                           /**< Whether directed advertising has a host to go to. */
+        ble_gap_addr_t   peer_addr;                                 /**< Host of directed advertising. */
+} adv_cache_t;
+
+static adv_cache_t m_adv;                                           /**< Advertising state. */
+
+
+/**@brief Function for getting the mode advertising moves to when a mode times out. */
+static ble_adv_mode_t mode_next(ble_adv_mode_t mode)
+{
+        switch (mode)
+        {
+        case BLE_ADV_MODE_DIRECTED:
+                return BLE_ADV_MODE_FAST;
+
+        case BLE_ADV_MODE_FAST:
+                return BLE_ADV_MODE_SLOW;
+
+        default:
+                return BLE_ADV_MODE_IDLE;
+        }
+}
+
+
+/**@brief Function for checking whether advertising may use a mode. */
+static bool mode_enabled(ble_adv_mode_t mode)
+{
+        switch (mode)
+        {
+        case BLE_ADV_MODE_IDLE:
+                return true;
+
+        case BLE_ADV_MODE_DIRECTED:
+                return m_adv.init.config.ble_adv_directed_enabled && m_adv.peer_addr_valid;
+
+        case BLE_ADV_MODE_FAST:
+                return m_adv.init.config.ble_adv_fast_enabled;
+
+        case BLE_ADV_MODE_SLOW:
+                return m_adv.init.config.ble_adv_slow_enabled;
+
+        default:
+                return false;
+        }
+}
+
+
+/**@brief Function for advertising in a mode, or in the first enabled mode after it.
+ *
+ * @param[in] mode  Mode to advertise in.
+ *
+ * @retval NRF_SUCCESS  If advertising was started, or there was no mode left.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+static ret_code_t mode_start(ble_adv_mode_t mode)
+{
+        ret_code_t           err_code;
+        ble_gap_adv_params_t adv_params;
+        ble_adv_evt_t        adv_evt;
+        payload_buf_t const * p_payload = &m_adv.payloads[m_adv.whitelist ? PAYLOAD_WHITELIST : PAYLOAD_OPEN];
+
+        while (!mode_enabled(mode))
+        {
+                mode = mode_next(mode);
+        }
+
+        (void) sd_ble_gap_adv_stop();
+        m_adv.mode = BLE_ADV_MODE_IDLE;
+
+        if (mode == BLE_ADV_MODE_IDLE)
+        {
+                m_adv.init.evt_handler(BLE_ADV_EVT_IDLE);
+                return NRF_SUCCESS;
+        }
+
+        memset(&adv_params, 0, sizeof(adv_params));
+
+        if (mode == BLE_ADV_MODE_DIRECTED)
+        {
+                // High duty cycle directed advertising, the SoftDevice ends it after 1.28 s.
+                adv_params.type        = BLE_GAP_ADV_TYPE_ADV_DIRECT_IND;
+                adv_params.p_peer_addr = &m_adv.peer_addr;
+                adv_params.fp          = BLE_GAP_ADV_FP_ANY;
+                adv_evt                = BLE_ADV_EVT_DIRECTED;
+        }
+        else
+        {
+                err_code = sd_ble_gap_adv_data_set(p_payload->data, p_payload->len, m_adv.p_srdata, m_adv.srdata_len);
+                if (err_code != NRF_SUCCESS)
+                {
+                        return err_code;
+                }
+
+                adv_params.type = BLE_GAP_ADV_TYPE_ADV_IND;
+                adv_params.fp   = m_adv.whitelist ? BLE_GAP_ADV_FP_FILTER_CONNREQ : BLE_GAP_ADV_FP_ANY;
+                if (mode == BLE_ADV_MODE_FAST)
+                {
+                        adv_params.interval = m_adv.init.config.ble_adv_fast_interval;
+                        adv_params.timeout  = m_adv.init.config.ble_adv_fast_timeout;
+                        adv_evt             = m_adv.whitelist ? BLE_ADV_EVT_FAST_WHITELIST : BLE_ADV_EVT_FAST;
+                }
+                else
+                {
+                        adv_params.interval = m_adv.init.config.ble_adv_slow_interval;
+                        adv_params.timeout  = m_adv.init.config.ble_adv_slow_timeout;
+                        adv_evt             = m_adv.whitelist ? BLE_ADV_EVT_SLOW_WHITELIST : BLE_ADV_EVT_SLOW;
+                }
+        }
+
+        err_code = sd_ble_gap_adv_start(&adv_params, m_adv.init.conn_cfg_tag);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        m_adv.mode = mode;
+        m_adv.init.evt_handler(adv_evt);
+
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t adv_cache_init(adv_cache_init_t const * p_init, ble_advdata_t const * p_advdata)
+{
+        memset(&m_adv, 0, sizeof(m_adv));
+
+        m_adv.init = *p_init;
+        m_adv.mode = BLE_ADV_MODE_IDLE;
+
+        return adv_cache_payload_build(p_advdata);
+}
+
+
+ret_code_t adv_cache_payload_build(ble_advdata_t const * p_advdata)
+{
+        ret_code_t    err_code;
+        ble_advdata_t advdata = *p_advdata;
+        payload_buf_t payloads[PAYLOAD_COUNT];
+
+        advdata.flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+        payloads[PAYLOAD_WHITELIST].len = BLE_GAP_ADV_MAX_SIZE;
+        err_code = adv_data_encode(&advdata, payloads[PAYLOAD_WHITELIST].data, &payloads[PAYLOAD_WHITELIST].len);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        advdata.flags = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+        payloads[PAYLOAD_OPEN].len = BLE_GAP_ADV_MAX_SIZE;
+        err_code = adv_data_encode(&advdata, payloads[PAYLOAD_OPEN].data, &payloads[PAYLOAD_OPEN].len);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        memcpy(m_adv.payloads, payloads, sizeof(payloads));
+
+        return NRF_SUCCESS;
+}
+
+
+void adv_cache_srdata_set(uint8_t const * p_data, uint16_t len)
+{
+        m_adv.p_srdata   = p_data;
+        m_adv.srdata_len = (p_data != NULL) ? len : 0;
+}
+
+
+void adv_cache_modes_config_set(ble_adv_modes_config_t const * p_config)
+{
+        m_adv.init.config = *p_config;
+}
+
+
+ret_code_t adv_cache_start(ble_adv_mode_t mode, ble_gap_addr_t const * p_peer_addr, bool whitelist)
+{
+        m_adv.whitelist       = whitelist && m_adv.init.config.ble_adv_whitelist_enabled;
+        m_adv.peer_addr_valid = (p_peer_addr != NULL);
+        if (p_peer_addr != NULL)
+        {
+                m_adv.peer_addr = *p_peer_addr;
+        }
+
+        return mode_start(mode);
+}
+
+
+void adv_cache_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+        ret_code_t err_code;
+
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_GAP_EVT_CONNECTED:
+                if (p_ble_evt->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
+                {
+                        // The SoftDevice stops advertising when a host connects.
+                        m_adv.mode = BLE_ADV_MODE_IDLE;
+                }
+                break;
+
+        case BLE_GAP_EVT_TIMEOUT:
+                if ((p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_ADVERTISING) &&
+                    (m_adv.mode != BLE_ADV_MODE_IDLE))
+                {
+                        err_code = mode_start(mode_next(m_adv.mode));
+                        if ((err_code != NRF_SUCCESS) && (m_adv.init.error_handler != NULL))
+                        {
+                                m_adv.init.error_handler(err_code);
+                        }
+                }
+                break;
+
+        default:
+                break;
+        }
+}
@@ -0,0 +1,113 @@
+/** @file
+ *
+ * @defgroup adv_cache Advertising from cached payloads
+ * @{
+ * @brief Connectable advertising that encodes its payloads once.
+ *
+ * @details Takes the place of the Advertising module of the SDK, which encodes the advertising
+ *          data again on every start. The payloads of whitelisted and of open advertising are
+ *          encoded by @ref adv_cache_payload_build, a start only hands one of them to the
+ *          SoftDevice.
+ *
+ *          Like the SDK module, advertising goes from directed to fast to slow advertising as
+ *          each times out, skipping the modes that are not enabled, and the application gets the
+ *          same @ref ble_adv_evt_t events. There are no whitelist or peer address requests: the
+ *          whitelist is the one the application set in the SoftDevice, and the peer of directed
+ *          advertising is given to @ref adv_cache_start.
+ *
+ *          The application must forward its BLE events to @ref adv_cache_on_ble_evt.
+ */
+#ifndef ADV_CACHE_H__
+#define ADV_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "ble_advdata.h"
+#include "ble_advertising.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Advertising initialization parameters. */
+typedef struct
+{
+        ble_adv_modes_config_t  config;                             /**< Advertising modes. Directed slow advertising is not supported. */
+        uint8_t                 conn_cfg_tag;                       /**< SoftDevice connection configuration of the links advertising makes. */
+        ble_adv_evt_handler_t   evt_handler;                        /**< Handler of the advertising events. */
+        ble_adv_error_handler_t error_handler;                      /**< Handler of errors when advertising moves to the next mode. */
+} adv_cache_init_t;
+
+
+/**@brief Function for initializing the module and encoding the payloads.
+ *
+ * @param[in] p_init     Initialization parameters.
+ * @param[in] p_advdata  Advertising data. Its flags are replaced by those of each payload.
+ *
+ * @retval NRF_SUCCESS  If the payloads were encoded.
+ * @return Otherwise the error code of the encoder.
+ */
+ret_code_t adv_cache_init(adv_cache_init_t const * p_init, ble_advdata_t const * p_advdata);
+
+
+/**@brief Function for encoding the payloads again, e.g. after the device name or the advertised
+ *        UUIDs changed.
+ *
+ * @details Takes effect from the next start.
+ *
+ * @param[in] p_advdata  Advertising data. Its flags are replaced by those of each payload.
+ *
+ * @retval NRF_SUCCESS  If the payloads were encoded.
+ * @return Otherwise the error code of the encoder. The previous payloads are kept.
+ */
+ret_code_t adv_cache_payload_build(ble_advdata_t const * p_advdata);
+
+
+/**@brief Function for setting the scan response sent with fast and slow advertising.
+ *
+ * @details The data is not copied and must stay valid. Takes effect from the next start.
+ *
+ * @param[in] p_data  Encoded scan response, NULL for none.
+ * @param[in] len     Length of the scan response.
+ */
+void adv_cache_srdata_set(uint8_t const * p_data, uint16_t len);
+
+
+/**@brief Function for changing the advertising modes.
+ *
+ * @details Takes effect from the next mode advertising moves to.
+ *
+ * @param[in] p_config  Advertising modes.
+ */
+void adv_cache_modes_config_set(ble_adv_modes_config_t const * p_config);
+
+
+/**@brief Function for starting advertising, or restarting it in another mode.
+ *
+ * @param[in] mode         First mode to advertise in. BLE_ADV_MODE_IDLE stops advertising.
+ * @param[in] p_peer_addr  Host to direct the advertising to, NULL to skip directed advertising.
+ * @param[in] whitelist    Whether fast and slow advertising accept connections from the
+ *                         whitelist only. They are then not discoverable.
+ *
+ * @retval NRF_SUCCESS  If advertising was started.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t adv_cache_start(ble_adv_mode_t mode, ble_gap_addr_t const * p_peer_addr, bool whitelist);
+
+
+/**@brief Function for handling BLE events.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+void adv_cache_on_ble_evt(ble_evt_t const * p_ble_evt);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_CACHE_H__
+
+/** @} */
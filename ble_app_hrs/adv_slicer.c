@@ -0,0 +1,76 @@
+/** @file
+ *
+ * @brief Bonding window slices module.
+ */
+#include <string.h>
+#include "adv_slicer.h"
+
+
+/**@brief Bonding window scheduler, alternating whitelisted and open advertising. */
+typedef struct
+{
+        adv_slice_t       current;                                  /**< Slice advertising now, ADV_SLICE_NONE if paused or stopped. */
+        adv_slice_stats_t stats[ADV_SLICE_COUNT];                   /**< Connections of each type of slice in the current window. */
+} adv_slicer_t;
+
+static adv_slicer_t m_adv_slicer;                                   /**< Bonding window scheduler. */
+
+
+void adv_slicer_window_open(void)
+{
+        memset(&m_adv_slicer.stats, 0, sizeof(m_adv_slicer.stats));
+}
+
+
+void adv_slicer_slice_begin(adv_slice_t slice)
+{
+        m_adv_slicer.current = slice;
+        m_adv_slicer.stats[slice].slice_cnt++;
+}
+
+
+void adv_slicer_slice_end(void)
+{
+        m_adv_slicer.current = ADV_SLICE_NONE;
+}
+
+
+adv_slice_t adv_slicer_current(void)
+{
+        return m_adv_slicer.current;
+}
+
+
+void adv_slicer_on_connected(conn_ctx_t * p_ctx)
+{
+        p_ctx->adv_slice = m_adv_slicer.current;
+        if (p_ctx->adv_slice != ADV_SLICE_NONE)
+        {
+                m_adv_slicer.stats[p_ctx->adv_slice].attempted_cnt++;
+        }
+}
+
+
+void adv_slicer_on_outcome(conn_ctx_t * p_ctx, bool accepted)
+{
+        if (p_ctx->adv_slice == ADV_SLICE_NONE)
+        {
+                return;
+        }
+
+        if (accepted)
+        {
+                m_adv_slicer.stats[p_ctx->adv_slice].accepted_cnt++;
+        }
+        else
+        {
+                m_adv_slicer.stats[p_ctx->adv_slice].rejected_cnt++;
+        }
+        p_ctx->adv_slice = ADV_SLICE_NONE;
+}
+
+
+void adv_slicer_stats_get(adv_slice_t slice, adv_slice_stats_t * p_stats)
+{
+        *p_stats = m_adv_slicer.stats[slice];
+}
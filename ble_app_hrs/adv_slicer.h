@@ -0,0 +1,91 @@
+/** @file
+ *
+ * @defgroup adv_slicer Bonding window slices
+ * @{
+ * @brief Bookkeeping of the bonding window, which alternates slices of whitelisted and of open
+ *        advertising.
+ *
+ * @details Open slices let a new host bond while whitelisted slices let a bonded host that lost
+ *          its link come back. The module knows which slice is advertising and counts, for each
+ *          type of slice, the links established in it and whether they were secured.
+ *
+ *          The module does not advertise or run timers. The application starts and ends the
+ *          slices and tells the module about them.
+ */
+#ifndef ADV_SLICER_H__
+#define ADV_SLICER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Connections of one type of bonding window slice. */
+typedef struct
+{
+        uint32_t slice_cnt;                                         /**< Number of slices run. */
+        uint32_t attempted_cnt;                                     /**< Number of links established in the slices. */
+        uint32_t rejected_cnt;                                      /**< Number of those links dropped or failing security before being secured. */
+        uint32_t accepted_cnt;                                      /**< Number of those links secured. */
+} adv_slice_stats_t;
+
+
+/**@brief Function for opening a bonding window, clearing the counts of the last one.
+ */
+void adv_slicer_window_open(void);
+
+
+/**@brief Function for noting the start of a slice.
+ *
+ * @param[in] slice  ADV_SLICE_WHITELIST or ADV_SLICE_OPEN.
+ */
+void adv_slicer_slice_begin(adv_slice_t slice);
+
+
+/**@brief Function for noting that no slice is advertising, e.g. when the slices are paused.
+ */
+void adv_slicer_slice_end(void);
+
+
+/**@brief Function for getting the slice advertising now.
+ *
+ * @return The slice, ADV_SLICE_NONE if paused or stopped.
+ */
+adv_slice_t adv_slicer_current(void);
+
+
+/**@brief Function for counting a link established in the current slice.
+ *
+ * @param[in] p_ctx  Context of the new link. It records the slice.
+ */
+void adv_slicer_on_connected(conn_ctx_t * p_ctx);
+
+
+/**@brief Function for counting the outcome of a link established in a slice.
+ *
+ * @details Only the first outcome of a link counts.
+ *
+ * @param[in] p_ctx     Context of the link.
+ * @param[in] accepted  Whether the link was secured, as opposed to dropped or failing security.
+ */
+void adv_slicer_on_outcome(conn_ctx_t * p_ctx, bool accepted);
+
+
+/**@brief Function for getting the counts of a type of slice in the current window.
+ *
+ * @param[in]  slice    ADV_SLICE_WHITELIST or ADV_SLICE_OPEN.
+ * @param[out] p_stats  Counts.
+ */
+void adv_slicer_stats_get(adv_slice_t slice, adv_slice_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADV_SLICER_H__
+
+/** @} */
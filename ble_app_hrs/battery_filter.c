@@ -0,0 +1,52 @@
+/** @file
+ *
+ * @brief Battery level filter module.
+ */
+#include <string.h>
+#include "battery_filter.h"
+#include "app_util.h"
+
+
+void battery_filter_init(battery_filter_t * p_filter, uint8_t level_reported)
+{
+        memset(p_filter, 0, sizeof(battery_filter_t));
+        p_filter->level          = level_reported;
+        p_filter->level_reported = level_reported;
+}
+
+
+bool battery_filter_put(battery_filter_t * p_filter, uint16_t battery_mv)
+{
+        uint8_t level_diff;
+
+        p_filter->reading_cnt++;
+
+        if (p_filter->mv_acc == 0)
+        {
+                p_filter->mv_acc = (uint32_t)battery_mv << BATTERY_FILTER_SHIFT;
+        }
+        else
+        {
+                p_filter->mv_acc -= p_filter->mv_acc >> BATTERY_FILTER_SHIFT;
+                p_filter->mv_acc += battery_mv;
+        }
+
+        p_filter->level = battery_level_in_percent((uint16_t)(p_filter->mv_acc >> BATTERY_FILTER_SHIFT));
+        level_diff      = (p_filter->level > p_filter->level_reported) ?
+                          (p_filter->level - p_filter->level_reported) :
+                          (p_filter->level_reported - p_filter->level);
+
+        if (level_diff < BATTERY_FILTER_HYSTERESIS)
+        {
+                if (level_diff != 0)
+                {
+                        p_filter->avoided_cnt++;
+                }
+                return false;
+        }
+
+        p_filter->level_reported = p_filter->level;
+        p_filter->reported_cnt++;
+
+        return true;
+}
@@ -0,0 +1,66 @@
+/** @file
+ *
+ * @defgroup battery_filter Battery level filter
+ * @{
+ * @brief Filtered battery level, reported only when it moved past a hysteresis band.
+ *
+ * @details Each battery voltage reading goes through a first order low-pass filter and is
+ *          converted to a level in percent. The level is only reported when it differs by at
+ *          least @ref BATTERY_FILTER_HYSTERESIS from the level last reported, so ADC noise and
+ *          slow drift do not cost a notification on every measurement. Level changes within the
+ *          band are counted as notifications avoided.
+ *
+ *          The module does not sample the battery. The application feeds it readings from the
+ *          SAADC, or from the sensor simulator, and notifies the levels it reports.
+ */
+#ifndef BATTERY_FILTER_H__
+#define BATTERY_FILTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATTERY_FILTER_HYSTERESIS      2                            /**< Change of the battery level (in percent) needed before a new level is reported. */
+#define BATTERY_FILTER_SHIFT           2                            /**< A new battery voltage reading is weighted 1/2^BATTERY_FILTER_SHIFT in the filtered voltage. */
+
+/**@brief Battery level filter. */
+typedef struct
+{
+        uint32_t mv_acc;                                            /**< Filtered battery voltage (in mV) scaled by 2^BATTERY_FILTER_SHIFT. 0 until the first reading. */
+        uint8_t  level;                                             /**< Level of the filtered voltage (in percent). */
+        uint8_t  level_reported;                                    /**< Level last reported (in percent). */
+        uint32_t reading_cnt;                                       /**< Number of readings. */
+        uint32_t reported_cnt;                                      /**< Number of levels reported. */
+        uint32_t avoided_cnt;                                       /**< Number of level changes within the hysteresis band that were not reported. */
+} battery_filter_t;
+
+
+/**@brief Function for initializing a filter. The first reading sets the filtered voltage.
+ *
+ * @param[out] p_filter        Filter.
+ * @param[in]  level_reported  Level reported before the first reading (in percent).
+ */
+void battery_filter_init(battery_filter_t * p_filter, uint8_t level_reported);
+
+
+/**@brief Function for filtering a battery voltage reading.
+ *
+ * @param[in,out] p_filter    Filter.
+ * @param[in]     battery_mv  Battery voltage (in mV).
+ *
+ * @return true if the level moved past the hysteresis band and @ref battery_filter_t::level_reported
+ *         holds the new level to report.
+ */
+bool battery_filter_put(battery_filter_t * p_filter, uint16_t battery_mv);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATTERY_FILTER_H__
+
+/** @} */
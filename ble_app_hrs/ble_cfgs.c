@@ -0,0 +1,170 @@
+/** @file
+ *
+ * @brief Configuration Service module.
+ */
+#include <string.h>
+#include "ble_cfgs.h"
+#include "ble_srv_common.h"
+
+
+/**@brief Function for handling a single Write Request to the Configuration characteristic.
+ *
+ * @details The characteristic requires write authorization so that queued writes reach
+ *          nrf_ble_qwr. Single Write Requests are accepted here; prepared and execute writes are
+ *          left to nrf_ble_qwr.
+ *
+ * @param[in] p_cfgs     Configuration Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_cfgs_t * p_cfgs, ble_evt_t const * p_ble_evt)
+{
+        uint32_t err_code;
+        ble_gatts_evt_rw_authorize_request_t const * p_auth_req =
+                &p_ble_evt->evt.gatts_evt.params.authorize_request;
+        ble_gatts_rw_authorize_reply_params_t auth_reply;
+        uint16_t       conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+        ble_cfgs_evt_t evt;
+
+        if ((p_auth_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) ||
+            (p_auth_req->request.write.op != BLE_GATTS_OP_WRITE_REQ) ||
+            (p_auth_req->request.write.handle != p_cfgs->config_handles.value_handle))
+        {
+                return;
+        }
+
+        memset(&auth_reply, 0, sizeof(auth_reply));
+
+        auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+        auth_reply.params.write.update      = 1;
+        auth_reply.params.write.offset      = p_auth_req->request.write.offset;
+        auth_reply.params.write.len         = p_auth_req->request.write.len;
+        auth_reply.params.write.p_data      = p_auth_req->request.write.data;
+
+        err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &auth_reply);
+        if ((err_code != NRF_SUCCESS) || (p_cfgs->evt_handler == NULL))
+        {
+                return;
+        }
+
+        evt.evt_type    = BLE_CFGS_EVT_CONFIG_WRITTEN;
+        evt.conn_handle = conn_handle;
+        evt.len         = p_auth_req->request.write.len;
+
+        p_cfgs->evt_handler(p_cfgs, &evt);
+}
+
+
+void ble_cfgs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+        ble_cfgs_t * p_cfgs = (ble_cfgs_t *)p_context;
+
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+                on_rw_authorize_request(p_cfgs, p_ble_evt);
+                break;
+
+        default:
+                // No implementation needed.
+                break;
+        }
+}
+
+
+/**@brief Function for adding the Configuration characteristic.
+ *
+ * @param[in] p_cfgs       Configuration Service structure.
+ * @param[in] p_cfgs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t config_char_add(ble_cfgs_t * p_cfgs, ble_cfgs_init_t const * p_cfgs_init)
+{
+        ble_gatts_char_md_t char_md;
+        ble_gatts_attr_t    attr_char_value;
+        ble_uuid_t          ble_uuid;
+        ble_gatts_attr_md_t attr_md;
+
+        memset(&char_md, 0, sizeof(char_md));
+
+        char_md.char_props.read  = 1;
+        char_md.char_props.write = 1;
+        char_md.p_char_user_desc = NULL;
+        char_md.p_char_pf        = NULL;
+        char_md.p_user_desc_md   = NULL;
+        char_md.p_cccd_md        = NULL;
+        char_md.p_sccd_md        = NULL;
+
+        ble_uuid.type = p_cfgs->uuid_type;
+        ble_uuid.uuid = BLE_UUID_CFGS_CONFIG_CHAR;
+
+        memset(&attr_md, 0, sizeof(attr_md));
+
+        attr_md.read_perm  = p_cfgs_init->config_read_perm;
+        attr_md.write_perm = p_cfgs_init->config_write_perm;
+
+        // Keep the value out of the SoftDevice attribute table.
+        attr_md.vloc    = BLE_GATTS_VLOC_USER;
+        attr_md.rd_auth = 0;
+        attr_md.wr_auth = 1;
+        attr_md.vlen    = 1;
+
+        memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+        attr_char_value.p_uuid    = &ble_uuid;
+        attr_char_value.p_attr_md = &attr_md;
+        attr_char_value.init_len  = 0;
+        attr_char_value.init_offs = 0;
+        attr_char_value.max_len   = BLE_CFGS_MAX_LEN;
+        attr_char_value.p_value   = p_cfgs->config;
+
+        return sd_ble_gatts_characteristic_add(p_cfgs->service_handle,
+                                               &char_md,
+                                               &attr_char_value,
+                                               &p_cfgs->config_handles);
+}
+
+
+uint32_t ble_cfgs_init(ble_cfgs_t * p_cfgs, ble_cfgs_init_t const * p_cfgs_init)
+{
+        uint32_t      err_code;
+        ble_uuid_t    ble_uuid;
+        ble_uuid128_t cfgs_base_uuid = CFGS_BASE_UUID;
+
+        if ((p_cfgs == NULL) || (p_cfgs_init == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        // Initialize the service structure.
+        p_cfgs->evt_handler = p_cfgs_init->evt_handler;
+        memset(p_cfgs->config, 0, sizeof(p_cfgs->config));
+
+        // Add a custom base UUID.
+        err_code = sd_ble_uuid_vs_add(&cfgs_base_uuid, &p_cfgs->uuid_type);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        ble_uuid.type = p_cfgs->uuid_type;
+        ble_uuid.uuid = BLE_UUID_CFGS_SERVICE;
+
+        // Add the service.
+        err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY,
+                                            &ble_uuid,
+                                            &p_cfgs->service_handle);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        return config_char_add(p_cfgs, p_cfgs_init);
+}
+
+
+uint16_t ble_cfgs_value_handle_get(ble_cfgs_t const * p_cfgs)
+{
+        return p_cfgs->config_handles.value_handle;
+}
@@ -0,0 +1,128 @@
+/** @file
+ *
+ * @defgroup ble_cfgs Configuration Service
+ * @{
+ * @brief Vendor-specific service holding a configuration blob written by the peer.
+ *
+ * @details The service has one Configuration characteristic of up to @ref BLE_CFGS_MAX_LEN
+ *          bytes. Values longer than the ATT payload are written with queued writes, which the
+ *          application handles with the nrf_ble_qwr module on the characteristic returned by
+ *          @ref ble_cfgs_value_handle_get. This module accepts single Write Requests itself.
+ *          The value lives in the service structure, so the application can read it directly.
+ *
+ * @note    The application must register this module as BLE event observer using the
+ *          @ref BLE_CFGS_DEF macro.
+ */
+#ifndef BLE_CFGS_H__
+#define BLE_CFGS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_CFGS_BLE_OBSERVER_PRIO
+#define BLE_CFGS_BLE_OBSERVER_PRIO 2
+#endif
+
+/**@brief   Macro for defining a ble_cfgs instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_CFGS_DEF(_name)                                                                         \
+static ble_cfgs_t _name;                                                                            \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_CFGS_BLE_OBSERVER_PRIO,                                                    \
+                     ble_cfgs_on_ble_evt, &_name)
+
+#define CFGS_BASE_UUID                 {{0x3C, 0x7A, 0x1E, 0x52, 0x94, 0x0B, 0x4D, 0x8F, \
+                                         0xA6, 0x21, 0x5D, 0xC0, 0x00, 0x00, 0x46, 0x43}}   /**< Used vendor-specific UUID. */
+
+#define BLE_UUID_CFGS_SERVICE          0x0001                       /**< The UUID of the Configuration Service. */
+#define BLE_UUID_CFGS_CONFIG_CHAR      0x0002                       /**< The UUID of the Configuration characteristic. */
+
+#define BLE_CFGS_MAX_LEN               512                          /**< Maximum length of the configuration blob, the longest attribute ATT allows. */
+
+/**@brief Configuration Service event types. */
+typedef enum
+{
+        BLE_CFGS_EVT_CONFIG_WRITTEN,                                    /**< Peer wrote the configuration with a single Write Request. */
+} ble_cfgs_evt_type_t;
+
+/**@brief Configuration Service event. */
+typedef struct
+{
+        ble_cfgs_evt_type_t evt_type;                                   /**< Type of event. */
+        uint16_t            conn_handle;                                /**< Connection handle of the link the event occurred on. */
+        uint16_t            len;                                        /**< Length of the value written. */
+} ble_cfgs_evt_t;
+
+// Forward declaration of the ble_cfgs_t type.
+typedef struct ble_cfgs_s ble_cfgs_t;
+
+/**@brief Configuration Service event handler type. */
+typedef void (*ble_cfgs_evt_handler_t) (ble_cfgs_t * p_cfgs, ble_cfgs_evt_t * p_evt);
+
+/**@brief Configuration Service init structure. This contains all options and data needed for
+ *        initialization of the service. */
+typedef struct
+{
+        ble_cfgs_evt_handler_t  evt_handler;                            /**< Event handler to be called for handling events in the Configuration Service. */
+        ble_gap_conn_sec_mode_t config_read_perm;                       /**< Initial security level for reading the Configuration characteristic. */
+        ble_gap_conn_sec_mode_t config_write_perm;                      /**< Initial security level for writing the Configuration characteristic. */
+} ble_cfgs_init_t;
+
+/**@brief Configuration Service structure. This contains various status information for the
+ *        service. */
+struct ble_cfgs_s
+{
+        ble_cfgs_evt_handler_t   evt_handler;                           /**< Event handler to be called for handling events in the Configuration Service. */
+        uint8_t                  uuid_type;                             /**< UUID type of the vendor-specific base UUID. */
+        uint16_t                 service_handle;                        /**< Handle of the Configuration Service (as provided by the BLE stack). */
+        ble_gatts_char_handles_t config_handles;                        /**< Handles related to the Configuration characteristic. */
+        uint8_t                  config[BLE_CFGS_MAX_LEN];              /**< Value of the Configuration characteristic, written by the SoftDevice. */
+};
+
+
+/**@brief Function for initializing the Configuration Service.
+ *
+ * @param[out] p_cfgs       Configuration Service structure. This structure will have to be
+ *                          supplied by the application. It will be initialized by this function,
+ *                          and will later be used to identify this particular service instance.
+ * @param[in]  p_cfgs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_cfgs_init(ble_cfgs_t * p_cfgs, ble_cfgs_init_t const * p_cfgs_init);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ * @param[in] p_context  Configuration Service structure.
+ */
+void ble_cfgs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Function for getting the handle to register with nrf_ble_qwr.
+ *
+ * @param[in] p_cfgs  Configuration Service structure.
+ *
+ * @return Value handle of the Configuration characteristic.
+ */
+uint16_t ble_cfgs_value_handle_get(ble_cfgs_t const * p_cfgs);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_CFGS_H__
+
+/** @} */
@@ -0,0 +1,366 @@
+/** @file
+ *
+ * @brief Heart Rate Log Service module.
+ */
+#include <string.h>
+#include "ble_hls.h"
+#include "ble_srv_common.h"
+
+
+/**@brief Function for checking whether the peer has enabled RACP indications.
+ *
+ * @param[in] p_hls        Heart Rate Log Service structure.
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static bool racp_indication_enabled(ble_hls_t * p_hls, uint16_t conn_handle)
+{
+        uint8_t           cccd_value[BLE_CCCD_VALUE_LEN];
+        ble_gatts_value_t gatts_value;
+
+        memset(&gatts_value, 0, sizeof(gatts_value));
+
+        gatts_value.len     = sizeof(cccd_value);
+        gatts_value.offset  = 0;
+        gatts_value.p_value = cccd_value;
+
+        if (sd_ble_gatts_value_get(conn_handle, p_hls->racp_handles.cccd_handle, &gatts_value) != NRF_SUCCESS)
+        {
+                return false;
+        }
+
+        return ble_srv_is_indication_enabled(cccd_value);
+}
+
+
+/**@brief Function for handling the Write event.
+ *
+ * @param[in] p_hls      Heart Rate Log Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_write(ble_hls_t * p_hls, ble_evt_t const * p_ble_evt)
+{
+        ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+        ble_hls_evt_t evt;
+
+        if ((p_hls->evt_handler == NULL) ||
+            (p_evt_write->handle != p_hls->data_handles.cccd_handle) ||
+            (p_evt_write->len != BLE_CCCD_VALUE_LEN))
+        {
+                return;
+        }
+
+        memset(&evt, 0, sizeof(evt));
+
+        evt.conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+
+        if (ble_srv_is_notification_enabled(p_evt_write->data))
+        {
+                evt.evt_type = BLE_HLS_EVT_NOTIFICATION_ENABLED;
+        }
+        else
+        {
+                evt.evt_type = BLE_HLS_EVT_NOTIFICATION_DISABLED;
+        }
+        p_hls->evt_handler(p_hls, &evt);
+}
+
+
+/**@brief Function for handling a write to the RACP.
+ *
+ * @details The write is rejected if the peer has not enabled RACP indications, as the response
+ *          could not be delivered.
+ *
+ * @param[in] p_hls      Heart Rate Log Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_hls_t * p_hls, ble_evt_t const * p_ble_evt)
+{
+        uint32_t err_code;
+        ble_gatts_evt_rw_authorize_request_t const * p_auth_req =
+                &p_ble_evt->evt.gatts_evt.params.authorize_request;
+        ble_gatts_rw_authorize_reply_params_t auth_reply;
+        uint16_t      conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+        ble_hls_evt_t evt;
+
+        if ((p_auth_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) ||
+            (p_auth_req->request.write.op != BLE_GATTS_OP_WRITE_REQ) ||
+            (p_auth_req->request.write.handle != p_hls->racp_handles.value_handle))
+        {
+                return;
+        }
+
+        memset(&auth_reply, 0, sizeof(auth_reply));
+
+        auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+        if (!racp_indication_enabled(p_hls, conn_handle))
+        {
+                auth_reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR;
+        }
+        else
+        {
+                auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+                auth_reply.params.write.update      = 1;
+                auth_reply.params.write.offset      = p_auth_req->request.write.offset;
+                auth_reply.params.write.len         = p_auth_req->request.write.len;
+                auth_reply.params.write.p_data      = p_auth_req->request.write.data;
+        }
+
+        err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &auth_reply);
+        if ((err_code != NRF_SUCCESS) ||
+            (auth_reply.params.write.gatt_status != BLE_GATT_STATUS_SUCCESS) ||
+            (p_hls->evt_handler == NULL))
+        {
+                return;
+        }
+
+        memset(&evt, 0, sizeof(evt));
+
+        evt.evt_type    = BLE_HLS_EVT_RACP_REQUEST;
+        evt.conn_handle = conn_handle;
+        ble_racp_decode(p_auth_req->request.write.len, p_auth_req->request.write.data, &evt.racp);
+
+        p_hls->evt_handler(p_hls, &evt);
+}
+
+
+void ble_hls_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+        ble_hls_t * p_hls = (ble_hls_t *)p_context;
+
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_GATTS_EVT_WRITE:
+                on_write(p_hls, p_ble_evt);
+                break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+                on_rw_authorize_request(p_hls, p_ble_evt);
+                break;
+
+        default:
+                // No implementation needed.
+                break;
+        }
+}
+
+
+/**@brief Function for adding the Log Data characteristic.
+ *
+ * @param[in] p_hls       Heart Rate Log Service structure.
+ * @param[in] p_hls_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t data_char_add(ble_hls_t * p_hls, ble_hls_init_t const * p_hls_init)
+{
+        ble_gatts_char_md_t char_md;
+        ble_gatts_attr_md_t cccd_md;
+        ble_gatts_attr_t    attr_char_value;
+        ble_uuid_t          ble_uuid;
+        ble_gatts_attr_md_t attr_md;
+
+        memset(&cccd_md, 0, sizeof(cccd_md));
+
+        cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+        cccd_md.read_perm  = p_hls_init->hls_data_attr_md.read_perm;
+        cccd_md.write_perm = p_hls_init->hls_data_attr_md.cccd_write_perm;
+
+        memset(&char_md, 0, sizeof(char_md));
+
+        char_md.char_props.notify = 1;
+        char_md.p_char_user_desc  = NULL;
+        char_md.p_char_pf         = NULL;
+        char_md.p_user_desc_md    = NULL;
+        char_md.p_cccd_md         = &cccd_md;
+        char_md.p_sccd_md         = NULL;
+
+        ble_uuid.type = p_hls->uuid_type;
+        ble_uuid.uuid = BLE_UUID_HLS_DATA_CHAR;
+
+        memset(&attr_md, 0, sizeof(attr_md));
+
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+        attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+        attr_md.rd_auth = 0;
+        attr_md.wr_auth = 0;
+        attr_md.vlen    = 1;
+
+        memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+        attr_char_value.p_uuid    = &ble_uuid;
+        attr_char_value.p_attr_md = &attr_md;
+        attr_char_value.init_len  = 0;
+        attr_char_value.init_offs = 0;
+        attr_char_value.max_len   = BLE_HLS_MAX_DATA_LEN;
+
+        return sd_ble_gatts_characteristic_add(p_hls->service_handle,
+                                               &char_md,
+                                               &attr_char_value,
+                                               &p_hls->data_handles);
+}
+
+
+/**@brief Function for adding the Record Access Control Point characteristic.
+ *
+ * @param[in] p_hls       Heart Rate Log Service structure.
+ * @param[in] p_hls_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t racp_char_add(ble_hls_t * p_hls, ble_hls_init_t const * p_hls_init)
+{
+        ble_gatts_char_md_t char_md;
+        ble_gatts_attr_md_t cccd_md;
+        ble_gatts_attr_t    attr_char_value;
+        ble_uuid_t          ble_uuid;
+        ble_gatts_attr_md_t attr_md;
+
+        memset(&cccd_md, 0, sizeof(cccd_md));
+
+        cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+        cccd_md.read_perm  = p_hls_init->hls_racp_attr_md.read_perm;
+        cccd_md.write_perm = p_hls_init->hls_racp_attr_md.cccd_write_perm;
+
+        memset(&char_md, 0, sizeof(char_md));
+
+        char_md.char_props.indicate = 1;
+        char_md.char_props.write    = 1;
+        char_md.p_char_user_desc    = NULL;
+        char_md.p_char_pf           = NULL;
+        char_md.p_user_desc_md      = NULL;
+        char_md.p_cccd_md           = &cccd_md;
+        char_md.p_sccd_md           = NULL;
+
+        BLE_UUID_BLE_ASSIGN(ble_uuid, BLE_UUID_RECORD_ACCESS_CONTROL_POINT_CHAR);
+
+        memset(&attr_md, 0, sizeof(attr_md));
+
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+        attr_md.write_perm = p_hls_init->hls_racp_attr_md.write_perm;
+
+        attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+        attr_md.rd_auth = 0;
+        attr_md.wr_auth = 1;
+        attr_md.vlen    = 1;
+
+        memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+        attr_char_value.p_uuid    = &ble_uuid;
+        attr_char_value.p_attr_md = &attr_md;
+        attr_char_value.init_len  = 0;
+        attr_char_value.init_offs = 0;
+        attr_char_value.max_len   = BLE_HLS_RACP_MAX_LEN;
+
+        return sd_ble_gatts_characteristic_add(p_hls->service_handle,
+                                               &char_md,
+                                               &attr_char_value,
+                                               &p_hls->racp_handles);
+}
+
+
+uint32_t ble_hls_init(ble_hls_t * p_hls, ble_hls_init_t const * p_hls_init)
+{
+        uint32_t      err_code;
+        ble_uuid_t    ble_uuid;
+        ble_uuid128_t hls_base_uuid = HLS_BASE_UUID;
+
+        if ((p_hls == NULL) || (p_hls_init == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        // Initialize the service structure.
+        p_hls->evt_handler = p_hls_init->evt_handler;
+
+        // Add a custom base UUID.
+        err_code = sd_ble_uuid_vs_add(&hls_base_uuid, &p_hls->uuid_type);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        ble_uuid.type = p_hls->uuid_type;
+        ble_uuid.uuid = BLE_UUID_HLS_SERVICE;
+
+        // Add the service.
+        err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY,
+                                            &ble_uuid,
+                                            &p_hls->service_handle);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        // Add the characteristics.
+        err_code = data_char_add(p_hls, p_hls_init);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        return racp_char_add(p_hls, p_hls_init);
+}
+
+
+uint32_t ble_hls_data_send(ble_hls_t     * p_hls,
+                           uint16_t        conn_handle,
+                           uint8_t const * p_data,
+                           uint16_t        len)
+{
+        ble_gatts_hvx_params_t hvx_params;
+
+        if ((p_hls == NULL) || (p_data == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        if (len > BLE_HLS_MAX_DATA_LEN)
+        {
+                return NRF_ERROR_INVALID_PARAM;
+        }
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_hls->data_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_data;
+
+        return sd_ble_gatts_hvx(conn_handle, &hvx_params);
+}
+
+
+uint32_t ble_hls_racp_response_send(ble_hls_t              * p_hls,
+                                    uint16_t                 conn_handle,
+                                    ble_racp_value_t const * p_racp)
+{
+        ble_gatts_hvx_params_t hvx_params;
+        uint8_t                encoded[BLE_HLS_RACP_MAX_LEN];
+        uint16_t               len;
+
+        if ((p_hls == NULL) || (p_racp == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        if (p_racp->operand_len > BLE_HLS_RACP_MAX_LEN - 2)
+        {
+                return NRF_ERROR_INVALID_PARAM;
+        }
+
+        len = ble_racp_encode(p_racp, encoded);
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_hls->racp_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_INDICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = encoded;
+
+        return sd_ble_gatts_hvx(conn_handle, &hvx_params);
+}
@@ -0,0 +1,156 @@
+/** @file
+ *
+ * @defgroup ble_hls Heart Rate Log Service
+ * @{
+ * @brief Vendor-specific service giving access to the heart rate history log.
+ *
+ * @details The service has a Log Data characteristic, which carries batches of logged samples
+ *          in notifications, and a Record Access Control Point (RACP) characteristic, through
+ *          which the peer requests, counts and deletes logged samples. The service checks that
+ *          RACP indications are enabled and decodes the requests. Carrying them out is up to the
+ *          application, which gets them through @ref ble_hls_evt_handler_t.
+ *
+ * @note    The application must register this module as BLE event observer using the
+ *          @ref BLE_HLS_DEF macro.
+ */
+#ifndef BLE_HLS_H__
+#define BLE_HLS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "ble_racp.h"
+#include "nrf_sdh_ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_HLS_BLE_OBSERVER_PRIO
+#define BLE_HLS_BLE_OBSERVER_PRIO 2
+#endif
+
+/**@brief   Macro for defining a ble_hls instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_HLS_DEF(_name)                                                                          \
+static ble_hls_t _name;                                                                             \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_HLS_BLE_OBSERVER_PRIO,                                                     \
+                     ble_hls_on_ble_evt, &_name)
+
+#define HLS_BASE_UUID                  {{0x3C, 0x7A, 0x1E, 0x52, 0x94, 0x0B, 0x4D, 0x8F, \
+                                         0xA6, 0x21, 0x5D, 0xC0, 0x00, 0x00, 0x4C, 0x48}}   /**< Used vendor-specific UUID. */
+
+#define BLE_UUID_HLS_SERVICE           0x0001                       /**< The UUID of the Heart Rate Log Service. */
+#define BLE_UUID_HLS_DATA_CHAR         0x0002                       /**< The UUID of the Log Data characteristic. */
+
+#define BLE_HLS_RACP_FILTER_SEQ        0x01                         /**< RACP operand filter type: 32-bit sample sequence number. */
+#define BLE_HLS_RACP_MAX_LEN           20                           /**< Maximum length of an RACP value. */
+#define BLE_HLS_MAX_DATA_LEN           (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)   /**< Maximum length of a Log Data notification. */
+
+/**@brief Heart Rate Log Service event types. */
+typedef enum
+{
+        BLE_HLS_EVT_NOTIFICATION_ENABLED,                               /**< Log Data notifications enabled. */
+        BLE_HLS_EVT_NOTIFICATION_DISABLED,                              /**< Log Data notifications disabled. */
+        BLE_HLS_EVT_RACP_REQUEST,                                       /**< Peer wrote a request to the RACP. */
+} ble_hls_evt_type_t;
+
+/**@brief Heart Rate Log Service event. */
+typedef struct
+{
+        ble_hls_evt_type_t evt_type;                                    /**< Type of event. */
+        uint16_t           conn_handle;                                 /**< Connection handle of the link the event occurred on. */
+        ble_racp_value_t   racp;                                        /**< Decoded request. Only valid for @ref BLE_HLS_EVT_RACP_REQUEST, and only during the event. */
+} ble_hls_evt_t;
+
+// Forward declaration of the ble_hls_t type.
+typedef struct ble_hls_s ble_hls_t;
+
+/**@brief Heart Rate Log Service event handler type. */
+typedef void (*ble_hls_evt_handler_t) (ble_hls_t * p_hls, ble_hls_evt_t * p_evt);
+
+/**@brief Heart Rate Log Service init structure. This contains all options and data needed for
+ *        initialization of the service. */
+typedef struct
+{
+        ble_hls_evt_handler_t        evt_handler;                       /**< Event handler to be called for handling events in the Heart Rate Log Service. */
+        ble_srv_cccd_security_mode_t hls_data_attr_md;                  /**< Initial security level for the Log Data characteristic CCCD. */
+        ble_srv_cccd_security_mode_t hls_racp_attr_md;                  /**< Initial security level for the RACP characteristic. */
+} ble_hls_init_t;
+
+/**@brief Heart Rate Log Service structure. This contains various status information for the
+ *        service. */
+struct ble_hls_s
+{
+        ble_hls_evt_handler_t    evt_handler;                           /**< Event handler to be called for handling events in the Heart Rate Log Service. */
+        uint8_t                  uuid_type;                             /**< UUID type of the vendor-specific base UUID. */
+        uint16_t                 service_handle;                        /**< Handle of the Heart Rate Log Service (as provided by the BLE stack). */
+        ble_gatts_char_handles_t data_handles;                          /**< Handles related to the Log Data characteristic. */
+        ble_gatts_char_handles_t racp_handles;                          /**< Handles related to the RACP characteristic. */
+};
+
+
+/**@brief Function for initializing the Heart Rate Log Service.
+ *
+ * @param[out] p_hls       Heart Rate Log Service structure. This structure will have to be
+ *                         supplied by the application. It will be initialized by this function,
+ *                         and will later be used to identify this particular service instance.
+ * @param[in]  p_hls_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_hls_init(ble_hls_t * p_hls, ble_hls_init_t const * p_hls_init);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ * @param[in] p_context  Heart Rate Log Service structure.
+ */
+void ble_hls_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Function for sending a batch of logged samples.
+ *
+ * @details The data is sent as one notification of the Log Data characteristic. It is up to the
+ *          application to keep @p len within the ATT payload of the link and to retry when the
+ *          SoftDevice has no free TX slot.
+ *
+ * @param[in] p_hls        Heart Rate Log Service structure.
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] p_data       Encoded samples.
+ * @param[in] len          Length of the encoded samples.
+ *
+ * @return NRF_SUCCESS on success, otherwise the error code of @ref sd_ble_gatts_hvx.
+ */
+uint32_t ble_hls_data_send(ble_hls_t     * p_hls,
+                           uint16_t        conn_handle,
+                           uint8_t const * p_data,
+                           uint16_t        len);
+
+
+/**@brief Function for indicating an RACP response.
+ *
+ * @param[in] p_hls        Heart Rate Log Service structure.
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] p_racp       Response.
+ *
+ * @return NRF_SUCCESS on success, otherwise the error code of @ref sd_ble_gatts_hvx.
+ */
+uint32_t ble_hls_racp_response_send(ble_hls_t              * p_hls,
+                                    uint16_t                 conn_handle,
+                                    ble_racp_value_t const * p_racp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_HLS_H__
+
+/** @} */
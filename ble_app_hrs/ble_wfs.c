@@ -0,0 +1,258 @@
+/** @file
+ *
+ * @brief Waveform Streaming Service module.
+ */
+#include <string.h>
+#include "ble_wfs.h"
+#include "ble_srv_common.h"
+
+
+/**@brief Function for handling the Write event.
+ *
+ * @param[in] p_wfs      Waveform Streaming Service structure.
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+static void on_write(ble_wfs_t * p_wfs, ble_evt_t const * p_ble_evt)
+{
+        ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+        ble_wfs_evt_t evt;
+
+        if (p_wfs->evt_handler == NULL)
+        {
+                return;
+        }
+
+        evt.conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+        evt.compressed  = false;
+
+        if ((p_evt_write->handle == p_wfs->data_handles.cccd_handle) &&
+            (p_evt_write->len == BLE_CCCD_VALUE_LEN))
+        {
+                if (ble_srv_is_notification_enabled(p_evt_write->data))
+                {
+                        evt.evt_type = BLE_WFS_EVT_NOTIFICATION_ENABLED;
+                }
+                else
+                {
+                        evt.evt_type = BLE_WFS_EVT_NOTIFICATION_DISABLED;
+                }
+                p_wfs->evt_handler(p_wfs, &evt);
+        }
+        else if ((p_evt_write->handle == p_wfs->ctrl_pt_handles.value_handle) &&
+                 (p_evt_write->len == 1))
+        {
+                if ((p_evt_write->data[0] == BLE_WFS_CTRL_PT_START) ||
+                    (p_evt_write->data[0] == BLE_WFS_CTRL_PT_START_CODED))
+                {
+                        evt.evt_type   = BLE_WFS_EVT_STREAM_START;
+                        evt.compressed = (p_evt_write->data[0] == BLE_WFS_CTRL_PT_START_CODED);
+                        p_wfs->evt_handler(p_wfs, &evt);
+                }
+                else if (p_evt_write->data[0] == BLE_WFS_CTRL_PT_STOP)
+                {
+                        evt.evt_type = BLE_WFS_EVT_STREAM_STOP;
+                        p_wfs->evt_handler(p_wfs, &evt);
+                }
+        }
+}
+
+
+void ble_wfs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+        ble_wfs_t * p_wfs = (ble_wfs_t *)p_context;
+
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_GATTS_EVT_WRITE:
+                on_write(p_wfs, p_ble_evt);
+                break;
+
+        default:
+                // No implementation needed.
+                break;
+        }
+}
+
+
+/**@brief Function for adding the Waveform Data characteristic.
+ *
+ * @param[in] p_wfs       Waveform Streaming Service structure.
+ * @param[in] p_wfs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t data_char_add(ble_wfs_t * p_wfs, ble_wfs_init_t const * p_wfs_init)
+{
+        ble_gatts_char_md_t char_md;
+        ble_gatts_attr_md_t cccd_md;
+        ble_gatts_attr_t    attr_char_value;
+        ble_uuid_t          ble_uuid;
+        ble_gatts_attr_md_t attr_md;
+
+        memset(&cccd_md, 0, sizeof(cccd_md));
+
+        cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+        cccd_md.read_perm  = p_wfs_init->wfs_data_attr_md.read_perm;
+        cccd_md.write_perm = p_wfs_init->wfs_data_attr_md.cccd_write_perm;
+
+        memset(&char_md, 0, sizeof(char_md));
+
+        char_md.char_props.notify = 1;
+        char_md.p_char_user_desc  = NULL;
+        char_md.p_char_pf         = NULL;
+        char_md.p_user_desc_md    = NULL;
+        char_md.p_cccd_md         = &cccd_md;
+        char_md.p_sccd_md         = NULL;
+
+        ble_uuid.type = p_wfs->uuid_type;
+        ble_uuid.uuid = BLE_UUID_WFS_DATA_CHAR;
+
+        memset(&attr_md, 0, sizeof(attr_md));
+
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+
+        attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+        attr_md.rd_auth = 0;
+        attr_md.wr_auth = 0;
+        attr_md.vlen    = 1;
+
+        memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+        attr_char_value.p_uuid    = &ble_uuid;
+        attr_char_value.p_attr_md = &attr_md;
+        attr_char_value.init_len  = 0;
+        attr_char_value.init_offs = 0;
+        attr_char_value.max_len   = BLE_WFS_MAX_DATA_LEN;
+
+        return sd_ble_gatts_characteristic_add(p_wfs->service_handle,
+                                               &char_md,
+                                               &attr_char_value,
+                                               &p_wfs->data_handles);
+}
+
+
+/**@brief Function for adding the Waveform Control Point characteristic.
+ *
+ * @param[in] p_wfs       Waveform Streaming Service structure.
+ * @param[in] p_wfs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t ctrl_pt_char_add(ble_wfs_t * p_wfs, ble_wfs_init_t const * p_wfs_init)
+{
+        ble_gatts_char_md_t char_md;
+        ble_gatts_attr_t    attr_char_value;
+        ble_uuid_t          ble_uuid;
+        ble_gatts_attr_md_t attr_md;
+        uint8_t             initial_value = BLE_WFS_CTRL_PT_STOP;
+
+        memset(&char_md, 0, sizeof(char_md));
+
+        char_md.char_props.write = 1;
+        char_md.p_char_user_desc = NULL;
+        char_md.p_char_pf        = NULL;
+        char_md.p_user_desc_md   = NULL;
+        char_md.p_cccd_md        = NULL;
+        char_md.p_sccd_md        = NULL;
+
+        ble_uuid.type = p_wfs->uuid_type;
+        ble_uuid.uuid = BLE_UUID_WFS_CTRL_PT_CHAR;
+
+        memset(&attr_md, 0, sizeof(attr_md));
+
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+        attr_md.write_perm = p_wfs_init->wfs_ctrl_pt_write_perm;
+
+        attr_md.vloc    = BLE_GATTS_VLOC_STACK;
+        attr_md.rd_auth = 0;
+        attr_md.wr_auth = 0;
+        attr_md.vlen    = 0;
+
+        memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+        attr_char_value.p_uuid    = &ble_uuid;
+        attr_char_value.p_attr_md = &attr_md;
+        attr_char_value.init_len  = sizeof(initial_value);
+        attr_char_value.init_offs = 0;
+        attr_char_value.max_len   = sizeof(initial_value);
+        attr_char_value.p_value   = &initial_value;
+
+        return sd_ble_gatts_characteristic_add(p_wfs->service_handle,
+                                               &char_md,
+                                               &attr_char_value,
+                                               &p_wfs->ctrl_pt_handles);
+}
+
+
+uint32_t ble_wfs_init(ble_wfs_t * p_wfs, ble_wfs_init_t const * p_wfs_init)
+{
+        uint32_t      err_code;
+        ble_uuid_t    ble_uuid;
+        ble_uuid128_t wfs_base_uuid = WFS_BASE_UUID;
+
+        if ((p_wfs == NULL) || (p_wfs_init == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        // Initialize the service structure.
+        p_wfs->evt_handler = p_wfs_init->evt_handler;
+
+        // Add a custom base UUID.
+        err_code = sd_ble_uuid_vs_add(&wfs_base_uuid, &p_wfs->uuid_type);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        ble_uuid.type = p_wfs->uuid_type;
+        ble_uuid.uuid = BLE_UUID_WFS_SERVICE;
+
+        // Add the service.
+        err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY,
+                                            &ble_uuid,
+                                            &p_wfs->service_handle);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        // Add the characteristics.
+        err_code = data_char_add(p_wfs, p_wfs_init);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        return ctrl_pt_char_add(p_wfs, p_wfs_init);
+}
+
+
+uint32_t ble_wfs_data_send(ble_wfs_t     * p_wfs,
+                           uint16_t        conn_handle,
+                           uint8_t const * p_data,
+                           uint16_t        len)
+{
+        ble_gatts_hvx_params_t hvx_params;
+
+        if ((p_wfs == NULL) || (p_data == NULL))
+        {
+                return NRF_ERROR_NULL;
+        }
+
+        if (len > BLE_WFS_MAX_DATA_LEN)
+        {
+                return NRF_ERROR_INVALID_PARAM;
+        }
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_wfs->data_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_data;
+
+        return sd_ble_gatts_hvx(conn_handle, &hvx_params);
+}
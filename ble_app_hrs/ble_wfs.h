@@ -0,0 +1,146 @@
+/** @file
+ *
+ * @defgroup ble_wfs Waveform Streaming Service
+ * @{
+ * @brief Vendor-specific service streaming raw PPG/ECG samples.
+ *
+ * @details The service has a Waveform Data characteristic, which carries batches of raw samples
+ *          in notifications, and a Waveform Control Point characteristic, which the peer writes
+ *          to start and stop the stream. The application decides when data is sent, so it can
+ *          apply its own flow control. The service only reports the peer requests through
+ *          @ref ble_wfs_evt_handler_t.
+ *
+ * @note    The application must register this module as BLE event observer using the
+ *          @ref BLE_WFS_DEF macro.
+ */
+#ifndef BLE_WFS_H__
+#define BLE_WFS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLE_WFS_BLE_OBSERVER_PRIO
+#define BLE_WFS_BLE_OBSERVER_PRIO 2
+#endif
+
+/**@brief   Macro for defining a ble_wfs instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_WFS_DEF(_name)                                                                          \
+static ble_wfs_t _name;                                                                             \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_WFS_BLE_OBSERVER_PRIO,                                                     \
+                     ble_wfs_on_ble_evt, &_name)
+
+#define WFS_BASE_UUID                  {{0x3C, 0x7A, 0x1E, 0x52, 0x94, 0x0B, 0x4D, 0x8F, \
+                                         0xA6, 0x21, 0x5D, 0xC0, 0x00, 0x00, 0x4E, 0x57}}   /**< Used vendor-specific UUID. */
+
+#define BLE_UUID_WFS_SERVICE           0x0001                       /**< The UUID of the Waveform Streaming Service. */
+#define BLE_UUID_WFS_DATA_CHAR         0x0002                       /**< The UUID of the Waveform Data characteristic. */
+#define BLE_UUID_WFS_CTRL_PT_CHAR      0x0003                       /**< The UUID of the Waveform Control Point characteristic. */
+
+#define BLE_WFS_CTRL_PT_STOP           0x00                         /**< Control Point value stopping the stream. */
+#define BLE_WFS_CTRL_PT_START          0x01                         /**< Control Point value starting the stream of raw 16-bit samples. */
+#define BLE_WFS_CTRL_PT_START_CODED    0x02                         /**< Control Point value starting the stream of delta/varint coded samples, see @ref sample_codec. */
+
+#define BLE_WFS_MAX_DATA_LEN           (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)   /**< Maximum length of a Waveform Data notification. */
+
+/**@brief Waveform Streaming Service event types. */
+typedef enum
+{
+        BLE_WFS_EVT_NOTIFICATION_ENABLED,                               /**< Waveform Data notifications enabled. */
+        BLE_WFS_EVT_NOTIFICATION_DISABLED,                              /**< Waveform Data notifications disabled. */
+        BLE_WFS_EVT_STREAM_START,                                       /**< Peer requested the stream to start. */
+        BLE_WFS_EVT_STREAM_STOP,                                        /**< Peer requested the stream to stop. */
+} ble_wfs_evt_type_t;
+
+/**@brief Waveform Streaming Service event. */
+typedef struct
+{
+        ble_wfs_evt_type_t evt_type;                                    /**< Type of event. */
+        uint16_t           conn_handle;                                 /**< Connection handle of the link the event occurred on. */
+        bool               compressed;                                  /**< Whether the peer requested coded samples. Only valid for @ref BLE_WFS_EVT_STREAM_START. */
+} ble_wfs_evt_t;
+
+// Forward declaration of the ble_wfs_t type.
+typedef struct ble_wfs_s ble_wfs_t;
+
+/**@brief Waveform Streaming Service event handler type. */
+typedef void (*ble_wfs_evt_handler_t) (ble_wfs_t * p_wfs, ble_wfs_evt_t * p_evt);
+
+/**@brief Waveform Streaming Service init structure. This contains all options and data needed for
+ *        initialization of the service. */
+typedef struct
+{
+        ble_wfs_evt_handler_t        evt_handler;                       /**< Event handler to be called for handling events in the Waveform Streaming Service. */
+        ble_srv_cccd_security_mode_t wfs_data_attr_md;                  /**< Initial security level for the Waveform Data characteristic CCCD. */
+        ble_gap_conn_sec_mode_t      wfs_ctrl_pt_write_perm;            /**< Initial security level for the Waveform Control Point characteristic. */
+} ble_wfs_init_t;
+
+/**@brief Waveform Streaming Service structure. This contains various status information for the
+ *        service. */
+struct ble_wfs_s
+{
+        ble_wfs_evt_handler_t    evt_handler;                           /**< Event handler to be called for handling events in the Waveform Streaming Service. */
+        uint8_t                  uuid_type;                             /**< UUID type of the vendor-specific base UUID. */
+        uint16_t                 service_handle;                        /**< Handle of the Waveform Streaming Service (as provided by the BLE stack). */
+        ble_gatts_char_handles_t data_handles;                          /**< Handles related to the Waveform Data characteristic. */
+        ble_gatts_char_handles_t ctrl_pt_handles;                       /**< Handles related to the Waveform Control Point characteristic. */
+};
+
+
+/**@brief Function for initializing the Waveform Streaming Service.
+ *
+ * @param[out] p_wfs       Waveform Streaming Service structure. This structure will have to be
+ *                         supplied by the application. It will be initialized by this function,
+ *                         and will later be used to identify this particular service instance.
+ * @param[in]  p_wfs_init  Information needed to initialize the service.
+ *
+ * @return NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_wfs_init(ble_wfs_t * p_wfs, ble_wfs_init_t const * p_wfs_init);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ * @param[in] p_context  Waveform Streaming Service structure.
+ */
+void ble_wfs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+/**@brief Function for sending a batch of waveform samples.
+ *
+ * @details The data is sent as one notification of the Waveform Data characteristic. It is up to
+ *          the application to keep @p len within the ATT payload of the link and to retry when
+ *          the SoftDevice has no free TX slot.
+ *
+ * @param[in] p_wfs        Waveform Streaming Service structure.
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] p_data       Encoded samples.
+ * @param[in] len          Length of the encoded samples.
+ *
+ * @return NRF_SUCCESS on success, otherwise the error code of @ref sd_ble_gatts_hvx.
+ */
+uint32_t ble_wfs_data_send(ble_wfs_t     * p_wfs,
+                           uint16_t        conn_handle,
+                           uint8_t const * p_data,
+                           uint16_t        len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_WFS_H__
+
+/** @} */
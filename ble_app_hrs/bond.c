@@ -0,0 +1,140 @@
+/** @file
+ *
+ * @brief Bond management module.
+ */
+#include "bond.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
+static bond_enc_stats_t m_enc_stats;                                /**< Connect to encrypted statistics. */
+#if BOND_EARLY_SEC_REQ_ENABLED && BOND_EARLY_SEC_REQ_AB
+static uint32_t         m_sec_req_call_cnt;                         /**< Number of calls to @ref bond_sec_request, to alternate the request. */
+#endif
+
+
+ret_code_t bond_on_bonded(pm_peer_id_t peer_id)
+{
+        ret_code_t err_code;
+        uint32_t   n_peer = pm_peer_count();
+
+#if BOND_SINGLE_HOST
+        pm_peer_id_t other = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+
+        while (other != PM_PEER_ID_INVALID)
+        {
+                if (other != peer_id)
+                {
+                        err_code = pm_peer_delete(other);
+                        if (err_code != NRF_SUCCESS)
+                        {
+                                return err_code;
+                        }
+                }
+                other = pm_next_peer_id_get(other);
+        }
+        UNUSED_VARIABLE(n_peer);
+#else
+        err_code = pm_peer_rank_highest(peer_id);
+        if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_BUSY) && (err_code != NRF_ERROR_STORAGE_FULL))
+        {
+                return err_code;
+        }
+
+        // Make room by deleting the least recently used bonds.
+        for (uint32_t i = whitelist_rank_count(); (n_peer > BOND_MAX_PEERS) && (i > 0); i--)
+        {
+                pm_peer_id_t lru = whitelist_rank_get(i - 1);
+
+                if (lru != peer_id)
+                {
+                        err_code = pm_peer_delete(lru);
+                        if (err_code != NRF_SUCCESS)
+                        {
+                                return err_code;
+                        }
+                        n_peer--;
+                }
+        }
+#endif
+
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t bond_sec_request(conn_ctx_t * p_ctx)
+{
+#if BOND_EARLY_SEC_REQ_ENABLED
+        ret_code_t err_code;
+
+#if BOND_EARLY_SEC_REQ_AB
+        if ((m_sec_req_call_cnt++ & 1) != 0)
+        {
+                p_ctx->enc_mode = BOND_ENC_HOST;
+                return NRF_SUCCESS;
+        }
+#endif
+
+        p_ctx->enc_mode = BOND_ENC_EARLY;
+
+        err_code = pm_conn_secure(p_ctx->conn_handle, false);
+        if ((err_code == NRF_ERROR_BUSY) || (err_code == NRF_ERROR_INVALID_STATE))
+        {
+                return NRF_SUCCESS;
+        }
+        return err_code;
+#else
+        p_ctx->enc_mode = BOND_ENC_HOST;
+        return NRF_SUCCESS;
+#endif
+}
+
+
+bool bond_on_encrypted(conn_ctx_t * p_ctx, uint32_t * p_enc_ms)
+{
+        uint32_t          enc_ms;
+        bond_enc_time_t * p_time = (p_ctx->enc_mode == BOND_ENC_EARLY) ? &m_enc_stats.early : &m_enc_stats.host;
+
+        if (p_ctx->encrypted)
+        {
+                return false;
+        }
+
+        enc_ms = TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->connected_ticks));
+
+        p_ctx->encrypted = true;
+        p_time->enc_cnt++;
+        p_time->enc_sum_ms += enc_ms;
+        p_time->enc_max_ms  = MAX(p_time->enc_max_ms, enc_ms);
+
+        *p_enc_ms = enc_ms;
+        return true;
+}
+
+
+bool bond_on_disconnected(conn_ctx_t const * p_ctx)
+{
+        if (p_ctx->encrypted || (p_ctx->enc_mode == BOND_ENC_NONE))
+        {
+                return false;
+        }
+
+        if (p_ctx->enc_mode == BOND_ENC_EARLY)
+        {
+                m_enc_stats.early.clear_cnt++;
+        }
+        else
+        {
+                m_enc_stats.host.clear_cnt++;
+        }
+
+        return true;
+}
+
+
+void bond_enc_stats_get(bond_enc_stats_t * p_stats)
+{
+        *p_stats = m_enc_stats;
+}
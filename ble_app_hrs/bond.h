@@ -0,0 +1,121 @@
+/** @file
+ *
+ * @defgroup bond Bond management
+ * @{
+ * @brief Bonds kept when a host bonds, and encryption of the links of bonded hosts.
+ *
+ * @details By default every bond is kept, up to @ref BOND_MAX_PEERS. The new host is ranked as
+ *          the most recently used, and the least recently used bonds make room for it. Bonded
+ *          hosts are asked to encrypt as soon as they connect, and the time from connect to
+ *          encrypted is measured.
+ *
+ *          No attribute of the application needs encryption, so a bonded host that is not asked
+ *          encrypts only if its own stack does. The statistics keep the links sent the early
+ *          Security Request apart from the links left to the host, and count the links of bonded
+ *          hosts that were closed before they were encrypted. With @ref BOND_EARLY_SEC_REQ_AB
+ *          both kinds are measured in one run.
+ *
+ *          The ranking is the one of the @ref whitelist module.
+ */
+#ifndef BOND_H__
+#define BOND_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "peer_manager.h"
+#include "conn_ctx.h"
+#include "whitelist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOND_SINGLE_HOST               0                            /**< Set to 1 to delete the other bonds when a host bonds, so that only the newest host stays bonded. */
+#define BOND_EARLY_SEC_REQ_ENABLED     1                            /**< Set to 0 to leave encrypting to the host, to compare the connect to encrypted latency without the early Security Request. */
+#ifndef BOND_EARLY_SEC_REQ_AB
+#define BOND_EARLY_SEC_REQ_AB          0                            /**< Set to 1 to send the early Security Request on every other connection of a bonded host only, to compare both in one run. Needs BOND_EARLY_SEC_REQ_ENABLED. */
+#endif
+#define BOND_MAX_PEERS                 WHITELIST_RANK_MAX_PEERS     /**< Most bonded hosts kept. The least recently used bond is deleted beyond. */
+
+/**@brief Time from connect to encrypted of the links of one kind. */
+typedef struct
+{
+        uint32_t enc_cnt;                                           /**< Number of links encrypted. */
+        uint32_t enc_sum_ms;                                        /**< Sum of the times from connect to encrypted (in ms). */
+        uint32_t enc_max_ms;                                        /**< Longest time from connect to encrypted (in ms). */
+        uint32_t clear_cnt;                                         /**< Number of links of bonded hosts closed before they were encrypted. */
+} bond_enc_time_t;
+
+/**@brief Connect to encrypted statistics. */
+typedef struct
+{
+        bond_enc_time_t early;                                      /**< Links sent the early Security Request. */
+        bond_enc_time_t host;                                       /**< Links left to the host. */
+} bond_enc_stats_t;
+
+
+/**@brief Function for handling a new bond, from the main loop.
+ *
+ * @details With @ref BOND_SINGLE_HOST the other bonds are deleted. Otherwise the new host is
+ *          ranked as the most recently used, also across resets, and the least recently used
+ *          bonds beyond @ref BOND_MAX_PEERS are deleted. A rank the Peer Manager could not store
+ *          is only kept until the next reset.
+ *
+ * @param[in] peer_id  Peer of the host that bonded.
+ *
+ * @retval NRF_SUCCESS  If the bonds were handled.
+ * @return Otherwise the error code of the Peer Manager.
+ */
+ret_code_t bond_on_bonded(pm_peer_id_t peer_id);
+
+
+/**@brief Function for asking a bonded host to encrypt as soon as it connects.
+ *
+ * @details The Peer Manager recognises a bonded host at connect, resolving its private address
+ *          if needed. A host that has a bond encrypts the link when it receives a Security
+ *          Request, instead of waiting until an attribute needs it. The request is only sent
+ *          with @ref BOND_EARLY_SEC_REQ_ENABLED, and with @ref BOND_EARLY_SEC_REQ_AB only on
+ *          every other call. The link is marked for the statistics either way.
+ *
+ * @param[in] p_ctx  Context of the new link.
+ *
+ * @retval NRF_SUCCESS  If the request was sent or left out, or a procedure is already ongoing.
+ * @return Otherwise the error code of the Peer Manager.
+ */
+ret_code_t bond_sec_request(conn_ctx_t * p_ctx);
+
+
+/**@brief Function for measuring the time from connect to encrypted.
+ *
+ * @param[in]  p_ctx     Context of the link.
+ * @param[out] p_enc_ms  Time from connect to encrypted (in ms).
+ *
+ * @return true if the link was encrypted for the first time, false if it had been measured.
+ */
+bool bond_on_encrypted(conn_ctx_t * p_ctx, uint32_t * p_enc_ms);
+
+
+/**@brief Function for counting a link of a bonded host that is closed before it was encrypted.
+ *
+ * @param[in] p_ctx  Context of the link.
+ *
+ * @return true if the link was counted, false if it was encrypted or not of a bonded host.
+ */
+bool bond_on_disconnected(conn_ctx_t const * p_ctx);
+
+
+/**@brief Function for getting the connect to encrypted statistics.
+ *
+ * @param[out] p_stats  Statistics.
+ */
+void bond_enc_stats_get(bond_enc_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOND_H__
+
+/** @} */
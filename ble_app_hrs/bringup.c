@@ -0,0 +1,150 @@
+/** @file
+ *
+ * @brief Connect-time bring-up module.
+ */
+#include <string.h>
+#include "bringup.h"
+#include "hrm_tx_queue.h"
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
+/**@brief Function for starting the current bring-up step of a link.
+ *
+ * @details A step that cannot run at all is skipped.
+ *
+ * @param[in]  p_ctx   Context of the link.
+ * @param[out] p_wait  true if the step waits for the peer, false if it is finished.
+ *
+ * @retval NRF_SUCCESS  If the step was started or skipped.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+static ret_code_t step_start(conn_ctx_t * p_ctx, bool * p_wait)
+{
+        ret_code_t err_code = NRF_SUCCESS;
+
+        p_ctx->bringup_step_ticks = app_timer_cnt_get();
+        *p_wait                   = false;
+
+        switch (p_ctx->bringup_step)
+        {
+        case BRINGUP_STEP_MTU:
+                err_code = sd_ble_gattc_exchange_mtu_request(p_ctx->conn_handle, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+                break;
+
+#if !defined (S112)
+        case BRINGUP_STEP_DATA_LENGTH:
+        {
+                ble_gap_data_length_params_t dl_params;
+
+                if (hrm_tx_queue_get(p_ctx->conn_handle)->ll_payload_len > LL_DEFAULT_PAYLOAD_LEN)
+                {
+                        return NRF_SUCCESS;
+                }
+
+                memset(&dl_params, 0, sizeof(ble_gap_data_length_params_t));
+                dl_params.max_tx_octets = BRINGUP_DATA_LENGTH;
+                dl_params.max_rx_octets = BRINGUP_DATA_LENGTH;
+
+                err_code = sd_ble_gap_data_length_update(p_ctx->conn_handle, &dl_params, NULL);
+                if (err_code == NRF_ERROR_RESOURCES)
+                {
+                        // The connection event length does not allow it, stay on short PDUs.
+                        return NRF_SUCCESS;
+                }
+        } break;
+#endif
+
+#ifndef S140
+        case BRINGUP_STEP_PHY:
+                // The link stays on the 1M PHY it connected on until the PHY monitor has RSSI
+                // readings, so a weak link is never moved to 2M. Only wait for a change the
+                // monitor has already requested.
+                *p_wait = p_ctx->phy_pending;
+                return NRF_SUCCESS;
+#endif
+
+        default:
+                return NRF_SUCCESS;
+        }
+
+        if (err_code == NRF_ERROR_BUSY)
+        {
+                // The same procedure is running already, wait for its result.
+                *p_wait = true;
+                return NRF_SUCCESS;
+        }
+        if (err_code == NRF_ERROR_INVALID_STATE)
+        {
+                // The procedure has been done already on this link.
+                return NRF_SUCCESS;
+        }
+
+        *p_wait = (err_code == NRF_SUCCESS);
+        return err_code;
+}
+
+
+ret_code_t bringup_start(conn_ctx_t * p_ctx, bringup_evt_t * p_evt)
+{
+        ret_code_t err_code;
+        bool       wait;
+
+        p_ctx->bringup_step = BRINGUP_STEP_MTU;
+
+        err_code = step_start(p_ctx, &wait);
+        if (err_code != NRF_SUCCESS)
+        {
+                *p_evt = BRINGUP_EVT_NONE;
+                return err_code;
+        }
+        if (wait)
+        {
+                *p_evt = BRINGUP_EVT_STEP_STARTED;
+                return NRF_SUCCESS;
+        }
+
+        return bringup_on_step_done(p_ctx->conn_handle, BRINGUP_STEP_MTU, p_evt);
+}
+
+
+ret_code_t bringup_on_step_done(uint16_t conn_handle, bringup_step_t step, bringup_evt_t * p_evt)
+{
+        ret_code_t   err_code;
+        bool         wait  = false;
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        *p_evt = BRINGUP_EVT_NONE;
+
+        if ((p_ctx == NULL) || (p_ctx->bringup_step != step))
+        {
+                return NRF_SUCCESS;
+        }
+
+        do
+        {
+                p_ctx->bringup_ms[p_ctx->bringup_step] =
+                        TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->bringup_step_ticks));
+                p_ctx->bringup_step++;
+
+                if (p_ctx->bringup_step != BRINGUP_STEP_DONE)
+                {
+                        err_code = step_start(p_ctx, &wait);
+                        if (err_code != NRF_SUCCESS)
+                        {
+                                return err_code;
+                        }
+                }
+        }
+        while ((p_ctx->bringup_step != BRINGUP_STEP_DONE) && !wait);
+
+        *p_evt = (p_ctx->bringup_step == BRINGUP_STEP_DONE) ? BRINGUP_EVT_DONE : BRINGUP_EVT_STEP_STARTED;
+        return NRF_SUCCESS;
+}
+
+
+bool bringup_step_timed_out(conn_ctx_t const * p_ctx)
+{
+        return (p_ctx->bringup_step != BRINGUP_STEP_DONE) &&
+               (app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->bringup_step_ticks) >= BRINGUP_STEP_TIMEOUT);
+}
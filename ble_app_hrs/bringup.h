@@ -0,0 +1,87 @@
+/** @file
+ *
+ * @defgroup bringup Connect-time bring-up
+ * @{
+ * @brief ATT MTU exchange and data length update started by the peripheral as soon as a link is
+ *        established.
+ *
+ * @details The peripheral negotiates the ATT MTU, then the data length, instead of waiting for
+ *          hosts that never ask. The data length follows the MTU so that it can be sized for it.
+ *          The PHY is left to the @ref phy_monitor, the last step only waits for a change it
+ *          requested. The time each step takes is kept in the @ref conn_ctx_t of the link.
+ *
+ *          The module does not run timers. The application gives a step that waits for the peer
+ *          @ref BRINGUP_STEP_TIMEOUT, and ends it with @ref bringup_on_step_done when it times out.
+ */
+#ifndef BRINGUP_H__
+#define BRINGUP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "app_timer.h"
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BRINGUP_DATA_LENGTH            (NRF_SDH_BLE_GATT_MAX_MTU_SIZE + 4)  /**< Link Layer PDU payload length requested at connect, an ATT packet of the largest MTU plus its L2CAP header. */
+#define BRINGUP_STEP_TIMEOUT           APP_TIMER_TICKS(5000)        /**< Longest time a step waits for the peer. */
+
+/**@brief Outcome of a call to the module. */
+typedef enum
+{
+        BRINGUP_EVT_NONE,                                           /**< Nothing changed, e.g. the step was not the one the link is in. */
+        BRINGUP_EVT_STEP_STARTED,                                   /**< A step started and waits for the peer. */
+        BRINGUP_EVT_DONE,                                           /**< The bring-up of the link finished. */
+} bringup_evt_t;
+
+
+/**@brief Function for starting the bring-up of a new link.
+ *
+ * @param[in]  p_ctx  Context of the link.
+ * @param[out] p_evt  Outcome.
+ *
+ * @retval NRF_SUCCESS  If the bring-up was started.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t bringup_start(conn_ctx_t * p_ctx, bringup_evt_t * p_evt);
+
+
+/**@brief Function for finishing a bring-up step of a link and starting the next one.
+ *
+ * @details Steps that do not need to wait for the peer are finished right away. A step the link
+ *          has already settled, or that the peer or the GATT module has already started, is not
+ *          requested again: the step then waits for the result of the running procedure.
+ *
+ * @param[in]  conn_handle  Connection handle of the link.
+ * @param[in]  step         Step whose procedure has completed or timed out.
+ * @param[out] p_evt        Outcome.
+ *
+ * @retval NRF_SUCCESS  If the step was finished, or the link is not in it.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t bringup_on_step_done(uint16_t conn_handle, bringup_step_t step, bringup_evt_t * p_evt);
+
+
+/**@brief Function for checking whether the current step of a link has waited
+ *        @ref BRINGUP_STEP_TIMEOUT for the peer.
+ *
+ * @details After an RTC overflow the elapsed time may be underestimated, which only delays the
+ *          step.
+ *
+ * @param[in] p_ctx  Context of the link.
+ *
+ * @return true if the step timed out, false if it is still in time or the bring-up is done.
+ */
+bool bringup_step_timed_out(conn_ctx_t const * p_ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRINGUP_H__
+
+/** @} */
@@ -0,0 +1,167 @@
+/** @file
+ *
+ * @brief Live heart rate broadcast module.
+ */
+#include <string.h>
+#include "broadcast.h"
+#include "app_util.h"
+#include "ble_srv_common.h"
+
+
+/**@brief Live heart rate broadcast. */
+typedef struct
+{
+        broadcast_init_t init;                                      /**< Initialization parameters. */
+        bool             running;                                   /**< Non-connectable advertising of the broadcast is on. */
+        uint16_t         seq;                                       /**< Sequence number of the last sample. */
+        uint8_t          data[BROADCAST_DATA_LEN];                  /**< Service data of the last sample. */
+        uint8_t          adv[BLE_GAP_ADV_MAX_SIZE];                 /**< Encoded non-connectable advertising data. */
+        uint16_t         adv_len;                                   /**< Length of the non-connectable advertising data, 0 before the first sample. */
+        uint8_t          sr[BLE_GAP_ADV_MAX_SIZE];                  /**< Encoded scan response of the connectable advertising. */
+        uint16_t         sr_len;                                    /**< Length of the scan response, 0 before the first sample. */
+} broadcast_t;
+
+static broadcast_t m_broadcast;                                     /**< Live heart rate broadcast. */
+
+
+/**@brief Function for passing an error to the error handler.
+ *
+ * @param[in] err_code  Error code.
+ */
+static void broadcast_error(ret_code_t err_code)
+{
+        if ((err_code != NRF_SUCCESS) && (m_broadcast.init.error_handler != NULL))
+        {
+                m_broadcast.init.error_handler(err_code);
+        }
+}
+
+
+void broadcast_init(broadcast_init_t const * p_init)
+{
+        memset(&m_broadcast, 0, sizeof(m_broadcast));
+        m_broadcast.init = *p_init;
+}
+
+
+void broadcast_update(uint16_t heart_rate, uint8_t battery_level)
+{
+        ret_code_t                 err_code;
+        ble_advdata_t              advdata;
+        ble_advdata_service_data_t service_data;
+        uint8_t                    len = 0;
+
+        m_broadcast.seq++;
+
+        len += uint16_encode(heart_rate, &m_broadcast.data[len]);
+        m_broadcast.data[len++] = battery_level;
+        len += uint16_encode(m_broadcast.seq, &m_broadcast.data[len]);
+
+        service_data.service_uuid = BLE_UUID_HEART_RATE_SERVICE;
+        service_data.data.size    = len;
+        service_data.data.p_data  = m_broadcast.data;
+
+        memset(&advdata, 0, sizeof(advdata));
+
+        advdata.name_type            = BLE_ADVDATA_NO_NAME;
+        advdata.p_service_data_array = &service_data;
+        advdata.service_data_count   = 1;
+
+        m_broadcast.sr_len = BLE_GAP_ADV_MAX_SIZE;
+        err_code = adv_data_encode(&advdata, m_broadcast.sr, &m_broadcast.sr_len);
+        if (err_code != NRF_SUCCESS)
+        {
+                m_broadcast.sr_len = 0;
+                broadcast_error(err_code);
+                return;
+        }
+
+        advdata.name_type = BLE_ADVDATA_FULL_NAME;
+        advdata.flags     = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+
+        m_broadcast.adv_len = BLE_GAP_ADV_MAX_SIZE;
+        err_code = adv_data_encode(&advdata, m_broadcast.adv, &m_broadcast.adv_len);
+        if (err_code != NRF_SUCCESS)
+        {
+                m_broadcast.adv_len = 0;
+                broadcast_error(err_code);
+                return;
+        }
+
+        if (m_broadcast.running)
+        {
+                err_code = sd_ble_gap_adv_data_set(m_broadcast.adv, m_broadcast.adv_len, NULL, 0);
+        }
+        else
+        {
+                // Keep the advertising data of the connectable advertising, only the scan response changes.
+                err_code = sd_ble_gap_adv_data_set(NULL, 0, m_broadcast.sr, m_broadcast.sr_len);
+        }
+        if (err_code != NRF_ERROR_INVALID_STATE)
+        {
+                broadcast_error(err_code);
+        }
+}
+
+
+uint8_t const * broadcast_srdata_get(uint16_t * p_len)
+{
+        *p_len = m_broadcast.sr_len;
+        return m_broadcast.sr;
+}
+
+
+void broadcast_resume(void)
+{
+        ret_code_t           err_code;
+        ble_gap_adv_params_t adv_params;
+
+        if (m_broadcast.running || (m_broadcast.adv_len == 0))
+        {
+                return;
+        }
+
+        memset(&adv_params, 0, sizeof(adv_params));
+
+        adv_params.type     = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND;
+        adv_params.fp       = BLE_GAP_ADV_FP_ANY;
+        adv_params.interval = BROADCAST_ADV_INTERVAL;
+        adv_params.timeout  = 0;
+
+        err_code = sd_ble_gap_adv_data_set(m_broadcast.adv, m_broadcast.adv_len, NULL, 0);
+        if (err_code != NRF_SUCCESS)
+        {
+                broadcast_error(err_code);
+                return;
+        }
+
+        err_code = sd_ble_gap_adv_start(&adv_params, m_broadcast.init.conn_cfg_tag);
+        if (err_code == NRF_ERROR_INVALID_STATE)
+        {
+                // Connectable advertising is on.
+                return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+                broadcast_error(err_code);
+                return;
+        }
+
+        m_broadcast.running = true;
+}
+
+
+void broadcast_stop(void)
+{
+        if (m_broadcast.running)
+        {
+                (void) sd_ble_gap_adv_stop();
+                m_broadcast.running = false;
+        }
+}
+
+
+bool broadcast_is_running(void)
+{
+        return m_broadcast.running;
+}
@@ -0,0 +1,92 @@
+/** @file
+ *
+ * @defgroup broadcast Live heart rate broadcast
+ * @{
+ * @brief Heart rate samples in the advertising data, for observers that do not connect.
+ *
+ * @details Each sample goes in Heart Rate service data. There is one advertising set: while no
+ *          connectable advertising is on, the sample is sent in a non-connectable broadcast, and
+ *          while connectable advertising is on, in its scan response. Whichever is on the air is
+ *          updated in place, the SoftDevice sends the new data from the next advertising event.
+ *
+ *          The application stops the broadcast before it starts connectable advertising, and
+ *          resumes it when that ends.
+ */
+#ifndef BROADCAST_H__
+#define BROADCAST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_advdata.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BROADCAST_ADV_INTERVAL         MSEC_TO_UNITS(500, UNIT_0_625_MS)  /**< Interval of the non-connectable broadcast (500 ms). */
+#define BROADCAST_DATA_LEN             5                            /**< Length of the broadcast service data: heart rate (2 bytes), battery level (1 byte), sequence number (2 bytes). */
+
+/**@brief Broadcast error handler type. */
+typedef void (*broadcast_error_handler_t)(uint32_t nrf_error);
+
+/**@brief Broadcast initialization parameters. */
+typedef struct
+{
+        uint8_t                   conn_cfg_tag;                     /**< SoftDevice configuration the broadcast advertises with. */
+        broadcast_error_handler_t error_handler;                    /**< Handler of the errors of the SoftDevice and of the encoder. */
+} broadcast_init_t;
+
+
+/**@brief Function for initializing the module.
+ *
+ * @param[in] p_init  Initialization parameters.
+ */
+void broadcast_init(broadcast_init_t const * p_init);
+
+
+/**@brief Function for putting a heart rate sample in the advertising data.
+ *
+ * @param[in] heart_rate     Heart rate (in beats per minute).
+ * @param[in] battery_level  Battery level (in percent).
+ */
+void broadcast_update(uint16_t heart_rate, uint8_t battery_level);
+
+
+/**@brief Function for getting the scan response of the connectable advertising.
+ *
+ * @details The data stays at the same place, and is updated by @ref broadcast_update.
+ *
+ * @param[out] p_len  Length of the scan response, 0 before the first sample.
+ *
+ * @return The encoded scan response.
+ */
+uint8_t const * broadcast_srdata_get(uint16_t * p_len);
+
+
+/**@brief Function for starting the non-connectable broadcast when no connectable advertising is
+ *        on.
+ *
+ * @details Does nothing before the first sample, or while connectable advertising is on.
+ */
+void broadcast_resume(void);
+
+
+/**@brief Function for stopping the non-connectable broadcast before connectable advertising
+ *        starts.
+ */
+void broadcast_stop(void);
+
+
+/**@brief Function for checking whether the non-connectable broadcast is on.
+ */
+bool broadcast_is_running(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BROADCAST_H__
+
+/** @} */
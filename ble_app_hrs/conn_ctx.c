@@ -0,0 +1,148 @@
+/** @file
+ *
+ * @brief Connection contexts module.
+ */
+#include <string.h>
+#include "conn_ctx.h"
+
+
+static conn_ctx_t m_conn_ctx[NRF_SDH_BLE_TOTAL_LINK_COUNT];         /**< Connection contexts, indexed by connection handle. */
+static uint8_t    m_conn_cnt;                                       /**< Number of links established. */
+
+
+/**@brief Function for clearing the context of a link.
+ *
+ * @param[in] p_ctx  Context to clear.
+ */
+static void conn_ctx_reset(conn_ctx_t * p_ctx)
+{
+        memset(p_ctx, 0, sizeof(conn_ctx_t));
+        p_ctx->conn_handle  = BLE_CONN_HANDLE_INVALID;
+        p_ctx->role         = CONN_ROLE_NONE;
+        p_ctx->peer_id      = PM_PEER_ID_INVALID;
+        p_ctx->att_mtu      = BLE_GATT_ATT_MTU_DEFAULT;
+        p_ctx->tx_phy       = BLE_GAP_PHY_1MBPS;
+        p_ctx->rx_phy       = BLE_GAP_PHY_1MBPS;
+        p_ctx->policy       = CONN_POLICY_ACTIVE;
+        p_ctx->phy_pref     = BLE_GAP_PHY_AUTO;
+        p_ctx->bringup_step = BRINGUP_STEP_DONE;
+}
+
+
+void conn_ctx_init(void)
+{
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                conn_ctx_reset(&m_conn_ctx[i]);
+        }
+        m_conn_cnt = 0;
+}
+
+
+conn_ctx_t * conn_ctx_open(uint16_t conn_handle)
+{
+        conn_ctx_t * p_ctx;
+
+        if (conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                return NULL;
+        }
+
+        p_ctx = &m_conn_ctx[conn_handle];
+
+        conn_ctx_reset(p_ctx);
+        p_ctx->conn_handle = conn_handle;
+        p_ctx->role        = (conn_ctx_find(CONN_ROLE_PRIMARY_HOST) == NULL) ?
+                             CONN_ROLE_PRIMARY_HOST : CONN_ROLE_SECONDARY_HOST;
+        m_conn_cnt++;
+
+        return p_ctx;
+}
+
+
+conn_ctx_t * conn_ctx_close(conn_ctx_t * p_ctx)
+{
+        conn_role_t  role = p_ctx->role;
+        conn_ctx_t * p_promoted = NULL;
+
+        conn_ctx_reset(p_ctx);
+        m_conn_cnt--;
+
+        if (role == CONN_ROLE_PRIMARY_HOST)
+        {
+                // The host that stays connected, if any, becomes the one served.
+                p_promoted = conn_ctx_find(CONN_ROLE_SECONDARY_HOST);
+                if (p_promoted != NULL)
+                {
+                        p_promoted->role = CONN_ROLE_PRIMARY_HOST;
+                }
+        }
+
+        return p_promoted;
+}
+
+
+uint8_t conn_ctx_count(void)
+{
+        return m_conn_cnt;
+}
+
+
+conn_ctx_t * conn_ctx_get(uint16_t conn_handle)
+{
+        if ((conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT) ||
+            (m_conn_ctx[conn_handle].conn_handle != conn_handle))
+        {
+                return NULL;
+        }
+        return &m_conn_ctx[conn_handle];
+}
+
+
+conn_ctx_t * conn_ctx_find(conn_role_t role)
+{
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                if ((m_conn_ctx[i].conn_handle != BLE_CONN_HANDLE_INVALID) &&
+                    (m_conn_ctx[i].role == role))
+                {
+                        return &m_conn_ctx[i];
+                }
+        }
+        return NULL;
+}
+
+
+conn_ctx_t * conn_ctx_find_by_peer(pm_peer_id_t peer_id)
+{
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                if ((m_conn_ctx[i].conn_handle != BLE_CONN_HANDLE_INVALID) &&
+                    (m_conn_ctx[i].peer_id == peer_id))
+                {
+                        return &m_conn_ctx[i];
+                }
+        }
+        return NULL;
+}
+
+
+void conn_ctx_cccd_set(conn_ctx_t * p_ctx, uint8_t flag, bool enabled)
+{
+        if (enabled)
+        {
+                p_ctx->cccd |= flag;
+        }
+        else
+        {
+                p_ctx->cccd &= ~flag;
+        }
+}
+
+
+bool conn_ctx_cccd_is_set(uint16_t conn_handle, uint8_t flag)
+{
+        conn_ctx_t const * p_ctx = conn_ctx_get(conn_handle);
+
+        return (p_ctx != NULL) && ((p_ctx->cccd & flag) != 0);
+}
@@ -0,0 +1,213 @@
+/** @file
+ *
+ * @defgroup conn_ctx Connection contexts
+ * @{
+ * @brief Table of the state of each link, indexed by connection handle.
+ *
+ * @details The SoftDevice hands out connection handles from 0 to NRF_SDH_BLE_TOTAL_LINK_COUNT - 1,
+ *          so the context of a link is found by indexing the table with its handle. The first
+ *          link is the primary host. Links that connect while it is there are secondary hosts,
+ *          and one of them takes its place when it goes.
+ */
+#ifndef CONN_CTX_H__
+#define CONN_CTX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_config.h"
+#include "ble.h"
+#include "peer_manager_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONN_CCCD_HRM                   0x01                        /**< Connection context CCCD flag: Heart Rate Measurement notifications enabled. */
+#define CONN_CCCD_WFS                   0x02                        /**< Connection context CCCD flag: Waveform Data notifications enabled. */
+#define CONN_CCCD_HLS                   0x04                        /**< Connection context CCCD flag: Log Data notifications enabled. */
+
+/**@brief Connection parameter profiles, from the slowest to the fastest. */
+typedef enum
+{
+        CONN_POLICY_IDLE,                                           /**< No subscriptions, e.g. a host that only bonds: long interval with slave latency. */
+        CONN_POLICY_ACTIVE,                                         /**< Heart Rate Measurement notifications: the interval of the Heart Rate Service. */
+        CONN_POLICY_STREAMING,                                      /**< Waveform stream running: short interval. */
+        CONN_POLICY_BURST,                                          /**< Bulk operation running: shortest interval, for a bounded time. */
+        CONN_POLICY_COUNT
+} conn_policy_t;
+
+/**@brief Users of the burst profile. */
+typedef enum
+{
+        CONN_BURST_USER_BOND,                                       /**< Pairing and bonding. */
+        CONN_BURST_USER_LOG,                                        /**< Heart rate log transfer. */
+        CONN_BURST_USER_CFG,                                        /**< Configuration upload. */
+        CONN_BURST_USER_COUNT
+} conn_burst_user_t;
+
+/**@brief Role of a link in the two-host scheme. */
+typedef enum
+{
+        CONN_ROLE_NONE,                                             /**< Entry unused. */
+        CONN_ROLE_PRIMARY_HOST,                                     /**< Host the device serves (host A). */
+        CONN_ROLE_SECONDARY_HOST,                                   /**< Host connected while another is served, e.g. to take over from it (host B). */
+} conn_role_t;
+
+/**@brief Steps of the connect-time bring-up of a link, in the order they run. */
+typedef enum
+{
+        BRINGUP_STEP_MTU,                                           /**< ATT MTU exchange. */
+        BRINGUP_STEP_DATA_LENGTH,                                   /**< Data length update. */
+        BRINGUP_STEP_PHY,                                           /**< PHY update. */
+        BRINGUP_STEP_DONE,                                          /**< Bring-up finished. */
+        BRINGUP_STEP_COUNT = BRINGUP_STEP_DONE,                     /**< Number of steps. */
+} bringup_step_t;
+
+/**@brief Advertising slices of the bonding window. */
+typedef enum
+{
+        ADV_SLICE_NONE,                                             /**< Not advertising in a bonding window slice. */
+        ADV_SLICE_WHITELIST,                                        /**< Advertising to the bonded hosts only. */
+        ADV_SLICE_OPEN,                                             /**< Advertising to any host, so that a new one can bond. */
+        ADV_SLICE_COUNT,                                            /**< Number of slice types. */
+} adv_slice_t;
+
+/**@brief How a link was brought to encryption, for the connect to encrypted statistics. */
+typedef enum
+{
+        BOND_ENC_NONE,                                              /**< Not recognised as a bonded host at connect. */
+        BOND_ENC_HOST,                                              /**< Bonded host left to encrypt on its own. */
+        BOND_ENC_EARLY,                                             /**< Bonded host sent the early Security Request. */
+} bond_enc_mode_t;
+
+/**@brief Context of one link. */
+typedef struct
+{
+        uint16_t     conn_handle;                                   /**< Handle of the link, BLE_CONN_HANDLE_INVALID if unused. */
+        conn_role_t  role;                                          /**< Role of the link. */
+        ble_gap_addr_t peer_addr;                                   /**< Address the peer connected with. */
+        pm_peer_id_t peer_id;                                       /**< Peer of the link, PM_PEER_ID_INVALID until the link is secured. */
+        uint16_t     att_mtu;                                       /**< Effective ATT MTU of the link. */
+        uint8_t      tx_phy;                                        /**< TX PHY of the link. */
+        uint8_t      rx_phy;                                        /**< RX PHY of the link. */
+        uint8_t      cccd;                                          /**< CONN_CCCD_* flags of the notifications the peer has enabled. */
+        conn_policy_t policy;                                       /**< Connection parameter profile last requested for the link. */
+        bool         policy_pending;                                /**< Whether the profile of the link must be (re)requested. */
+        uint32_t     policy_due_ticks;                              /**< RTC counter value when the pending request is due. */
+        uint32_t     policy_request_ticks;                          /**< RTC counter value of the last request. */
+        uint32_t     policy_request_cnt;                            /**< Number of profiles requested. */
+        uint32_t     policy_since_ticks;                            /**< RTC counter value up to which the profile times are accounted. */
+        uint32_t     policy_time_ms[CONN_POLICY_COUNT];             /**< Time spent with each profile requested (in ms). */
+        uint8_t      burst_users;                                   /**< Bit mask of the conn_burst_user_t holding a burst reference. */
+        uint32_t     burst_deadline_ticks[CONN_BURST_USER_COUNT];   /**< RTC counter value when the reference of each user expires. */
+        bool         burst_switching;                               /**< Whether the link waits for the burst interval. */
+        uint32_t     burst_start_ticks;                             /**< RTC counter value of the first request of the burst. */
+        uint32_t     burst_switch_cnt;                              /**< Number of switches to the burst interval. */
+        uint32_t     burst_switch_sum_ms;                           /**< Sum of the times from burst request to burst interval (in ms). */
+        uint32_t     burst_switch_max_ms;                           /**< Longest time from burst request to burst interval (in ms). */
+        uint16_t     conn_interval;                                 /**< Connection interval in effect (in 1.25 ms units). */
+        uint16_t     slave_latency;                                 /**< Slave latency in effect. */
+        uint16_t     conn_sup_timeout;                              /**< Supervision timeout in effect (in 10 ms units). */
+        uint32_t     conn_param_update_cnt;                         /**< Number of connection parameter updates of the link. */
+        uint32_t     conn_param_reject_cnt;                         /**< Number of profiles the peer did not accept. */
+        uint32_t     connected_ticks;                               /**< RTC counter value when the link was established. */
+        adv_slice_t  adv_slice;                                     /**< Bonding window slice the link was established in, until it is secured or dropped. */
+        bringup_step_t bringup_step;                                /**< Step of the connect-time bring-up the link is in. */
+        uint32_t     bringup_step_ticks;                            /**< RTC counter value when the step started. */
+        uint32_t     bringup_ms[BRINGUP_STEP_COUNT];                /**< Time each step took (in ms). */
+        bool         encrypted;                                     /**< Whether the link has been encrypted. */
+        bond_enc_mode_t enc_mode;                                   /**< How the link was brought to encryption. */
+        uint32_t     hvn_tx_cnt;                                    /**< Number of notifications transmitted on the link. */
+        uint32_t     phy_update_cnt;                                /**< Number of PHY updates of the link. */
+        uint8_t      phy_pref;                                      /**< PHY last requested by the PHY monitor, BLE_GAP_PHY_AUTO until then. */
+        bool         phy_pending;                                   /**< Whether a PHY update requested by the PHY monitor has not completed yet. */
+        bool         phy_2m_unsupported;                            /**< Whether the peer rejected 2M PHY. */
+        uint32_t     phy_change_ticks;                              /**< RTC counter value of the last PHY request. */
+        uint32_t     phy_request_cnt;                               /**< Number of PHY changes requested. */
+        int32_t      rssi_acc;                                      /**< Filtered RSSI (in dBm) scaled by 2^PHY_RSSI_FILTER_SHIFT. */
+        uint32_t     rssi_cnt;                                      /**< Number of RSSI readings. */
+} conn_ctx_t;
+
+
+/**@brief Function for clearing all connection contexts. */
+void conn_ctx_init(void);
+
+
+/**@brief Function for taking the context of a new link.
+ *
+ * @details The context is cleared. The link becomes the primary host if there is none, otherwise
+ *          a secondary host.
+ *
+ * @param[in] conn_handle  Connection handle of the new link.
+ *
+ * @return Pointer to the context, or NULL if the handle is out of range.
+ */
+conn_ctx_t * conn_ctx_open(uint16_t conn_handle);
+
+
+/**@brief Function for releasing the context of a link that is gone.
+ *
+ * @param[in] p_ctx  Context of the link.
+ *
+ * @return Context of the secondary host that became the primary host in its place, or NULL.
+ */
+conn_ctx_t * conn_ctx_close(conn_ctx_t * p_ctx);
+
+
+/**@brief Function for getting the number of links established. */
+uint8_t conn_ctx_count(void);
+
+
+/**@brief Function for getting the context of a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ *
+ * @return Pointer to the context, or NULL if the handle is not an established link.
+ */
+conn_ctx_t * conn_ctx_get(uint16_t conn_handle);
+
+
+/**@brief Function for finding the link that has a given role.
+ *
+ * @param[in] role  Role to look for.
+ *
+ * @return Pointer to the context, or NULL if no link has the role.
+ */
+conn_ctx_t * conn_ctx_find(conn_role_t role);
+
+
+/**@brief Function for finding the link to a given peer.
+ *
+ * @param[in] peer_id  Peer to look for.
+ *
+ * @return Pointer to the context, or NULL if the peer is not connected.
+ */
+conn_ctx_t * conn_ctx_find_by_peer(pm_peer_id_t peer_id);
+
+
+/**@brief Function for recording whether the peer of a link has enabled a notification.
+ *
+ * @param[in] p_ctx    Context of the link.
+ * @param[in] flag     CONN_CCCD_* flag of the notification.
+ * @param[in] enabled  Whether the notification is enabled.
+ */
+void conn_ctx_cccd_set(conn_ctx_t * p_ctx, uint8_t flag, bool enabled);
+
+
+/**@brief Function for checking whether the peer of a link has enabled a notification.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] flag         CONN_CCCD_* flag of the notification.
+ *
+ * @return true if the link is established and the notification is enabled.
+ */
+bool conn_ctx_cccd_is_set(uint16_t conn_handle, uint8_t flag);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONN_CTX_H__
+
+/** @} */
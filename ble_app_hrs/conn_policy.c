@@ -0,0 +1,324 @@
+/** @file
+ *
+ * @brief Connection parameter policy module.
+ */
+#include "conn_policy.h"
+#include "ble_conn_params.h"
+#include "app_util.h"
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
+APP_TIMER_DEF(m_timer_id);                                          /**< Connection parameter policy timer. */
+
+static conn_policy_init_t m_init;                                   /**< Init structure given to @ref conn_policy_init. */
+
+
+/**@brief Function for getting the time left until a point in time of the application timer.
+ *
+ * @details Points in time lie less than half the RTC range ahead, so a larger difference means
+ *          the point has passed.
+ *
+ * @param[in] now_ticks  Current RTC counter value.
+ * @param[in] at_ticks   Point in time.
+ *
+ * @return Ticks left, 0 if the point has passed.
+ */
+static uint32_t ticks_left(uint32_t now_ticks, uint32_t at_ticks)
+{
+        uint32_t left = app_timer_cnt_diff_compute(at_ticks, now_ticks);
+
+        return (left > (APP_TIMER_MAX_CNT_VAL / 2)) ? 0 : left;
+}
+
+
+/**@brief Function for adding the time since the last call to the profile time of a link.
+ *
+ * @param[in] p_ctx      Context of the link.
+ * @param[in] now_ticks  Current RTC counter value.
+ */
+static void time_account(conn_ctx_t * p_ctx, uint32_t now_ticks)
+{
+        p_ctx->policy_time_ms[p_ctx->policy] +=
+                TICKS_TO_MS(app_timer_cnt_diff_compute(now_ticks, p_ctx->policy_since_ticks));
+        p_ctx->policy_since_ticks = now_ticks;
+}
+
+
+/**@brief Function for arming the policy timer for the next link that needs it.
+ *
+ * @details The timer fires for the earliest pending request or burst expiry, and at least every
+ *          @ref CONN_POLICY_ACCOUNT_INTERVAL while a link is up, so the profile times never
+ *          miss an RTC overflow.
+ */
+static void timer_arm(void)
+{
+        ret_code_t err_code;
+        uint32_t   now_ticks = app_timer_cnt_get();
+        uint32_t   delay     = CONN_POLICY_ACCOUNT_INTERVAL;
+
+        if (conn_ctx_count() == 0)
+        {
+                return;
+        }
+
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                conn_ctx_t const * p_ctx = conn_ctx_get(i);
+
+                if (p_ctx == NULL)
+                {
+                        continue;
+                }
+                if (p_ctx->policy_pending)
+                {
+                        delay = MIN(delay, ticks_left(now_ticks, p_ctx->policy_due_ticks));
+                }
+                for (uint32_t user = 0; user < CONN_BURST_USER_COUNT; user++)
+                {
+                        if (p_ctx->burst_users & (1 << user))
+                        {
+                                delay = MIN(delay, ticks_left(now_ticks, p_ctx->burst_deadline_ticks[user]));
+                        }
+                }
+        }
+
+        err_code = app_timer_stop(m_timer_id);
+        if (err_code == NRF_SUCCESS)
+        {
+                err_code = app_timer_start(m_timer_id, MAX(delay, APP_TIMER_MIN_TIMEOUT_TICKS), NULL);
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+                m_init.error_handler(err_code);
+        }
+}
+
+
+/**@brief Function for passing an event to the application.
+ *
+ * @param[in] p_evt  Event.
+ */
+static void evt_send(conn_policy_evt_t const * p_evt)
+{
+        if (m_init.evt_handler != NULL)
+        {
+                m_init.evt_handler(p_evt);
+        }
+}
+
+
+/**@brief Function for handling the policy timer timeout.
+ *
+ * @details Releases expired burst references and requests the profile of every link whose
+ *          request is due. Links on which the Connection Parameters module is still negotiating
+ *          keep waiting, and are retried when the negotiation ends.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void timeout_handler(void * p_context)
+{
+        UNUSED_PARAMETER(p_context);
+
+        uint32_t now_ticks = app_timer_cnt_get();
+
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                conn_ctx_t * p_ctx = conn_ctx_get(i);
+
+                if (p_ctx == NULL)
+                {
+                        continue;
+                }
+
+                time_account(p_ctx, now_ticks);
+
+                for (uint32_t user = 0; user < CONN_BURST_USER_COUNT; user++)
+                {
+                        if ((p_ctx->burst_users & (1 << user)) &&
+                            (ticks_left(now_ticks, p_ctx->burst_deadline_ticks[user]) == 0))
+                        {
+                                conn_policy_evt_t evt =
+                                {
+                                        .evt_type    = CONN_POLICY_EVT_BURST_TIMEOUT,
+                                        .conn_handle = p_ctx->conn_handle,
+                                        .params.user = (conn_burst_user_t)user,
+                                };
+
+                                evt_send(&evt);
+                                conn_burst_release(p_ctx->conn_handle, (conn_burst_user_t)user);
+                        }
+                }
+
+                if (!p_ctx->policy_pending ||
+                    (ticks_left(now_ticks, p_ctx->policy_due_ticks) > 0))
+                {
+                        continue;
+                }
+
+                conn_policy_t         policy = conn_policy_get(p_ctx);
+                ble_gap_conn_params_t params = m_init.p_params[policy];
+                ret_code_t            err_code;
+
+                err_code = ble_conn_params_change_conn_params(p_ctx->conn_handle, &params);
+                if (err_code == NRF_SUCCESS)
+                {
+                        conn_policy_evt_t evt =
+                        {
+                                .evt_type      = CONN_POLICY_EVT_REQUESTED,
+                                .conn_handle   = p_ctx->conn_handle,
+                                .params.policy = policy,
+                        };
+
+                        p_ctx->policy               = policy;
+                        p_ctx->policy_pending       = false;
+                        p_ctx->policy_request_ticks = now_ticks;
+                        p_ctx->policy_request_cnt++;
+
+                        evt_send(&evt);
+                }
+                else if ((err_code != NRF_ERROR_BUSY) &&
+                         (err_code != NRF_ERROR_INVALID_STATE) &&
+                         (err_code != BLE_ERROR_INVALID_CONN_HANDLE))
+                {
+                        m_init.error_handler(err_code);
+                }
+        }
+
+        timer_arm();
+}
+
+
+ret_code_t conn_policy_init(conn_policy_init_t const * p_init)
+{
+        m_init = *p_init;
+
+        return app_timer_create(&m_timer_id, APP_TIMER_MODE_SINGLE_SHOT, timeout_handler);
+}
+
+
+conn_policy_t conn_policy_get(conn_ctx_t const * p_ctx)
+{
+        if (p_ctx->burst_users != 0)
+        {
+                return CONN_POLICY_BURST;
+        }
+        if (m_init.streaming_get(p_ctx->conn_handle))
+        {
+                return CONN_POLICY_STREAMING;
+        }
+        if (p_ctx->cccd & CONN_CCCD_HRM)
+        {
+                return CONN_POLICY_ACTIVE;
+        }
+        return CONN_POLICY_IDLE;
+}
+
+
+void conn_policy_on_connected(conn_ctx_t * p_ctx, uint32_t delay)
+{
+        p_ctx->policy_since_ticks = p_ctx->connected_ticks;
+        conn_policy_refresh(p_ctx->conn_handle, delay);
+        timer_arm();
+}
+
+
+void conn_policy_time_update(conn_ctx_t * p_ctx)
+{
+        time_account(p_ctx, app_timer_cnt_get());
+}
+
+
+void conn_policy_schedule(uint16_t conn_handle, uint32_t delay)
+{
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        if (p_ctx == NULL)
+        {
+                return;
+        }
+
+        uint32_t now_ticks = app_timer_cnt_get();
+        uint32_t elapsed   = app_timer_cnt_diff_compute(now_ticks, p_ctx->policy_request_ticks);
+
+        // After an RTC overflow the elapsed time may be underestimated, which only delays the request.
+        if ((p_ctx->policy_request_cnt > 0) && (elapsed < CONN_POLICY_MIN_UPDATE_INTERVAL))
+        {
+                delay = MAX(delay, CONN_POLICY_MIN_UPDATE_INTERVAL - elapsed);
+        }
+
+        p_ctx->policy_pending   = true;
+        p_ctx->policy_due_ticks = now_ticks + delay;
+
+        timer_arm();
+}
+
+
+void conn_policy_refresh(uint16_t conn_handle, uint32_t delay)
+{
+        conn_ctx_t const * p_ctx = conn_ctx_get(conn_handle);
+
+        if ((p_ctx != NULL) && (conn_policy_get(p_ctx) != p_ctx->policy))
+        {
+                conn_policy_schedule(conn_handle, delay);
+        }
+}
+
+
+void conn_policy_on_conn_param_update(conn_ctx_t * p_ctx, ble_gap_conn_params_t const * p_params)
+{
+        if (p_ctx->burst_switching &&
+            (p_params->max_conn_interval <= m_init.p_params[CONN_POLICY_BURST].max_conn_interval))
+        {
+                uint32_t switch_ms =
+                        TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->burst_start_ticks));
+
+                p_ctx->burst_switching      = false;
+                p_ctx->burst_switch_cnt++;
+                p_ctx->burst_switch_sum_ms += switch_ms;
+                p_ctx->burst_switch_max_ms  = MAX(p_ctx->burst_switch_max_ms, switch_ms);
+        }
+}
+
+
+void conn_burst_request(uint16_t conn_handle, conn_burst_user_t user, uint32_t timeout)
+{
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        if (p_ctx == NULL)
+        {
+                return;
+        }
+
+        if (p_ctx->burst_users == 0)
+        {
+                p_ctx->burst_start_ticks = app_timer_cnt_get();
+                p_ctx->burst_switching   = true;
+        }
+
+        p_ctx->burst_users                |= (1 << user);
+        p_ctx->burst_deadline_ticks[user]  = app_timer_cnt_get() + MIN(timeout, CONN_BURST_MAX_TIMEOUT);
+
+        conn_policy_refresh(conn_handle, CONN_BURST_START_DELAY);
+        timer_arm();
+}
+
+
+void conn_burst_release(uint16_t conn_handle, conn_burst_user_t user)
+{
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        if ((p_ctx == NULL) || !(p_ctx->burst_users & (1 << user)))
+        {
+                return;
+        }
+
+        p_ctx->burst_users &= ~(1 << user);
+        if (p_ctx->burst_users == 0)
+        {
+                p_ctx->burst_switching = false;
+        }
+
+        conn_policy_refresh(conn_handle, CONN_POLICY_SETTLE_DELAY);
+}
@@ -0,0 +1,175 @@
+/** @file
+ *
+ * @defgroup conn_policy Connection parameter policy
+ * @{
+ * @brief Connection parameter profile of each link chosen from its activity, with a bounded
+ *        burst profile for bulk operations.
+ *
+ * @details A link without subscriptions runs the idle profile, one with Heart Rate Measurement
+ *          notifications the active profile, and one streaming the waveform the streaming
+ *          profile. Bulk operations hold a reference on the burst profile, which wins over the
+ *          others until every user released it or its time is up.
+ *
+ *          Requests are sent from the policy timer of the module, so that a burst of subscription
+ *          changes, e.g. the CCCD writes after connecting, leads to one request. Requests on a
+ *          link are at least @ref CONN_POLICY_MIN_UPDATE_INTERVAL apart, so that overlapping
+ *          activities do not make the parameters thrash. The time each link spends with each
+ *          profile, and the time from a burst request to the burst interval, are kept in its
+ *          @ref conn_ctx_t.
+ *
+ *          The requests go through the Connection Parameters module of the SDK.
+ */
+#ifndef CONN_POLICY_H__
+#define CONN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "app_timer.h"
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONN_POLICY_SETTLE_DELAY        APP_TIMER_TICKS(1000)       /**< Time a link's subscriptions must be stable before its connection parameters are renegotiated. */
+#define CONN_POLICY_MIN_UPDATE_INTERVAL APP_TIMER_TICKS(2000)       /**< Shortest time between two connection parameter requests on a link. */
+#define CONN_POLICY_ACCOUNT_INTERVAL    APP_TIMER_TICKS(60000)      /**< Longest time between two updates of the profile times of a link. Must be below half the RTC range. */
+#define CONN_BURST_START_DELAY          APP_TIMER_TICKS(20)         /**< Time from a burst request to the connection parameter request. */
+#define CONN_BURST_MAX_TIMEOUT          APP_TIMER_TICKS(60000)      /**< Longest time a burst reference is held. Must be below half the RTC range. */
+
+/**@brief Connection parameter policy event types. */
+typedef enum
+{
+        CONN_POLICY_EVT_REQUESTED,                                  /**< A profile was requested on a link. */
+        CONN_POLICY_EVT_BURST_TIMEOUT,                              /**< The burst reference of a user timed out and was released. */
+} conn_policy_evt_type_t;
+
+/**@brief Connection parameter policy event. */
+typedef struct
+{
+        conn_policy_evt_type_t evt_type;                            /**< Type of event. */
+        uint16_t               conn_handle;                         /**< Connection handle of the link. */
+        union
+        {
+                conn_policy_t     policy;                           /**< Profile requested, for @ref CONN_POLICY_EVT_REQUESTED. */
+                conn_burst_user_t user;                             /**< User whose reference timed out, for @ref CONN_POLICY_EVT_BURST_TIMEOUT. */
+        } params;
+} conn_policy_evt_t;
+
+/**@brief Connection parameter policy event handler type. */
+typedef void (*conn_policy_evt_handler_t)(conn_policy_evt_t const * p_evt);
+
+/**@brief Connection parameter policy error handler type. */
+typedef void (*conn_policy_error_handler_t)(uint32_t nrf_error);
+
+/**@brief Function type for checking whether a link streams, i.e. needs the streaming profile. */
+typedef bool (*conn_policy_streaming_get_t)(uint16_t conn_handle);
+
+/**@brief Connection parameter policy init structure. */
+typedef struct
+{
+        ble_gap_conn_params_t const * p_params;                     /**< Connection parameters of each profile, CONN_POLICY_COUNT entries. Must stay valid. */
+        conn_policy_streaming_get_t   streaming_get;                /**< Function for checking whether a link streams. */
+        conn_policy_evt_handler_t     evt_handler;                  /**< Handler of the events, may be NULL. */
+        conn_policy_error_handler_t   error_handler;                /**< Handler of the errors of the policy timer and of the Connection Parameters module. */
+} conn_policy_init_t;
+
+
+/**@brief Function for initializing the policy.
+ *
+ * @param[in] p_init  Init structure.
+ *
+ * @retval NRF_SUCCESS  If the policy timer was created.
+ * @return Otherwise the error code of the application timer.
+ */
+ret_code_t conn_policy_init(conn_policy_init_t const * p_init);
+
+
+/**@brief Function for choosing the connection parameter profile of a link from its activity.
+ *
+ * @param[in] p_ctx  Context of the link.
+ *
+ * @return Profile the link should use.
+ */
+conn_policy_t conn_policy_get(conn_ctx_t const * p_ctx);
+
+
+/**@brief Function for starting the policy of a new link.
+ *
+ * @details The link starts on the parameters it connected with, and moves to the profile of its
+ *          activity after the delay.
+ *
+ * @param[in] p_ctx  Context of the link.
+ * @param[in] delay  Time to wait before sending the first request (ticks).
+ */
+void conn_policy_on_connected(conn_ctx_t * p_ctx, uint32_t delay);
+
+
+/**@brief Function for accounting the profile time of a link up to now, e.g. before it is
+ *        reported.
+ *
+ * @param[in] p_ctx  Context of the link.
+ */
+void conn_policy_time_update(conn_ctx_t * p_ctx);
+
+
+/**@brief Function for scheduling the renegotiation of the connection parameters of a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] delay        Time to wait before sending the request (ticks).
+ */
+void conn_policy_schedule(uint16_t conn_handle, uint32_t delay);
+
+
+/**@brief Function for re-evaluating the connection parameter profile of a link.
+ *
+ * @details Called whenever the activity of the link changes. A request is only scheduled if the
+ *          profile changes.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] delay        Time to wait before sending a request (ticks).
+ */
+void conn_policy_refresh(uint16_t conn_handle, uint32_t delay);
+
+
+/**@brief Function for handling a connection parameter update of a link.
+ *
+ * @details Measures the time from the burst request to the burst interval.
+ *
+ * @param[in] p_ctx     Context of the link.
+ * @param[in] p_params  Connection parameters in effect.
+ */
+void conn_policy_on_conn_param_update(conn_ctx_t * p_ctx, ble_gap_conn_params_t const * p_params);
+
+
+/**@brief Function for requesting the burst profile on a link.
+ *
+ * @details For bulk operations. Every user holds at most one reference, which a new request
+ *          renews. The link stays on the burst profile until all users have released it or
+ *          their time is up, then it falls back to the profile of its subscriptions.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] user         User of the burst profile.
+ * @param[in] timeout      Time after which the reference is released (ticks), at most
+ *                         @ref CONN_BURST_MAX_TIMEOUT.
+ */
+void conn_burst_request(uint16_t conn_handle, conn_burst_user_t user, uint32_t timeout);
+
+
+/**@brief Function for releasing the burst profile reference of a user on a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] user         User of the burst profile.
+ */
+void conn_burst_release(uint16_t conn_handle, conn_burst_user_t user);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONN_POLICY_H__
+
+/** @} */
@@ -0,0 +1,175 @@
+/** @file
+ *
+ * @brief Stream handover module.
+ */
+#include "handover.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+
+
+/**@brief Move of the streams from the primary host to a secondary host that bonded. */
+typedef struct
+{
+        bool     pending;                                           /**< Whether host A is kept until host B has enabled its notifications. */
+        uint16_t from_handle;                                       /**< Link of host A. */
+        uint16_t to_handle;                                         /**< Link of host B. */
+        bool     measuring;                                         /**< Whether the measurements transmitted to either host are followed to find the gap. */
+        bool     from_gone;                                         /**< Whether host A has been disconnected. */
+        bool     air_seen;                                          /**< Whether air_last_ticks is valid. */
+        bool     gap_done;                                          /**< Whether the gap has been measured and is to be logged. */
+        uint32_t air_last_ticks;                                    /**< Sample time of the newest measurement transmitted to either host. */
+        uint32_t air_spacing_max;                                   /**< Largest spacing between the sample times transmitted to either host (ticks). */
+        uint32_t dropped_cnt;                                       /**< Measurements of host A dropped when they were merged into host B's queue. */
+} handover_t;
+
+static handover_t m_handover =                                      /**< Handover state. */
+{
+        .from_handle = BLE_CONN_HANDLE_INVALID,
+        .to_handle   = BLE_CONN_HANDLE_INVALID,
+};
+
+
+void handover_begin(uint16_t from_handle, uint16_t to_handle, bool wait)
+{
+        hrm_tx_queue_t const * p_src = hrm_tx_queue_get(from_handle);
+        hrm_tx_queue_t const * p_dst = hrm_tx_queue_get(to_handle);
+
+        CRITICAL_REGION_ENTER();
+
+        m_handover.from_handle = from_handle;
+        m_handover.to_handle   = to_handle;
+        m_handover.pending     = wait;
+
+        m_handover.air_seen = false;
+        if (p_src->latency_cnt > 0)
+        {
+                m_handover.air_last_ticks = p_src->last_air_ticks;
+                m_handover.air_seen       = true;
+        }
+        if ((p_dst->latency_cnt > 0) &&
+            (!m_handover.air_seen || hrm_tx_queue_is_newer(p_dst->last_air_ticks, m_handover.air_last_ticks)))
+        {
+                m_handover.air_last_ticks = p_dst->last_air_ticks;
+                m_handover.air_seen       = true;
+        }
+        m_handover.air_spacing_max = 0;
+        m_handover.dropped_cnt     = 0;
+        m_handover.from_gone       = false;
+        m_handover.gap_done        = false;
+        m_handover.measuring       = true;
+
+        CRITICAL_REGION_EXIT();
+}
+
+
+bool handover_is_pending(void)
+{
+        return m_handover.pending;
+}
+
+
+void handover_links_get(uint16_t * p_from_handle, uint16_t * p_to_handle)
+{
+        *p_from_handle = m_handover.from_handle;
+        *p_to_handle   = m_handover.to_handle;
+}
+
+
+bool handover_is_ready(void)
+{
+        conn_ctx_t const * p_from = conn_ctx_get(m_handover.from_handle);
+        conn_ctx_t const * p_to   = conn_ctx_get(m_handover.to_handle);
+
+        if (!m_handover.pending || (p_from == NULL) || (p_to == NULL))
+        {
+                return false;
+        }
+
+        return (p_from->cccd & HANDOVER_CCCD_MASK & ~p_to->cccd) == 0;
+}
+
+
+void handover_stop(void)
+{
+        m_handover.pending = false;
+}
+
+
+void handover_merge(hrm_tx_queue_merge_result_t * p_merge)
+{
+        conn_ctx_t * p_from = conn_ctx_get(m_handover.from_handle);
+
+        hrm_tx_queue_merge(hrm_tx_queue_get(m_handover.to_handle), hrm_tx_queue_get(m_handover.from_handle), p_merge);
+        m_handover.dropped_cnt += p_merge->dropped_cnt;
+
+        // Host A gets nothing more, it is about to be disconnected.
+        p_from->cccd &= ~HANDOVER_CCCD_MASK;
+}
+
+
+void handover_on_air(uint16_t conn_handle, uint32_t sample_ticks)
+{
+        if (!m_handover.measuring ||
+            ((conn_handle != m_handover.from_handle) && (conn_handle != m_handover.to_handle)))
+        {
+                return;
+        }
+
+        if (m_handover.air_seen)
+        {
+                if (!hrm_tx_queue_is_newer(sample_ticks, m_handover.air_last_ticks))
+                {
+                        // The other host received this one already.
+                        return;
+                }
+                m_handover.air_spacing_max = MAX(m_handover.air_spacing_max,
+                                                 app_timer_cnt_diff_compute(sample_ticks, m_handover.air_last_ticks));
+        }
+        m_handover.air_last_ticks = sample_ticks;
+        m_handover.air_seen       = true;
+
+        if (m_handover.from_gone && (conn_handle == m_handover.to_handle))
+        {
+                m_handover.measuring = false;
+                m_handover.gap_done  = true;
+        }
+}
+
+
+bool handover_on_disconnected(uint16_t conn_handle)
+{
+        bool ended = false;
+
+        if (m_handover.pending &&
+            ((conn_handle == m_handover.from_handle) || (conn_handle == m_handover.to_handle)))
+        {
+                m_handover.pending = false;
+                ended              = true;
+        }
+
+        CRITICAL_REGION_ENTER();
+        if (m_handover.measuring)
+        {
+                m_handover.from_gone |= (conn_handle == m_handover.from_handle);
+                m_handover.measuring  = (conn_handle != m_handover.to_handle);
+        }
+        CRITICAL_REGION_EXIT();
+
+        return ended;
+}
+
+
+bool handover_gap_take(uint16_t conn_handle, uint32_t * p_spacing, uint32_t * p_dropped_cnt)
+{
+        if (!m_handover.gap_done || (conn_handle != m_handover.to_handle))
+        {
+                return false;
+        }
+
+        m_handover.gap_done = false;
+        *p_spacing          = m_handover.air_spacing_max;
+        *p_dropped_cnt      = m_handover.dropped_cnt;
+
+        return true;
+}
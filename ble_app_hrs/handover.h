@@ -0,0 +1,125 @@
+/** @file
+ *
+ * @defgroup handover Stream handover
+ * @{
+ * @brief Move of the streams from the primary host (host A) to a secondary host that bonded
+ *        (host B).
+ *
+ * @details Host A is kept until host B has enabled the notifications host A uses, then host A's
+ *          queued measurements are merged into host B's queue and host A is disconnected by the
+ *          application. Across the handover the module follows the measurements either host
+ *          received, to report the gap host B saw.
+ *
+ *          The module does not disconnect, run timers or move the waveform stream. The
+ *          application does, and tells the module about the links that go through
+ *          @ref handover_on_disconnected. @ref handover_on_air must be given to the outbound Heart
+ *          Rate Measurement queues as their on air handler.
+ */
+#ifndef HANDOVER_H__
+#define HANDOVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hrm_tx_queue.h"
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HANDOVER_CCCD_MASK             (CONN_CCCD_HRM | CONN_CCCD_WFS)  /**< Notifications that move from host A to host B. */
+
+
+/**@brief Function for starting a handover.
+ *
+ * @details Starts measuring the gap. The gap is the largest spacing between the sample times of
+ *          the measurements either host received, less the measurement interval, from the last
+ *          one host A received until host B receives one after host A is gone. Measurements both
+ *          hosts received count once. A gapless handover gives 0.
+ *
+ * @param[in] from_handle  Link of host A.
+ * @param[in] to_handle    Link of host B.
+ * @param[in] wait         Whether host A is kept until host B has enabled its notifications.
+ *                         Otherwise the application disconnects host A right away.
+ */
+void handover_begin(uint16_t from_handle, uint16_t to_handle, bool wait);
+
+
+/**@brief Function for checking whether host A is kept for host B.
+ */
+bool handover_is_pending(void);
+
+
+/**@brief Function for getting the links of the last handover.
+ *
+ * @param[out] p_from_handle  Link of host A.
+ * @param[out] p_to_handle    Link of host B.
+ */
+void handover_links_get(uint16_t * p_from_handle, uint16_t * p_to_handle);
+
+
+/**@brief Function for checking whether host B has enabled the notifications host A uses.
+ *
+ * @return true if host A is kept for host B, both are connected and the streams can move.
+ */
+bool handover_is_ready(void);
+
+
+/**@brief Function for ending the wait for host B, e.g. before the streams move or when it timed
+ *        out.
+ */
+void handover_stop(void);
+
+
+/**@brief Function for merging host A's queued measurements into host B's queue.
+ *
+ * @details Host A's notifications are turned off in its context, it gets nothing more. Both hosts
+ *          must be connected. Must be called from a critical region, together with the drain of
+ *          host B's queue.
+ *
+ * @param[out] p_merge  Result of the merge.
+ */
+void handover_merge(hrm_tx_queue_merge_result_t * p_merge);
+
+
+/**@brief Function for following the measurements transmitted across a handover.
+ *
+ * @details Called by the outbound Heart Rate Measurement queues for every measurement
+ *          transmitted, from a critical region.
+ *
+ * @param[in] conn_handle   Link the measurement was transmitted on.
+ * @param[in] sample_ticks  RTC counter value when the heart rate was sampled.
+ */
+void handover_on_air(uint16_t conn_handle, uint32_t sample_ticks);
+
+
+/**@brief Function for handling the disconnection of a link.
+ *
+ * @details Host A is expected to go. If host B goes, the handover and the measuring end.
+ *
+ * @param[in] conn_handle  Link that was disconnected.
+ *
+ * @return true if a handover waiting for host B ended, false otherwise.
+ */
+bool handover_on_disconnected(uint16_t conn_handle);
+
+
+/**@brief Function for taking the measured gap of the last handover, once.
+ *
+ * @param[in]  conn_handle     Link a measurement was just transmitted on.
+ * @param[out] p_spacing       Largest spacing between the sample times either host received
+ *                             (ticks).
+ * @param[out] p_dropped_cnt   Measurements of host A dropped when they were merged.
+ *
+ * @return true if conn_handle is host B and the gap was measured since the last call.
+ */
+bool handover_gap_take(uint16_t conn_handle, uint32_t * p_spacing, uint32_t * p_dropped_cnt);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HANDOVER_H__
+
+/** @} */
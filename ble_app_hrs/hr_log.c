@@ -0,0 +1,579 @@
+/** @file
+ *
+ * @brief Heart rate history log module.
+ */
+#include <string.h>
+#include "hr_log.h"
+#include "sdk_config.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "app_timer.h"
+
+
+#define RECORD_KEY_MAX                  0xBFFF                      /**< Highest record key FDS accepts. */
+#define RECORD_KEY(record_seq)          ((uint16_t)(((record_seq) % RECORD_KEY_MAX) + 1))  /**< Record key of a log record. */
+
+#define FDS_PAGE_HEADER_WORDS           2                           /**< Words of a virtual page taken by the FDS page tag. */
+#define FDS_RECORD_HEADER_WORDS         3                           /**< Words of a record taken by the FDS record header. */
+#define RECORD_WORDS                    ((HR_LOG_RECORD_SIZE / sizeof(uint32_t)) + FDS_RECORD_HEADER_WORDS)  /**< Words of a log record in flash. */
+#define RECORDS_PER_PAGE                ((FDS_VIRTUAL_PAGE_SIZE - FDS_PAGE_HEADER_WORDS) / RECORD_WORDS)   /**< Log records that fit in one virtual page. */
+#define LOG_PAGES                       CEIL_DIV(HR_LOG_MAX_RECORDS + 1, RECORDS_PER_PAGE)   /**< Virtual pages the log needs: all records plus the one written before the oldest is collected. */
+
+/**@brief Log record as stored in flash. */
+typedef struct
+{
+        uint32_t seq;                                               /**< Sequence number of the record. The first sample has sequence number seq * HR_LOG_SAMPLES_PER_RECORD. */
+        uint32_t time_s;                                            /**< Seconds since reset when the record was started. */
+        uint16_t boot;                                              /**< Number of the reset the record was started after. */
+        uint16_t count;                                             /**< Number of samples in the record. */
+        struct
+        {
+                uint16_t time_offset_s;                             /**< Seconds since the record was started. */
+                uint16_t heart_rate;                                /**< Heart rate. */
+        } samples[HR_LOG_SAMPLES_PER_RECORD];
+} hr_log_record_t;
+
+STATIC_ASSERT(sizeof(hr_log_record_t) == HR_LOG_RECORD_SIZE);
+
+// The log shares FDS with the Peer Manager, and FDS keeps one page for garbage collection.
+STATIC_ASSERT(FDS_VIRTUAL_PAGES >= LOG_PAGES + HR_LOG_PM_PAGES + 1);
+
+/**@brief State of a RAM record. */
+typedef enum
+{
+        BUFFER_FREE,                                                /**< Not in use. */
+        BUFFER_FILLING,                                             /**< Collecting samples. */
+        BUFFER_WRITE_PENDING,                                       /**< Full, waiting for FDS to accept the write. */
+        BUFFER_WRITING,                                             /**< Full, being written by FDS. */
+} buffer_state_t;
+
+static hr_log_record_t m_buffers[2];                                /**< RAM records. FDS writes directly from them. */
+static buffer_state_t  m_buffer_states[2];                          /**< States of the RAM records. */
+static uint8_t         m_active;                                    /**< Index of the RAM record collecting samples. */
+static bool            m_initialized;                               /**< Whether the records in flash have been found. */
+static bool            m_scan_pending;                              /**< Whether the records in flash are to be found once FDS is initialized. */
+static bool            m_gc_pending;                                /**< Whether garbage collection was started for a write. */
+static bool            m_gc_done;                                   /**< Whether garbage collection ran since the last write failed for lack of space. */
+static uint32_t        m_first_record_seq;                          /**< Sequence number of the oldest record in flash. */
+static uint32_t        m_next_record_seq;                           /**< Sequence number of the next record to start. */
+static uint32_t        m_record_cnt;                                /**< Number of records in flash. */
+static uint16_t        m_boot;                                      /**< Number of the current reset. */
+static uint64_t        m_uptime_ticks;                              /**< RTC ticks since reset. */
+static uint32_t        m_last_ticks;                                /**< RTC counter value when the uptime was last updated. */
+static uint32_t        m_dropped_cnt;                               /**< Number of samples dropped. */
+
+
+/**@brief Function for getting the number of seconds since reset.
+ *
+ * @details Must be called at least once per RTC counter overflow period.
+ */
+static uint32_t uptime_get(void)
+{
+        uint32_t now_ticks = app_timer_cnt_get();
+
+        m_uptime_ticks += app_timer_cnt_diff_compute(now_ticks, m_last_ticks);
+        m_last_ticks    = now_ticks;
+
+        return (uint32_t)(m_uptime_ticks / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**@brief Function for starting to collect samples in a RAM record.
+ *
+ * @param[in] idx  Index of the RAM record.
+ */
+static void buffer_start(uint8_t idx)
+{
+        hr_log_record_t * p_record = &m_buffers[idx];
+
+        p_record->seq    = m_next_record_seq++;
+        p_record->time_s = uptime_get();
+        p_record->boot   = m_boot;
+        p_record->count  = 0;
+
+        m_buffer_states[idx] = BUFFER_FILLING;
+        m_active             = idx;
+}
+
+
+/**@brief Function for finding a record in flash.
+ *
+ * @param[in]  record_seq  Sequence number of the record.
+ * @param[out] p_desc      Descriptor of the record.
+ *
+ * @return true if the record was found.
+ */
+static bool record_find(uint32_t record_seq, fds_record_desc_t * p_desc)
+{
+        fds_find_token_t   token;
+        fds_flash_record_t flash_record;
+
+        memset(&token, 0, sizeof(token));
+
+        // Keys wrap around, so check the sequence number as well.
+        while (fds_record_find(HR_LOG_FILE_ID, RECORD_KEY(record_seq), p_desc, &token) == FDS_SUCCESS)
+        {
+                bool found = false;
+
+                if (fds_record_open(p_desc, &flash_record) == FDS_SUCCESS)
+                {
+                        found = (((hr_log_record_t const *)flash_record.p_data)->seq == record_seq);
+                        (void)fds_record_close(p_desc);
+                }
+                if (found)
+                {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+
+/**@brief Function for deleting the oldest record from flash. */
+static void oldest_delete(void)
+{
+        fds_record_desc_t desc;
+
+        if (m_record_cnt == 0)
+        {
+                return;
+        }
+
+        if (record_find(m_first_record_seq, &desc))
+        {
+                if (fds_record_delete(&desc) != FDS_SUCCESS)
+                {
+                        // FDS queue full, try again with the next write.
+                        return;
+                }
+        }
+
+        m_first_record_seq++;
+        m_record_cnt--;
+}
+
+
+/**@brief Function for writing full RAM records to flash. */
+static void buffers_flush(void)
+{
+        ret_code_t err_code;
+
+        if (!m_initialized)
+        {
+                return;
+        }
+
+        for (uint8_t i = 0; i < ARRAY_SIZE(m_buffers); i++)
+        {
+                // Write the older record first.
+                uint8_t idx = (m_active + 1 + i) % ARRAY_SIZE(m_buffers);
+
+                if (m_buffer_states[idx] != BUFFER_WRITE_PENDING)
+                {
+                        continue;
+                }
+
+                if (m_record_cnt >= HR_LOG_MAX_RECORDS)
+                {
+                        oldest_delete();
+                }
+
+                fds_record_t const record =
+                {
+                        .file_id           = HR_LOG_FILE_ID,
+                        .key               = RECORD_KEY(m_buffers[idx].seq),
+                        .data.p_data       = &m_buffers[idx],
+                        .data.length_words = sizeof(hr_log_record_t) / sizeof(uint32_t),
+                };
+
+                err_code = fds_record_write(NULL, &record);
+                if (err_code == FDS_SUCCESS)
+                {
+                        m_buffer_states[idx] = BUFFER_WRITING;
+                }
+                else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+                {
+                        if (m_gc_pending)
+                        {
+                                return;
+                        }
+                        if (m_gc_done)
+                        {
+                                // Garbage collection alone did not help, make room.
+                                oldest_delete();
+                        }
+                        if (fds_gc() == FDS_SUCCESS)
+                        {
+                                m_gc_pending = true;
+                        }
+                        return;
+                }
+                else if ((err_code == FDS_ERR_NO_SPACE_IN_QUEUES) || (err_code == FDS_ERR_BUSY))
+                {
+                        // Retried on the next FDS event.
+                        return;
+                }
+                else
+                {
+                        m_dropped_cnt       += m_buffers[idx].count;
+                        m_buffer_states[idx] = BUFFER_FREE;
+                }
+        }
+}
+
+
+/**@brief Function for handling the completion of a record write.
+ *
+ * @param[in] p_evt  FDS write event.
+ */
+static void on_write(fds_evt_t const * p_evt)
+{
+        for (uint8_t idx = 0; idx < ARRAY_SIZE(m_buffers); idx++)
+        {
+                if ((m_buffer_states[idx] != BUFFER_WRITING) ||
+                    (RECORD_KEY(m_buffers[idx].seq) != p_evt->write.record_key))
+                {
+                        continue;
+                }
+
+                if (p_evt->result != FDS_SUCCESS)
+                {
+                        m_buffer_states[idx] = BUFFER_WRITE_PENDING;
+                        break;
+                }
+
+                m_gc_done = false;
+                if (m_buffers[idx].seq >= m_first_record_seq)
+                {
+                        // Not written before the log was cleared.
+                        m_record_cnt++;
+                }
+
+                CRITICAL_REGION_ENTER();
+                m_buffer_states[idx] = BUFFER_FREE;
+                if (m_buffer_states[m_active] != BUFFER_FILLING)
+                {
+                        buffer_start(idx);
+                }
+                CRITICAL_REGION_EXIT();
+                break;
+        }
+}
+
+
+/**@brief Function for finding the records already stored in flash. */
+static ret_code_t log_scan(void)
+{
+        ret_code_t         err_code;
+        fds_record_desc_t  desc;
+        fds_find_token_t   token;
+        fds_flash_record_t flash_record;
+        uint32_t           min_seq  = UINT32_MAX;
+        uint32_t           max_seq  = 0;
+        uint16_t           max_boot = 0;
+
+        memset(&token, 0, sizeof(token));
+
+        m_record_cnt = 0;
+
+        err_code = fds_record_find_in_file(HR_LOG_FILE_ID, &desc, &token);
+        while (err_code == FDS_SUCCESS)
+        {
+                err_code = fds_record_open(&desc, &flash_record);
+                if (err_code != FDS_SUCCESS)
+                {
+                        return err_code;
+                }
+
+                hr_log_record_t const * p_record = flash_record.p_data;
+
+                min_seq  = MIN(min_seq, p_record->seq);
+                max_seq  = MAX(max_seq, p_record->seq);
+                max_boot = MAX(max_boot, p_record->boot);
+                m_record_cnt++;
+
+                err_code = fds_record_close(&desc);
+                if (err_code != FDS_SUCCESS)
+                {
+                        return err_code;
+                }
+
+                err_code = fds_record_find_in_file(HR_LOG_FILE_ID, &desc, &token);
+        }
+
+        if (err_code != FDS_ERR_NOT_FOUND)
+        {
+                return err_code;
+        }
+
+        CRITICAL_REGION_ENTER();
+
+        // Samples taken before the scan were numbered from 0, move them behind the stored records.
+        uint32_t base_seq = (m_record_cnt != 0) ? max_seq + 1 : 0;
+
+        m_boot              = (m_record_cnt != 0) ? max_boot + 1 : 0;
+        m_next_record_seq  += base_seq;
+        m_first_record_seq  = (m_record_cnt != 0) ? min_seq : base_seq;
+
+        for (uint8_t idx = 0; idx < ARRAY_SIZE(m_buffers); idx++)
+        {
+                m_buffers[idx].seq += base_seq;
+                m_buffers[idx].boot = m_boot;
+        }
+
+        m_initialized = true;
+
+        CRITICAL_REGION_EXIT();
+
+        buffers_flush();
+
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t hr_log_init(void)
+{
+        ret_code_t err_code;
+
+        m_last_ticks = app_timer_cnt_get();
+        buffer_start(0);
+
+        err_code = log_scan();
+        if (err_code == FDS_ERR_NOT_INITIALIZED)
+        {
+                // Scanned on FDS_EVT_INIT.
+                m_scan_pending = true;
+                return NRF_SUCCESS;
+        }
+
+        return err_code;
+}
+
+
+void hr_log_on_fds_evt(fds_evt_t const * p_evt)
+{
+        switch (p_evt->id)
+        {
+        case FDS_EVT_INIT:
+                if ((p_evt->result == FDS_SUCCESS) && m_scan_pending)
+                {
+                        m_scan_pending = false;
+                        (void)log_scan();
+                }
+                break;
+
+        case FDS_EVT_WRITE:
+                if (p_evt->write.file_id == HR_LOG_FILE_ID)
+                {
+                        on_write(p_evt);
+                }
+                break;
+
+        case FDS_EVT_DEL_FILE:
+                if (p_evt->del.file_id == HR_LOG_FILE_ID)
+                {
+                        (void)fds_gc();
+                }
+                break;
+
+        case FDS_EVT_GC:
+                if (m_gc_pending)
+                {
+                        m_gc_pending = false;
+                        m_gc_done    = true;
+                }
+                break;
+
+        default:
+                break;
+        }
+
+        // Any completed operation may have freed room in the FDS queue or in flash.
+        buffers_flush();
+}
+
+
+void hr_log_append(uint16_t heart_rate)
+{
+        bool full = false;
+
+        CRITICAL_REGION_ENTER();
+
+        hr_log_record_t * p_record = &m_buffers[m_active];
+
+        if (m_buffer_states[m_active] != BUFFER_FILLING)
+        {
+                m_dropped_cnt++;
+        }
+        else
+        {
+                uint32_t offset_s = uptime_get() - p_record->time_s;
+
+                p_record->samples[p_record->count].time_offset_s = (uint16_t)MIN(offset_s, UINT16_MAX);
+                p_record->samples[p_record->count].heart_rate    = heart_rate;
+                p_record->count++;
+
+                if (p_record->count == HR_LOG_SAMPLES_PER_RECORD)
+                {
+                        uint8_t other = m_active ^ 1;
+
+                        m_buffer_states[m_active] = BUFFER_WRITE_PENDING;
+                        if (m_buffer_states[other] == BUFFER_FREE)
+                        {
+                                buffer_start(other);
+                        }
+                        full = true;
+                }
+        }
+
+        CRITICAL_REGION_EXIT();
+
+        if (full)
+        {
+                buffers_flush();
+        }
+}
+
+
+bool hr_log_range_get(uint32_t * p_first_seq, uint32_t * p_last_seq)
+{
+        uint32_t end_seq = 0;
+
+        if (!m_initialized)
+        {
+                return false;
+        }
+
+        CRITICAL_REGION_ENTER();
+        for (uint8_t idx = 0; idx < ARRAY_SIZE(m_buffers); idx++)
+        {
+                if (m_buffer_states[idx] != BUFFER_FREE)
+                {
+                        end_seq = MAX(end_seq, m_buffers[idx].seq * HR_LOG_SAMPLES_PER_RECORD + m_buffers[idx].count);
+                }
+        }
+        CRITICAL_REGION_EXIT();
+
+        *p_first_seq = m_first_record_seq * HR_LOG_SAMPLES_PER_RECORD;
+
+        if (end_seq <= *p_first_seq)
+        {
+                return false;
+        }
+
+        *p_last_seq = end_seq - 1;
+
+        return true;
+}
+
+
+/**@brief Function for copying samples out of a record.
+ *
+ * @return Number of samples copied.
+ */
+static uint16_t record_read(hr_log_record_t const * p_record,
+                            uint16_t                idx,
+                            hr_log_sample_t       * p_samples,
+                            uint16_t                max_cnt)
+{
+        uint16_t cnt = 0;
+
+        while ((cnt < max_cnt) && (idx + cnt < p_record->count))
+        {
+                p_samples[cnt].seq        = p_record->seq * HR_LOG_SAMPLES_PER_RECORD + idx + cnt;
+                p_samples[cnt].time_s     = p_record->time_s + p_record->samples[idx + cnt].time_offset_s;
+                p_samples[cnt].boot       = p_record->boot;
+                p_samples[cnt].heart_rate = p_record->samples[idx + cnt].heart_rate;
+                cnt++;
+        }
+
+        return cnt;
+}
+
+
+uint16_t hr_log_read(uint32_t seq, hr_log_sample_t * p_samples, uint16_t max_cnt)
+{
+        fds_record_desc_t  desc;
+        fds_flash_record_t flash_record;
+        uint32_t           record_seq = seq / HR_LOG_SAMPLES_PER_RECORD;
+        uint16_t           idx        = seq % HR_LOG_SAMPLES_PER_RECORD;
+        uint16_t           cnt        = 0;
+        bool               in_ram     = false;
+
+        if (!m_initialized || (record_seq < m_first_record_seq))
+        {
+                return 0;
+        }
+
+        // Records not yet in flash are read from RAM.
+        CRITICAL_REGION_ENTER();
+        for (uint8_t i = 0; i < ARRAY_SIZE(m_buffers); i++)
+        {
+                if ((m_buffer_states[i] != BUFFER_FREE) && (m_buffers[i].seq == record_seq))
+                {
+                        cnt    = record_read(&m_buffers[i], idx, p_samples, max_cnt);
+                        in_ram = true;
+                        break;
+                }
+        }
+        CRITICAL_REGION_EXIT();
+
+        if (in_ram || !record_find(record_seq, &desc))
+        {
+                return cnt;
+        }
+
+        if (fds_record_open(&desc, &flash_record) == FDS_SUCCESS)
+        {
+                cnt = record_read(flash_record.p_data, idx, p_samples, max_cnt);
+                (void)fds_record_close(&desc);
+        }
+
+        return cnt;
+}
+
+
+ret_code_t hr_log_clear(void)
+{
+        ret_code_t err_code;
+
+        if (!m_initialized)
+        {
+                return NRF_ERROR_INVALID_STATE;
+        }
+
+        if ((m_buffer_states[0] == BUFFER_WRITING) && (m_buffer_states[1] == BUFFER_WRITING))
+        {
+                // No RAM record is free to restart the log in, FDS still writes from both.
+                return NRF_ERROR_BUSY;
+        }
+
+        err_code = fds_file_delete(HR_LOG_FILE_ID);
+        if (err_code != FDS_SUCCESS)
+        {
+                return err_code;
+        }
+
+        CRITICAL_REGION_ENTER();
+        for (uint8_t idx = 0; idx < ARRAY_SIZE(m_buffers); idx++)
+        {
+                // Records already handed to FDS are deleted with the file.
+                if (m_buffer_states[idx] != BUFFER_WRITING)
+                {
+                        m_buffer_states[idx] = BUFFER_FREE;
+                }
+        }
+        buffer_start((m_buffer_states[0] == BUFFER_FREE) ? 0 : 1);
+        m_first_record_seq = m_buffers[m_active].seq;
+        m_record_cnt       = 0;
+        CRITICAL_REGION_EXIT();
+
+        return NRF_SUCCESS;
+}
+
+
+uint32_t hr_log_dropped_cnt_get(void)
+{
+        return m_dropped_cnt;
+}
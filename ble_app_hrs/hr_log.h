@@ -0,0 +1,120 @@
+/** @file
+ *
+ * @defgroup hr_log Heart rate history log
+ * @{
+ * @brief Append-only circular log of timestamped heart rate samples in flash.
+ *
+ * @details Samples are collected in RAM and written to FDS one record of @ref HR_LOG_RECORD_SIZE
+ *          bytes at a time, so flash is written once every @ref HR_LOG_SAMPLES_PER_RECORD samples.
+ *          Two RAM records alternate: one collects samples while the other is being written.
+ *          When the log holds @ref HR_LOG_MAX_RECORDS records, the oldest one is deleted.
+ *
+ *          Every sample has a sequence number that keeps increasing across resets, so a host can
+ *          fetch only what it has not seen yet. Timestamps count seconds since the reset given
+ *          by the boot number of the sample.
+ *
+ *          The module uses the FDS instance of the Peer Manager. The application must forward
+ *          its FDS events to @ref hr_log_on_fds_evt. Three log records fit in a virtual page, so
+ *          the log takes 6 pages, and FDS_VIRTUAL_PAGES must also cover @ref HR_LOG_PM_PAGES
+ *          and the garbage collection page. This is checked at compile time.
+ */
+#ifndef HR_LOG_H__
+#define HR_LOG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "fds.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HR_LOG_FILE_ID                 0x4852                       /**< FDS file of the log. The Peer Manager uses file IDs from 0xC000. */
+#define HR_LOG_RECORD_SIZE             1024                         /**< Size of one log record in bytes, a quarter of a virtual flash page. */
+#define HR_LOG_RECORD_HEADER_SIZE      12                           /**< Size of the header of a log record in bytes. */
+#define HR_LOG_SAMPLES_PER_RECORD      ((HR_LOG_RECORD_SIZE - HR_LOG_RECORD_HEADER_SIZE) / 4)   /**< Number of samples in one log record. */
+#define HR_LOG_MAX_RECORDS             16                           /**< Number of records kept in flash. */
+#define HR_LOG_PM_PAGES                3                            /**< Virtual flash pages left to the Peer Manager for bonds. */
+
+/**@brief Heart rate sample read from the log. */
+typedef struct
+{
+        uint32_t seq;                                               /**< Sequence number of the sample. */
+        uint32_t time_s;                                            /**< Seconds since the reset the sample was taken after. */
+        uint16_t boot;                                              /**< Number of the reset the sample was taken after. */
+        uint16_t heart_rate;                                        /**< Heart rate. */
+} hr_log_sample_t;
+
+
+/**@brief Function for initializing the log.
+ *
+ * @details Finds the records already stored. If FDS is not initialized yet, this is done on
+ *          @ref FDS_EVT_INIT.
+ *
+ * @retval NRF_SUCCESS  If the log was initialized or waits for FDS.
+ * @return Otherwise an FDS error code.
+ */
+ret_code_t hr_log_init(void);
+
+
+/**@brief Function for handling FDS events.
+ *
+ * @param[in] p_evt  Event received from FDS.
+ */
+void hr_log_on_fds_evt(fds_evt_t const * p_evt);
+
+
+/**@brief Function for adding a heart rate sample to the log.
+ *
+ * @details The sample is dropped if both RAM records are full, i.e. flash writes do not keep up.
+ *
+ * @param[in] heart_rate  Heart rate.
+ */
+void hr_log_append(uint16_t heart_rate);
+
+
+/**@brief Function for getting the sequence numbers of the oldest and the newest sample.
+ *
+ * @param[out] p_first_seq  Sequence number of the oldest sample.
+ * @param[out] p_last_seq   Sequence number of the newest sample.
+ *
+ * @return false if the log is empty.
+ */
+bool hr_log_range_get(uint32_t * p_first_seq, uint32_t * p_last_seq);
+
+
+/**@brief Function for reading consecutive samples.
+ *
+ * @details Reading stops at the end of the log or of the record holding @p seq, whichever
+ *          comes first.
+ *
+ * @param[in]  seq        Sequence number of the first sample to read.
+ * @param[out] p_samples  Samples read.
+ * @param[in]  max_cnt    Maximum number of samples to read.
+ *
+ * @return Number of samples read, 0 if the sample @p seq is not in the log.
+ */
+uint16_t hr_log_read(uint32_t seq, hr_log_sample_t * p_samples, uint16_t max_cnt);
+
+
+/**@brief Function for deleting all samples from the log.
+ *
+ * @retval NRF_SUCCESS      If the log was cleared.
+ * @retval NRF_ERROR_BUSY   If FDS is still writing both RAM records. Try again later.
+ * @return Otherwise an FDS error code.
+ */
+ret_code_t hr_log_clear(void);
+
+
+/**@brief Function for getting the number of samples dropped because flash did not keep up. */
+uint32_t hr_log_dropped_cnt_get(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HR_LOG_H__
+
+/** @} */
@@ -0,0 +1,374 @@
+/** @file
+ *
+ * @brief Heart Rate Measurement TX queue module.
+ */
+#include <string.h>
+#include "hrm_tx_queue.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "app_timer.h"
+#include "ble.h"
+#include "ble_err.h"
+
+
+#define LL_PDU_OVERHEAD                10                           /**< Bytes on air per Link Layer PDU besides the payload (preamble, access address, header and CRC). */
+#define L2CAP_ATT_HVX_OVERHEAD         7                            /**< L2CAP header plus ATT opcode and handle of a notification. */
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+static hrm_tx_queue_t m_queues[NRF_SDH_BLE_TOTAL_LINK_COUNT];       /**< Queues, indexed by connection handle. */
+static uint16_t       m_value_handle;                               /**< Handle of the Heart Rate Measurement value. */
+static hrm_tx_queue_air_handler_t m_air_handler;                    /**< Handler of the measurements transmitted. */
+
+
+/**@brief Function for dropping every queued measurement of a link.
+ *
+ * @param[in] p_queue  Queue of the link.
+ */
+static void queue_flush(hrm_tx_queue_t * p_queue)
+{
+        p_queue->dropped_cnt += p_queue->count;
+        p_queue->count        = 0;
+}
+
+
+/**@brief Function for getting a queued measurement.
+ *
+ * @param[in] p_queue  Queue of the link.
+ * @param[in] idx      Position in the queue, 0 for the oldest.
+ */
+static hrm_packet_t * queue_packet(hrm_tx_queue_t * p_queue, uint8_t idx)
+{
+        return &p_queue->packets[(p_queue->head + idx) % HRM_TX_QUEUE_SIZE];
+}
+
+
+/**@brief Function for inserting a measurement into a queue by sample time.
+ *
+ * @details If the queue is full, the oldest of its measurements and the new one is dropped.
+ *
+ * @param[in] p_queue   Queue of the link.
+ * @param[in] p_packet  Measurement to insert.
+ *
+ * @return false if the new measurement was dropped.
+ */
+static bool queue_insert(hrm_tx_queue_t * p_queue, hrm_packet_t const * p_packet)
+{
+        uint8_t pos;
+
+        p_queue->queued_cnt++;
+
+        if (p_queue->count == HRM_TX_QUEUE_SIZE)
+        {
+                p_queue->dropped_cnt++;
+                if (!hrm_tx_queue_is_newer(p_packet->sample_ticks, queue_packet(p_queue, 0)->sample_ticks))
+                {
+                        return false;
+                }
+                p_queue->head = (p_queue->head + 1) % HRM_TX_QUEUE_SIZE;
+                p_queue->count--;
+        }
+
+        for (pos = p_queue->count;
+             (pos > 0) && hrm_tx_queue_is_newer(queue_packet(p_queue, pos - 1)->sample_ticks, p_packet->sample_ticks);
+             pos--)
+        {
+                *queue_packet(p_queue, pos) = *queue_packet(p_queue, pos - 1);
+        }
+
+        *queue_packet(p_queue, pos) = *p_packet;
+        p_queue->count++;
+
+        return true;
+}
+
+
+/**@brief Function for checking whether a queue holds a measurement of a sample time.
+ *
+ * @param[in] p_queue       Queue of the link.
+ * @param[in] sample_ticks  Sample time.
+ */
+static bool queue_has(hrm_tx_queue_t * p_queue, uint32_t sample_ticks)
+{
+        for (uint8_t i = 0; i < p_queue->count; i++)
+        {
+                if (queue_packet(p_queue, i)->sample_ticks == sample_ticks)
+                {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+
+void hrm_tx_queue_init(uint16_t value_handle, hrm_tx_queue_air_handler_t air_handler)
+{
+        m_value_handle = value_handle;
+        m_air_handler  = air_handler;
+
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                hrm_tx_queue_reset(&m_queues[i], BLE_CONN_HANDLE_INVALID);
+        }
+}
+
+
+hrm_tx_queue_t * hrm_tx_queue_get(uint16_t conn_handle)
+{
+        if (conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                return NULL;
+        }
+        return &m_queues[conn_handle];
+}
+
+
+void hrm_tx_queue_reset(hrm_tx_queue_t * p_queue, uint16_t conn_handle)
+{
+        memset(p_queue, 0, sizeof(hrm_tx_queue_t));
+        p_queue->conn_handle    = conn_handle;
+        p_queue->credits        = HVN_TX_QUEUE_SIZE;
+        p_queue->max_hrm_len    = HRM_DEFAULT_LEN;
+        p_queue->ll_payload_len = LL_DEFAULT_PAYLOAD_LEN;
+}
+
+
+bool hrm_tx_queue_is_newer(uint32_t sample_ticks, uint32_t than_ticks)
+{
+        uint32_t diff = app_timer_cnt_diff_compute(sample_ticks, than_ticks);
+
+        return (diff != 0) && (diff <= (APP_TIMER_MAX_CNT_VAL / 2));
+}
+
+
+void hrm_tx_queue_encode(uint16_t       heart_rate,
+                         uint8_t        contact_flags,
+                         rr_ring_t    * p_ring,
+                         uint16_t       max_len,
+                         hrm_packet_t * p_packet)
+{
+        uint8_t * p_encoded_buffer = p_packet->data;
+        uint8_t  flags  = contact_flags & (HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED |
+                                           HRM_FLAG_MASK_SENSOR_CONTACT_DETECTED);
+        uint16_t len    = 1;
+        uint8_t  rr_cnt = 0;
+        uint16_t rr_interval;
+
+        // Encode heart rate measurement.
+        if (heart_rate > 0xff)
+        {
+                flags |= HRM_FLAG_MASK_HR_VALUE_16BIT;
+                len   += uint16_encode(heart_rate, &p_encoded_buffer[len]);
+        }
+        else
+        {
+                p_encoded_buffer[len++] = (uint8_t)heart_rate;
+        }
+
+        // Encode RR interval values, the ones that do not fit stay in the ring.
+        while ((len + sizeof(uint16_t) <= max_len) && rr_ring_pop(p_ring, &rr_interval))
+        {
+                len += uint16_encode(rr_interval, &p_encoded_buffer[len]);
+                rr_cnt++;
+        }
+        if (rr_cnt > 0)
+        {
+                flags |= HRM_FLAG_MASK_RR_INTERVAL_INCLUDED;
+        }
+
+        p_encoded_buffer[0] = flags;
+
+        p_packet->len    = len;
+        p_packet->rr_cnt = rr_cnt;
+}
+
+
+uint32_t hrm_tx_queue_air_bytes_get(hrm_tx_queue_t const * p_queue, uint16_t len)
+{
+        uint32_t l2cap_len = len + L2CAP_ATT_HVX_OVERHEAD;
+        uint32_t pdu_cnt   = CEIL_DIV(l2cap_len, p_queue->ll_payload_len);
+
+        return l2cap_len + (pdu_cnt * LL_PDU_OVERHEAD);
+}
+
+
+void hrm_tx_queue_inflight_push(hrm_tx_queue_t * p_queue, bool is_hrm, uint32_t sample_ticks)
+{
+        if (p_queue->inflight_cnt < HVN_TX_QUEUE_SIZE)
+        {
+                hvn_inflight_t * p_inflight =
+                        &p_queue->inflight[(p_queue->inflight_head + p_queue->inflight_cnt) % HVN_TX_QUEUE_SIZE];
+
+                p_inflight->is_hrm       = is_hrm;
+                p_inflight->sample_ticks = sample_ticks;
+                p_queue->inflight_cnt++;
+        }
+}
+
+
+ret_code_t hrm_tx_queue_drain(hrm_tx_queue_t * p_queue)
+{
+        ret_code_t err_code;
+
+        while ((p_queue->count > 0) && (p_queue->credits > 0))
+        {
+                hrm_packet_t const * p_packet = &p_queue->packets[p_queue->head];
+                uint16_t len                  = p_packet->len;
+                ble_gatts_hvx_params_t hvx_params;
+
+                memset(&hvx_params, 0, sizeof(hvx_params));
+
+                hvx_params.handle = m_value_handle;
+                hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+                hvx_params.offset = 0;
+                hvx_params.p_len  = &len;
+                hvx_params.p_data = p_packet->data;
+
+                err_code = sd_ble_gatts_hvx(p_queue->conn_handle, &hvx_params);
+                if (err_code == NRF_ERROR_RESOURCES)
+                {
+                        // Other notifications (e.g. Battery Level) use the same slots. Wait for TX complete.
+                        p_queue->credits = 0;
+                        p_queue->busy_cnt++;
+                        break;
+                }
+                else if ((err_code == NRF_ERROR_INVALID_STATE) ||
+                         (err_code == BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+                {
+                        // Notifications are not enabled on this link, nobody is waiting for the queued data.
+                        queue_flush(p_queue);
+                        return NRF_ERROR_INVALID_STATE;
+                }
+                else if (err_code == BLE_ERROR_INVALID_CONN_HANDLE)
+                {
+                        // The link is gone, its disconnect event has not been handled yet.
+                        queue_flush(p_queue);
+                        return BLE_ERROR_INVALID_CONN_HANDLE;
+                }
+                else if (err_code != NRF_SUCCESS)
+                {
+                        APP_ERROR_HANDLER(err_code);
+                }
+
+                p_queue->credits--;
+                p_queue->head = (p_queue->head + 1) % HRM_TX_QUEUE_SIZE;
+                p_queue->count--;
+                p_queue->sent_cnt++;
+                p_queue->last_sent_ticks = p_packet->sample_ticks;
+                p_queue->rr_sent_cnt   += p_packet->rr_cnt;
+                p_queue->air_bytes_cnt += hrm_tx_queue_air_bytes_get(p_queue, len);
+
+                hrm_tx_queue_inflight_push(p_queue, true, p_packet->sample_ticks);
+        }
+
+        return NRF_SUCCESS;
+}
+
+
+void hrm_tx_queue_merge(hrm_tx_queue_t              * p_dst,
+                        hrm_tx_queue_t              * p_src,
+                        hrm_tx_queue_merge_result_t * p_result)
+{
+        memset(p_result, 0, sizeof(hrm_tx_queue_merge_result_t));
+
+        while (p_src->count > 0)
+        {
+                hrm_packet_t const * p_packet = queue_packet(p_src, 0);
+
+                if (((p_dst->sent_cnt > 0) &&
+                     !hrm_tx_queue_is_newer(p_packet->sample_ticks, p_dst->last_sent_ticks)) ||
+                    queue_has(p_dst, p_packet->sample_ticks))
+                {
+                        p_result->skipped_cnt++;
+                }
+                else if (p_packet->len > p_dst->max_hrm_len)
+                {
+                        // Encoded for the ATT payload of the other host.
+                        p_result->dropped_cnt++;
+                }
+                else
+                {
+                        uint32_t dropped_was = p_dst->dropped_cnt;
+
+                        if (queue_insert(p_dst, p_packet))
+                        {
+                                p_result->moved_cnt++;
+                        }
+                        p_result->dropped_cnt += p_dst->dropped_cnt - dropped_was;
+                }
+
+                p_src->head = (p_src->head + 1) % HRM_TX_QUEUE_SIZE;
+                p_src->count--;
+                p_src->handed_over_cnt++;
+        }
+}
+
+
+ret_code_t hrm_tx_queue_put(hrm_tx_queue_t * p_queue, hrm_packet_t const * p_hrm)
+{
+        ret_code_t err_code;
+
+        CRITICAL_REGION_ENTER();
+
+        if (p_queue->count == HRM_TX_QUEUE_SIZE)
+        {
+                p_queue->head = (p_queue->head + 1) % HRM_TX_QUEUE_SIZE;
+                p_queue->count--;
+                p_queue->dropped_cnt++;
+        }
+
+        hrm_packet_t * p_packet = &p_queue->packets[(p_queue->head + p_queue->count) % HRM_TX_QUEUE_SIZE];
+
+        memcpy(p_packet->data, p_hrm->data, p_hrm->len);
+        p_packet->len          = p_hrm->len;
+        p_packet->rr_cnt       = p_hrm->rr_cnt;
+        p_packet->sample_ticks = p_hrm->sample_ticks;
+        p_queue->count++;
+        p_queue->queued_cnt++;
+
+        err_code = hrm_tx_queue_drain(p_queue);
+
+        CRITICAL_REGION_EXIT();
+
+        return err_code;
+}
+
+
+ret_code_t hrm_tx_queue_on_tx_complete(hrm_tx_queue_t * p_queue, uint8_t count, uint32_t now_ticks)
+{
+        ret_code_t err_code;
+
+        CRITICAL_REGION_ENTER();
+
+        for (uint8_t i = 0; (i < count) && (p_queue->inflight_cnt > 0); i++)
+        {
+                hvn_inflight_t const * p_inflight = &p_queue->inflight[p_queue->inflight_head];
+
+                if (p_inflight->is_hrm)
+                {
+                        uint32_t latency_ms =
+                                TICKS_TO_MS(app_timer_cnt_diff_compute(now_ticks, p_inflight->sample_ticks));
+
+                        p_queue->latency_cnt++;
+                        p_queue->latency_sum_ms += latency_ms;
+                        p_queue->latency_max_ms  = MAX(p_queue->latency_max_ms, latency_ms);
+                        p_queue->last_air_ticks  = p_inflight->sample_ticks;
+
+                        if (m_air_handler != NULL)
+                        {
+                                m_air_handler(p_queue->conn_handle, p_inflight->sample_ticks);
+                        }
+                }
+                p_queue->inflight_head = (p_queue->inflight_head + 1) % HVN_TX_QUEUE_SIZE;
+                p_queue->inflight_cnt--;
+        }
+
+        p_queue->credits = MIN(p_queue->credits + count, HVN_TX_QUEUE_SIZE);
+        err_code = hrm_tx_queue_drain(p_queue);
+
+        CRITICAL_REGION_EXIT();
+
+        return err_code;
+}
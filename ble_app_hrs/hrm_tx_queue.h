@@ -0,0 +1,250 @@
+/** @file
+ *
+ * @defgroup hrm_tx_queue Heart Rate Measurement TX queue
+ * @{
+ * @brief Per-link queue of encoded Heart Rate Measurements waiting for a SoftDevice TX slot.
+ *
+ * @details Measurements are queued here and handed to the SoftDevice only while the link has
+ *          free TX slots (credits). Credits are returned on BLE_GATTS_EVT_HVN_TX_COMPLETE, which
+ *          drains the queue again, so a burst of samples is delayed instead of lost. Every link
+ *          has its own queue and credits, so a slow host only delays its own measurements.
+ *
+ *          Other notifications of a link (waveform, log) use the same credits. Their senders take
+ *          a credit and record the notification with @ref hrm_tx_queue_inflight_push.
+ *
+ *          The module does not touch the connection state of the application. When the SoftDevice
+ *          reports that notifications are off or the link is gone, the queue is flushed and the
+ *          error is returned, so that the caller can act on it outside any critical region.
+ */
+#ifndef HRM_TX_QUEUE_H__
+#define HRM_TX_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "sdk_config.h"
+#include "ble_gatt.h"
+#include "rr_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HVN_TX_QUEUE_SIZE              8                            /**< Number of notifications the SoftDevice may hold per link, i.e. the TX credits shared by all notifying characteristics of a link. */
+#define HRM_TX_QUEUE_SIZE              8                            /**< Number of encoded Heart Rate Measurements buffered per link while the SoftDevice has no free TX slot. */
+#define HRM_MAX_LEN                    (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)  /**< Maximum length of an encoded Heart Rate Measurement (MTU minus ATT opcode and handle). */
+#define HRM_DEFAULT_LEN                (BLE_GATT_ATT_MTU_DEFAULT - 3)       /**< Length of an encoded Heart Rate Measurement until the ATT MTU has been exchanged. */
+#define LL_DEFAULT_PAYLOAD_LEN         27                           /**< Link Layer PDU payload length until the data length has been updated. */
+
+#define HRM_FLAG_MASK_HR_VALUE_16BIT            (0x01 << 0)         /**< Heart Rate Value Format bit. */
+#define HRM_FLAG_MASK_SENSOR_CONTACT_DETECTED   (0x01 << 1)         /**< Sensor Contact Detected bit. */
+#define HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED  (0x01 << 2)         /**< Sensor Contact Supported bit. */
+#define HRM_FLAG_MASK_RR_INTERVAL_INCLUDED      (0x01 << 4)         /**< RR-Interval bit. */
+
+/**@brief Encoded Heart Rate Measurement waiting for a SoftDevice TX slot. */
+typedef struct
+{
+        uint16_t len;                                               /**< Length of the encoded measurement. */
+        uint8_t  rr_cnt;                                            /**< Number of RR intervals in the encoded measurement. */
+        uint32_t sample_ticks;                                      /**< RTC counter value when the heart rate was sampled. */
+        uint8_t  data[HRM_MAX_LEN];                                 /**< Encoded measurement. */
+} hrm_packet_t;
+
+/**@brief Notification held by the SoftDevice until it is transmitted. */
+typedef struct
+{
+        bool     is_hrm;                                            /**< Whether the notification is a Heart Rate Measurement. */
+        uint32_t sample_ticks;                                      /**< RTC counter value when the heart rate was sampled. */
+} hvn_inflight_t;
+
+/**@brief Measurements of a queue merged into the queue of another link. */
+typedef struct
+{
+        uint32_t moved_cnt;                                         /**< Measurements moved to the other link. */
+        uint32_t skipped_cnt;                                       /**< Measurements the other link already has, or older than the newest it was sent. */
+        uint32_t dropped_cnt;                                       /**< Measurements that did not fit the ATT payload or the queue of the other link. */
+} hrm_tx_queue_merge_result_t;
+
+/**@brief Handler of a Heart Rate Measurement transmitted on a link.
+ *
+ * @param[in] conn_handle   Link the measurement was transmitted on.
+ * @param[in] sample_ticks  RTC counter value when the heart rate was sampled.
+ */
+typedef void (*hrm_tx_queue_air_handler_t)(uint16_t conn_handle, uint32_t sample_ticks);
+
+/**@brief Outbound Heart Rate Measurement queue of one link. */
+typedef struct
+{
+        uint16_t     conn_handle;                                   /**< Handle of the link, BLE_CONN_HANDLE_INVALID if unused. */
+        uint8_t      credits;                                       /**< Free SoftDevice TX slots of the link. */
+        uint8_t      head;                                          /**< Index of the oldest queued measurement. */
+        uint8_t      count;                                         /**< Number of queued measurements. */
+        uint16_t     max_hrm_len;                                   /**< Maximum length of an encoded measurement on this link, from the effective ATT MTU. */
+        uint8_t      ll_payload_len;                                /**< Link Layer PDU payload length of the link. */
+        hrm_packet_t packets[HRM_TX_QUEUE_SIZE];                    /**< Queued measurements. */
+        uint32_t     queued_cnt;                                    /**< Number of measurements queued. */
+        uint32_t     sent_cnt;                                      /**< Number of measurements handed to the SoftDevice. */
+        uint32_t     dropped_cnt;                                   /**< Number of measurements dropped because the queue was full or the link went away. */
+        uint32_t     handed_over_cnt;                               /**< Number of measurements passed on by @ref hrm_tx_queue_merge, whatever became of them there. */
+        uint32_t     last_sent_ticks;                               /**< Sample time of the newest measurement handed to the SoftDevice, valid if sent_cnt is not 0. */
+        uint32_t     last_air_ticks;                                /**< Sample time of the newest measurement transmitted, valid if latency_cnt is not 0. */
+        uint32_t     busy_cnt;                                      /**< Number of times the SoftDevice had no free TX slot for the link. */
+        uint32_t     rr_sent_cnt;                                   /**< Number of RR intervals handed to the SoftDevice. */
+        uint32_t     air_bytes_cnt;                                 /**< Estimated bytes on air of the measurements handed to the SoftDevice. */
+        hvn_inflight_t inflight[HVN_TX_QUEUE_SIZE];                 /**< Notifications held by the SoftDevice, oldest first. */
+        uint8_t      inflight_head;                                 /**< Index of the oldest notification held by the SoftDevice. */
+        uint8_t      inflight_cnt;                                  /**< Number of notifications held by the SoftDevice. */
+        uint32_t     latency_cnt;                                   /**< Number of sample-to-air latencies measured. */
+        uint32_t     latency_sum_ms;                                /**< Sum of the sample-to-air latencies (in ms). */
+        uint32_t     latency_max_ms;                                /**< Largest sample-to-air latency (in ms). */
+} hrm_tx_queue_t;
+
+
+/**@brief Function for initializing the queues of all links.
+ *
+ * @param[in] value_handle  Handle of the Heart Rate Measurement value the queues notify.
+ * @param[in] air_handler   Handler called for every measurement transmitted, from the critical
+ *                          region of @ref hrm_tx_queue_on_tx_complete. May be NULL.
+ */
+void hrm_tx_queue_init(uint16_t value_handle, hrm_tx_queue_air_handler_t air_handler);
+
+
+/**@brief Function for getting the queue of a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ *
+ * @return Pointer to the queue, or NULL if the handle is not a valid link.
+ */
+hrm_tx_queue_t * hrm_tx_queue_get(uint16_t conn_handle);
+
+
+/**@brief Function for resetting the queue of a link.
+ *
+ * @param[in] p_queue      Queue to reset.
+ * @param[in] conn_handle  Connection handle of the link, or BLE_CONN_HANDLE_INVALID.
+ */
+void hrm_tx_queue_reset(hrm_tx_queue_t * p_queue, uint16_t conn_handle);
+
+
+/**@brief Function for checking whether a sample time is later than another.
+ *
+ * @details Sample times are RTC counter values, so they wrap. Times half the counter range or
+ *          more apart are taken as wrapped.
+ *
+ * @param[in] sample_ticks  Sample time to check.
+ * @param[in] than_ticks    Sample time to compare with.
+ *
+ * @return true if @p sample_ticks is later than @p than_ticks.
+ */
+bool hrm_tx_queue_is_newer(uint32_t sample_ticks, uint32_t than_ticks);
+
+
+/**@brief Function for encoding a Heart Rate Measurement.
+ *
+ * @details Same encoding as the Heart Rate Service module, but packs as many buffered RR
+ *          intervals as fit in @p max_len, i.e. in the negotiated ATT payload of the link. The
+ *          ones that do not fit are kept in the ring for the next measurement.
+ *
+ * @param[in]  heart_rate     Measurement to be encoded.
+ * @param[in]  contact_flags  HRM_FLAG_MASK_SENSOR_CONTACT_* flags of the measurement.
+ * @param[in]  p_ring         RR intervals to pack. The caller must be its only consumer.
+ * @param[in]  max_len        Maximum length of the encoded measurement.
+ * @param[out] p_packet       Packet where the encoded measurement will be written.
+ */
+void hrm_tx_queue_encode(uint16_t       heart_rate,
+                         uint8_t        contact_flags,
+                         rr_ring_t    * p_ring,
+                         uint16_t       max_len,
+                         hrm_packet_t * p_packet);
+
+
+/**@brief Function for estimating the bytes on air of a notification.
+ *
+ * @details Counts the L2CAP and ATT headers and the Link Layer overhead of every PDU the
+ *          notification is fragmented into. Empty PDUs and retransmissions are not counted.
+ *
+ * @param[in] p_queue  Queue of the link the notification is sent on.
+ * @param[in] len      Length of the notification value.
+ *
+ * @return Estimated number of bytes on air.
+ */
+uint32_t hrm_tx_queue_air_bytes_get(hrm_tx_queue_t const * p_queue, uint16_t len);
+
+
+/**@brief Function for recording a notification handed to the SoftDevice.
+ *
+ * @param[in] p_queue       Queue of the link.
+ * @param[in] is_hrm        Whether the notification is a Heart Rate Measurement.
+ * @param[in] sample_ticks  RTC counter value when the heart rate was sampled.
+ */
+void hrm_tx_queue_inflight_push(hrm_tx_queue_t * p_queue, bool is_hrm, uint32_t sample_ticks);
+
+
+/**@brief Function for handing queued measurements to the SoftDevice.
+ *
+ * @details Sends as many measurements as the link has free TX slots. Must be called with the
+ *          queue protected against concurrent access.
+ *
+ * @param[in] p_queue  Queue of the link.
+ *
+ * @retval NRF_SUCCESS                    If the queue is empty or waits for TX slots.
+ * @retval NRF_ERROR_INVALID_STATE        If notifications are not enabled on the link. The queue
+ *                                        was flushed.
+ * @retval BLE_ERROR_INVALID_CONN_HANDLE  If the link is gone. The queue was flushed.
+ */
+ret_code_t hrm_tx_queue_drain(hrm_tx_queue_t * p_queue);
+
+
+/**@brief Function for merging the queued measurements of a link into the queue of another one.
+ *
+ * @details The measurements are merged by sample time, so the other link still sends them oldest
+ *          first. Measurements the other link has queued or been sent already, fanned out to both
+ *          links, are skipped, and so are older ones, which would reach its host out of order. If
+ *          the queue of the other link overflows, its oldest measurements are dropped. @p p_src is
+ *          left empty. @p p_dst is not drained. Must be called with both queues protected against
+ *          concurrent access.
+ *
+ * @param[in,out] p_dst     Queue of the link taking over.
+ * @param[in,out] p_src     Queue of the link handing over.
+ * @param[out]    p_result  What happened to the measurements of @p p_src.
+ */
+void hrm_tx_queue_merge(hrm_tx_queue_t              * p_dst,
+                        hrm_tx_queue_t              * p_src,
+                        hrm_tx_queue_merge_result_t * p_result);
+
+
+/**@brief Function for queueing an encoded measurement on a link and sending it.
+ *
+ * @details If the queue is full the oldest measurement is dropped and counted, so that a link
+ *          that cannot keep up still gets the freshest heart rate.
+ *
+ * @param[in] p_queue  Queue of the link.
+ * @param[in] p_hrm    Encoded measurement.
+ *
+ * @return The result of @ref hrm_tx_queue_drain.
+ */
+ret_code_t hrm_tx_queue_put(hrm_tx_queue_t * p_queue, hrm_packet_t const * p_hrm);
+
+
+/**@brief Function for handling the transmission of notifications of a link.
+ *
+ * @details Records the sample-to-air latency of the transmitted measurements, reports them to
+ *          the air handler, returns the TX slots to the link and sends the measurements that were
+ *          waiting for them.
+ *
+ * @param[in] p_queue    Queue of the link.
+ * @param[in] count      Number of notifications transmitted.
+ * @param[in] now_ticks  Current RTC counter value.
+ *
+ * @return The result of @ref hrm_tx_queue_drain.
+ */
+ret_code_t hrm_tx_queue_on_tx_complete(hrm_tx_queue_t * p_queue, uint8_t count, uint32_t now_ticks);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HRM_TX_QUEUE_H__
+
+/** @} */
@@ -52,6 +52,7 @@
 #include "nrf.h"
 #include "nrf_sdm.h"
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "ble.h"
 #include "ble_err.h"
 #include "ble_hci.h"
@@ -62,6 +63,8 @@
 #include "ble_hrs.h"
 #include "ble_dis.h"
 #include "ble_conn_params.h"
+#include "nrf_drv_saadc.h"
+#include "nrf_ble_qwr.h"
 #include "sensorsim.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_ble.h"
@@ -73,6 +76,28 @@
 #include "fds.h"
 #include "nrf_ble_gatt.h"
 #include "ble_conn_state.h"
+#include "ble_radio_notification.h"
+#include "ble_wfs.h"
+#include "ble_hls.h"
+#include "ble_cfgs.h"
+#include "hr_log.h"
+#include "sample_codec.h"
+#include "hrm_tx_queue.h"
+#include "rr_ring.h"
+#include "adv_cache.h"
+#include "conn_ctx.h"
+#include "phy_monitor.h"
+#include "handover.h"
+#include "whitelist.h"
+#include "bond.h"
+#include "adv_slicer.h"
+#include "broadcast.h"
+#include "battery_filter.h"
+#include "ram_budget.h"
+#include "reconnect.h"
+#include "adv_adapt.h"
+#include "bringup.h"
+#include "conn_policy.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
@@ -84,13 +109,11 @@
 
 
 #define APP_BLE_CONN_CFG_TAG            1                                       /**< A tag identifying the SoftDevice BLE configuration. */
-#define LINK_TOTAL                      NRF_SDH_BLE_PERIPHERAL_LINK_COUNT + \
-        NRF_SDH_BLE_CENTRAL_LINK_COUNT
 
 #define ADVERTISING_LED                 BSP_BOARD_LED_0                         /**< Is on when device is advertising. */
 #define CONNECTED_LED                   BSP_BOARD_LED_1                         /**< Is on when device has connected. */
 #define BONDING_LED                     BSP_BOARD_LED_2                         /**< Is on when device is advertising for 2nd connection. */
-#define CONNECTED_2_LED                 BSP_BOARD_LED_3                         /**< Is on when device has connected with 2nd host. */
+#define CONNECTED_2_LED                 BSP_BOARD_LED_3                         /**< Is on when device has connected with one or more secondary hosts. */
 
 #define REMOVE_BOND_BUTTON              BSP_BUTTON_0                            /**< Button that will trigger the notification event with the LED Button Service */
 #define BONDING_BUTTON                  BSP_BUTTON_1                            /**< Button that will trigger the notification event with the LED Button Service */
@@ -102,13 +125,31 @@
 #define APP_ADV_FAST_TIMEOUT                30                                         /**< The duration of the fast advertising period (in seconds). */
 #define APP_ADV_SLOW_TIMEOUT                180                                        /**< The duration of the slow advertising period (in seconds). */
 
-#define APP_BLE_CONN_CFG_TAG                1                                       /**< A tag identifying the SoftDevice BLE configuration. */
+#define ADV_PAYLOAD_CACHED                  1                                          /**< Set to 0 to advertise with the Advertising module of the SDK, which encodes the payload on every start, to compare the restart time. */
+
+#define BROADCAST_ENABLED                   1                                          /**< Set to 0 to keep the live heart rate out of the advertising data. */
+
 #define APP_BLE_OBSERVER_PRIO               3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 
 #define BATTERY_LEVEL_MEAS_INTERVAL         APP_TIMER_TICKS(2000)                   /**< Battery level measurement interval (ticks). */
-#define MIN_BATTERY_LEVEL                   81                                      /**< Minimum simulated battery level. */
-#define MAX_BATTERY_LEVEL                   100                                     /**< Maximum simulated 7battery level. */
-#define BATTERY_LEVEL_INCREMENT             1                                       /**< Increment between each simulated battery level measurement. */
+#define BATTERY_LEVEL_SIMULATED             0                                       /**< Set to 1 to feed the battery pipeline from the sensor simulator instead of the SAADC. */
+#define MIN_BATTERY_VOLTAGE                 2900                                    /**< Minimum simulated battery voltage (in mV). */
+#define MAX_BATTERY_VOLTAGE                 3000                                    /**< Maximum simulated battery voltage (in mV). */
+#define BATTERY_VOLTAGE_INCREMENT           2                                       /**< Increment between each simulated battery voltage measurement (in mV). */
+
+#define ADC_REF_VOLTAGE_IN_MILLIVOLTS       600                                     /**< Reference voltage (in milli volts) used by ADC while doing conversion. */
+#define ADC_PRE_SCALING_COMPENSATION        6                                       /**< The ADC is configured to use VDD with 1/6 prescaling as input. And hence the result of conversion is to be multiplied by 6 to get the actual value of the battery voltage.*/
+#define DIODE_FWD_VOLT_DROP_MILLIVOLTS      270                                     /**< Typical forward voltage drop of the diode between the battery and VDD on the development kit. */
+#define ADC_RES_10BIT                       1024                                    /**< Maximum digital value for 10-bit ADC conversion. */
+
+/**@brief Macro to convert the result of ADC conversion in millivolts.
+ *
+ * @param[in]  ADC_VALUE   ADC result.
+ *
+ * @retval     Result converted to millivolts.
+ */
+#define ADC_RESULT_IN_MILLI_VOLTS(ADC_VALUE)\
+        ((((ADC_VALUE) * ADC_REF_VOLTAGE_IN_MILLIVOLTS) / ADC_RES_10BIT) * ADC_PRE_SCALING_COMPENSATION)
 
 #define HEART_RATE_MEAS_INTERVAL            APP_TIMER_TICKS(1000)                   /**< Heart rate measurement interval (ticks). */
 #define MIN_HEART_RATE                      140                                     /**< Minimum heart rate as returned by the simulated measurement function. */
@@ -119,6 +160,7 @@
 #define MIN_RR_INTERVAL                     100                                     /**< Minimum RR interval as returned by the simulated measurement function. */
 #define MAX_RR_INTERVAL                     500                                     /**< Maximum RR interval as returned by the simulated measurement function. */
 #define RR_INTERVAL_INCREMENT               1                                       /**< Value by which the RR interval is incremented/decremented for each call to the simulated measurement function. */
+#define RR_INTERVALS_PER_TIMEOUT            6                                       /**< Number of simulated RR intervals registered on each RR interval timer timeout. */
 
 #define SENSOR_CONTACT_DETECTED_INTERVAL    APP_TIMER_TICKS(5000)                   /**< Sensor Contact Detected toggle interval (ticks). */
 
@@ -127,6 +169,21 @@
 #define SLAVE_LATENCY                       0                                       /**< Slave latency. */
 #define CONN_SUP_TIMEOUT                    MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Connection supervisory timeout (4 seconds). */
 
+#define BURST_MIN_CONN_INTERVAL             MSEC_TO_UNITS(7.5, UNIT_1_25_MS)        /**< Minimum connection interval of a link in a bulk operation (7.5 ms). */
+#define BURST_MAX_CONN_INTERVAL             MSEC_TO_UNITS(15, UNIT_1_25_MS)         /**< Maximum connection interval of a link in a bulk operation (15 ms). */
+#define STREAMING_MIN_CONN_INTERVAL         MSEC_TO_UNITS(15, UNIT_1_25_MS)         /**< Minimum connection interval of a link streaming or transferring the log (15 ms). */
+#define STREAMING_MAX_CONN_INTERVAL         MSEC_TO_UNITS(30, UNIT_1_25_MS)         /**< Maximum connection interval of a link streaming or transferring the log (30 ms). */
+#define IDLE_MIN_CONN_INTERVAL              MSEC_TO_UNITS(750, UNIT_1_25_MS)        /**< Minimum connection interval of a link without subscriptions (0.75 seconds). */
+#define IDLE_MAX_CONN_INTERVAL              MSEC_TO_UNITS(1000, UNIT_1_25_MS)       /**< Maximum connection interval of a link without subscriptions (1 second). */
+#define IDLE_SLAVE_LATENCY                  4                                       /**< Slave latency of a link without subscriptions. */
+#define IDLE_CONN_SUP_TIMEOUT               MSEC_TO_UNITS(12000, UNIT_10_MS)        /**< Connection supervisory timeout of a link without subscriptions (12 seconds, more than twice the longest interval times the latency plus one). */
+#define HLS_BURST_TIMEOUT                   APP_TIMER_TICKS(30000)                  /**< Longest time a log transfer holds the burst profile. */
+#define CFG_BURST_TIMEOUT                   APP_TIMER_TICKS(10000)                  /**< Longest time a configuration upload holds the burst profile. */
+#define BOND_BURST_TIMEOUT                  APP_TIMER_TICKS(10000)                  /**< Longest time bonding holds the burst profile. */
+
+#define HANDOVER_GAPLESS                    1                                       /**< Set to 0 to disconnect host A as soon as host B bonds, without moving its stream. */
+#define HANDOVER_TIMEOUT                    APP_TIMER_TICKS(30000)                  /**< Longest time host A is kept after host B bonded, waiting for host B to enable its notifications. */
+
 #define FIRST_CONN_PARAMS_UPDATE_DELAY      APP_TIMER_TICKS(5000)                   /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY       APP_TIMER_TICKS(30000)                  /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT        3                                       /**< Number of attempts before giving up the connection parameter negotiation. */
@@ -153,35 +210,195 @@
 #define APP_FEATURE_NOT_SUPPORTED           BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2    /**< Reply when unsupported features are requested. */
 
 
+#define HRM_CONN_EVT_ALIGNED                0                                       /**< Set to 1 to queue the freshest Heart Rate Measurement just before the radio becomes active instead of from the measurement timer. */
+#define HRM_RADIO_NOTIFICATION_DISTANCE     NRF_RADIO_NOTIFICATION_DISTANCE_800US   /**< Time between the radio notification and the start of the radio event. */
+#define HRM_RADIO_NOTIFICATION_IRQ_PRIORITY APP_IRQ_PRIORITY_LOW                    /**< Priority of the radio notification interrupt. */
+
+#define WFS_SAMPLE_RATE_HZ                  250                                     /**< Sample rate of the streamed waveform. */
+#define WFS_TIMER_INTERVAL_MS               20                                      /**< Interval of the waveform sampling timer (in ms). */
+#define WFS_SAMPLES_PER_TIMEOUT             ((WFS_SAMPLE_RATE_HZ * WFS_TIMER_INTERVAL_MS) / 1000)   /**< Number of waveform samples taken on each waveform timer timeout. */
+#define WFS_TIMER_INTERVAL                  APP_TIMER_TICKS(WFS_TIMER_INTERVAL_MS)  /**< Waveform sampling timer interval (ticks). */
+#define WFS_HRM_RESERVED_CREDITS            2                                       /**< TX slots of a link the waveform stream leaves free for Heart Rate Measurements. */
+#define WFS_DATA_LENGTH                     251                                     /**< Link Layer PDU payload length requested when streaming starts. */
+#define WFS_CODEC_KEYFRAME_INTERVAL         50                                      /**< Number of coded waveform samples between keyframes. Every batch also starts with one. */
+#define MIN_WAVEFORM_SAMPLE                 0                                       /**< Minimum simulated waveform sample (12-bit ADC). */
+#define MAX_WAVEFORM_SAMPLE                 4095                                    /**< Maximum simulated waveform sample (12-bit ADC). */
+#define WAVEFORM_SAMPLE_INCREMENT           20                                      /**< Increment between each simulated waveform sample. */
+
+#define QWR_MEM_BUFF_SIZE                   1024                                    /**< Queued write memory per link. Holds a 512 byte value written in 18 byte prepare writes at the default ATT MTU, i.e. 29 x (6 + 18) bytes. */
+
+#define HLS_SAMPLE_LEN                      12                                      /**< Length of one logged sample in a Log Data notification. */
+
+#define TICKS_TO_MS(ticks)                  ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
 BLE_HRS_DEF(m_hrs);                                                 /**< Heart rate service instance. */
 BLE_BAS_DEF(m_bas);                                                 /**< Structure used to identify the battery service. */
+BLE_WFS_DEF(m_wfs);                                                 /**< Waveform Streaming Service instance. */
+BLE_HLS_DEF(m_hls);                                                 /**< Heart Rate Log Service instance. */
+BLE_CFGS_DEF(m_cfgs);                                               /**< Configuration Service instance. */
 NRF_BLE_GATT_DEF(m_gatt);                                           /**< GATT module instance. */
+#if !ADV_PAYLOAD_CACHED
 BLE_ADVERTISING_DEF(m_advertising);                                 /**< Advertising module instance. */
+#endif
 APP_TIMER_DEF(m_battery_timer_id);                                  /**< Battery timer. */
 APP_TIMER_DEF(m_heart_rate_timer_id);                               /**< Heart rate measurement timer. */
 APP_TIMER_DEF(m_rr_interval_timer_id);                              /**< RR interval timer. */
 APP_TIMER_DEF(m_sensor_contact_timer_id);                           /**< Sensor contact detected timer. */
+APP_TIMER_DEF(m_wfs_timer_id);                                      /**< Waveform sampling timer. */
+APP_TIMER_DEF(m_handover_timer_id);                                 /**< Handover timer. */
+APP_TIMER_DEF(m_bringup_timer_id);                                  /**< Connect-time bring-up timer. */
 
 #define ADVERTISING_BOND_TIME_INTERVAL                               APP_TIMER_TICKS(30000)
+#define ADV_SLICE_WHITELIST_TIME                                     APP_TIMER_TICKS(2000)      /**< Length of a bonding window slice advertising to the bonded hosts only. */
+#define ADV_SLICE_OPEN_TIME                                          APP_TIMER_TICKS(1000)      /**< Length of a bonding window slice advertising to any host. */
 APP_TIMER_DEF(m_advertising_bond_timer_id);                                /**< Advertising time for the bonding with 2nd host. */
+APP_TIMER_DEF(m_adv_slice_timer_id);                                       /**< Bonding window slice timer. */
+APP_TIMER_DEF(m_whitelist_rotation_timer_id);                              /**< Whitelist rotation timer. */
 static bool advertising_bond_timer_is_running = false;                     /**< Flag Avertising timer status for bonding with 2nd host. */
 static pm_peer_id_t m_bonded_peer_id;                                      /**< Peer ID of the current bonded central. */
 static bool m_bond_second_host_is_running = false;
 
-static uint16_t m_conn_handle         = BLE_CONN_HANDLE_INVALID;    /**< Handle of the current connection. */
 static bool m_rr_interval_enabled = true;                           /**< Flag for enabling and disabling the registration of new RR interval measurements (the purpose of disabling this is just to test sending HRM without RR interval data. */
 
-static sensorsim_cfg_t m_battery_sim_cfg;                           /**< Battery Level sensor simulator configuration. */
-static sensorsim_state_t m_battery_sim_state;                       /**< Battery Level sensor simulator state. */
+#if BATTERY_LEVEL_SIMULATED
+static sensorsim_cfg_t m_battery_sim_cfg;                           /**< Battery voltage sensor simulator configuration. */
+static sensorsim_state_t m_battery_sim_state;                       /**< Battery voltage sensor simulator state. */
+#else
+static nrf_saadc_value_t m_adc_buf[2];                              /**< SAADC result buffers, one converted while the other is processed. */
+#endif
+static battery_filter_t m_battery_filter;                           /**< Battery level filter, its reported level is the one of the Battery Service. */
 static sensorsim_cfg_t m_heart_rate_sim_cfg;                        /**< Heart Rate sensor simulator configuration. */
 static sensorsim_state_t m_heart_rate_sim_state;                    /**< Heart Rate sensor simulator state. */
 static sensorsim_cfg_t m_rr_interval_sim_cfg;                       /**< RR Interval sensor simulator configuration. */
 static sensorsim_state_t m_rr_interval_sim_state;                   /**< RR Interval sensor simulator state. */
+static sensorsim_cfg_t m_waveform_sim_cfg;                          /**< Waveform sensor simulator configuration. */
+static sensorsim_state_t m_waveform_sim_state;                      /**< Waveform sensor simulator state. */
 
 static pm_peer_id_t m_peer_id;                                      /**< Device reference handle to the current bonded central. */
-static uint32_t m_whitelist_peer_cnt;                               /**< Number of peers currently in the whitelist. */
-static pm_peer_id_t m_whitelist_peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];        /**< List of peers currently in the whitelist. */
+#define WHITELIST_ROTATION_INTERVAL     APP_TIMER_TICKS(30000)      /**< Time between whitelist rotations, one fast advertising period. */
+
+static bool m_whitelist_rotation_running;                           /**< Whether the whitelist rotation timer is running. */
+
+static ble_gap_conn_params_t const m_conn_policy_params[CONN_POLICY_COUNT] =   /**< Connection parameters of each profile. */
+{
+        [CONN_POLICY_IDLE] =
+        {
+                .min_conn_interval = IDLE_MIN_CONN_INTERVAL,
+                .max_conn_interval = IDLE_MAX_CONN_INTERVAL,
+                .slave_latency     = IDLE_SLAVE_LATENCY,
+                .conn_sup_timeout  = IDLE_CONN_SUP_TIMEOUT,
+        },
+        [CONN_POLICY_ACTIVE] =
+        {
+                .min_conn_interval = MIN_CONN_INTERVAL,
+                .max_conn_interval = MAX_CONN_INTERVAL,
+                .slave_latency     = SLAVE_LATENCY,
+                .conn_sup_timeout  = CONN_SUP_TIMEOUT,
+        },
+        [CONN_POLICY_STREAMING] =
+        {
+                .min_conn_interval = STREAMING_MIN_CONN_INTERVAL,
+                .max_conn_interval = STREAMING_MAX_CONN_INTERVAL,
+                .slave_latency     = SLAVE_LATENCY,
+                .conn_sup_timeout  = CONN_SUP_TIMEOUT,
+        },
+        [CONN_POLICY_BURST] =
+        {
+                .min_conn_interval = BURST_MIN_CONN_INTERVAL,
+                .max_conn_interval = BURST_MAX_CONN_INTERVAL,
+                .slave_latency     = SLAVE_LATENCY,
+                .conn_sup_timeout  = CONN_SUP_TIMEOUT,
+        },
+};
+
+
+static ble_advdata_t          m_advdata;                           /**< Advertising data. */
+static ble_adv_modes_config_t m_adv_modes_config;                  /**< Advertising modes in use. */
+static ble_adv_evt_t          m_adv_evt = BLE_ADV_EVT_IDLE;         /**< Last advertising event, i.e. what is advertising unless a host has connected since. */
+
+/**@brief Cost of restarting the advertising. */
+typedef struct
+{
+        uint32_t cnt;                                               /**< Number of restarts. */
+        uint32_t sum_cycles;                                        /**< Sum of the CPU cycles the restarts took. */
+        uint32_t max_cycles;                                        /**< Most CPU cycles a restart took. */
+} adv_restart_stats_t;
+
+static adv_restart_stats_t m_adv_restart_stats;                     /**< Advertising restart statistics. */
+
+
+/**@brief Waveform stream state of one link.
+ *
+ * @details Samples are collected into one batch per link. A full batch is sent only while the
+ *          link has more than @ref WFS_HRM_RESERVED_CREDITS free TX slots and no Heart Rate
+ *          Measurement waiting, so the stream never delays the Heart Rate Service. Samples that
+ *          arrive while a full batch waits for a slot are dropped.
+ */
+typedef struct
+{
+        bool     streaming;                                         /**< Whether the peer has started the stream. */
+        bool     batch_full;                                        /**< Whether the batch is complete and waits for a TX slot. */
+        bool     compressed;                                        /**< Whether samples are delta/varint coded instead of raw 16-bit values. */
+        sample_codec_t codec;                                       /**< Encoder state of the coded stream. */
+        uint8_t  seq;                                               /**< Sequence number of the next batch. */
+        uint16_t len;                                               /**< Length of the batch. */
+        uint8_t  data[BLE_WFS_MAX_DATA_LEN];                        /**< Batch: sequence number followed by the samples. */
+        uint32_t start_ticks;                                       /**< RTC counter value when the stream started. */
+        uint32_t bytes_cnt;                                         /**< Number of bytes handed to the SoftDevice since the stream started. */
+        uint32_t dropped_cnt;                                       /**< Number of samples dropped since the stream started. */
+        uint32_t sample_cnt;                                        /**< Number of samples put in a batch since the stream started. */
+        uint32_t coded_len;                                         /**< Number of bytes the coded samples took. */
+        uint32_t codec_cycles;                                      /**< CPU cycles spent encoding samples. */
+} wfs_link_t;
+
+static wfs_link_t m_wfs_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];        /**< Waveform stream states, indexed by connection handle. */
+static uint32_t m_wfs_streaming_cnt;                                /**< Number of links streaming. */
+
+/**@brief Heart rate log transfer state of one link.
+ *
+ * @details Logged samples are sent under the same rule as the waveform stream: only while no
+ *          Heart Rate Measurement waits and more than @ref WFS_HRM_RESERVED_CREDITS TX slots
+ *          are free.
+ */
+typedef struct
+{
+        bool     transferring;                                      /**< Whether a Report Stored Records procedure is running. */
+        uint32_t next_seq;                                          /**< Sequence number of the next sample to send. */
+        uint32_t last_seq;                                          /**< Sequence number of the last sample to send. */
+        uint32_t sent_cnt;                                          /**< Number of samples sent by the procedure. */
+        uint32_t start_ticks;                                       /**< RTC counter value when the procedure started. */
+} hls_link_t;
+
+static hls_link_t m_hls_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];        /**< Heart rate log transfer states, indexed by connection handle. */
+
+static nrf_ble_qwr_t m_qwr[NRF_SDH_BLE_TOTAL_LINK_COUNT];           /**< Queued Writes modules, indexed by connection handle. */
+static uint8_t m_qwr_mem[NRF_SDH_BLE_TOTAL_LINK_COUNT][QWR_MEM_BUFF_SIZE];  /**< Queued write memory of each link. */
 
+/**@brief Configuration upload statistics of one link. */
+typedef struct
+{
+        uint32_t start_ticks;                                       /**< RTC counter value when the first prepare write of the upload arrived. */
+        uint16_t prep_cnt;                                          /**< Number of prepare writes of the upload. */
+} cfg_upload_t;
+
+static cfg_upload_t m_cfg_uploads[NRF_SDH_BLE_TOTAL_LINK_COUNT];    /**< Configuration upload statistics, indexed by connection handle. */
+
+static rr_ring_t m_rr_ring;                                         /**< RR intervals waiting for the next Heart Rate Measurement. */
+
+#if HRM_CONN_EVT_ALIGNED
+/**@brief Heart rate sample waiting for the next radio event. */
+typedef struct
+{
+        uint16_t heart_rate;                                        /**< Heart rate sample. */
+        uint32_t sample_ticks;                                      /**< RTC counter value when the heart rate was sampled. */
+} hrm_sample_t;
+
+STATIC_ASSERT(sizeof(hrm_sample_t) <= SCHED_MAX_EVENT_DATA_SIZE);
+
+static hrm_sample_t m_hrm_pending_sample;                           /**< Freshest heart rate not yet queued for sending. */
+static bool         m_hrm_pending;                                  /**< Whether a heart rate is waiting for the next radio event. */
+#endif
 
 static ble_uuid_t m_adv_uuids[] =                                   /**< Universally unique service identifiers. */
 {
@@ -207,203 +424,1814 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
         app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
-/**@brief Fetch the list of peer manager peer IDs.
+/**@brief Function for checking whether a link streams the waveform, for the connection
+ *        parameter policy.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static bool wfs_link_is_streaming(uint16_t conn_handle)
+{
+        return m_wfs_links[conn_handle].streaming;
+}
+
+
+/**@brief Function for handling the events of the connection parameter policy.
+ *
+ * @param[in] p_evt  Event.
+ */
+static void on_conn_policy_evt(conn_policy_evt_t const * p_evt)
+{
+        switch (p_evt->evt_type)
+        {
+        case CONN_POLICY_EVT_REQUESTED:
+                NRF_LOG_INFO("Link 0x%x: connection parameter profile %d requested",
+                             p_evt->conn_handle,
+                             p_evt->params.policy);
+                break;
+
+        case CONN_POLICY_EVT_BURST_TIMEOUT:
+                NRF_LOG_INFO("Link 0x%x: burst of user %d timed out", p_evt->conn_handle, p_evt->params.user);
+                break;
+
+        default:
+                break;
+        }
+}
+
+
+/**@brief Function for recording whether the peer of a link has enabled a notification, and
+ *        moving the link to the connection parameter profile that fits its subscriptions.
  *
- * @param[inout] p_peers   The buffer where to store the list of peer IDs.
- * @param[inout] p_size    In: The size of the @p p_peers buffer.
- *                         Out: The number of peers copied in the buffer.
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] flag         CONN_CCCD_* flag of the notification.
+ * @param[in] enabled      Whether the notification is enabled.
  */
-static void peer_list_get(pm_peer_id_t * p_peers, uint32_t * p_size)
+static void link_cccd_set(uint16_t conn_handle, uint8_t flag, bool enabled)
 {
-        pm_peer_id_t peer_id;
-        uint32_t peers_to_copy;
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        if (p_ctx == NULL)
+        {
+                return;
+        }
+
+        conn_ctx_cccd_set(p_ctx, flag, enabled);
+        conn_policy_refresh(conn_handle, CONN_POLICY_SETTLE_DELAY);
+}
+
 
-        peers_to_copy = (*p_size < BLE_GAP_WHITELIST_ADDR_MAX_COUNT) ?
-                        *p_size : BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+/**@brief Function for acting on the result of sending the queued Heart Rate Measurements of a link.
+ *
+ * @details Must be called outside the critical region the queue was drained in, since changing
+ *          the subscriptions of a link may renegotiate its connection parameters.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] err_code     Result of @ref hrm_tx_queue_drain.
+ */
+static void hrm_tx_queue_result_handle(uint16_t conn_handle, ret_code_t err_code)
+{
+        hrm_tx_queue_t const * p_queue = hrm_tx_queue_get(conn_handle);
+        uint32_t               spacing;
+        uint32_t               dropped_cnt;
 
-        peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
-        *p_size = 0;
+        if (err_code == NRF_ERROR_INVALID_STATE)
+        {
+                link_cccd_set(conn_handle, CONN_CCCD_HRM, false);
+        }
 
-        while ((peer_id != PM_PEER_ID_INVALID) && (peers_to_copy--))
+        if (handover_gap_take(conn_handle, &spacing, &dropped_cnt))
         {
-                p_peers[(*p_size)++] = peer_id;
-                peer_id = pm_next_peer_id_get(peer_id);
+                uint32_t gap = (spacing > HEART_RATE_MEAS_INTERVAL) ? spacing - HEART_RATE_MEAS_INTERVAL : 0;
+
+                NRF_LOG_INFO("Handover to link 0x%x: %d ms of measurements missed, %d dropped, %d sent on link",
+                             conn_handle,
+                             TICKS_TO_MS(gap),
+                             dropped_cnt,
+                             p_queue->sent_cnt);
         }
 }
 
 
-/**@brief Clear bond information from persistent storage.
+/**@brief Function for logging the counters of an outbound Heart Rate Measurement queue.
  */
-static void delete_bonds(void)
+static void hrm_tx_queue_stats_log(hrm_tx_queue_t const * p_queue)
 {
-        ret_code_t err_code;
+        NRF_LOG_INFO("HRM link 0x%x: queued %d, sent %d, dropped %d, TX busy %d",
+                     p_queue->conn_handle,
+                     p_queue->queued_cnt,
+                     p_queue->sent_cnt,
+                     p_queue->dropped_cnt,
+                     p_queue->busy_cnt);
+
+        if (p_queue->rr_sent_cnt > 0)
+        {
+                NRF_LOG_INFO("HRM link 0x%x: %d RR intervals in %d bytes on air, %d.%02d bytes per RR interval",
+                             p_queue->conn_handle,
+                             p_queue->rr_sent_cnt,
+                             p_queue->air_bytes_cnt,
+                             p_queue->air_bytes_cnt / p_queue->rr_sent_cnt,
+                             ((p_queue->air_bytes_cnt * 100) / p_queue->rr_sent_cnt) % 100);
+        }
 
-        NRF_LOG_INFO("Erase bonds!");
+        if (p_queue->latency_cnt > 0)
+        {
+                NRF_LOG_INFO("HRM link 0x%x: sample-to-air latency avg %d ms, max %d ms",
+                             p_queue->conn_handle,
+                             p_queue->latency_sum_ms / p_queue->latency_cnt,
+                             p_queue->latency_max_ms);
+        }
 
-        err_code = pm_peers_delete();
-        APP_ERROR_CHECK(err_code);
+        NRF_LOG_INFO("RR intervals dropped before being sent: %d", m_rr_ring.overflow_cnt);
 }
 
 
-/**@brief Function for starting advertising.
+/**@brief Function for logging the sustained throughput of the waveform stream of a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
  */
-void advertising_start(bool b_whitelist)
+static void wfs_throughput_log(uint16_t conn_handle)
 {
-        ret_code_t ret = NRF_SUCCESS;
-        if (b_whitelist)
+        wfs_link_t const * p_link = &m_wfs_links[conn_handle];
+        uint32_t elapsed_ms = TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_link->start_ticks));
+
+        if (elapsed_ms == 0)
         {
-                memset(m_whitelist_peers, PM_PEER_ID_INVALID, sizeof(m_whitelist_peers));
-                m_whitelist_peer_cnt = (sizeof(m_whitelist_peers) / sizeof(pm_peer_id_t));
+                return;
+        }
 
-                peer_list_get(m_whitelist_peers, &m_whitelist_peer_cnt);
+        NRF_LOG_INFO("Waveform link 0x%x: %d bytes in %d ms, %d bytes/s, %d samples dropped",
+                     conn_handle,
+                     p_link->bytes_cnt,
+                     elapsed_ms,
+                     (uint32_t)(((uint64_t)p_link->bytes_cnt * 1000) / elapsed_ms),
+                     p_link->dropped_cnt);
 
-                ret = pm_whitelist_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                APP_ERROR_CHECK(ret);
+        if (p_link->compressed && (p_link->sample_cnt != 0) && (p_link->coded_len != 0))
+        {
+                // Raw samples take two bytes each.
+                NRF_LOG_INFO("Waveform link 0x%x: compression %d.%02d:1, %d cycles/sample",
+                             conn_handle,
+                             (2 * p_link->sample_cnt) / p_link->coded_len,
+                             ((200 * p_link->sample_cnt) / p_link->coded_len) % 100,
+                             p_link->codec_cycles / p_link->sample_cnt);
+        }
+}
+
+
+/**@brief Function for sending the waveform batch of a link if it is full and TX slots allow.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static void wfs_batch_send(uint16_t conn_handle)
+{
+        ret_code_t err_code;
+        bool       notifications_off = false;
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(conn_handle);
+
+        if ((p_queue == NULL) || (p_queue->conn_handle != conn_handle))
+        {
+                return;
+        }
+
+        wfs_link_t * p_link = &m_wfs_links[conn_handle];
+
+        CRITICAL_REGION_ENTER();
 
-                NRF_LOG_INFO("advertising_start, m_whitelist_peer_cnt = %d", m_whitelist_peer_cnt);
-                if (m_whitelist_peer_cnt > 0)
+        if (p_link->streaming &&
+            p_link->batch_full &&
+            (p_queue->count == 0) &&
+            (p_queue->credits > WFS_HRM_RESERVED_CREDITS))
+        {
+                err_code = ble_wfs_data_send(&m_wfs, conn_handle, p_link->data, p_link->len);
+                if (err_code == NRF_SUCCESS)
                 {
-                        // Setup the device identies list.
-                        // Some SoftDevices do not support this feature.
-                        ret = pm_device_identities_list_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                        if (ret != NRF_ERROR_NOT_SUPPORTED)
-                        {
-                                APP_ERROR_CHECK(ret);
-                        }
-                        NRF_LOG_INFO("Advertising with whitelist");
-                        bsp_board_led_on(ADVERTISING_LED);
+                        p_queue->credits--;
+                        hrm_tx_queue_inflight_push(p_queue, false, 0);
 
+                        p_link->bytes_cnt += p_link->len;
+                        p_link->seq++;
+                        p_link->len        = 0;
+                        p_link->batch_full = false;
                 }
-                else
+                else if (err_code == NRF_ERROR_RESOURCES)
                 {
-                        NRF_LOG_INFO("Peer record is empty. Without Whiltelist");
-                        bsp_board_led_on(BONDING_LED);
+                        p_queue->credits = 0;
+                        p_queue->busy_cnt++;
+                }
+                else if ((err_code == NRF_ERROR_INVALID_STATE) ||
+                         (err_code == BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+                {
+                        notifications_off = true;
+                }
+                else if (err_code != BLE_ERROR_INVALID_CONN_HANDLE)
+                {
+                        APP_ERROR_HANDLER(err_code);
                 }
+        }
 
-                ret = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
-                APP_ERROR_CHECK(ret);
+        CRITICAL_REGION_EXIT();
+
+        if (notifications_off)
+        {
+                link_cccd_set(conn_handle, CONN_CCCD_WFS, false);
         }
-        else
+}
+
+
+/**@brief Function for handling the Waveform sampling timer timeout.
+ *
+ * @details Takes the waveform samples of the last timer interval and appends them to the batch
+ *          of every streaming link.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void wfs_meas_timeout_handler(void * p_context)
+{
+        uint16_t samples[WFS_SAMPLES_PER_TIMEOUT];
+        uint32_t i;
+        uint16_t conn_handle;
+
+        UNUSED_PARAMETER(p_context);
+
+        for (i = 0; i < WFS_SAMPLES_PER_TIMEOUT; i++)
         {
-                //if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
+                samples[i] = (uint16_t)sensorsim_measure(&m_waveform_sim_state, &m_waveform_sim_cfg);
+        }
+
+        for (conn_handle = 0; conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT; conn_handle++)
+        {
+                wfs_link_t * p_link = &m_wfs_links[conn_handle];
+                uint16_t     max_len;
+
+                if (!p_link->streaming)
                 {
-                        NRF_LOG_INFO("Restart the advertising without whitelist");
-                        ret = ble_advertising_restart_without_whitelist(&m_advertising);
-                        if (ret != NRF_ERROR_INVALID_STATE)
+                        continue;
+                }
+                max_len = hrm_tx_queue_get(conn_handle)->max_hrm_len;
+
+                CRITICAL_REGION_ENTER();
+                for (i = 0; i < WFS_SAMPLES_PER_TIMEOUT; i++)
+                {
+                        if (p_link->batch_full)
                         {
-                                APP_ERROR_CHECK(ret);
+                                p_link->dropped_cnt++;
+                                continue;
+                        }
+                        if (p_link->len == 0)
+                        {
+                                p_link->data[p_link->len++] = p_link->seq;
+                                // Every batch is decodable on its own.
+                                sample_codec_reset(&p_link->codec);
                         }
+                        if (p_link->compressed)
+                        {
+                                uint32_t start_cycles = DWT->CYCCNT;
+                                uint8_t  len          = sample_codec_encode(&p_link->codec,
+                                                                            samples[i],
+                                                                            &p_link->data[p_link->len],
+                                                                            max_len - p_link->len);
+
+                                p_link->codec_cycles += DWT->CYCCNT - start_cycles;
+                                p_link->coded_len    += len;
+                                p_link->len          += len;
+                                p_link->batch_full    = (p_link->len + SAMPLE_CODEC_MAX_LEN > max_len);
+                        }
+                        else
+                        {
+                                p_link->len       += uint16_encode(samples[i], &p_link->data[p_link->len]);
+                                p_link->batch_full = (p_link->len + sizeof(uint16_t) > max_len);
+                        }
+                        p_link->sample_cnt++;
                 }
+                CRITICAL_REGION_EXIT();
+
+                wfs_batch_send(conn_handle);
         }
 }
 
-/**@brief Function for handling File Data Storage events.
+
+/**@brief Function for requesting long Link Layer PDUs for a bulk transfer.
  *
- * @param[in] p_evt  Peer Manager event.
- * @param[in] cmd
+ * @details 2M PHY is left to the PHY monitor, which only requests it once the RSSI shows the
+ *          link is strong enough.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
  */
-static void fds_evt_handler(fds_evt_t const * const p_evt)
+static void link_speed_up(uint16_t conn_handle)
 {
-        if (p_evt->id == FDS_EVT_GC)
+        ret_code_t err_code;
+
+#if !defined (S112)
+        ble_gap_data_length_params_t dl_params;
+
+        memset(&dl_params, 0, sizeof(ble_gap_data_length_params_t));
+        dl_params.max_tx_octets = WFS_DATA_LENGTH;
+        dl_params.max_rx_octets = WFS_DATA_LENGTH;
+
+        err_code = sd_ble_gap_data_length_update(conn_handle, &dl_params, NULL);
+        if ((err_code == NRF_ERROR_RESOURCES) || (err_code == NRF_ERROR_BUSY))
         {
-                NRF_LOG_DEBUG("GC completed\n");
+                // The connection event length does not allow it or a procedure is ongoing, keep what we have.
+                NRF_LOG_INFO("Data length update on link 0x%x not possible: 0x%x", conn_handle, err_code);
         }
-}
-
-static void stop_advertising_bond_timer(void)
-{
-        uint32_t err_code = NRF_SUCCESS;
-        if (advertising_bond_timer_is_running)
+        else
         {
-                err_code = app_timer_stop(m_advertising_bond_timer_id);
                 APP_ERROR_CHECK(err_code);
-                advertising_bond_timer_is_running = false;
-                m_bond_second_host_is_running = false;
         }
+#endif
 }
 
-static void advertising_bond_timeout_handler(void * p_context)
+
+/**@brief Function for (re)arming the bring-up timer for the steps that have just started.
+ */
+static void bringup_timer_arm(void)
 {
-        UNUSED_PARAMETER(p_context);
+        ret_code_t err_code;
+
+        err_code = app_timer_stop(m_bringup_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_start(m_bringup_timer_id, BRINGUP_STEP_TIMEOUT, NULL);
+        APP_ERROR_CHECK(err_code);
+}
+
 
-        uint32_t periph_link_cnt = ble_conn_state_n_peripherals(); // Number of peripheral links.
-        if (periph_link_cnt == 1)//NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+/**@brief Function for handling the outcome of a bring-up call.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] err_code     Error code of the call.
+ * @param[in] evt          Outcome of the call.
+ */
+static void bringup_evt_handle(uint16_t conn_handle, ret_code_t err_code, bringup_evt_t evt)
+{
+        APP_ERROR_CHECK(err_code);
+
+        if (evt == BRINGUP_EVT_STEP_STARTED)
         {
-                NRF_LOG_INFO("Stop advertising for bonding!!!");
-                (void) sd_ble_gap_adv_stop();
-                m_bond_second_host_is_running = false;
+                bringup_timer_arm();
+        }
+        else if (evt == BRINGUP_EVT_DONE)
+        {
+                conn_ctx_t const * p_ctx = conn_ctx_get(conn_handle);
+
+                NRF_LOG_INFO("Link 0x%x: up in %d ms, MTU %d (%d ms), PDU payload %d (%d ms), PHY %d (%d ms)",
+                             conn_handle,
+                             TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->connected_ticks)),
+                             p_ctx->att_mtu,
+                             p_ctx->bringup_ms[BRINGUP_STEP_MTU],
+                             hrm_tx_queue_get(conn_handle)->ll_payload_len,
+                             p_ctx->bringup_ms[BRINGUP_STEP_DATA_LENGTH],
+                             p_ctx->tx_phy,
+                             p_ctx->bringup_ms[BRINGUP_STEP_PHY]);
         }
 }
 
-static void on_advertising_for_bond_request(void)
+
+/**@brief Function for finishing a bring-up step of a link and starting the next one.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] step         Step whose procedure has completed.
+ */
+static void bringup_step_done(uint16_t conn_handle, bringup_step_t step)
 {
-        uint32_t err_code = NRF_SUCCESS;
+        ret_code_t    err_code;
+        bringup_evt_t evt;
+
+        err_code = bringup_on_step_done(conn_handle, step, &evt);
+        bringup_evt_handle(conn_handle, err_code, evt);
+}
 
-        uint32_t periph_link_cnt = ble_conn_state_n_peripherals(); // Number of peripheral links.
 
-        if (m_bond_second_host_is_running)
-                return;
+/**@brief Function for handling the bring-up timer timeout.
+ *
+ * @details Moves on links whose peer has not completed the step in @ref BRINGUP_STEP_TIMEOUT.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void bringup_timeout_handler(void * p_context)
+{
+        bool pending = false;
+
+        UNUSED_PARAMETER(p_context);
 
-        // if the device is already connected to 1 host, it would start the 2nd advertising.
-        if (periph_link_cnt == 1)//NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
         {
-                // Create timers.
-                err_code = app_timer_create(&m_advertising_bond_timer_id,
-                                            APP_TIMER_MODE_SINGLE_SHOT,
-                                            advertising_bond_timeout_handler);
-                APP_ERROR_CHECK(err_code);
+                conn_ctx_t const * p_ctx = conn_ctx_get(i);
 
-                // Start application timers.
-                err_code = app_timer_start(m_advertising_bond_timer_id, ADVERTISING_BOND_TIME_INTERVAL, NULL);
-                APP_ERROR_CHECK(err_code);
+                if ((p_ctx == NULL) || (p_ctx->bringup_step == BRINGUP_STEP_DONE))
+                {
+                        continue;
+                }
 
-                advertising_bond_timer_is_running = true;
+                if (bringup_step_timed_out(p_ctx))
+                {
+                        NRF_LOG_WARNING("Link 0x%x: bring-up step %d timed out", p_ctx->conn_handle, p_ctx->bringup_step);
+                        bringup_step_done(p_ctx->conn_handle, p_ctx->bringup_step);
+                }
+                else
+                {
+                        pending = true;
+                }
+        }
 
-                m_bond_second_host_is_running = true;
+        if (pending)
+        {
+                bringup_timer_arm();
+        }
+}
 
-                NRF_LOG_INFO("Press button BONDING_BUTTON");
-                NRF_LOG_INFO("Start Advertising bonding for 2nd host!!");
-                advertising_start(false);
+
+/**@brief Function for moving the streams of host A to host B and disconnecting host A.
+ *
+ * @details Measurements still queued for host A are merged into host B's queue by sample time.
+ *          The ones host B already has, fanned out to both links, are skipped. A waveform stream
+ *          keeps its batch and sequence number, so host B sees it continue.
+ */
+static void handover_execute(void)
+{
+        ret_code_t       err_code;
+        uint16_t         from_handle;
+        uint16_t         to_handle;
+        hrm_tx_queue_t * p_dst;
+        wfs_link_t     * p_wfs_src;
+        wfs_link_t     * p_wfs_dst;
+        bool             wfs_moved   = false;
+        ret_code_t       drain_err_code;
+        hrm_tx_queue_merge_result_t merge;
+
+        handover_stop();
+        (void)app_timer_stop(m_handover_timer_id);
+
+        handover_links_get(&from_handle, &to_handle);
+        if ((conn_ctx_get(from_handle) == NULL) || (conn_ctx_get(to_handle) == NULL))
+        {
+                return;
+        }
+
+        p_dst     = hrm_tx_queue_get(to_handle);
+        p_wfs_src = &m_wfs_links[from_handle];
+        p_wfs_dst = &m_wfs_links[to_handle];
+
+        CRITICAL_REGION_ENTER();
+
+        handover_merge(&merge);
+
+        if (p_wfs_src->streaming && !p_wfs_dst->streaming &&
+            conn_ctx_cccd_is_set(to_handle, CONN_CCCD_WFS))
+        {
+                // The stream runs on, so the number of streaming links does not change.
+                *p_wfs_dst = *p_wfs_src;
+                memset(p_wfs_src, 0, sizeof(wfs_link_t));
+                if (p_wfs_dst->len > p_dst->max_hrm_len)
+                {
+                        p_wfs_dst->len        = 0;
+                        p_wfs_dst->batch_full = false;
+                }
+                wfs_moved = true;
+        }
+
+        drain_err_code = hrm_tx_queue_drain(p_dst);
+
+        CRITICAL_REGION_EXIT();
+
+        hrm_tx_queue_result_handle(to_handle, drain_err_code);
+
+        NRF_LOG_INFO("Handover 0x%x -> 0x%x: measurements %d moved, %d already there, %d dropped",
+                     from_handle,
+                     to_handle,
+                     merge.moved_cnt,
+                     merge.skipped_cnt,
+                     merge.dropped_cnt);
+        NRF_LOG_INFO("Handover 0x%x -> 0x%x: waveform stream moved %d", from_handle, to_handle, wfs_moved);
+
+        if (wfs_moved)
+        {
+                wfs_batch_send(to_handle);
+                conn_policy_refresh(to_handle, CONN_BURST_START_DELAY);
+        }
+
+        err_code = sd_ble_gap_disconnect(from_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        if (err_code != NRF_ERROR_INVALID_STATE)
+        {
+                APP_ERROR_CHECK(err_code);
+        }
+}
+
+
+/**@brief Function for moving the streams to host B once it has enabled the notifications host A
+ *        uses.
+ */
+static void handover_check(void)
+{
+        if (handover_is_ready())
+        {
+                handover_execute();
+        }
+}
+
+
+/**@brief Function for handling the handover timer timeout.
+ *
+ * @details Host B has not enabled all the notifications of host A in time. Hand over what it has.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void handover_timeout_handler(void * p_context)
+{
+        uint16_t from_handle;
+        uint16_t to_handle;
+
+        UNUSED_PARAMETER(p_context);
+
+        if (handover_is_pending())
+        {
+                handover_links_get(&from_handle, &to_handle);
+                NRF_LOG_WARNING("Handover: link 0x%x did not enable all notifications", to_handle);
+                handover_execute();
+        }
+}
+
+
+/**@brief Function for handing the streams of host A over to host B, which has just bonded.
+ *
+ * @param[in] from_handle  Link of host A.
+ * @param[in] to_handle    Link of host B.
+ */
+static void handover_start(uint16_t from_handle, uint16_t to_handle)
+{
+        ret_code_t err_code;
+
+        handover_begin(from_handle, to_handle, HANDOVER_GAPLESS);
+
+#if HANDOVER_GAPLESS
+        NRF_LOG_INFO("Handover 0x%x -> 0x%x: waiting for the notifications to be enabled", from_handle, to_handle);
+
+        err_code = app_timer_start(m_handover_timer_id, HANDOVER_TIMEOUT, NULL);
+        APP_ERROR_CHECK(err_code);
+
+        handover_check();
+#else
+        NRF_LOG_INFO("Disconnect the original connection handle %d with Host A", from_handle);
+        err_code = sd_ble_gap_disconnect(from_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+        if (err_code != NRF_ERROR_INVALID_STATE)
+        {
+                APP_ERROR_CHECK(err_code);
+        }
+#endif
+}
+
+
+/**@brief Function for handling the Waveform Streaming Service events.
+ *
+ * @param[in] p_wfs  Waveform Streaming Service structure.
+ * @param[in] p_evt  Event received from the Waveform Streaming Service.
+ */
+static void on_wfs_evt(ble_wfs_t * p_wfs, ble_wfs_evt_t * p_evt)
+{
+        ret_code_t err_code;
+        wfs_link_t * p_link;
+
+        if (p_evt->conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                return;
+        }
+
+        p_link = &m_wfs_links[p_evt->conn_handle];
+
+        switch (p_evt->evt_type)
+        {
+        case BLE_WFS_EVT_NOTIFICATION_ENABLED:
+                link_cccd_set(p_evt->conn_handle, CONN_CCCD_WFS, true);
+                handover_check();
+                break;
+
+        case BLE_WFS_EVT_NOTIFICATION_DISABLED:
+                link_cccd_set(p_evt->conn_handle, CONN_CCCD_WFS, false);
+                break;
+
+        case BLE_WFS_EVT_STREAM_START:
+                if (!conn_ctx_cccd_is_set(p_evt->conn_handle, CONN_CCCD_WFS) || p_link->streaming)
+                {
+                        break;
+                }
+                NRF_LOG_INFO("Waveform stream started on link 0x%x, %s",
+                             p_evt->conn_handle,
+                             (uint32_t)(p_evt->compressed ? "coded" : "raw"));
+
+                if (p_evt->compressed)
+                {
+                        // Cycle counter for the codec statistics.
+                        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                        DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+                }
+
+                CRITICAL_REGION_ENTER();
+                p_link->streaming    = true;
+                p_link->batch_full   = false;
+                p_link->compressed   = p_evt->compressed;
+                p_link->len          = 0;
+                p_link->start_ticks  = app_timer_cnt_get();
+                p_link->bytes_cnt    = 0;
+                p_link->dropped_cnt  = 0;
+                p_link->sample_cnt   = 0;
+                p_link->coded_len    = 0;
+                p_link->codec_cycles = 0;
+                sample_codec_init(&p_link->codec, WFS_CODEC_KEYFRAME_INTERVAL);
+                CRITICAL_REGION_EXIT();
+
+                link_speed_up(p_evt->conn_handle);
+                conn_policy_refresh(p_evt->conn_handle, CONN_BURST_START_DELAY);
+
+                if (m_wfs_streaming_cnt++ == 0)
+                {
+                        err_code = app_timer_start(m_wfs_timer_id, WFS_TIMER_INTERVAL, NULL);
+                        APP_ERROR_CHECK(err_code);
+                }
+                break;
+
+        case BLE_WFS_EVT_STREAM_STOP:
+                if (!p_link->streaming)
+                {
+                        break;
+                }
+                p_link->streaming = false;
+                wfs_throughput_log(p_evt->conn_handle);
+                conn_policy_refresh(p_evt->conn_handle, CONN_POLICY_SETTLE_DELAY);
+
+                if (--m_wfs_streaming_cnt == 0)
+                {
+                        err_code = app_timer_stop(m_wfs_timer_id);
+                        APP_ERROR_CHECK(err_code);
+                }
+                break;
+
+        default:
+                break;
+        }
+}
+
+
+/**@brief Function for resetting the waveform stream state of a link.
+ *
+ * @details Stops the stream of the link if it is running, e.g. on disconnect.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static void wfs_link_reset(uint16_t conn_handle)
+{
+        ble_wfs_evt_t evt;
+
+        if (conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                return;
+        }
+
+        evt.evt_type    = BLE_WFS_EVT_STREAM_STOP;
+        evt.conn_handle = conn_handle;
+        on_wfs_evt(&m_wfs, &evt);
+
+        memset(&m_wfs_links[conn_handle], 0, sizeof(wfs_link_t));
+}
+
+
+/**@brief Function for indicating an RACP response code.
+ *
+ * @param[in] conn_handle    Connection handle of the link.
+ * @param[in] opcode         Op code of the request.
+ * @param[in] response_code  Response code.
+ */
+static void hls_racp_response_send(uint16_t conn_handle, uint8_t opcode, uint8_t response_code)
+{
+        ret_code_t       err_code;
+        ble_racp_value_t response;
+        uint8_t          operand[2];
+
+        operand[0] = opcode;
+        operand[1] = response_code;
+
+        response.opcode      = RACP_OPCODE_RESPONSE_CODE;
+        response.operator    = RACP_OPERATOR_NULL;
+        response.operand_len = sizeof(operand);
+        response.p_operand   = operand;
+
+        err_code = ble_hls_racp_response_send(&m_hls, conn_handle, &response);
+        if ((err_code != NRF_SUCCESS) &&
+            (err_code != NRF_ERROR_INVALID_STATE) &&
+            (err_code != BLE_ERROR_INVALID_CONN_HANDLE) &&
+            (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+        {
+                APP_ERROR_HANDLER(err_code);
+        }
+}
+
+
+/**@brief Function for ending the heart rate log transfer of a link.
+ *
+ * @param[in] conn_handle    Connection handle of the link.
+ * @param[in] response_code  RACP response code to indicate.
+ */
+static void hls_transfer_end(uint16_t conn_handle, uint8_t response_code)
+{
+        hls_link_t * p_link     = &m_hls_links[conn_handle];
+        uint32_t     elapsed_ms = TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_link->start_ticks));
+
+        p_link->transferring = false;
+        conn_burst_release(conn_handle, CONN_BURST_USER_LOG);
+
+        NRF_LOG_INFO("Log transfer on link 0x%x: %d samples in %d ms",
+                     conn_handle,
+                     p_link->sent_cnt,
+                     elapsed_ms);
+
+        hls_racp_response_send(conn_handle, RACP_OPCODE_REPORT_RECS, response_code);
+}
+
+
+/**@brief Function for sending logged samples while TX slots allow.
+ *
+ * @details Each notification carries as many samples as fit into the ATT payload of the link.
+ *          A sample is its sequence number (4 bytes), boot number (2 bytes), seconds since that
+ *          boot (4 bytes) and heart rate (2 bytes). Samples deleted from the log while the
+ *          transfer runs are skipped.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static void hls_transfer_pump(uint16_t conn_handle)
+{
+        ret_code_t      err_code;
+        hr_log_sample_t samples[BLE_HLS_MAX_DATA_LEN / HLS_SAMPLE_LEN];
+        uint8_t         data[BLE_HLS_MAX_DATA_LEN];
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(conn_handle);
+
+        if ((p_queue == NULL) || (p_queue->conn_handle != conn_handle))
+        {
+                return;
+        }
+
+        hls_link_t * p_link = &m_hls_links[conn_handle];
+
+        while (p_link->transferring &&
+               (p_queue->count == 0) &&
+               (p_queue->credits > WFS_HRM_RESERVED_CREDITS))
+        {
+                uint32_t first_seq;
+                uint32_t last_seq;
+                uint16_t max_cnt = MIN(p_queue->max_hrm_len / HLS_SAMPLE_LEN,
+                                       p_link->last_seq - p_link->next_seq + 1);
+                uint16_t cnt     = hr_log_read(p_link->next_seq, samples, max_cnt);
+                uint16_t len     = 0;
+
+                if (cnt == 0)
+                {
+                        if (!hr_log_range_get(&first_seq, &last_seq) || (first_seq > p_link->last_seq))
+                        {
+                                hls_transfer_end(conn_handle, RACP_RESPONSE_NO_RECORDS_FOUND);
+                        }
+                        else if (p_link->next_seq < first_seq)
+                        {
+                                p_link->next_seq = first_seq;
+                        }
+                        else
+                        {
+                                // The record was lost, continue with the next one.
+                                p_link->next_seq = (p_link->next_seq / HR_LOG_SAMPLES_PER_RECORD + 1) *
+                                                   HR_LOG_SAMPLES_PER_RECORD;
+                                if (p_link->next_seq > p_link->last_seq)
+                                {
+                                        hls_transfer_end(conn_handle, RACP_RESPONSE_SUCCESS);
+                                }
+                        }
+                        continue;
+                }
+
+                for (uint16_t i = 0; i < cnt; i++)
+                {
+                        len += uint32_encode(samples[i].seq, &data[len]);
+                        len += uint16_encode(samples[i].boot, &data[len]);
+                        len += uint32_encode(samples[i].time_s, &data[len]);
+                        len += uint16_encode(samples[i].heart_rate, &data[len]);
+                }
+
+                CRITICAL_REGION_ENTER();
+                err_code = ble_hls_data_send(&m_hls, conn_handle, data, len);
+                if (err_code == NRF_SUCCESS)
+                {
+                        p_queue->credits--;
+                        hrm_tx_queue_inflight_push(p_queue, false, 0);
+                }
+                else if (err_code == NRF_ERROR_RESOURCES)
+                {
+                        p_queue->credits = 0;
+                        p_queue->busy_cnt++;
+                }
+                CRITICAL_REGION_EXIT();
+
+                if (err_code == NRF_SUCCESS)
+                {
+                        p_link->next_seq  = samples[cnt - 1].seq + 1;
+                        p_link->sent_cnt += cnt;
+                        if (p_link->next_seq > p_link->last_seq)
+                        {
+                                hls_transfer_end(conn_handle, RACP_RESPONSE_SUCCESS);
+                        }
+                }
+                else if ((err_code == NRF_ERROR_INVALID_STATE) ||
+                         (err_code == BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+                {
+                        link_cccd_set(conn_handle, CONN_CCCD_HLS, false);
+                        hls_transfer_end(conn_handle, RACP_RESPONSE_PROCEDURE_NOT_DONE);
+                }
+                else if ((err_code != NRF_ERROR_RESOURCES) &&
+                         (err_code != BLE_ERROR_INVALID_CONN_HANDLE))
+                {
+                        APP_ERROR_HANDLER(err_code);
+                }
+                else
+                {
+                        break;
+                }
+        }
+}
+
+
+/**@brief Function for getting the samples selected by an RACP request.
+ *
+ * @details Operands are a filter type, @ref BLE_HLS_RACP_FILTER_SEQ, followed by one or two
+ *          32-bit sample sequence numbers.
+ *
+ * @param[in]  p_racp      Decoded request.
+ * @param[out] p_from_seq  Sequence number of the first selected sample.
+ * @param[out] p_to_seq    Sequence number of the last selected sample.
+ *
+ * @return RACP response code, RACP_RESPONSE_SUCCESS if at least one sample was selected.
+ */
+static uint8_t hls_racp_range_get(ble_racp_value_t const * p_racp, uint32_t * p_from_seq, uint32_t * p_to_seq)
+{
+        uint32_t first_seq;
+        uint32_t last_seq;
+        uint8_t  operand_len = 0;
+
+        switch (p_racp->operator)
+        {
+        case RACP_OPERATOR_ALL:
+        case RACP_OPERATOR_FIRST:
+        case RACP_OPERATOR_LAST:
+                break;
+
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+                operand_len = 1 + sizeof(uint32_t);
+                break;
+
+        case RACP_OPERATOR_RANGE:
+                operand_len = 1 + 2 * sizeof(uint32_t);
+                break;
+
+        case RACP_OPERATOR_NULL:
+                return RACP_RESPONSE_INVALID_OPERATOR;
+
+        default:
+                return RACP_RESPONSE_OPERATOR_UNSUPPORTED;
+        }
+
+        if (p_racp->operand_len != operand_len)
+        {
+                return RACP_RESPONSE_INVALID_OPERAND;
+        }
+        if ((operand_len != 0) && (p_racp->p_operand[0] != BLE_HLS_RACP_FILTER_SEQ))
+        {
+                return RACP_RESPONSE_OPERAND_UNSUPPORTED;
+        }
+
+        if (!hr_log_range_get(&first_seq, &last_seq))
+        {
+                return RACP_RESPONSE_NO_RECORDS_FOUND;
+        }
+
+        *p_from_seq = first_seq;
+        *p_to_seq   = last_seq;
+
+        switch (p_racp->operator)
+        {
+        case RACP_OPERATOR_FIRST:
+                *p_to_seq = first_seq;
+                break;
+
+        case RACP_OPERATOR_LAST:
+                *p_from_seq = last_seq;
+                break;
+
+        case RACP_OPERATOR_LESS_OR_EQUAL:
+                *p_to_seq = MIN(last_seq, uint32_decode(&p_racp->p_operand[1]));
+                break;
+
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+                *p_from_seq = MAX(first_seq, uint32_decode(&p_racp->p_operand[1]));
+                break;
+
+        case RACP_OPERATOR_RANGE:
+                *p_from_seq = MAX(first_seq, uint32_decode(&p_racp->p_operand[1]));
+                *p_to_seq   = MIN(last_seq, uint32_decode(&p_racp->p_operand[1 + sizeof(uint32_t)]));
+                break;
+
+        default:
+                break;
+        }
+
+        return (*p_from_seq <= *p_to_seq) ? RACP_RESPONSE_SUCCESS : RACP_RESPONSE_NO_RECORDS_FOUND;
+}
+
+
+/**@brief Function for handling an RACP request.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] p_racp       Decoded request.
+ */
+static void hls_racp_request_handle(uint16_t conn_handle, ble_racp_value_t const * p_racp)
+{
+        hls_link_t * p_link = &m_hls_links[conn_handle];
+        uint32_t     from_seq;
+        uint32_t     to_seq;
+        uint8_t      response_code;
+
+        if (p_link->transferring && (p_racp->opcode != RACP_OPCODE_ABORT_OPERATION))
+        {
+                hls_racp_response_send(conn_handle, p_racp->opcode, RACP_RESPONSE_PROCEDURE_NOT_DONE);
+                return;
+        }
+
+        switch (p_racp->opcode)
+        {
+        case RACP_OPCODE_REPORT_RECS:
+                response_code = hls_racp_range_get(p_racp, &from_seq, &to_seq);
+                if ((response_code == RACP_RESPONSE_SUCCESS) &&
+                    !conn_ctx_cccd_is_set(conn_handle, CONN_CCCD_HLS))
+                {
+                        response_code = RACP_RESPONSE_PROCEDURE_NOT_DONE;
+                }
+                if (response_code != RACP_RESPONSE_SUCCESS)
+                {
+                        hls_racp_response_send(conn_handle, p_racp->opcode, response_code);
+                        break;
+                }
+
+                NRF_LOG_INFO("Log transfer on link 0x%x: samples %d to %d", conn_handle, from_seq, to_seq);
+
+                p_link->transferring = true;
+                p_link->next_seq     = from_seq;
+                p_link->last_seq     = to_seq;
+                p_link->sent_cnt     = 0;
+                p_link->start_ticks  = app_timer_cnt_get();
+
+                link_speed_up(conn_handle);
+                conn_burst_request(conn_handle, CONN_BURST_USER_LOG, HLS_BURST_TIMEOUT);
+                hls_transfer_pump(conn_handle);
+                break;
+
+        case RACP_OPCODE_REPORT_NUM_RECS:
+        {
+                ble_racp_value_t response;
+                uint8_t          operand[sizeof(uint16_t)];
+
+                response_code = hls_racp_range_get(p_racp, &from_seq, &to_seq);
+                if ((response_code != RACP_RESPONSE_SUCCESS) && (response_code != RACP_RESPONSE_NO_RECORDS_FOUND))
+                {
+                        hls_racp_response_send(conn_handle, p_racp->opcode, response_code);
+                        break;
+                }
+
+                uint32_t num = (response_code == RACP_RESPONSE_SUCCESS) ? (to_seq - from_seq + 1) : 0;
+
+                response.opcode      = RACP_OPCODE_NUM_RECS_RESPONSE;
+                response.operator    = RACP_OPERATOR_NULL;
+                response.operand_len = uint16_encode((uint16_t)MIN(num, UINT16_MAX), operand);
+                response.p_operand   = operand;
+
+                ret_code_t err_code = ble_hls_racp_response_send(&m_hls, conn_handle, &response);
+                if ((err_code != NRF_SUCCESS) &&
+                    (err_code != NRF_ERROR_INVALID_STATE) &&
+                    (err_code != BLE_ERROR_INVALID_CONN_HANDLE) &&
+                    (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+                {
+                        APP_ERROR_HANDLER(err_code);
+                }
+        } break;
+
+        case RACP_OPCODE_DELETE_RECS:
+                if (p_racp->operator != RACP_OPERATOR_ALL)
+                {
+                        response_code = (p_racp->operator == RACP_OPERATOR_NULL) ?
+                                        RACP_RESPONSE_INVALID_OPERATOR : RACP_RESPONSE_OPERATOR_UNSUPPORTED;
+                }
+                else
+                {
+                        response_code = (hr_log_clear() == NRF_SUCCESS) ?
+                                        RACP_RESPONSE_SUCCESS : RACP_RESPONSE_PROCEDURE_NOT_DONE;
+                }
+                hls_racp_response_send(conn_handle, p_racp->opcode, response_code);
+                break;
+
+        case RACP_OPCODE_ABORT_OPERATION:
+                if (p_racp->operator != RACP_OPERATOR_NULL)
+                {
+                        hls_racp_response_send(conn_handle, p_racp->opcode, RACP_RESPONSE_INVALID_OPERATOR);
+                        break;
+                }
+                p_link->transferring = false;
+                conn_burst_release(conn_handle, CONN_BURST_USER_LOG);
+                hls_racp_response_send(conn_handle, p_racp->opcode, RACP_RESPONSE_SUCCESS);
+                break;
+
+        default:
+                hls_racp_response_send(conn_handle, p_racp->opcode, RACP_RESPONSE_OPCODE_UNSUPPORTED);
+                break;
+        }
+}
+
+
+/**@brief Function for handling the Heart Rate Log Service events.
+ *
+ * @param[in] p_hls  Heart Rate Log Service structure.
+ * @param[in] p_evt  Event received from the Heart Rate Log Service.
+ */
+static void on_hls_evt(ble_hls_t * p_hls, ble_hls_evt_t * p_evt)
+{
+        if (p_evt->conn_handle >= NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                return;
+        }
+
+        switch (p_evt->evt_type)
+        {
+        case BLE_HLS_EVT_NOTIFICATION_ENABLED:
+                link_cccd_set(p_evt->conn_handle, CONN_CCCD_HLS, true);
+                break;
+
+        case BLE_HLS_EVT_NOTIFICATION_DISABLED:
+                link_cccd_set(p_evt->conn_handle, CONN_CCCD_HLS, false);
+                break;
+
+        case BLE_HLS_EVT_RACP_REQUEST:
+                hls_racp_request_handle(p_evt->conn_handle, &p_evt->racp);
+                break;
+
+        default:
+                break;
+        }
+}
+
+
+/**@brief Function for resetting the heart rate log transfer state of a link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static void hls_link_reset(uint16_t conn_handle)
+{
+        if (conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                memset(&m_hls_links[conn_handle], 0, sizeof(hls_link_t));
+        }
+}
+
+
+/**@brief Function for handling the HVN TX complete event.
+ *
+ * @details Records the sample-to-air latency of the transmitted measurements, returns the TX
+ *          slots to the link and sends the measurements that were waiting for them. Notifications
+ *          of other characteristics complete through the same event, so the latency is an estimate.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] count        Number of notifications transmitted.
+ */
+static void on_hvn_tx_complete(uint16_t conn_handle, uint8_t count)
+{
+        ret_code_t err_code;
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(conn_handle);
+
+        if ((p_queue == NULL) || (p_queue->conn_handle != conn_handle))
+        {
+                return;
+        }
+
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+        if (p_ctx != NULL)
+        {
+                p_ctx->hvn_tx_cnt += count;
+        }
+
+        err_code = hrm_tx_queue_on_tx_complete(p_queue, count, app_timer_cnt_get());
+        hrm_tx_queue_result_handle(conn_handle, err_code);
+
+        // Heart Rate Measurements first, then the log transfer, the stream gets what is left.
+        hls_transfer_pump(conn_handle);
+        wfs_batch_send(conn_handle);
+}
+
+
+/**@brief Function for reading the Heart Rate Measurement CCCD of a link.
+ *
+ * @details Used when the CCCD has been restored from the bond instead of written by the peer.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ */
+static void hrm_cccd_refresh(uint16_t conn_handle)
+{
+        ret_code_t err_code;
+        uint8_t cccd[BLE_CCCD_VALUE_LEN];
+        ble_gatts_value_t gatts_value;
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(conn_handle);
+
+        if ((p_queue == NULL) || (p_queue->conn_handle != conn_handle))
+        {
+                return;
+        }
+
+        memset(&gatts_value, 0, sizeof(gatts_value));
+
+        gatts_value.len     = sizeof(cccd);
+        gatts_value.offset  = 0;
+        gatts_value.p_value = cccd;
+
+        err_code = sd_ble_gatts_value_get(conn_handle, m_hrs.hrm_handles.cccd_handle, &gatts_value);
+        if (err_code == NRF_SUCCESS)
+        {
+                link_cccd_set(conn_handle, CONN_CCCD_HRM, ble_srv_is_notification_enabled(cccd));
+                handover_check();
+        }
+        else if (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
+        {
+                APP_ERROR_HANDLER(err_code);
+        }
+
+        NRF_LOG_INFO("HRM link 0x%x notifications %s",
+                     conn_handle,
+                     conn_ctx_cccd_is_set(conn_handle, CONN_CCCD_HRM) ? "enabled" : "disabled");
+}
+
+
+/**@brief Function for handling a write to the Heart Rate Measurement CCCD.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] p_write      Write event received from the BLE stack.
+ */
+static void on_hrm_cccd_write(uint16_t conn_handle, ble_gatts_evt_write_t const * p_write)
+{
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(conn_handle);
+
+        if ((p_queue == NULL) ||
+            (p_queue->conn_handle != conn_handle) ||
+            (p_write->handle != m_hrs.hrm_handles.cccd_handle) ||
+            (p_write->len != BLE_CCCD_VALUE_LEN))
+        {
+                return;
+        }
+
+        link_cccd_set(conn_handle, CONN_CCCD_HRM, ble_srv_is_notification_enabled(p_write->data));
+        handover_check();
+
+        NRF_LOG_INFO("HRM link 0x%x notifications %s",
+                     conn_handle,
+                     conn_ctx_cccd_is_set(conn_handle, CONN_CCCD_HRM) ? "enabled" : "disabled");
+}
+
+
+/**@brief Function for acting on the result of a whitelist change.
+ *
+ * @details A whitelist advertising still uses is given again by @ref advertising_start, after it
+ *          has stopped the advertising. The rotation timer runs while there are more bonds than
+ *          whitelist entries.
+ *
+ * @param[in] err_code  Result of the whitelist change.
+ */
+static void whitelist_result_handle(ret_code_t err_code)
+{
+        whitelist_stats_t stats;
+        bool              rotate = whitelist_is_rotating();
+
+        if (err_code == NRF_ERROR_INVALID_STATE)
+        {
+                NRF_LOG_INFO("Whitelist in use, %d peers wait for the next advertising start",
+                             whitelist_peer_count());
+        }
+        else
+        {
+                APP_ERROR_CHECK(err_code);
+
+                whitelist_stats_get(&stats);
+                NRF_LOG_DEBUG("Whitelist: %d peers, %d updates, %d redundant updates avoided",
+                              whitelist_peer_count(),
+                              stats.push_cnt,
+                              stats.avoided_cnt);
+        }
+
+        if (rotate != m_whitelist_rotation_running)
+        {
+                err_code = rotate ? app_timer_start(m_whitelist_rotation_timer_id, WHITELIST_ROTATION_INTERVAL, NULL) :
+                                    app_timer_stop(m_whitelist_rotation_timer_id);
+                APP_ERROR_CHECK(err_code);
+
+                m_whitelist_rotation_running = rotate;
+        }
+}
+
+
+/**@brief Function for ranking a bonded host that came back as the most recently used.
+ *
+ * @param[in] peer_id  Peer of the host.
+ */
+static void whitelist_reconnect_handle(pm_peer_id_t peer_id)
+{
+        whitelist_stats_t stats;
+
+        whitelist_result_handle(whitelist_on_reconnected(peer_id));
+
+        whitelist_stats_get(&stats);
+        NRF_LOG_INFO("Peer %d back, %d%% of %d reconnects from the whitelist",
+                     peer_id,
+                     (stats.hit_cnt * 100) / (stats.hit_cnt + stats.miss_cnt),
+                     stats.hit_cnt + stats.miss_cnt);
+}
+
+
+/**@brief Clear bond information from persistent storage.
+ */
+static void delete_bonds(void)
+{
+        ret_code_t err_code;
+
+        NRF_LOG_INFO("Erase bonds!");
+
+        err_code = pm_peers_delete();
+        APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for adding a connection to the connect latency histogram, and fitting the fast
+ *        advertising to it.
+ *
+ * @details The new parameters apply from the next start.
+ */
+static void adv_fast_params_adapt(void)
+{
+        uint32_t          latency_ms;
+        adv_adapt_stats_t stats;
+        adv_adapt_fit_t   fit;
+
+        if (!adv_adapt_on_connected(&latency_ms))
+        {
+                return;
+        }
+
+        adv_adapt_stats_get(&stats);
+        NRF_LOG_INFO("Host connected %d ms after advertising started (%d connections, %d without)",
+                     latency_ms,
+                     stats.connect_cnt,
+                     stats.idle_cnt);
+
+        if (!adv_adapt_fit(&fit))
+        {
+                return;
+        }
+
+        NRF_LOG_INFO("Advertising: fast interval %d ms, period %d s, %d ms radio-on saved per hour advertising",
+                     (fit.fast_interval * UNIT_0_625_MS) / 1000,
+                     fit.fast_timeout,
+                     fit.saved_ms_per_hour);
+
+#if ADV_ADAPT_ENABLED
+        if ((m_adv_modes_config.ble_adv_fast_interval != fit.fast_interval) ||
+            (m_adv_modes_config.ble_adv_fast_timeout != fit.fast_timeout))
+        {
+                m_adv_modes_config.ble_adv_fast_interval = fit.fast_interval;
+                m_adv_modes_config.ble_adv_fast_timeout  = fit.fast_timeout;
+#if ADV_PAYLOAD_CACHED
+                adv_cache_modes_config_set(&m_adv_modes_config);
+#else
+                ble_advertising_modes_config_set(&m_advertising, &m_adv_modes_config);
+#endif
+        }
+#endif
+}
+
+
+/**@brief Function for handling advertising events.
+ *
+ * @details This function will be called for advertising events which are passed to the application.
+ *
+ * @param[in] ble_adv_evt  Advertising event.
+ */
+static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
+{
+        ret_code_t ret;
+
+        m_adv_evt = ble_adv_evt;
+
+        switch (ble_adv_evt)
+        {
+        case BLE_ADV_EVT_FAST:
+                adv_adapt_on_started();
+                NRF_LOG_INFO("Fast advertising.");
+                ret = bsp_indication_set(BSP_INDICATE_ADVERTISING);
+                APP_ERROR_CHECK(ret);
+                break;
+
+        case BLE_ADV_EVT_DIRECTED:
+                adv_adapt_on_started();
+                NRF_LOG_INFO("Directed advertising to the lost host.");
+                ret = bsp_indication_set(BSP_INDICATE_ADVERTISING_DIRECTED);
+                APP_ERROR_CHECK(ret);
+                break;
+
+        case BLE_ADV_EVT_IDLE:
+                // The lost host did not come back.
+                reconnect_cancel();
+                adv_adapt_on_idle();
+                broadcast_resume();
+//                sleep_mode_enter();
+                break;
+
+        case BLE_ADV_EVT_FAST_WHITELIST:
+                adv_adapt_on_started();
+                NRF_LOG_INFO("Fast advertising with Whitelist");
+                ret = bsp_indication_set(BSP_INDICATE_ADVERTISING_WHITELIST);
+                APP_ERROR_CHECK(ret);
+                break;
+
+#if !ADV_PAYLOAD_CACHED
+        case BLE_ADV_EVT_PEER_ADDR_REQUEST:
+                if (reconnect_peer_addr_get() != NULL)
+                {
+                        ble_gap_addr_t peer_addr = *reconnect_peer_addr_get();
+
+                        ret = ble_advertising_peer_addr_reply(&m_advertising, &peer_addr);
+                        APP_ERROR_CHECK(ret);
+                }
+                break;
+
+        case BLE_ADV_EVT_WHITELIST_REQUEST:
+        {
+                ble_gap_addr_t whitelist_addrs[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+                ble_gap_irk_t whitelist_irks[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+                uint32_t addr_cnt = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+                uint32_t irk_cnt  = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+
+                ret = pm_whitelist_get(whitelist_addrs, &addr_cnt, whitelist_irks, &irk_cnt);
+                APP_ERROR_CHECK(ret);
+                NRF_LOG_INFO("pm_whitelist_get returns %d addr in whitelist and %d irk whitelist",
+                             addr_cnt,
+                             irk_cnt);
+
+                // Apply the whitelist.
+                ret = ble_advertising_whitelist_reply(&m_advertising,
+                                                      whitelist_addrs,
+                                                      addr_cnt,
+                                                      whitelist_irks,
+                                                      irk_cnt);
+                APP_ERROR_CHECK(ret);
+        }
+        break;
+#endif
+
+        default:
+                break;
+        }
+}
+
+
+#if !ADV_PAYLOAD_CACHED
+/**@brief Function for initializing the Advertising module of the SDK.
+ *
+ * @details Also called to undo ble_advertising_restart_without_whitelist(), which otherwise keeps
+ *          the whitelist off until the next disconnect.
+ */
+static void adv_module_init(void)
+{
+        ret_code_t             err_code;
+        ble_advertising_init_t init;
+
+        memset(&init, 0, sizeof(init));
+
+        init.advdata     = m_advdata;
+        init.config      = m_adv_modes_config;
+        init.evt_handler = on_adv_evt;
+
+        err_code = ble_advertising_init(&m_advertising, &init);
+        APP_ERROR_CHECK(err_code);
+
+        ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+}
+#endif
+
+
+/**@brief Function for recording the CPU cycles an advertising restart took.
+ *
+ * @param[in] cycles  CPU cycles of the restart.
+ */
+static void adv_restart_account(uint32_t cycles)
+{
+        m_adv_restart_stats.cnt++;
+        m_adv_restart_stats.sum_cycles += cycles;
+        m_adv_restart_stats.max_cycles  = MAX(m_adv_restart_stats.max_cycles, cycles);
+
+        NRF_LOG_INFO("Advertising restart: %d cycles, payload cached %d (average %d, max %d)",
+                     cycles,
+                     ADV_PAYLOAD_CACHED,
+                     m_adv_restart_stats.sum_cycles / m_adv_restart_stats.cnt,
+                     m_adv_restart_stats.max_cycles);
+}
+
+
+/**@brief Function for starting advertising.
+ */
+void advertising_start(bool b_whitelist)
+{
+        ret_code_t ret          = NRF_SUCCESS;
+        uint32_t   start_cycles = DWT->CYCCNT;
+
+        broadcast_stop();
+
+        if (b_whitelist)
+        {
+                // A whitelist change left over while advertising used the old one goes in now.
+                (void) sd_ble_gap_adv_stop();
+                whitelist_result_handle(whitelist_apply());
+
+                NRF_LOG_INFO("advertising_start, m_whitelist_peer_cnt = %d", whitelist_peer_count());
+                if (whitelist_peer_count() > 0)
+                {
+                        NRF_LOG_INFO("Advertising with whitelist");
+                        bsp_board_led_on(ADVERTISING_LED);
+
+                }
+                else
+                {
+                        NRF_LOG_INFO("Peer record is empty. Without Whiltelist");
+                        bsp_board_led_on(BONDING_LED);
+                }
+
+                // A host that lost its link is called back with directed advertising first, the
+                // module falls back to fast advertising when that times out. Directed advertising
+                // carries no payload.
+                ble_gap_addr_t const * p_lost_addr = reconnect_peer_addr_get();
+#if ADV_PAYLOAD_CACHED
+                ret = adv_cache_start((p_lost_addr != NULL) ? BLE_ADV_MODE_DIRECTED : BLE_ADV_MODE_FAST,
+                                      p_lost_addr,
+                                      whitelist_peer_count() > 0);
+#else
+                ret = ble_advertising_start(&m_advertising,
+                                            (p_lost_addr != NULL) ? BLE_ADV_MODE_DIRECTED : BLE_ADV_MODE_FAST);
+#endif
+                APP_ERROR_CHECK(ret);
+        }
+        else
+        {
+                //if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
+                {
+                        NRF_LOG_INFO("Restart the advertising without whitelist");
+#if ADV_PAYLOAD_CACHED
+                        ret = adv_cache_start(BLE_ADV_MODE_FAST, NULL, false);
+#else
+                        ret = ble_advertising_restart_without_whitelist(&m_advertising);
+#endif
+                        if (ret != NRF_ERROR_INVALID_STATE)
+                        {
+                                APP_ERROR_CHECK(ret);
+                        }
+                }
+        }
+
+        adv_restart_account(DWT->CYCCNT - start_cycles);
+}
+
+
+/**@brief Function for handling the whitelist rotation timer timeout.
+ *
+ * @details Moves the rotating whitelist entries on to the next less recently used hosts. Fast
+ *          advertising with the whitelist is restarted to use them; otherwise they apply from the
+ *          next advertising start.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void whitelist_rotation_timeout_handler(void * p_context)
+{
+        UNUSED_PARAMETER(p_context);
+
+        if (!whitelist_rotate())
+        {
+                return;
+        }
+
+        if ((m_adv_evt == BLE_ADV_EVT_FAST_WHITELIST) &&
+            !broadcast_is_running() &&
+            (sd_ble_gap_adv_stop() == NRF_SUCCESS))
+        {
+                advertising_start(true);
+        }
+        else
+        {
+                whitelist_result_handle(whitelist_apply());
+        }
+}
+
+/**@brief Function for handling File Data Storage events.
+ *
+ * @param[in] p_evt  Peer Manager event.
+ * @param[in] cmd
+ */
+static void fds_evt_handler(fds_evt_t const * const p_evt)
+{
+        if (p_evt->id == FDS_EVT_GC)
+        {
+                NRF_LOG_DEBUG("GC completed\n");
+        }
+
+        hr_log_on_fds_evt(p_evt);
+}
+
+/**@brief Function for starting a slice of the bonding window.
+ *
+ * @param[in] slice  ADV_SLICE_WHITELIST or ADV_SLICE_OPEN.
+ */
+static void adv_slice_start(adv_slice_t slice)
+{
+        uint32_t err_code;
+
+        adv_slicer_slice_begin(slice);
+
+        if (slice == ADV_SLICE_OPEN)
+        {
+                advertising_start(false);
+        }
+        else
+        {
+#if !ADV_PAYLOAD_CACHED
+                // Undo ble_advertising_restart_without_whitelist() of the open slice.
+                (void) sd_ble_gap_adv_stop();
+                adv_module_init();
+#endif
+                advertising_start(true);
+        }
+
+        err_code = app_timer_start(m_adv_slice_timer_id,
+                                   (slice == ADV_SLICE_OPEN) ? ADV_SLICE_OPEN_TIME : ADV_SLICE_WHITELIST_TIME,
+                                   NULL);
+        APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for pausing the slices, e.g. when no peripheral link is left to advertise for.
+ */
+static void adv_slice_pause(void)
+{
+        uint32_t err_code;
+
+        err_code = app_timer_stop(m_adv_slice_timer_id);
+        APP_ERROR_CHECK(err_code);
+
+        adv_slicer_slice_end();
+}
+
+
+/**@brief Function for logging the connections of the slices of the bonding window.
+ */
+static void adv_slice_stats_log(void)
+{
+        for (uint32_t slice = ADV_SLICE_WHITELIST; slice < ADV_SLICE_COUNT; slice++)
+        {
+                adv_slice_stats_t stats;
+
+                adv_slicer_stats_get((adv_slice_t)slice, &stats);
+                NRF_LOG_INFO("Bonding window, %s slices: %d run, %d links attempted, %d rejected, %d accepted",
+                             (uint32_t)((slice == ADV_SLICE_OPEN) ? "open" : "whitelist"),
+                             stats.slice_cnt,
+                             stats.attempted_cnt,
+                             stats.rejected_cnt,
+                             stats.accepted_cnt);
+        }
+}
+
+
+/**@brief Function for handling the end of a slice of the bonding window.
+ *
+ * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
+ *                       app_start_timer() call to the timeout handler.
+ */
+static void adv_slice_timeout_handler(void * p_context)
+{
+        UNUSED_PARAMETER(p_context);
+
+        // Without links the advertising belongs to the bonded hosts again, and with all links
+        // used there is nothing to advertise for.
+        if (!advertising_bond_timer_is_running ||
+            (conn_ctx_count() == 0) ||
+            (conn_ctx_count() >= NRF_SDH_BLE_PERIPHERAL_LINK_COUNT))
+        {
+                adv_slicer_slice_end();
+                return;
+        }
+
+        adv_slice_start((adv_slicer_current() == ADV_SLICE_OPEN) ? ADV_SLICE_WHITELIST : ADV_SLICE_OPEN);
+}
+
+
+/**@brief Function for counting a link established in a slice of the bonding window.
+ *
+ * @param[in] p_ctx  Context of the new link.
+ */
+static void adv_slice_on_connected(conn_ctx_t * p_ctx)
+{
+        adv_slicer_on_connected(p_ctx);
+
+        if (advertising_bond_timer_is_running && (conn_ctx_count() >= NRF_SDH_BLE_PERIPHERAL_LINK_COUNT))
+        {
+                adv_slice_pause();
+        }
+}
+
+
+/**@brief Function for counting the outcome of a link established in a slice of the bonding
+ *        window.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ * @param[in] accepted     Whether the link was secured, as opposed to dropped or failing security.
+ */
+static void adv_slice_on_outcome(uint16_t conn_handle, bool accepted)
+{
+        conn_ctx_t * p_ctx = conn_ctx_get(conn_handle);
+
+        if (p_ctx != NULL)
+        {
+                adv_slicer_on_outcome(p_ctx, accepted);
+        }
+}
+
+
+static void stop_advertising_bond_timer(void)
+{
+        uint32_t err_code = NRF_SUCCESS;
+        if (advertising_bond_timer_is_running)
+        {
+                err_code = app_timer_stop(m_advertising_bond_timer_id);
+                APP_ERROR_CHECK(err_code);
+                advertising_bond_timer_is_running = false;
+                m_bond_second_host_is_running = false;
+                adv_slice_pause();
+                adv_slice_stats_log();
+        }
+}
+
+static void advertising_bond_timeout_handler(void * p_context)
+{
+        UNUSED_PARAMETER(p_context);
+
+        advertising_bond_timer_is_running = false;
+        adv_slice_pause();
+        adv_slice_stats_log();
+
+        // With no link left, the advertising was restarted for the bonded hosts, leave it running.
+        if (conn_ctx_count() > 0)
+        {
+                NRF_LOG_INFO("Stop advertising for bonding!!!");
+                (void) sd_ble_gap_adv_stop();
+                m_bond_second_host_is_running = false;
+                broadcast_stop();
+        }
+
+        broadcast_resume();
+}
+
+static void on_advertising_for_bond_request(void)
+{
+        uint32_t err_code = NRF_SUCCESS;
+
+        if (m_bond_second_host_is_running)
+                return;
+
+        // if the device is already connected to a host and has a free link, it would start the advertising.
+        if ((conn_ctx_count() > 0) && (conn_ctx_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT))
+        {
+                // Create timers.
+                err_code = app_timer_create(&m_advertising_bond_timer_id,
+                                            APP_TIMER_MODE_SINGLE_SHOT,
+                                            advertising_bond_timeout_handler);
+                APP_ERROR_CHECK(err_code);
+
+                // Start application timers.
+                err_code = app_timer_start(m_advertising_bond_timer_id, ADVERTISING_BOND_TIME_INTERVAL, NULL);
+                APP_ERROR_CHECK(err_code);
+
+                advertising_bond_timer_is_running = true;
+
+                m_bond_second_host_is_running = true;
+
+                NRF_LOG_INFO("Press button BONDING_BUTTON");
+                NRF_LOG_INFO("Start Advertising bonding for host %d!!", conn_ctx_count() + 1);
+
+                // Alternate open slices for the new host with whitelisted ones, so that a bonded
+                // host that lost its link can still come back. The new host is waiting, start open.
+                adv_slicer_window_open();
+                adv_slice_start(ADV_SLICE_OPEN);
+        }
+}
+
+/**@brief Function for clearing other bond records in main loop
+ *
+ * @details This function is called when a pairing/bonding has just been successful.
+ */
+static void on_bonded (pm_peer_id_t const * p_handle, uint16_t event_size)
+{
+        ret_code_t err_code;
+
+        NRF_LOG_INFO("on_bonded: # peer %d, %s, new peer id = %d",
+                     pm_peer_count(),
+                     (uint32_t)(BOND_SINGLE_HOST ? "delete all others" : "keep all"),
+                     m_bonded_peer_id);
+
+        err_code = bond_on_bonded(m_bonded_peer_id);
+        APP_ERROR_CHECK(err_code);
+
+        // Stop the advertising bonding timer
+        stop_advertising_bond_timer();
+
+        // The new bond belongs to a secondary host, hand over to it.
+        conn_ctx_t const * p_primary = conn_ctx_find(CONN_ROLE_PRIMARY_HOST);
+        conn_ctx_t const * p_bonded  = conn_ctx_find_by_peer(m_bonded_peer_id);
+        if ((p_primary != NULL) && (p_bonded != NULL) && (p_bonded->role == CONN_ROLE_SECONDARY_HOST))
+        {
+                bsp_board_led_off(BONDING_LED);
+                handover_start(p_primary->conn_handle, p_bonded->conn_handle);
         }
 }
 
-/**@brief Function for clearing other bond records in main loop
+
+/**@brief Function for logging the connect to encrypted statistics of the links of one kind.
  *
- * @details This function is called when a pairing/bonding has just been successful.
+ * @param[in] p_kind  Kind of the links.
+ * @param[in] p_time  Statistics of the links.
  */
-static void on_bonded (pm_peer_id_t const * p_handle, uint16_t event_size)
+static void enc_time_log(char const * p_kind, bond_enc_time_t const * p_time)
 {
-        uint32_t err_code;
-        uint32_t n_peer, i;
-        pm_peer_id_t peer_id, peer_id_prev = PM_PEER_ID_INVALID;
+        NRF_LOG_INFO("%s: %d links encrypted, average %d ms, max %d ms, %d closed unencrypted",
+                     (uint32_t)p_kind,
+                     p_time->enc_cnt,
+                     (p_time->enc_cnt > 0) ? (p_time->enc_sum_ms / p_time->enc_cnt) : 0,
+                     p_time->enc_max_ms,
+                     p_time->clear_cnt);
+}
 
-        n_peer = pm_peer_count();
 
-        NRF_LOG_INFO("on_bonded: # peer %d, delete all except peer id = %d", n_peer, m_bonded_peer_id);
+/**@brief Function for logging the connect to encrypted statistics, with and without the early
+ *        Security Request.
+ */
+static void enc_stats_log(void)
+{
+        bond_enc_stats_t stats;
+
+        bond_enc_stats_get(&stats);
+        enc_time_log("Early Security Request", &stats.early);
+        enc_time_log("Left to the host", &stats.host);
+}
 
-        for (i = 0; i < n_peer; i++)
-        {
-                peer_id      = pm_next_peer_id_get (peer_id_prev);
-                peer_id_prev = peer_id;
 
-                if (peer_id != PM_PEER_ID_INVALID && peer_id != m_bonded_peer_id)
-                {
-                        err_code = pm_peer_delete(peer_id);
-                        APP_ERROR_CHECK(err_code);
-                }
+/**@brief Function for logging the time from connect to encrypted of a link.
+ *
+ * @param[in] p_ctx  Context of the link.
+ */
+static void enc_stats_on_encrypted(conn_ctx_t * p_ctx)
+{
+        uint32_t enc_ms;
+
+        if (!bond_on_encrypted(p_ctx, &enc_ms))
+        {
+                return;
         }
 
-        // Stop the advertising bonding timer
-        stop_advertising_bond_timer();
+        NRF_LOG_INFO("Link 0x%x: encrypted %d ms after connect, early request %d",
+                     p_ctx->conn_handle,
+                     enc_ms,
+                     (p_ctx->enc_mode == BOND_ENC_EARLY));
+        enc_stats_log();
+}
+
 
-        uint32_t periph_link_cnt = ble_conn_state_n_peripherals();   // Number of peripheral links.
-        if (periph_link_cnt  == NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+/**@brief Function for logging a link of a bonded host that is closed before it was encrypted.
+ *
+ * @param[in] p_ctx  Context of the link.
+ */
+static void enc_stats_on_disconnected(conn_ctx_t const * p_ctx)
+{
+        if (!bond_on_disconnected(p_ctx))
         {
-                bsp_board_led_off(BONDING_LED);
-                NRF_LOG_INFO("Disconnect the original connection handle %d with Host A", m_conn_handle);
-                err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
-                APP_ERROR_CHECK(err_code);
+                return;
         }
+
+        NRF_LOG_INFO("Link 0x%x: bonded host left unencrypted, early request %d",
+                     p_ctx->conn_handle,
+                     (p_ctx->enc_mode == BOND_ENC_EARLY));
+        enc_stats_log();
 }
 
 
@@ -423,6 +2251,12 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
         {
                 NRF_LOG_INFO("PM_EVT_BONDED_PEER_CONNECTED");
                 NRF_LOG_INFO("Connected to a previously bonded device.");
+                conn_ctx_t * p_ctx = conn_ctx_get(p_evt->conn_handle);
+                if (p_ctx != NULL)
+                {
+                        err_code = bond_sec_request(p_ctx);
+                        APP_ERROR_CHECK(err_code);
+                }
         } break;
 
         case PM_EVT_CONN_SEC_SUCCEEDED:
@@ -434,12 +2268,24 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
                              p_evt->params.conn_sec_succeeded.procedure);
 
                 m_peer_id = p_evt->peer_id;
+                adv_slice_on_outcome(p_evt->conn_handle, true);
+                conn_ctx_t * p_ctx = conn_ctx_get(p_evt->conn_handle);
+                if (p_ctx != NULL)
+                {
+                        p_ctx->peer_id = p_evt->peer_id;
+                }
+                conn_burst_release(p_evt->conn_handle, CONN_BURST_USER_BOND);
 
                 switch (p_evt->params.conn_sec_succeeded.procedure)
                 {
                 case PM_LINK_SECURED_PROCEDURE_ENCRYPTION:
                         NRF_LOG_INFO("PM_LINK_SECURED_PROCEDURE_ENCRYPTION succeed.\r\n");
 
+                        if (p_ctx != NULL)
+                        {
+                                enc_stats_on_encrypted(p_ctx);
+                        }
+                        whitelist_reconnect_handle(p_evt->peer_id);
                         break;
 
                 case PM_LINK_SECURED_PROCEDURE_BONDING:
@@ -473,6 +2319,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
                  * How to handle this error is highly application dependent. */
 
                 NRF_LOG_INFO("PM_EVT_CONN_SEC_FAILED");
+                adv_slice_on_outcome(p_evt->conn_handle, false);
+                conn_burst_release(p_evt->conn_handle, CONN_BURST_USER_BOND);
         } break;
 
         case PM_EVT_CONN_SEC_CONFIG_REQ:
@@ -501,6 +2349,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
         {
 
                 NRF_LOG_INFO("PM_EVT_PEERS_DELETE_SUCCEEDED");
+                err_code = whitelist_remove(p_evt->peer_id);
+                whitelist_result_handle(err_code);
 
         }
         break;
@@ -508,13 +2358,17 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
         {
 
                 NRF_LOG_INFO("PM_EVT_PEERS_DELETE_SUCCEEDED");
+                err_code = whitelist_load();
+                whitelist_result_handle(err_code);
                 //advertising_start(true);
-                err_code = ble_advertising_restart_without_whitelist(&m_advertising);
-                if (err_code != NRF_ERROR_INVALID_STATE)
-                {
-                        APP_ERROR_CHECK(err_code);
-                }
+                advertising_start(false);
+
+        } break;
 
+        case PM_EVT_LOCAL_DB_CACHE_APPLIED:
+        {
+                // The CCCDs of the bond have been restored, notifications may already be enabled.
+                hrm_cccd_refresh(p_evt->conn_handle);
         } break;
 
         case PM_EVT_LOCAL_DB_CACHE_APPLY_FAILED:
@@ -531,36 +2385,11 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
                 {
                         NRF_LOG_INFO("New Bond, add the peer to the whitelist if possible");
                         NRF_LOG_INFO("\tm_whitelist_peer_cnt %d, MAX_PEERS_WLIST %d",
-                                     m_whitelist_peer_cnt + 1,
+                                     whitelist_peer_count() + 1,
                                      BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
 
-
-                        if (m_whitelist_peer_cnt < BLE_GAP_WHITELIST_ADDR_MAX_COUNT)
-                        {
-                                memset(m_whitelist_peers, PM_PEER_ID_INVALID, sizeof(m_whitelist_peers));
-                                m_whitelist_peer_cnt = (sizeof(m_whitelist_peers) / sizeof(pm_peer_id_t));
-
-                                peer_list_get(m_whitelist_peers, &m_whitelist_peer_cnt);
-
-                                err_code = pm_whitelist_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                                APP_ERROR_CHECK(err_code);
-
-                                if (m_whitelist_peer_cnt > 0)
-                                {
-                                        // Setup the device identies list.
-                                        // Some SoftDevices do not support this feature.
-                                        err_code = pm_device_identities_list_set(m_whitelist_peers, m_whitelist_peer_cnt);
-                                        if (err_code != NRF_ERROR_NOT_SUPPORTED)
-                                        {
-                                                APP_ERROR_CHECK(err_code);
-                                        }
-                                        NRF_LOG_INFO("Advertising with whitelist");
-                                }
-
-                        }
-
-
-
+                        err_code = whitelist_add(p_evt->peer_id);
+                        whitelist_result_handle(err_code);
                 }
         } break;
 
@@ -589,8 +2418,13 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
         } break;
 
         case PM_EVT_CONN_SEC_START:
+                // Key distribution and the GATT discovery that follows a new bond are bulk traffic.
+                if (p_evt->params.conn_sec_start.procedure != PM_LINK_SECURED_PROCEDURE_ENCRYPTION)
+                {
+                        conn_burst_request(p_evt->conn_handle, CONN_BURST_USER_BOND, BOND_BURST_TIMEOUT);
+                }
+                break;
 
-        case PM_EVT_LOCAL_DB_CACHE_APPLIED:
         case PM_EVT_SERVICE_CHANGED_IND_SENT:
         case PM_EVT_SERVICE_CHANGED_IND_CONFIRMED:
         default:
@@ -600,17 +2434,28 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 
 
 
-/**@brief Function for performing battery measurement and updating the Battery Level characteristic
- *        in Battery Service.
+/**@brief Function for filtering a battery voltage reading and updating the Battery Level
+ *        characteristic in Battery Service.
+ *
+ * @details The characteristic is only updated when the filtered level moved past the hysteresis
+ *          band of the @ref battery_filter module.
+ *
+ * @param[in] battery_mv  Battery voltage (in mV).
  */
-static void battery_level_update(void)
+static void battery_level_update(uint16_t battery_mv)
 {
         ret_code_t err_code;
-        uint8_t battery_level;
 
-        battery_level = (uint8_t)sensorsim_measure(&m_battery_sim_state, &m_battery_sim_cfg);
+        if (!battery_filter_put(&m_battery_filter, battery_mv))
+        {
+                return;
+        }
+
+        NRF_LOG_INFO("Battery level %d%%, %d updates avoided so far",
+                     m_battery_filter.level_reported,
+                     m_battery_filter.avoided_cnt);
 
-        err_code = ble_bas_battery_level_update(&m_bas, battery_level);
+        err_code = ble_bas_battery_level_update(&m_bas, m_battery_filter.level_reported);
         if ((err_code != NRF_SUCCESS) &&
             (err_code != NRF_ERROR_INVALID_STATE) &&
             (err_code != NRF_ERROR_RESOURCES) &&
@@ -632,14 +2477,212 @@ static void battery_level_update(void)
 static void battery_level_meas_timeout_handler(void * p_context)
 {
         UNUSED_PARAMETER(p_context);
-        battery_level_update();
+
+#if BATTERY_LEVEL_SIMULATED
+        battery_level_update((uint16_t)sensorsim_measure(&m_battery_sim_state, &m_battery_sim_cfg));
+#else
+        ret_code_t err_code;
+
+        // The result arrives in saadc_event_handler().
+        err_code = nrf_drv_saadc_sample();
+        APP_ERROR_CHECK(err_code);
+#endif
+}
+
+
+#if !BATTERY_LEVEL_SIMULATED
+/**@brief Function for handling the ADC interrupt.
+ *
+ * @details  This function will fetch the conversion result from the ADC, convert the value into
+ *           millivolts and pass it on to the battery level filter.
+ */
+static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_evt)
+{
+        ret_code_t err_code;
+
+        if (p_evt->type == NRF_DRV_SAADC_EVT_DONE)
+        {
+                nrf_saadc_value_t adc_result = p_evt->data.done.p_buffer[0];
+
+                err_code = nrf_drv_saadc_buffer_convert(p_evt->data.done.p_buffer, 1);
+                APP_ERROR_CHECK(err_code);
+
+                battery_level_update(ADC_RESULT_IN_MILLI_VOLTS(MAX(adc_result, 0)) + DIODE_FWD_VOLT_DROP_MILLIVOLTS);
+        }
+}
+
+
+/**@brief Function for configuring ADC to do battery level conversion.
+ *
+ * @details VDD is sampled through EasyDMA into two buffers. Oversampling is set in sdk_config.h,
+ *          burst mode takes all oversamples on a single sample task.
+ */
+static void adc_configure(void)
+{
+        ret_code_t err_code = nrf_drv_saadc_init(NULL, saadc_event_handler);
+        APP_ERROR_CHECK(err_code);
+
+        nrf_saadc_channel_config_t config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_VDD);
+        config.burst = NRF_SAADC_BURST_ENABLED;
+
+        err_code = nrf_drv_saadc_channel_init(0, &config);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = nrf_drv_saadc_buffer_convert(&m_adc_buf[0], 1);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = nrf_drv_saadc_buffer_convert(&m_adc_buf[1], 1);
+        APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+/**@brief Function for queueing a heart rate sample on every subscribed link.
+ *
+ * @details The measurement is encoded once, so that it fits the smallest ATT payload of all
+ *          subscribed links.
+ *
+ * @param[in] heart_rate    Heart rate sample.
+ * @param[in] sample_ticks  RTC counter value when the heart rate was sampled.
+ */
+static void hrm_fan_out(uint16_t heart_rate, uint32_t sample_ticks)
+{
+        ret_code_t   err_code;
+        hrm_packet_t hrm;
+        uint8_t  contact_flags = 0;
+        uint16_t max_len = HRM_MAX_LEN;
+        uint32_t subscribed_cnt = 0;
+        uint32_t i;
+
+        for (i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                if (conn_ctx_cccd_is_set(i, CONN_CCCD_HRM))
+                {
+                        max_len = MIN(max_len, hrm_tx_queue_get(i)->max_hrm_len);
+                        subscribed_cnt++;
+                }
+        }
+
+        if (subscribed_cnt == 0)
+        {
+                return;
+        }
+
+        if (m_hrs.is_sensor_contact_supported)
+        {
+                contact_flags |= HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED;
+        }
+        if (m_hrs.is_sensor_contact_detected)
+        {
+                contact_flags |= HRM_FLAG_MASK_SENSOR_CONTACT_DETECTED;
+        }
+
+        hrm_tx_queue_encode(heart_rate, contact_flags, &m_rr_ring, max_len, &hrm);
+        hrm.sample_ticks = sample_ticks;
+
+        for (i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                if (conn_ctx_cccd_is_set(i, CONN_CCCD_HRM))
+                {
+                        err_code = hrm_tx_queue_put(hrm_tx_queue_get(i), &hrm);
+                        hrm_tx_queue_result_handle(i, err_code);
+                }
+        }
 }
 
 
+#if HRM_CONN_EVT_ALIGNED
+/**@brief Function for queueing a heart rate sample taken from a radio notification, from the
+ *        main loop.
+ *
+ * @param[in] p_sample    Heart rate sample.
+ * @param[in] event_size  Size of the sample.
+ */
+static void hrm_sample_send(hrm_sample_t const * p_sample, uint16_t event_size)
+{
+        UNUSED_PARAMETER(event_size);
+
+        hrm_fan_out(p_sample->heart_rate, p_sample->sample_ticks);
+}
+
+
+/**@brief Function for handling radio notifications.
+ *
+ * @details Takes the freshest heart rate sample just before the radio becomes active, so it is
+ *          sent in the upcoming connection event instead of waiting for the next one.
+ *
+ *          The notification interrupt preempts the BLE event handler, which opens and closes the
+ *          links and their subscriptions. The sample is therefore handed to the scheduler and
+ *          fanned out from the main loop, the way new bonds are, where the connection parameter
+ *          policy may also start and stop its timers.
+ *
+ * @param[in] radio_active  Whether the radio is about to become active.
+ */
+static void on_radio_notification(bool radio_active)
+{
+        ret_code_t   err_code;
+        bool         pending;
+        hrm_sample_t sample;
+
+        if (!radio_active)
+        {
+                return;
+        }
+
+        CRITICAL_REGION_ENTER();
+        pending       = m_hrm_pending;
+        sample        = m_hrm_pending_sample;
+        m_hrm_pending = false;
+        CRITICAL_REGION_EXIT();
+
+        if (pending)
+        {
+                err_code = app_sched_event_put(&sample, sizeof(sample), (app_sched_event_handler_t)hrm_sample_send);
+                APP_ERROR_CHECK(err_code);
+        }
+}
+
+
+/**@brief Function for initializing the radio notifications used to align measurements with
+ *        connection events.
+ */
+static void radio_notification_init(void)
+{
+        ret_code_t err_code;
+
+        err_code = ble_radio_notification_init(HRM_RADIO_NOTIFICATION_IRQ_PRIORITY,
+                                               HRM_RADIO_NOTIFICATION_DISTANCE,
+                                               on_radio_notification);
+        APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+#if BROADCAST_ENABLED
+/**@brief Function for putting a heart rate sample in the broadcast and in the scan response.
+ *
+ * @param[in] heart_rate  Heart rate (in beats per minute).
+ */
+static void heart_rate_broadcast(uint16_t heart_rate)
+{
+        broadcast_update(heart_rate, m_battery_filter.level_reported);
+
+#if ADV_PAYLOAD_CACHED
+        uint16_t        sr_len;
+        uint8_t const * p_sr = broadcast_srdata_get(&sr_len);
+
+        adv_cache_srdata_set(p_sr, sr_len);
+#endif
+}
+#endif
+
+
 /**@brief Function for handling the Heart rate measurement timer timeout.
  *
  * @details This function will be called each time the heart rate measurement timer expires.
- *          It will exclude RR Interval data from every third measurement.
+ *          It will exclude RR Interval data from every third measurement. When
+ *          HRM_CONN_EVT_ALIGNED is set the sample is only stored, and sent from the main loop
+ *          after the next radio notification.
  *
  * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
  *                       app_start_timer() call to the timeout handler.
@@ -647,7 +2690,6 @@ static void battery_level_meas_timeout_handler(void * p_context)
 static void heart_rate_meas_timeout_handler(void * p_context)
 {
         static uint32_t cnt = 0;
-        ret_code_t err_code;
         uint16_t heart_rate;
 
         UNUSED_PARAMETER(p_context);
@@ -655,15 +2697,19 @@ static void heart_rate_meas_timeout_handler(void * p_context)
         heart_rate = (uint16_t)sensorsim_measure(&m_heart_rate_sim_state, &m_heart_rate_sim_cfg);
 
         cnt++;
-        err_code = ble_hrs_heart_rate_measurement_send(&m_hrs, heart_rate);
-        if ((err_code != NRF_SUCCESS) &&
-            (err_code != NRF_ERROR_INVALID_STATE) &&
-            (err_code != NRF_ERROR_RESOURCES) &&
-            (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-            )
-        {
-                APP_ERROR_HANDLER(err_code);
-        }
+#if HRM_CONN_EVT_ALIGNED
+        CRITICAL_REGION_ENTER();
+        m_hrm_pending_sample.heart_rate   = heart_rate;
+        m_hrm_pending_sample.sample_ticks = app_timer_cnt_get();
+        m_hrm_pending                     = true;
+        CRITICAL_REGION_EXIT();
+#else
+        hrm_fan_out(heart_rate, app_timer_cnt_get());
+#endif
+        hr_log_append(heart_rate);
+#if BROADCAST_ENABLED
+        heart_rate_broadcast(heart_rate);
+#endif
 
         // Disable RR Interval recording every third heart rate measurement.
         // NOTE: An application will normally not do this. It is done here just for testing generation
@@ -685,26 +2731,14 @@ static void rr_interval_timeout_handler(void * p_context)
 
         if (m_rr_interval_enabled)
         {
-                uint16_t rr_interval;
+                for (uint32_t i = 0; i < RR_INTERVALS_PER_TIMEOUT; i++)
+                {
+                        uint16_t rr_interval;
 
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
-                rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
-                                                          &m_rr_interval_sim_cfg);
-                ble_hrs_rr_interval_add(&m_hrs, rr_interval);
+                        rr_interval = (uint16_t)sensorsim_measure(&m_rr_interval_sim_state,
+                                                                  &m_rr_interval_sim_cfg);
+                        (void)rr_ring_push(&m_rr_ring, rr_interval);
+                }
         }
 }
 
@@ -759,6 +2793,31 @@ static void timers_init(void)
                                     APP_TIMER_MODE_REPEATED,
                                     sensor_contact_detected_timeout_handler);
         APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_create(&m_wfs_timer_id,
+                                    APP_TIMER_MODE_REPEATED,
+                                    wfs_meas_timeout_handler);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_create(&m_handover_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    handover_timeout_handler);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_create(&m_bringup_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    bringup_timeout_handler);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_create(&m_adv_slice_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    adv_slice_timeout_handler);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = app_timer_create(&m_whitelist_rotation_timer_id,
+                                    APP_TIMER_MODE_REPEATED,
+                                    whitelist_rotation_timeout_handler);
+        APP_ERROR_CHECK(err_code);
 }
 
 
@@ -798,9 +2857,40 @@ static void gap_params_init(void)
 /**@brief Function for handling events from the GATT library. */
 void gatt_evt_handler(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt)
 {
-        NRF_LOG_INFO("ATT MTU exchange completed. central 0x%x peripheral 0x%x",
-                     p_gatt->att_mtu_desired_central,
-                     p_gatt->att_mtu_desired_periph);
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(p_evt->conn_handle);
+        conn_ctx_t     * p_ctx   = conn_ctx_get(p_evt->conn_handle);
+
+        switch (p_evt->evt_id)
+        {
+        case NRF_BLE_GATT_EVT_ATT_MTU_UPDATED:
+                NRF_LOG_INFO("ATT MTU exchange completed on link 0x%x, effective MTU %d",
+                             p_evt->conn_handle,
+                             p_evt->params.att_mtu_effective);
+                if (p_queue != NULL)
+                {
+                        p_queue->max_hrm_len = MIN(p_evt->params.att_mtu_effective - 3, HRM_MAX_LEN);
+                }
+                if (p_ctx != NULL)
+                {
+                        p_ctx->att_mtu = p_evt->params.att_mtu_effective;
+                }
+                bringup_step_done(p_evt->conn_handle, BRINGUP_STEP_MTU);
+                break;
+
+        case NRF_BLE_GATT_EVT_DATA_LENGTH_UPDATED:
+                NRF_LOG_INFO("Data length updated on link 0x%x to %d bytes",
+                             p_evt->conn_handle,
+                             p_evt->params.data_length);
+                if (p_queue != NULL)
+                {
+                        p_queue->ll_payload_len = p_evt->params.data_length;
+                }
+                bringup_step_done(p_evt->conn_handle, BRINGUP_STEP_DATA_LENGTH);
+                break;
+
+        default:
+                break;
+        }
 }
 
 
@@ -818,9 +2908,95 @@ static void gatt_init(void)
 }
 
 
+/**@brief Function for handling a Queued Write module error.
+ *
+ * @param[in] nrf_error  Error code containing information about what went wrong.
+ */
+static void qwr_error_handler(uint32_t nrf_error)
+{
+        APP_ERROR_HANDLER(nrf_error);
+}
+
+
+/**@brief Function for handling Queued Write module events.
+ *
+ * @details Only the Configuration characteristic accepts queued writes. The upload time, from the
+ *          first prepare write to the execute write, is logged.
+ *
+ * @param[in] p_qwr  Queued Write module the event comes from.
+ * @param[in] p_evt  Event received from the Queued Write module.
+ *
+ * @return BLE_GATT_STATUS_SUCCESS to accept the write, otherwise a GATT error code.
+ */
+static uint16_t qwr_evt_handler(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt)
+{
+        if (p_evt->attr_handle != ble_cfgs_value_handle_get(&m_cfgs))
+        {
+                return APP_FEATURE_NOT_SUPPORTED;
+        }
+
+        if ((p_evt->evt_type == NRF_BLE_QWR_EVT_EXECUTE_WRITE) &&
+            (p_qwr->conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT))
+        {
+                cfg_upload_t * p_upload = &m_cfg_uploads[p_qwr->conn_handle];
+
+                NRF_LOG_INFO("Configuration upload on link 0x%x: %d prepare writes in %d ms",
+                             p_qwr->conn_handle,
+                             p_upload->prep_cnt,
+                             TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_upload->start_ticks)));
+
+                p_upload->prep_cnt = 0;
+                conn_burst_release(p_qwr->conn_handle, CONN_BURST_USER_CFG);
+        }
+
+        return BLE_GATT_STATUS_SUCCESS;
+}
+
+
+/**@brief Function for passing BLE events to the Queued Write module of their link.
+ *
+ * @details An instance that sees the connected event of another link takes it over, and one
+ *          that sees its user memory request answers it with its own buffer. So every event goes
+ *          only to the instance of its connection handle. The event structures of the GAP, GATTS
+ *          and common events all start with the connection handle, events without a link carry
+ *          BLE_CONN_HANDLE_INVALID there and are not passed on.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ * @param[in] p_context  Unused.
+ */
+static void qwr_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+        UNUSED_PARAMETER(p_context);
+
+        uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+
+        if (conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT)
+        {
+                nrf_ble_qwr_on_ble_evt(p_ble_evt, &m_qwr[conn_handle]);
+        }
+}
+
+
+/**@brief Function for handling the Configuration Service events.
+ *
+ * @param[in] p_cfgs  Configuration Service structure.
+ * @param[in] p_evt   Event received from the Configuration Service.
+ */
+static void on_cfgs_evt(ble_cfgs_t * p_cfgs, ble_cfgs_evt_t * p_evt)
+{
+        if (p_evt->evt_type == BLE_CFGS_EVT_CONFIG_WRITTEN)
+        {
+                NRF_LOG_INFO("Configuration written on link 0x%x: %d bytes in one Write Request",
+                             p_evt->conn_handle,
+                             p_evt->len);
+        }
+}
+
+
 /**@brief Function for initializing services that will be used by the application.
  *
- * @details Initialize the Heart Rate, Battery and Device Information services.
+ * @details Initialize the Heart Rate, Battery, Device Information, Waveform Streaming, Heart Rate
+ *          Log and Configuration services, and the Queued Write module of every link.
  */
 static void services_init(void)
 {
@@ -828,6 +3004,10 @@ static void services_init(void)
         ble_hrs_init_t hrs_init;
         ble_bas_init_t bas_init;
         ble_dis_init_t dis_init;
+        ble_wfs_init_t wfs_init;
+        ble_hls_init_t hls_init;
+        ble_cfgs_init_t cfgs_init;
+        nrf_ble_qwr_init_t qwr_init;
         uint8_t body_sensor_location;
 
         // Initialize Heart Rate Service.
@@ -868,6 +3048,8 @@ static void services_init(void)
         err_code = ble_bas_init(&m_bas, &bas_init);
         APP_ERROR_CHECK(err_code);
 
+        battery_filter_init(&m_battery_filter, bas_init.initial_batt_level);
+
         // Initialize Device Information Service.
         memset(&dis_init, 0, sizeof(dis_init));
 
@@ -878,6 +3060,62 @@ static void services_init(void)
 
         err_code = ble_dis_init(&dis_init);
         APP_ERROR_CHECK(err_code);
+
+        // Initialize Waveform Streaming Service.
+        memset(&wfs_init, 0, sizeof(wfs_init));
+
+        wfs_init.evt_handler = on_wfs_evt;
+
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&wfs_init.wfs_data_attr_md.cccd_write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&wfs_init.wfs_data_attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&wfs_init.wfs_data_attr_md.write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&wfs_init.wfs_ctrl_pt_write_perm);
+
+        err_code = ble_wfs_init(&m_wfs, &wfs_init);
+        APP_ERROR_CHECK(err_code);
+
+        // Initialize Heart Rate Log Service.
+        memset(&hls_init, 0, sizeof(hls_init));
+
+        hls_init.evt_handler = on_hls_evt;
+
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&hls_init.hls_data_attr_md.cccd_write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&hls_init.hls_data_attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&hls_init.hls_data_attr_md.write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&hls_init.hls_racp_attr_md.cccd_write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&hls_init.hls_racp_attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&hls_init.hls_racp_attr_md.write_perm);
+
+        err_code = ble_hls_init(&m_hls, &hls_init);
+        APP_ERROR_CHECK(err_code);
+
+        // Initialize Configuration Service.
+        memset(&cfgs_init, 0, sizeof(cfgs_init));
+
+        cfgs_init.evt_handler = on_cfgs_evt;
+
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cfgs_init.config_read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cfgs_init.config_write_perm);
+
+        err_code = ble_cfgs_init(&m_cfgs, &cfgs_init);
+        APP_ERROR_CHECK(err_code);
+
+        // Initialize the Queued Write module of every link.
+        for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+        {
+                memset(&qwr_init, 0, sizeof(qwr_init));
+
+                qwr_init.error_handler     = qwr_error_handler;
+                qwr_init.mem_buffer.p_mem  = m_qwr_mem[i];
+                qwr_init.mem_buffer.len    = QWR_MEM_BUFF_SIZE;
+                qwr_init.callback          = qwr_evt_handler;
+
+                err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+                APP_ERROR_CHECK(err_code);
+
+                err_code = nrf_ble_qwr_attr_register(&m_qwr[i], ble_cfgs_value_handle_get(&m_cfgs));
+                APP_ERROR_CHECK(err_code);
+        }
 }
 
 
@@ -885,12 +3123,14 @@ static void services_init(void)
  */
 static void sensor_simulator_init(void)
 {
-        m_battery_sim_cfg.min          = MIN_BATTERY_LEVEL;
-        m_battery_sim_cfg.max          = MAX_BATTERY_LEVEL;
-        m_battery_sim_cfg.incr         = BATTERY_LEVEL_INCREMENT;
+#if BATTERY_LEVEL_SIMULATED
+        m_battery_sim_cfg.min          = MIN_BATTERY_VOLTAGE;
+        m_battery_sim_cfg.max          = MAX_BATTERY_VOLTAGE;
+        m_battery_sim_cfg.incr         = BATTERY_VOLTAGE_INCREMENT;
         m_battery_sim_cfg.start_at_max = true;
 
         sensorsim_init(&m_battery_sim_state, &m_battery_sim_cfg);
+#endif
 
         m_heart_rate_sim_cfg.min          = MIN_HEART_RATE;
         m_heart_rate_sim_cfg.max          = MAX_HEART_RATE;
@@ -905,6 +3145,13 @@ static void sensor_simulator_init(void)
         m_rr_interval_sim_cfg.start_at_max = false;
 
         sensorsim_init(&m_rr_interval_sim_state, &m_rr_interval_sim_cfg);
+
+        m_waveform_sim_cfg.min          = MIN_WAVEFORM_SAMPLE;
+        m_waveform_sim_cfg.max          = MAX_WAVEFORM_SAMPLE;
+        m_waveform_sim_cfg.incr         = WAVEFORM_SAMPLE_INCREMENT;
+        m_waveform_sim_cfg.start_at_max = false;
+
+        sensorsim_init(&m_waveform_sim_state, &m_waveform_sim_cfg);
 }
 
 
@@ -932,21 +3179,31 @@ static void application_timers_start(void)
 /**@brief Function for handling the Connection Parameters Module.
  *
  * @details This function will be called for all events in the Connection Parameters Module which
- *          are passed to the application.
- *          @note All this function does is to disconnect. This could have been done by simply
- *                setting the disconnect_on_fail config parameter, but instead we use the event
- *                handler mechanism to demonstrate its use.
+ *          are passed to the application. A negotiation that ends lets the link request the
+ *          profile it waits for. A link whose peer refuses its profile stays connected on the
+ *          parameters the peer chose, until its subscriptions change.
  *
  * @param[in] p_evt  Event received from the Connection Parameters Module.
  */
 static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 {
-        ret_code_t err_code;
+        conn_ctx_t * p_ctx = conn_ctx_get(p_evt->conn_handle);
 
-        if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
+        if (p_ctx == NULL)
         {
-                err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
-                APP_ERROR_CHECK(err_code);
+                return;
+        }
+
+        if ((p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) && !p_ctx->policy_pending)
+        {
+                p_ctx->conn_param_reject_cnt++;
+                NRF_LOG_WARNING("Link 0x%x: peer refused connection parameter profile %d",
+                                p_evt->conn_handle,
+                                p_ctx->policy);
+        }
+        else if (p_ctx->policy_pending || (conn_policy_get(p_ctx) != p_ctx->policy))
+        {
+                conn_policy_schedule(p_evt->conn_handle, CONN_POLICY_SETTLE_DELAY);
         }
 }
 
@@ -981,6 +3238,18 @@ static void conn_params_init(void)
 
         err_code = ble_conn_params_init(&cp_init);
         APP_ERROR_CHECK(err_code);
+
+        conn_policy_init_t policy_init;
+
+        memset(&policy_init, 0, sizeof(policy_init));
+
+        policy_init.p_params      = m_conn_policy_params;
+        policy_init.streaming_get = wfs_link_is_streaming;
+        policy_init.evt_handler   = on_conn_policy_evt;
+        policy_init.error_handler = conn_params_error_handler;
+
+        err_code = conn_policy_init(&policy_init);
+        APP_ERROR_CHECK(err_code);
 }
 
 
@@ -1005,92 +3274,97 @@ static void sleep_mode_enter(void)
 }
 
 
-/**@brief Function for handling advertising events.
- *
- * @details This function will be called for advertising events which are passed to the application.
+/**@brief Function for logging the host of a lost link coming back.
  *
- * @param[in] ble_adv_evt  Advertising event.
+ * @param[in] p_ctx  Context of the new link.
  */
-static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
+static void reconnect_log(conn_ctx_t const * p_ctx)
 {
-        ret_code_t ret;
+        uint32_t          reconnect_ms;
+        reconnect_stats_t stats;
 
-        switch (ble_adv_evt)
+        if (!reconnect_on_connected(p_ctx, &reconnect_ms))
         {
-        case BLE_ADV_EVT_FAST:
-                NRF_LOG_INFO("Fast advertising.");
-                ret = bsp_indication_set(BSP_INDICATE_ADVERTISING);
-                APP_ERROR_CHECK(ret);
-                break;
+                return;
+        }
 
-        case BLE_ADV_EVT_IDLE:
-//                sleep_mode_enter();
-                break;
+        reconnect_stats_get(&stats);
+        NRF_LOG_INFO("Link 0x%x: host back after %d ms (%d reconnects, average %d ms, max %d ms)",
+                     p_ctx->conn_handle,
+                     reconnect_ms,
+                     stats.reconnect_cnt,
+                     stats.reconnect_sum_ms / stats.reconnect_cnt,
+                     stats.reconnect_max_ms);
+}
 
-        case BLE_ADV_EVT_FAST_WHITELIST:
-                NRF_LOG_INFO("Fast advertising with Whitelist");
-                ret = bsp_indication_set(BSP_INDICATE_ADVERTISING_WHITELIST);
-                APP_ERROR_CHECK(ret);
-                break;
 
+/**@brief Function for handling the Connected event.
+ *
+ * @param[in] p_gap_evt GAP event received from the BLE stack.
+ */
+static void on_connected(const ble_gap_evt_t * const p_gap_evt)
+{
+        ret_code_t    err_code;
+        bringup_evt_t bringup_evt;
 
-        case BLE_ADV_EVT_WHITELIST_REQUEST:
-        {
-                ble_gap_addr_t whitelist_addrs[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
-                ble_gap_irk_t whitelist_irks[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
-                uint32_t addr_cnt = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
-                uint32_t irk_cnt  = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+        NRF_LOG_INFO("Connection with link 0x%x established.", p_gap_evt->conn_handle);
 
-                ret = pm_whitelist_get(whitelist_addrs, &addr_cnt, whitelist_irks, &irk_cnt);
-                APP_ERROR_CHECK(ret);
-                NRF_LOG_INFO("pm_whitelist_get returns %d addr in whitelist and %d irk whitelist",
-                             addr_cnt,
-                             irk_cnt);
+        conn_ctx_t * p_ctx = conn_ctx_open(p_gap_evt->conn_handle);
 
-                // Apply the whitelist.
-                ret = ble_advertising_whitelist_reply(&m_advertising,
-                                                      whitelist_addrs,
-                                                      addr_cnt,
-                                                      whitelist_irks,
-                                                      irk_cnt);
-                APP_ERROR_CHECK(ret);
+        if (p_ctx == NULL)
+        {
+                return;
         }
-        break;
 
-        default:
-                break;
+        p_ctx->peer_addr        = p_gap_evt->params.connected.peer_addr;
+        p_ctx->connected_ticks  = app_timer_cnt_get();
+        p_ctx->conn_interval    = p_gap_evt->params.connected.conn_params.max_conn_interval;
+        p_ctx->slave_latency    = p_gap_evt->params.connected.conn_params.slave_latency;
+        p_ctx->conn_sup_timeout = p_gap_evt->params.connected.conn_params.conn_sup_timeout;
+
+        adv_fast_params_adapt();
+        reconnect_log(p_ctx);
+        adv_slice_on_connected(p_ctx);
+
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(p_gap_evt->conn_handle);
+        if (p_queue != NULL)
+        {
+                hrm_tx_queue_reset(p_queue, p_gap_evt->conn_handle);
         }
-}
+        wfs_link_reset(p_gap_evt->conn_handle);
+        hls_link_reset(p_gap_evt->conn_handle);
 
+        m_cfg_uploads[p_gap_evt->conn_handle].prep_cnt = 0;
 
+        err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[p_gap_evt->conn_handle], p_gap_evt->conn_handle);
+        APP_ERROR_CHECK(err_code);
 
+#ifndef S140
+        // Readings for the PHY monitor.
+        err_code = phy_monitor_start(p_gap_evt->conn_handle);
+        APP_ERROR_CHECK(err_code);
+#endif
 
-/**@brief Function for handling the Connected event.
- *
- * @param[in] p_gap_evt GAP event received from the BLE stack.
- */
-static void on_connected(const ble_gap_evt_t * const p_gap_evt)
-{
-        ret_code_t err_code;
-        uint32_t periph_link_cnt = ble_conn_state_n_peripherals(); // Number of peripheral links.
+        err_code = bringup_start(p_ctx, &bringup_evt);
+        bringup_evt_handle(p_ctx->conn_handle, err_code, bringup_evt);
 
-        NRF_LOG_INFO("Connection with link 0x%x established.", p_gap_evt->conn_handle);
+        // Links start on the Heart Rate Service parameters, move to the profile of the link later.
+        conn_policy_on_connected(p_ctx, FIRST_CONN_PARAMS_UPDATE_DELAY);
 
         // Update LEDs
-        // first device connection
-        if (periph_link_cnt == 1)
+        if (p_ctx->role == CONN_ROLE_PRIMARY_HOST)
         {
-                m_conn_handle  = p_gap_evt->conn_handle;
                 bsp_board_led_off(ADVERTISING_LED);
                 bsp_board_led_off(BONDING_LED);
                 bsp_board_led_on(CONNECTED_LED);
         }
-        else if (periph_link_cnt == NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+        else
         {
                 bsp_board_led_off(BONDING_LED);
                 bsp_board_led_on(CONNECTED_2_LED);
         }
 
+        broadcast_resume();
 }
 
 /**@brief Function for handling the Disconnected event.
@@ -1099,25 +3373,117 @@ static void on_connected(const ble_gap_evt_t * const p_gap_evt)
  */
 static void on_disconnected(ble_gap_evt_t const * const p_gap_evt)
 {
-        ret_code_t err_code;
-        uint32_t periph_link_cnt = ble_conn_state_n_peripherals(); // Number of peripheral links.
+        conn_ctx_t * p_ctx = conn_ctx_get(p_gap_evt->conn_handle);
 
         NRF_LOG_INFO("Connection 0x%x has been disconnected. Reason: 0x%X",
                      p_gap_evt->conn_handle,
                      p_gap_evt->params.disconnected.reason);
 
-        if (m_conn_handle == p_gap_evt->conn_handle)
+        if (p_ctx == NULL)
+        {
+                return;
+        }
+
+        NRF_LOG_INFO("Link 0x%x: role %d, peer %d, MTU %d, %d notifications, %d PHY updates in %d s",
+                     p_ctx->conn_handle,
+                     p_ctx->role,
+                     p_ctx->peer_id,
+                     p_ctx->att_mtu,
+                     p_ctx->hvn_tx_cnt,
+                     p_ctx->phy_update_cnt,
+                     TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->connected_ticks)) / 1000);
+        NRF_LOG_INFO("Link 0x%x: profile %d, %d connection parameter updates, %d profiles refused",
+                     p_ctx->conn_handle,
+                     p_ctx->policy,
+                     p_ctx->conn_param_update_cnt,
+                     p_ctx->conn_param_reject_cnt);
+
+#ifndef S140
+        NRF_LOG_INFO("Link 0x%x: PHY tx %d rx %d, %d PHY changes requested, RSSI %d dBm",
+                     p_ctx->conn_handle,
+                     p_ctx->tx_phy,
+                     p_ctx->rx_phy,
+                     p_ctx->phy_request_cnt,
+                     phy_monitor_rssi_get(p_ctx));
+#endif
+
+        conn_policy_time_update(p_ctx);
+        NRF_LOG_INFO("Link 0x%x: %d s idle, %d s active, %d s streaming, %d s burst",
+                     p_ctx->conn_handle,
+                     p_ctx->policy_time_ms[CONN_POLICY_IDLE] / 1000,
+                     p_ctx->policy_time_ms[CONN_POLICY_ACTIVE] / 1000,
+                     p_ctx->policy_time_ms[CONN_POLICY_STREAMING] / 1000,
+                     p_ctx->policy_time_ms[CONN_POLICY_BURST] / 1000);
+        if (p_ctx->burst_switch_cnt > 0)
+        {
+                NRF_LOG_INFO("Link 0x%x: %d burst switches, average %d ms, max %d ms",
+                             p_ctx->conn_handle,
+                             p_ctx->burst_switch_cnt,
+                             p_ctx->burst_switch_sum_ms / p_ctx->burst_switch_cnt,
+                             p_ctx->burst_switch_max_ms);
+        }
+
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(p_gap_evt->conn_handle);
+        if (p_queue != NULL)
+        {
+                CRITICAL_REGION_ENTER();
+                p_queue->dropped_cnt += p_queue->count;
+                p_queue->count        = 0;
+                CRITICAL_REGION_EXIT();
+
+                hrm_tx_queue_stats_log(p_queue);
+                hrm_tx_queue_reset(p_queue, BLE_CONN_HANDLE_INVALID);
+        }
+        wfs_link_reset(p_gap_evt->conn_handle);
+        hls_link_reset(p_gap_evt->conn_handle);
+
+        if (handover_on_disconnected(p_ctx->conn_handle))
+        {
+                (void)app_timer_stop(m_handover_timer_id);
+        }
+
+        adv_slice_on_outcome(p_ctx->conn_handle, false);
+        enc_stats_on_disconnected(p_ctx);
+
+        conn_role_t  role      = p_ctx->role;
+        bool         reconnect = reconnect_on_disconnected(p_ctx, p_gap_evt->params.disconnected.reason);
+        conn_ctx_t * p_primary = conn_ctx_close(p_ctx);
+
+        if (role == CONN_ROLE_PRIMARY_HOST)
         {
                 bsp_board_led_off(CONNECTED_LED);
-                m_conn_handle = BLE_CONN_HANDLE_INVALID;
+        }
+        if (p_primary != NULL)
+        {
+                NRF_LOG_INFO("Link 0x%x is now the primary host", p_primary->conn_handle);
+                bsp_board_led_on(CONNECTED_LED);
+        }
+
+        if (conn_ctx_find(CONN_ROLE_SECONDARY_HOST) == NULL)
+        {
+                bsp_board_led_off(CONNECTED_2_LED);
         }
 
-        if (periph_link_cnt == 0)
+        if (conn_ctx_count() == 0)
         {
                 advertising_start(true);
                 bsp_board_led_off(CONNECTED_LED);
                 bsp_board_led_off(CONNECTED_2_LED);
         }
+        else if (reconnect && (conn_ctx_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT))
+        {
+                // Call the lost host back even though another one is still connected. The bonding
+                // window may be advertising already; it is not an error if it is not.
+                (void)sd_ble_gap_adv_stop();
+                advertising_start(true);
+        }
+        else if (advertising_bond_timer_is_running && (adv_slicer_current() == ADV_SLICE_NONE))
+        {
+                // A link of the bonding window was dropped while it is still open, advertise again.
+                adv_slice_start(ADV_SLICE_OPEN);
+        }
+
+        broadcast_resume();
 }
 
 
@@ -1130,6 +3496,14 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 {
         ret_code_t err_code;
 
+#if ADV_PAYLOAD_CACHED
+        adv_cache_on_ble_evt(p_ble_evt);
+#endif
+#ifndef S140
+        err_code = phy_monitor_on_ble_evt(p_ble_evt);
+        APP_ERROR_CHECK(err_code);
+#endif
+
         switch (p_ble_evt->header.evt_id)
         {
         case BLE_GAP_EVT_CONNECTED:
@@ -1144,18 +3518,61 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 
 #ifndef S140
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
-        {
                 NRF_LOG_DEBUG("PHY update request.");
-                ble_gap_phys_t const phys =
+                break;
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+                NRF_LOG_INFO("PHY on link 0x%x updated: tx %d, rx %d",
+                             p_ble_evt->evt.gap_evt.conn_handle,
+                             p_ble_evt->evt.gap_evt.params.phy_update.tx_phy,
+                             p_ble_evt->evt.gap_evt.params.phy_update.rx_phy);
+                bringup_step_done(p_ble_evt->evt.gap_evt.conn_handle, BRINGUP_STEP_PHY);
+                break;
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+        {
+                conn_ctx_t * p_ctx = conn_ctx_get(p_ble_evt->evt.gap_evt.conn_handle);
+                uint8_t      phy;
+
+                if (p_ctx == NULL)
                 {
-                        .rx_phys = BLE_GAP_PHY_AUTO,
-                        .tx_phys = BLE_GAP_PHY_AUTO,
-                };
-                err_code = sd_ble_gap_phy_update(p_ble_evt->evt.gap_evt.conn_handle, &phys);
+                        break;
+                }
+
+                err_code = phy_monitor_on_rssi(p_ctx, p_ble_evt->evt.gap_evt.params.rssi_changed.rssi, &phy);
                 APP_ERROR_CHECK(err_code);
+                if (phy != BLE_GAP_PHY_AUTO)
+                {
+                        NRF_LOG_INFO("Link 0x%x: RSSI %d dBm, requesting %s PHY",
+                                     p_ctx->conn_handle,
+                                     phy_monitor_rssi_get(p_ctx),
+                                     (uint32_t)((phy == BLE_GAP_PHY_2MBPS) ? "2M" : "1M"));
+                }
         } break;
 #endif
 
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+        {
+                ble_gap_conn_params_t const * p_params =
+                        &p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+                conn_ctx_t * p_ctx = conn_ctx_get(p_ble_evt->evt.gap_evt.conn_handle);
+
+                if (p_ctx != NULL)
+                {
+                        p_ctx->conn_interval    = p_params->max_conn_interval;
+                        p_ctx->slave_latency    = p_params->slave_latency;
+                        p_ctx->conn_sup_timeout = p_params->conn_sup_timeout;
+                        p_ctx->conn_param_update_cnt++;
+
+                        conn_policy_on_conn_param_update(p_ctx, p_params);
+                }
+                NRF_LOG_INFO("Link 0x%x: interval %d x 1.25 ms, latency %d, timeout %d x 10 ms",
+                             p_ble_evt->evt.gap_evt.conn_handle,
+                             p_params->max_conn_interval,
+                             p_params->slave_latency,
+                             p_params->conn_sup_timeout);
+        } break;
+
 #if !defined (S112)
         case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
         {
@@ -1168,6 +3585,16 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
         } break;
 #endif //!defined (S112)
 
+        case BLE_GATTS_EVT_WRITE:
+                on_hrm_cccd_write(p_ble_evt->evt.gatts_evt.conn_handle,
+                                  &p_ble_evt->evt.gatts_evt.params.write);
+                break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+                on_hvn_tx_complete(p_ble_evt->evt.gatts_evt.conn_handle,
+                                   p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count);
+                break;
+
         case BLE_GATTC_EVT_TIMEOUT:
                 // Disconnect on GATT Client timeout event.
                 NRF_LOG_DEBUG("GATT Client Timeout.");
@@ -1184,39 +3611,32 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
                 APP_ERROR_CHECK(err_code);
                 break;
 
-        case BLE_EVT_USER_MEM_REQUEST:
-                //err_code = sd_ble_user_mem_reply(m_conn_handle, NULL);
-                err_code = sd_ble_user_mem_reply(p_ble_evt->evt.gattc_evt.conn_handle, NULL);
-                APP_ERROR_CHECK(err_code);
-                break;
-
         case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
         {
-                ble_gatts_evt_rw_authorize_request_t req;
-                ble_gatts_rw_authorize_reply_params_t auth_reply;
-
-                req = p_ble_evt->evt.gatts_evt.params.authorize_request;
-
-                if (req.type != BLE_GATTS_AUTHORIZE_TYPE_INVALID)
+                // Queued writes and user memory requests are answered by nrf_ble_qwr, only
+                // time configuration uploads here.
+                ble_gatts_evt_rw_authorize_request_t const * p_req =
+                        &p_ble_evt->evt.gatts_evt.params.authorize_request;
+                uint16_t conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+
+                if ((p_req->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
+                    (p_req->request.write.op == BLE_GATTS_OP_PREP_WRITE_REQ) &&
+                    (p_req->request.write.handle == ble_cfgs_value_handle_get(&m_cfgs)) &&
+                    (conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT))
                 {
-                        if ((req.request.write.op == BLE_GATTS_OP_PREP_WRITE_REQ)     ||
-                            (req.request.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) ||
-                            (req.request.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL))
+                        if (m_cfg_uploads[conn_handle].prep_cnt++ == 0)
                         {
-                                if (req.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
-                                {
-                                        auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
-                                }
-                                else
-                                {
-                                        auth_reply.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
-                                }
-                                auth_reply.params.write.gatt_status = APP_FEATURE_NOT_SUPPORTED;
-                                err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle,
-                                                                           &auth_reply);
-                                APP_ERROR_CHECK(err_code);
+                                m_cfg_uploads[conn_handle].start_ticks = app_timer_cnt_get();
+                                conn_burst_request(conn_handle, CONN_BURST_USER_CFG, CFG_BURST_TIMEOUT);
                         }
                 }
+                else if ((p_req->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE) &&
+                         (p_req->request.write.op == BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL) &&
+                         (conn_handle < NRF_SDH_BLE_TOTAL_LINK_COUNT))
+                {
+                        m_cfg_uploads[conn_handle].prep_cnt = 0;
+                        conn_burst_release(conn_handle, CONN_BURST_USER_CFG);
+                }
         } break;
 
 
@@ -1228,6 +3648,44 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 
 
 
+#if RAM_BUDGET_REPORT
+/**@brief Function for logging how many peripheral links fit in the RAM of the application.
+ *
+ * @details Must be called after the SoftDevice is enabled and before the BLE stack is enabled,
+ *          see @ref ram_budget_probe.
+ */
+static void ram_budget_report(void)
+{
+        ret_code_t   err_code;
+        ram_budget_t budget;
+        uint32_t     link_ram = sizeof(conn_ctx_t) + sizeof(hrm_tx_queue_t) + sizeof(wfs_link_t) +
+                                sizeof(hls_link_t) + sizeof(nrf_ble_qwr_t) + QWR_MEM_BUFF_SIZE +
+                                sizeof(cfg_upload_t);
+
+        err_code = ram_budget_probe(APP_BLE_CONN_CFG_TAG, link_ram, &budget);
+
+        NRF_LOG_INFO("RAM budget: RAM_START 0x%x, %d bytes unused, %d bytes of application state per link",
+                     budget.app_ram_start, budget.unused_ram, budget.link_ram);
+
+        for (uint8_t i = 0; i < budget.trial_cnt; i++)
+        {
+                NRF_LOG_INFO("RAM budget: %d links, SoftDevice needs RAM_START 0x%x, %s",
+                             i + 1, budget.sd_ram_start[i],
+                             (uint32_t)(budget.fits[i] ? "fits" : "does not fit"));
+        }
+        if (budget.reject_err_code != NRF_SUCCESS)
+        {
+                NRF_LOG_WARNING("RAM budget: %d links rejected by the SoftDevice, error 0x%x",
+                                budget.trial_cnt + 1, budget.reject_err_code);
+        }
+
+        NRF_LOG_INFO("RAM budget: up to %d peripheral links fit", budget.fit_cnt);
+
+        APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
 /**@brief Function for initializing the BLE stack.
  *
  * @details Initializes the SoftDevice and the BLE event interrupt.
@@ -1239,18 +3697,34 @@ static void ble_stack_init(void)
         err_code = nrf_sdh_enable_request();
         APP_ERROR_CHECK(err_code);
 
+#if RAM_BUDGET_REPORT
+        ram_budget_report();
+#endif
+
         // Configure the BLE stack using the default settings.
         // Fetch the start address of the application RAM.
         uint32_t ram_start = 0;
         err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
         APP_ERROR_CHECK(err_code);
 
+        // Let the SoftDevice queue several notifications per link, these are the TX credits of the
+        // outbound Heart Rate Measurement queues.
+        ble_cfg_t ble_cfg;
+        memset(&ble_cfg, 0, sizeof(ble_cfg));
+        ble_cfg.conn_cfg.conn_cfg_tag                            = APP_BLE_CONN_CFG_TAG;
+        ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = HVN_TX_QUEUE_SIZE;
+        err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+        APP_ERROR_CHECK(err_code);
+
         // Enable BLE stack.
         err_code = nrf_sdh_ble_enable(&ram_start);
         APP_ERROR_CHECK(err_code);
 
         // Register a handler for BLE events.
         NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
+
+        // Register the Queued Write modules of all links.
+        NRF_SDH_BLE_OBSERVER(m_qwr_observer, NRF_BLE_QWR_BLE_OBSERVER_PRIO, qwr_on_ble_evt, NULL);
 }
 
 
@@ -1295,6 +3769,29 @@ static void button_event_handler(uint8_t pin_no, uint8_t button_action)
 }
 
 
+extern uint32_t __FLASH_segment_used_end__;                         /**< End of the flash used by the application image. */
+
+/**@brief Function for checking that the application image ends below the FDS pages.
+ *
+ * @details FDS takes FDS_VIRTUAL_PAGES pages right below the bootloader, or the end of flash
+ *          if there is none, like FDS itself computes it. The linker does not know about these
+ *          pages, so an image grown into them would be silently corrupted by the log.
+ */
+static void fds_flash_check(void)
+{
+        uint32_t flash_end = (NRF_UICR->NRFFW[0] != 0xFFFFFFFF) ?
+                             NRF_UICR->NRFFW[0] : (NRF_FICR->CODESIZE * NRF_FICR->CODEPAGESIZE);
+        uint32_t fds_start = flash_end - (FDS_VIRTUAL_PAGES * FDS_VIRTUAL_PAGE_SIZE * sizeof(uint32_t));
+
+        NRF_LOG_INFO("Flash: image ends at 0x%x, FDS starts at 0x%x",
+                     (uint32_t)&__FLASH_segment_used_end__, fds_start);
+
+        if ((uint32_t)&__FLASH_segment_used_end__ > fds_start)
+        {
+                APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
+        }
+}
+
 
 /**@brief Function for the Peer Manager initialization.
  */
@@ -1328,6 +3825,31 @@ static void peer_manager_init(void)
 
         err_code = fds_register(fds_evt_handler);
         APP_ERROR_CHECK(err_code);
+
+        err_code = whitelist_load();
+        whitelist_result_handle(err_code);
+}
+
+
+#if ADV_PAYLOAD_CACHED
+/**@brief Function for handling an error of the advertising moving to its next mode.
+ *
+ * @param[in] nrf_error  Error code containing information about what went wrong.
+ */
+static void adv_cache_error_handler(uint32_t nrf_error)
+{
+        APP_ERROR_HANDLER(nrf_error);
+}
+#endif
+
+
+/**@brief Function for handling an error of the heart rate broadcast.
+ *
+ * @param[in] nrf_error  Error code containing information about what went wrong.
+ */
+static void broadcast_error_handler(uint32_t nrf_error)
+{
+        APP_ERROR_HANDLER(nrf_error);
 }
 
 
@@ -1335,35 +3857,57 @@ static void peer_manager_init(void)
  */
 static void advertising_init(void)
 {
-        ret_code_t err_code;
-        ble_advertising_init_t init;
-        uint8_t adv_flags;
+        memset(&m_advdata, 0, sizeof(m_advdata));
 
-        memset(&init, 0, sizeof(init));
+        m_advdata.name_type               = BLE_ADVDATA_FULL_NAME;
+        m_advdata.include_appearance      = true;
+        m_advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+        m_advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+        m_advdata.uuids_complete.p_uuids  = m_adv_uuids;
 
-        adv_flags                            = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+        memset(&m_adv_modes_config, 0, sizeof(m_adv_modes_config));
 
-        init.advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-        init.advdata.include_appearance      = true;
-        init.advdata.flags                   = adv_flags;
-        init.advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
-        init.advdata.uuids_complete.p_uuids  = m_adv_uuids;
+        m_adv_modes_config.ble_adv_whitelist_enabled      = true;
+        m_adv_modes_config.ble_adv_directed_enabled       = true;
+        m_adv_modes_config.ble_adv_fast_enabled           = true;
+        m_adv_modes_config.ble_adv_fast_interval          = APP_ADV_FAST_INTERVAL;
+        m_adv_modes_config.ble_adv_fast_timeout           = APP_ADV_FAST_TIMEOUT;
+        m_adv_modes_config.ble_adv_slow_enabled           = true;
+        m_adv_modes_config.ble_adv_slow_interval          = APP_ADV_SLOW_INTERVAL;
+        m_adv_modes_config.ble_adv_slow_timeout           = APP_ADV_SLOW_TIMEOUT;
+        m_adv_modes_config.ble_adv_on_disconnect_disabled = true;
 
-        init.config.ble_adv_whitelist_enabled      = true;
-        init.config.ble_adv_fast_enabled           = true;
-        init.config.ble_adv_fast_interval          = APP_ADV_FAST_INTERVAL;
-        init.config.ble_adv_fast_timeout           = APP_ADV_FAST_TIMEOUT;
-        init.config.ble_adv_slow_enabled           = true;
-        init.config.ble_adv_slow_interval          = APP_ADV_SLOW_INTERVAL;
-        init.config.ble_adv_slow_timeout           = APP_ADV_SLOW_TIMEOUT;
-        init.config.ble_adv_on_disconnect_disabled = true;
+        adv_adapt_init(&m_adv_modes_config);
 
-        init.evt_handler = on_adv_evt;
+#if ADV_PAYLOAD_CACHED
+        ret_code_t       err_code;
+        adv_cache_init_t init;
 
-        err_code = ble_advertising_init(&m_advertising, &init);
+        memset(&init, 0, sizeof(init));
+
+        init.config        = m_adv_modes_config;
+        init.conn_cfg_tag  = APP_BLE_CONN_CFG_TAG;
+        init.evt_handler   = on_adv_evt;
+        init.error_handler = adv_cache_error_handler;
+
+        err_code = adv_cache_init(&init, &m_advdata);
         APP_ERROR_CHECK(err_code);
+#else
+        adv_module_init();
+#endif
 
-        ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+        broadcast_init_t broadcast;
+
+        memset(&broadcast, 0, sizeof(broadcast));
+
+        broadcast.conn_cfg_tag  = APP_BLE_CONN_CFG_TAG;
+        broadcast.error_handler = broadcast_error_handler;
+
+        broadcast_init(&broadcast);
+
+        // Cycle counter for the restart statistics.
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 
@@ -1420,14 +3964,26 @@ int main(void)
         buttons_init();
         ble_stack_init();
         scheduler_init();
+#if HRM_CONN_EVT_ALIGNED
+        radio_notification_init();
+#endif
         gap_params_init();
         gatt_init();
         advertising_init();
         services_init();
+        conn_ctx_init();
+        hrm_tx_queue_init(m_hrs.hrm_handles.value_handle, handover_on_air);
         sensor_simulator_init();
+#if !BATTERY_LEVEL_SIMULATED
+        adc_configure();
+#endif
         conn_params_init();
+        fds_flash_check();
         peer_manager_init();
 
+        err_code = hr_log_init();
+        APP_ERROR_CHECK(err_code);
+
         // Start execution.
         NRF_LOG_INFO("Heart Rate Sensor example started.");
         application_timers_start();
@@ -0,0 +1,155 @@
+/** @file
+ *
+ * @brief PHY monitor module.
+ */
+#include "phy_monitor.h"
+#include "ble_hci.h"
+
+
+/**@brief Function for requesting a PHY on a link.
+ *
+ * @param[in] p_ctx  Context of the link.
+ * @param[in] phy    BLE_GAP_PHY_1MBPS or BLE_GAP_PHY_2MBPS.
+ *
+ * @retval NRF_SUCCESS      If the request was sent.
+ * @retval NRF_ERROR_BUSY   If a procedure is ongoing.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+static ret_code_t phy_request(conn_ctx_t * p_ctx, uint8_t phy)
+{
+        ret_code_t err_code;
+        ble_gap_phys_t const phys =
+        {
+                .rx_phys = phy,
+                .tx_phys = phy,
+        };
+
+        err_code = sd_ble_gap_phy_update(p_ctx->conn_handle, &phys);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        p_ctx->phy_pref         = phy;
+        p_ctx->phy_pending      = true;
+        p_ctx->phy_change_ticks = app_timer_cnt_get();
+        p_ctx->phy_request_cnt++;
+
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t phy_monitor_start(uint16_t conn_handle)
+{
+        return sd_ble_gap_rssi_start(conn_handle, PHY_RSSI_THRESHOLD_DBM, PHY_RSSI_SKIP_COUNT);
+}
+
+
+ret_code_t phy_monitor_on_rssi(conn_ctx_t * p_ctx, int8_t rssi, uint8_t * p_phy)
+{
+        ret_code_t err_code;
+        int32_t    rssi_filtered;
+        uint8_t    phy;
+
+        *p_phy = BLE_GAP_PHY_AUTO;
+
+        if (p_ctx->rssi_cnt++ == 0)
+        {
+                p_ctx->rssi_acc = rssi * (1 << PHY_RSSI_FILTER_SHIFT);
+        }
+        else
+        {
+                p_ctx->rssi_acc += rssi - (p_ctx->rssi_acc / (1 << PHY_RSSI_FILTER_SHIFT));
+        }
+        rssi_filtered = phy_monitor_rssi_get(p_ctx);
+
+        if ((rssi_filtered >= PHY_2M_RSSI_DBM) && (p_ctx->phy_pref != BLE_GAP_PHY_2MBPS) && !p_ctx->phy_2m_unsupported)
+        {
+                phy = BLE_GAP_PHY_2MBPS;
+        }
+        else if ((rssi_filtered <= PHY_1M_RSSI_DBM) && (p_ctx->phy_pref != BLE_GAP_PHY_1MBPS))
+        {
+                phy = BLE_GAP_PHY_1MBPS;
+        }
+        else
+        {
+                return NRF_SUCCESS;
+        }
+
+        // After an RTC overflow the elapsed time may be underestimated, which only delays the change.
+        if ((p_ctx->phy_request_cnt > 0) &&
+            (app_timer_cnt_diff_compute(app_timer_cnt_get(), p_ctx->phy_change_ticks) < PHY_MIN_DWELL))
+        {
+                return NRF_SUCCESS;
+        }
+
+        err_code = phy_request(p_ctx, phy);
+        if (err_code == NRF_ERROR_BUSY)
+        {
+                return NRF_SUCCESS;
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+                *p_phy = phy;
+        }
+
+        return err_code;
+}
+
+
+int32_t phy_monitor_rssi_get(conn_ctx_t const * p_ctx)
+{
+        return p_ctx->rssi_acc / (1 << PHY_RSSI_FILTER_SHIFT);
+}
+
+
+ret_code_t phy_monitor_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+        uint16_t     conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+        conn_ctx_t * p_ctx       = conn_ctx_get(conn_handle);
+
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        {
+                // Keep the PHY the monitor chose, and 1M PHY until it has chosen.
+                uint8_t phy = ((p_ctx != NULL) && (p_ctx->phy_pref != BLE_GAP_PHY_AUTO)) ?
+                              p_ctx->phy_pref : BLE_GAP_PHY_1MBPS;
+                ble_gap_phys_t const phys =
+                {
+                        .rx_phys = phy,
+                        .tx_phys = phy,
+                };
+                return sd_ble_gap_phy_update(conn_handle, &phys);
+        }
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+        {
+                ble_gap_evt_phy_update_t const * p_phy = &p_ble_evt->evt.gap_evt.params.phy_update;
+
+                if (p_ctx == NULL)
+                {
+                        break;
+                }
+
+                p_ctx->phy_pending = false;
+                if (p_phy->status == BLE_HCI_STATUS_CODE_SUCCESS)
+                {
+                        p_ctx->tx_phy = p_phy->tx_phy;
+                        p_ctx->rx_phy = p_phy->rx_phy;
+                        p_ctx->phy_update_cnt++;
+                }
+                else if (p_phy->status == BLE_HCI_UNSUPPORTED_REMOTE_FEATURE)
+                {
+                        // The peer has no 2M PHY, stop asking for it.
+                        p_ctx->phy_2m_unsupported = true;
+                        p_ctx->phy_pref           = BLE_GAP_PHY_1MBPS;
+                }
+        } break;
+
+        default:
+                break;
+        }
+
+        return NRF_SUCCESS;
+}
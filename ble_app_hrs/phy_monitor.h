@@ -0,0 +1,91 @@
+/** @file
+ *
+ * @defgroup phy_monitor PHY monitor
+ * @{
+ * @brief Choice of the PHY of each link from its RSSI.
+ *
+ * @details A link moves to 2M PHY when its filtered RSSI is at or above @ref PHY_2M_RSSI_DBM,
+ *          which halves the airtime, and back to 1M PHY, which has the better sensitivity, when it
+ *          drops to @ref PHY_1M_RSSI_DBM. The gap between the two thresholds and the
+ *          @ref PHY_MIN_DWELL time between changes keep the link from flapping.
+ *
+ *          Until the first change a link stays on the 1M PHY it connected on, and PHY update
+ *          requests of the peer are answered with the PHY the monitor chose. The state of a link
+ *          is kept in its @ref conn_ctx_t.
+ *
+ *          The application must forward its BLE events to @ref phy_monitor_on_ble_evt and the RSSI
+ *          readings to @ref phy_monitor_on_rssi.
+ */
+#ifndef PHY_MONITOR_H__
+#define PHY_MONITOR_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "app_timer.h"
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PHY_RSSI_THRESHOLD_DBM         2                            /**< Change of the RSSI (in dBm) that reports a new reading. */
+#define PHY_RSSI_SKIP_COUNT            4                            /**< Number of RSSI samples that must differ before a new reading is reported. */
+#define PHY_RSSI_FILTER_SHIFT          2                            /**< A new RSSI reading is weighted 1/2^PHY_RSSI_FILTER_SHIFT in the filtered RSSI. */
+#define PHY_2M_RSSI_DBM                (-65)                        /**< Filtered RSSI (in dBm) at or above which a link moves to 2M PHY. */
+#define PHY_1M_RSSI_DBM                (-75)                        /**< Filtered RSSI (in dBm) at or below which a link moves back to 1M PHY. */
+#define PHY_MIN_DWELL                  APP_TIMER_TICKS(10000)       /**< Shortest time between two PHY changes on a link. */
+
+
+/**@brief Function for starting the RSSI readings of a new link.
+ *
+ * @param[in] conn_handle  Connection handle of the link.
+ *
+ * @retval NRF_SUCCESS  If the readings were started.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t phy_monitor_start(uint16_t conn_handle);
+
+
+/**@brief Function for handling a new RSSI reading of a link.
+ *
+ * @param[in]  p_ctx  Context of the link.
+ * @param[in]  rssi   RSSI reading (in dBm).
+ * @param[out] p_phy  PHY requested, BLE_GAP_PHY_AUTO if the PHY is kept. It is kept while a
+ *                    procedure is ongoing, and tried again on a later reading.
+ *
+ * @retval NRF_SUCCESS  If the reading was handled.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t phy_monitor_on_rssi(conn_ctx_t * p_ctx, int8_t rssi, uint8_t * p_phy);
+
+
+/**@brief Function for getting the filtered RSSI of a link.
+ *
+ * @param[in] p_ctx  Context of the link.
+ *
+ * @return Filtered RSSI (in dBm), 0 before the first reading.
+ */
+int32_t phy_monitor_rssi_get(conn_ctx_t const * p_ctx);
+
+
+/**@brief Function for handling BLE events.
+ *
+ * @details Answers the PHY update requests of the peers and records the PHY updates in the
+ *          context of the link. Must be called before the application looks at the context.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ *
+ * @retval NRF_SUCCESS  If the event was handled.
+ * @return Otherwise the error code of the SoftDevice.
+ */
+ret_code_t phy_monitor_on_ble_evt(ble_evt_t const * p_ble_evt);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PHY_MONITOR_H__
+
+/** @} */
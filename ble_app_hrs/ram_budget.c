@@ -0,0 +1,127 @@
+/** @file
+ *
+ * @brief RAM budget probe module.
+ */
+#include "ram_budget.h"
+
+#if RAM_BUDGET_REPORT
+#include <string.h>
+#include "nordic_common.h"
+#include "sdk_config.h"
+#include "ble.h"
+#include "hrm_tx_queue.h"
+
+extern uint32_t __app_ram_start__;                                  /**< Start of the application RAM (RAM_START of the SES project). */
+extern uint32_t __heap_end__;                                       /**< End of the heap. */
+extern uint32_t __StackLimit;                                       /**< Start of the stack. The RAM between the heap and the stack is unused. */
+
+
+/**@brief Function for configuring the SoftDevice like the application does.
+ *
+ * @details Sets every configuration nrf_sdh_ble_default_cfg_set() and the application set,
+ *          unconditionally, so that a later call overrides all of an earlier one.
+ *
+ * @param[in] conn_cfg_tag  Tag of the connection configuration.
+ * @param[in] periph_cnt    Number of peripheral links.
+ * @param[in] central_cnt   Number of central links.
+ * @param[in] ram_top       Application RAM start passed to sd_ble_cfg_set().
+ *
+ * @return The first error of sd_ble_cfg_set(), or NRF_SUCCESS.
+ */
+static ret_code_t cfg_set(uint8_t conn_cfg_tag, uint8_t periph_cnt, uint8_t central_cnt, uint32_t ram_top)
+{
+        ret_code_t err_code;
+        ble_cfg_t  ble_cfg;
+
+        memset(&ble_cfg, 0, sizeof(ble_cfg));
+        ble_cfg.gap_cfg.role_count_cfg.periph_role_count  = periph_cnt;
+        ble_cfg.gap_cfg.role_count_cfg.central_role_count = central_cnt;
+        ble_cfg.gap_cfg.role_count_cfg.central_sec_count  = MIN(central_cnt, BLE_GAP_ROLE_COUNT_CENTRAL_SEC_DEFAULT);
+        err_code = sd_ble_cfg_set(BLE_GAP_CFG_ROLE_COUNT, &ble_cfg, ram_top);
+
+        if (err_code == NRF_SUCCESS)
+        {
+                memset(&ble_cfg, 0, sizeof(ble_cfg));
+                ble_cfg.conn_cfg.conn_cfg_tag                     = conn_cfg_tag;
+                ble_cfg.conn_cfg.params.gap_conn_cfg.conn_count   = periph_cnt + central_cnt;
+                ble_cfg.conn_cfg.params.gap_conn_cfg.event_length = NRF_SDH_BLE_GAP_EVENT_LENGTH;
+                err_code = sd_ble_cfg_set(BLE_CONN_CFG_GAP, &ble_cfg, ram_top);
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+                memset(&ble_cfg, 0, sizeof(ble_cfg));
+                ble_cfg.conn_cfg.conn_cfg_tag                 = conn_cfg_tag;
+                ble_cfg.conn_cfg.params.gatt_conn_cfg.att_mtu = NRF_SDH_BLE_GATT_MAX_MTU_SIZE;
+                err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATT, &ble_cfg, ram_top);
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+                memset(&ble_cfg, 0, sizeof(ble_cfg));
+                ble_cfg.conn_cfg.conn_cfg_tag                            = conn_cfg_tag;
+                ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = HVN_TX_QUEUE_SIZE;
+                err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_top);
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+                memset(&ble_cfg, 0, sizeof(ble_cfg));
+                ble_cfg.common_cfg.vs_uuid_cfg.vs_uuid_count = NRF_SDH_BLE_VS_UUID_COUNT;
+                err_code = sd_ble_cfg_set(BLE_COMMON_CFG_VS_UUID, &ble_cfg, ram_top);
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+                memset(&ble_cfg, 0, sizeof(ble_cfg));
+                ble_cfg.gatts_cfg.attr_tab_size.attr_tab_size = NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE;
+                err_code = sd_ble_cfg_set(BLE_GATTS_CFG_ATTR_TAB_SIZE, &ble_cfg, ram_top);
+        }
+
+        return err_code;
+}
+
+
+ret_code_t ram_budget_probe(uint8_t conn_cfg_tag, uint32_t link_ram, ram_budget_t * p_budget)
+{
+        ret_code_t err_code;
+        uint32_t   ram_top = (uint32_t)&__StackLimit;
+
+        memset(p_budget, 0, sizeof(ram_budget_t));
+        p_budget->app_ram_start = (uint32_t)&__app_ram_start__;
+        p_budget->unused_ram    = (uint32_t)&__StackLimit - (uint32_t)&__heap_end__;
+        p_budget->link_ram      = link_ram;
+
+        for (uint8_t link_cnt = 1; link_cnt <= RAM_BUDGET_MAX_LINKS; link_cnt++)
+        {
+                uint32_t sd_start = RAM_BUDGET_PROBE_BASE;
+
+                err_code = cfg_set(conn_cfg_tag, link_cnt, 0, ram_top);
+                if (err_code == NRF_SUCCESS)
+                {
+                        // Fails with the RAM the SoftDevice needs written to sd_start.
+                        err_code = sd_ble_enable(&sd_start);
+                }
+                if (err_code != NRF_ERROR_NO_MEM)
+                {
+                        p_budget->reject_err_code = err_code;
+                        break;
+                }
+
+                int32_t  sd_growth  = (int32_t)sd_start - (int32_t)p_budget->app_ram_start;
+                uint32_t app_growth = (link_cnt > NRF_SDH_BLE_TOTAL_LINK_COUNT) ?
+                                      (link_cnt - NRF_SDH_BLE_TOTAL_LINK_COUNT) * link_ram : 0;
+                bool     fits       = (sd_growth + (int32_t)app_growth) <= (int32_t)p_budget->unused_ram;
+
+                p_budget->sd_ram_start[link_cnt - 1] = sd_start;
+                p_budget->fits[link_cnt - 1]         = fits;
+                p_budget->trial_cnt                  = link_cnt;
+
+                if (fits)
+                {
+                        p_budget->fit_cnt = link_cnt;
+                }
+        }
+
+        return cfg_set(conn_cfg_tag,
+                       NRF_SDH_BLE_PERIPHERAL_LINK_COUNT,
+                       NRF_SDH_BLE_CENTRAL_LINK_COUNT,
+                       ram_top);
+}
+#endif // RAM_BUDGET_REPORT
@@ -0,0 +1,68 @@
+/** @file
+ *
+ * @defgroup ram_budget RAM budget probe
+ * @{
+ * @brief Number of peripheral links that fit in the RAM of the application.
+ *
+ * @details For every link count, the SoftDevice is configured like the application configures it
+ *          and asked for the RAM it needs. The links fit if the SoftDevice RAM beyond RAM_START,
+ *          plus the per-link state of the application for the links beyond
+ *          NRF_SDH_BLE_TOTAL_LINK_COUNT, fit in the unused RAM between the heap and the stack.
+ *          Moving RAM_START, and resizing the per-link arrays, is left to the developer.
+ *
+ *          The module does not log. The application reports the result.
+ */
+#ifndef RAM_BUDGET_H__
+#define RAM_BUDGET_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RAM_BUDGET_REPORT              0                            /**< Set to 1 to log at startup how many peripheral links fit in the RAM of the application. */
+#define RAM_BUDGET_MAX_LINKS           8                            /**< Largest number of peripheral links tried. */
+#define RAM_BUDGET_PROBE_BASE          0x20000000                   /**< Application RAM base passed to sd_ble_enable(). Too low on purpose, so that the SoftDevice returns the RAM it needs. */
+
+/**@brief Result of the probe. */
+typedef struct
+{
+        uint32_t   app_ram_start;                                   /**< Start of the application RAM (RAM_START of the project). */
+        uint32_t   unused_ram;                                      /**< RAM unused between the heap and the stack (in bytes). */
+        uint32_t   link_ram;                                        /**< Application state per link (in bytes). */
+        uint8_t    trial_cnt;                                       /**< Number of link counts tried, from 1. */
+        uint32_t   sd_ram_start[RAM_BUDGET_MAX_LINKS];              /**< RAM_START the SoftDevice needs for each link count tried. */
+        bool       fits[RAM_BUDGET_MAX_LINKS];                      /**< Whether each link count tried fits. */
+        ret_code_t reject_err_code;                                 /**< Error the SoftDevice rejected link count trial_cnt + 1 with, or NRF_SUCCESS if none was rejected. */
+        uint8_t    fit_cnt;                                         /**< Largest link count that fits, 0 if none. */
+} ram_budget_t;
+
+
+/**@brief Function for probing how many peripheral links fit in the RAM of the application.
+ *
+ * @details Must be called after the SoftDevice is enabled and before the BLE stack is enabled.
+ *          The configuration for NRF_SDH_BLE_PERIPHERAL_LINK_COUNT and
+ *          NRF_SDH_BLE_CENTRAL_LINK_COUNT is put back at the end, so that nothing of the last trial
+ *          stays behind: nrf_sdh_ble_default_cfg_set() skips the ATT MTU and the attribute table
+ *          size when they are at their defaults.
+ *
+ * @param[in]  conn_cfg_tag  Tag of the connection configuration of the application.
+ * @param[in]  link_ram      Application state per link (in bytes).
+ * @param[out] p_budget      Result of the probe.
+ *
+ * @retval NRF_SUCCESS  If the configuration was put back.
+ * @return Otherwise the error code of sd_ble_cfg_set().
+ */
+ret_code_t ram_budget_probe(uint8_t conn_cfg_tag, uint32_t link_ram, ram_budget_t * p_budget);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAM_BUDGET_H__
+
+/** @} */
@@ -0,0 +1,72 @@
+/** @file
+ *
+ * @brief Fast reconnect module.
+ */
+#include <string.h>
+#include "reconnect.h"
+#include "ble_hci.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TICKS_TO_MS(ticks)             ((uint32_t)(((uint64_t)(ticks) * 1000) / APP_TIMER_CLOCK_FREQ))  /**< Converts RTC ticks of the application timer (prescaler 0) to milliseconds. */
+
+
+static bool              m_pending;                                 /**< Whether a host is expected back. */
+static ble_gap_addr_t    m_peer_addr;                               /**< Address of the host expected back. */
+static uint32_t          m_lost_ticks;                              /**< RTC counter value when the link was lost. */
+static reconnect_stats_t m_stats;                                   /**< Reconnection statistics. */
+
+
+bool reconnect_on_disconnected(conn_ctx_t const * p_ctx, uint8_t reason)
+{
+        if ((reason != BLE_HCI_CONNECTION_TIMEOUT) &&
+            (reason != BLE_HCI_STATUS_CODE_LMP_RESPONSE_TIMEOUT))
+        {
+                return false;
+        }
+
+        m_pending    = true;
+        m_peer_addr  = p_ctx->peer_addr;
+        m_lost_ticks = app_timer_cnt_get();
+
+        return true;
+}
+
+
+bool reconnect_on_connected(conn_ctx_t const * p_ctx, uint32_t * p_reconnect_ms)
+{
+        if (!m_pending ||
+            (p_ctx->peer_addr.addr_type != m_peer_addr.addr_type) ||
+            (memcmp(p_ctx->peer_addr.addr, m_peer_addr.addr, BLE_GAP_ADDR_LEN) != 0))
+        {
+                return false;
+        }
+
+        uint32_t reconnect_ms = TICKS_TO_MS(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_lost_ticks));
+
+        m_pending = false;
+        m_stats.reconnect_cnt++;
+        m_stats.reconnect_sum_ms += reconnect_ms;
+        m_stats.reconnect_max_ms  = MAX(m_stats.reconnect_max_ms, reconnect_ms);
+
+        *p_reconnect_ms = reconnect_ms;
+        return true;
+}
+
+
+void reconnect_cancel(void)
+{
+        m_pending = false;
+}
+
+
+ble_gap_addr_t const * reconnect_peer_addr_get(void)
+{
+        return m_pending ? &m_peer_addr : NULL;
+}
+
+
+void reconnect_stats_get(reconnect_stats_t * p_stats)
+{
+        *p_stats = m_stats;
+}
@@ -0,0 +1,81 @@
+/** @file
+ *
+ * @defgroup reconnect Fast reconnect
+ * @{
+ * @brief Host of a link lost to a supervision timeout, called back with directed advertising.
+ *
+ * @details A link the host or the application closed is not called back. A link lost to a
+ *          supervision timeout is: its host is remembered until it connects again, or until the
+ *          advertising ends without it, and the time it took to come back is measured.
+ *
+ *          The module does not advertise. The application advertises directed to
+ *          @ref reconnect_peer_addr_get while a host is expected back.
+ */
+#ifndef RECONNECT_H__
+#define RECONNECT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "conn_ctx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Time from link loss to reconnection of the hosts that came back. */
+typedef struct
+{
+        uint32_t reconnect_cnt;                                     /**< Number of hosts that came back. */
+        uint32_t reconnect_sum_ms;                                  /**< Sum of the times from link loss to reconnection (in ms). */
+        uint32_t reconnect_max_ms;                                  /**< Longest time from link loss to reconnection (in ms). */
+} reconnect_stats_t;
+
+
+/**@brief Function for remembering the host of a link lost to a supervision timeout.
+ *
+ * @param[in] p_ctx   Context of the link.
+ * @param[in] reason  HCI reason of the disconnection.
+ *
+ * @return true if the host is expected back.
+ */
+bool reconnect_on_disconnected(conn_ctx_t const * p_ctx, uint8_t reason);
+
+
+/**@brief Function for checking whether a new link is the host of a lost link coming back.
+ *
+ * @param[in]  p_ctx           Context of the new link.
+ * @param[out] p_reconnect_ms  Time from link loss to reconnection (in ms).
+ *
+ * @return true if the host came back, false if another host connected or none was expected.
+ */
+bool reconnect_on_connected(conn_ctx_t const * p_ctx, uint32_t * p_reconnect_ms);
+
+
+/**@brief Function for giving up on the lost host, e.g. when the advertising ended without it.
+ */
+void reconnect_cancel(void);
+
+
+/**@brief Function for getting the address of the host expected back.
+ *
+ * @return Address of the host, the target of the directed advertising, or NULL if no host is
+ *         expected back.
+ */
+ble_gap_addr_t const * reconnect_peer_addr_get(void);
+
+
+/**@brief Function for getting the reconnection statistics.
+ *
+ * @param[out] p_stats  Statistics.
+ */
+void reconnect_stats_get(reconnect_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECONNECT_H__
+
+/** @} */
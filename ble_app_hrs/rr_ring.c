@@ -0,0 +1,56 @@
+/** @file
+ *
+ * @brief RR interval ring module.
+ */
+#include <string.h>
+#include "rr_ring.h"
+#include "nrf.h"
+#include "app_util.h"
+
+
+STATIC_ASSERT(IS_POWER_OF_TWO(RR_RING_SIZE));
+
+
+void rr_ring_init(rr_ring_t * p_ring)
+{
+        memset(p_ring, 0, sizeof(rr_ring_t));
+}
+
+
+bool rr_ring_push(rr_ring_t * p_ring, uint16_t rr_interval)
+{
+        uint32_t tail = p_ring->tail;
+
+        if ((tail - p_ring->head) == RR_RING_SIZE)
+        {
+                p_ring->overflow_cnt++;
+                return false;
+        }
+
+        p_ring->buffer[tail & (RR_RING_SIZE - 1)] = rr_interval;
+
+        // Publish the value before the index.
+        __DMB();
+        p_ring->tail = tail + 1;
+
+        return true;
+}
+
+
+bool rr_ring_pop(rr_ring_t * p_ring, uint16_t * p_rr_interval)
+{
+        uint32_t head = p_ring->head;
+
+        if (head == p_ring->tail)
+        {
+                return false;
+        }
+
+        // Read the value before releasing its slot to the producer.
+        __DMB();
+        *p_rr_interval = p_ring->buffer[head & (RR_RING_SIZE - 1)];
+        __DMB();
+        p_ring->head = head + 1;
+
+        return true;
+}
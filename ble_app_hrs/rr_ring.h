@@ -0,0 +1,73 @@
+/** @file
+ *
+ * @defgroup rr_ring RR interval ring
+ * @{
+ * @brief Lock-free single-producer/single-consumer ring of RR intervals.
+ *
+ * @details The RR interval timer is the only producer and writes only @ref rr_ring_t::tail, the
+ *          Heart Rate Measurement encoder is the only consumer and writes only
+ *          @ref rr_ring_t::head. Both indexes run freely and are masked on access, so push and
+ *          pop are O(1) and need no critical region. Data memory barriers order the access to a
+ *          slot against the index that hands it over, so the ring stays correct when producer and
+ *          consumer run at different interrupt priorities.
+ */
+#ifndef RR_RING_H__
+#define RR_RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RR_RING_SIZE                   64                           /**< Number of RR intervals buffered until the next Heart Rate Measurement is sent. Must be a power of two. */
+
+/**@brief RR interval ring. */
+typedef struct
+{
+        uint16_t          buffer[RR_RING_SIZE];                     /**< RR intervals. */
+        volatile uint32_t head;                                     /**< Index of the next RR interval to pop, written by the consumer. */
+        volatile uint32_t tail;                                     /**< Index of the next RR interval to push, written by the producer. */
+        volatile uint32_t overflow_cnt;                             /**< Number of RR intervals dropped because the ring was full, written by the producer. */
+} rr_ring_t;
+
+
+/**@brief Function for emptying a ring. Neither side may use it meanwhile.
+ *
+ * @param[out] p_ring  Ring.
+ */
+void rr_ring_init(rr_ring_t * p_ring);
+
+
+/**@brief Function for pushing an RR interval to the ring. Producer side only.
+ *
+ * @details If the ring is full the RR interval is dropped and counted as overflow.
+ *
+ * @param[in] p_ring       Ring.
+ * @param[in] rr_interval  RR interval to push.
+ *
+ * @retval true   The RR interval was pushed.
+ * @retval false  The ring was full.
+ */
+bool rr_ring_push(rr_ring_t * p_ring, uint16_t rr_interval);
+
+
+/**@brief Function for popping an RR interval from the ring. Consumer side only.
+ *
+ * @param[in]  p_ring         Ring.
+ * @param[out] p_rr_interval  Popped RR interval.
+ *
+ * @retval true   An RR interval was popped.
+ * @retval false  The ring was empty.
+ */
+bool rr_ring_pop(rr_ring_t * p_ring, uint16_t * p_rr_interval);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RR_RING_H__
+
+/** @} */
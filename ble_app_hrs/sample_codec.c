@@ -0,0 +1,137 @@
+/** @file
+ *
+ * @brief Sample stream codec module.
+ */
+#include <stdbool.h>
+#include "sample_codec.h"
+
+
+/**@brief Function for checking whether the next sample is a keyframe.
+ *
+ * @param[in] p_codec  Codec.
+ *
+ * @return true if the next sample is coded as an absolute value.
+ */
+static bool keyframe_next(sample_codec_t const * p_codec)
+{
+        return (p_codec->since_keyframe == 0) ||
+               ((p_codec->keyframe_interval != 0) &&
+                (p_codec->since_keyframe >= p_codec->keyframe_interval));
+}
+
+
+/**@brief Function for counting a coded sample towards the next keyframe.
+ *
+ * @details The count saturates, so that with keyframe interval 0 it never wraps back to the value
+ *          that forces a keyframe.
+ *
+ * @param[in,out] p_codec   Codec.
+ * @param[in]     keyframe  Whether the sample was coded as a keyframe.
+ */
+static void keyframe_count(sample_codec_t * p_codec, bool keyframe)
+{
+        if (keyframe)
+        {
+                p_codec->since_keyframe = 1;
+        }
+        else if (p_codec->since_keyframe < UINT16_MAX)
+        {
+                p_codec->since_keyframe++;
+        }
+}
+
+
+/**@brief Function for mapping a 16-bit two's complement difference to an unsigned value.
+ *
+ * @details Small differences of either sign map to small values: 0, -1, 1, -2, ... map to
+ *          0, 1, 2, 3, ...
+ */
+static uint16_t zigzag_encode(uint16_t diff)
+{
+        return (uint16_t)((diff << 1) ^ ((diff & 0x8000) ? 0xFFFF : 0x0000));
+}
+
+
+/**@brief Function for reversing @ref zigzag_encode. */
+static uint16_t zigzag_decode(uint16_t value)
+{
+        return (uint16_t)((value >> 1) ^ ((value & 0x0001) ? 0xFFFF : 0x0000));
+}
+
+
+void sample_codec_init(sample_codec_t * p_codec, uint16_t keyframe_interval)
+{
+        p_codec->keyframe_interval = keyframe_interval;
+        p_codec->since_keyframe    = 0;
+        p_codec->prev              = 0;
+}
+
+
+void sample_codec_reset(sample_codec_t * p_codec)
+{
+        p_codec->since_keyframe = 0;
+}
+
+
+uint8_t sample_codec_encode(sample_codec_t * p_codec, uint16_t sample, uint8_t * p_buf, uint16_t buf_len)
+{
+        uint8_t  buf[SAMPLE_CODEC_MAX_LEN];
+        uint8_t  len = 0;
+        bool     keyframe = keyframe_next(p_codec);
+        uint16_t value    = keyframe ? sample : zigzag_encode((uint16_t)(sample - p_codec->prev));
+
+        do
+        {
+                buf[len] = value & 0x7F;
+                value  >>= 7;
+                if (value != 0)
+                {
+                        buf[len] |= 0x80;
+                }
+                len++;
+        } while (value != 0);
+
+        if (len > buf_len)
+        {
+                return 0;
+        }
+
+        for (uint8_t i = 0; i < len; i++)
+        {
+                p_buf[i] = buf[i];
+        }
+
+        p_codec->prev = sample;
+        keyframe_count(p_codec, keyframe);
+
+        return len;
+}
+
+
+uint8_t sample_codec_decode(sample_codec_t * p_codec, uint8_t const * p_buf, uint16_t buf_len, uint16_t * p_sample)
+{
+        uint32_t value = 0;
+        uint8_t  len   = 0;
+        bool     keyframe = keyframe_next(p_codec);
+
+        do
+        {
+                if ((len == buf_len) || (len == SAMPLE_CODEC_MAX_LEN))
+                {
+                        return 0;
+                }
+                value |= (uint32_t)(p_buf[len] & 0x7F) << (7 * len);
+        } while (p_buf[len++] & 0x80);
+
+        if (value > UINT16_MAX)
+        {
+                return 0;
+        }
+
+        *p_sample = keyframe ? (uint16_t)value : (uint16_t)(p_codec->prev + zigzag_decode((uint16_t)value));
+
+        p_codec->prev = *p_sample;
+        keyframe_count(p_codec, keyframe);
+
+        return len;
+}
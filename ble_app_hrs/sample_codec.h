@@ -0,0 +1,87 @@
+/** @file
+ *
+ * @defgroup sample_codec Sample stream codec
+ * @{
+ * @brief Delta/varint codec for streams of 16-bit samples.
+ *
+ * @details Consecutive samples are encoded as the zigzag-mapped difference to the previous sample,
+ *          written as a little-endian base-128 variable-length integer. Slowly changing signals
+ *          such as RR intervals or a band-limited waveform therefore cost one byte per sample
+ *          instead of two.
+ *
+ *          Every @ref sample_codec_t::keyframe_interval samples, and on the first sample after
+ *          @ref sample_codec_reset, the absolute sample is written instead of a delta. A decoder
+ *          that lost data resynchronizes on the next keyframe. Encoder and decoder must use the
+ *          same keyframe interval.
+ */
+#ifndef SAMPLE_CODEC_H__
+#define SAMPLE_CODEC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_CODEC_MAX_LEN           3                            /**< Maximum number of bytes one encoded sample takes. */
+
+/**@brief Sample codec state. One instance per direction and stream. */
+typedef struct
+{
+        uint16_t keyframe_interval;                                 /**< Number of samples between keyframes, including the keyframe. 0 writes only the first keyframe. */
+        uint16_t since_keyframe;                                    /**< Number of samples coded since the last keyframe. */
+        uint16_t prev;                                              /**< Previous sample. */
+} sample_codec_t;
+
+
+/**@brief Function for initializing a codec.
+ *
+ * @param[out] p_codec            Codec to initialize.
+ * @param[in]  keyframe_interval  Number of samples between keyframes.
+ */
+void sample_codec_init(sample_codec_t * p_codec, uint16_t keyframe_interval);
+
+
+/**@brief Function for forcing the next sample to be coded as a keyframe.
+ *
+ * @details Use it at the start of every independently decodable unit, e.g. a notification.
+ *
+ * @param[in,out] p_codec  Codec.
+ */
+void sample_codec_reset(sample_codec_t * p_codec);
+
+
+/**@brief Function for encoding one sample.
+ *
+ * @details Nothing is written and the codec state is left unchanged if the encoded sample does
+ *          not fit into the buffer.
+ *
+ * @param[in,out] p_codec  Codec.
+ * @param[in]     sample   Sample to encode.
+ * @param[out]    p_buf    Buffer to write the encoded sample to.
+ * @param[in]     buf_len  Free space in the buffer.
+ *
+ * @return Number of bytes written, 0 if the sample did not fit.
+ */
+uint8_t sample_codec_encode(sample_codec_t * p_codec, uint16_t sample, uint8_t * p_buf, uint16_t buf_len);
+
+
+/**@brief Function for decoding one sample.
+ *
+ * @param[in,out] p_codec   Codec.
+ * @param[in]     p_buf     Encoded data.
+ * @param[in]     buf_len   Length of the encoded data.
+ * @param[out]    p_sample  Decoded sample.
+ *
+ * @return Number of bytes consumed, 0 if the data is truncated or malformed.
+ */
+uint8_t sample_codec_decode(sample_codec_t * p_codec, uint8_t const * p_buf, uint16_t buf_len, uint16_t * p_sample);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLE_CODEC_H__
+
+/** @} */
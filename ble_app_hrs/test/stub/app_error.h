@@ -0,0 +1,27 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK error handler. Any error reaching it fails the test.
+ */
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define APP_ERROR_HANDLER(err_code)                                                         \
+        do                                                                                  \
+        {                                                                                   \
+                fprintf(stderr, "%s:%d: error 0x%x\n", __FILE__, __LINE__, (unsigned)(err_code)); \
+                abort();                                                                    \
+        } while (0)
+
+#define APP_ERROR_CHECK(err_code)                                                           \
+        do                                                                                  \
+        {                                                                                   \
+                if ((err_code) != 0)                                                        \
+                {                                                                           \
+                        APP_ERROR_HANDLER(err_code);                                        \
+                }                                                                           \
+        } while (0)
+
+#endif // APP_ERROR_H__
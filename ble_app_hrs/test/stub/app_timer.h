@@ -0,0 +1,22 @@
+/** @file
+ *
+ * @brief Host build stand-in for the application timer counter functions. The tests implement
+ *        app_timer_cnt_get() if they use it.
+ */
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdint.h>
+
+#define APP_TIMER_CLOCK_FREQ           32768
+#define APP_TIMER_MAX_CNT_VAL          0x00FFFFFF
+#define APP_TIMER_TICKS(ms)            ((uint32_t)(((uint64_t)(ms) * APP_TIMER_CLOCK_FREQ) / 1000))
+
+uint32_t app_timer_cnt_get(void);
+
+static inline uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from)
+{
+        return (ticks_to - ticks_from) & APP_TIMER_MAX_CNT_VAL;
+}
+
+#endif // APP_TIMER_H__
@@ -0,0 +1,50 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK utility macros.
+ */
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+#include <stdint.h>
+
+#define MIN(a, b)                      ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                      ((a) < (b) ? (b) : (a))
+#define ARRAY_SIZE(arr)                (sizeof(arr) / sizeof((arr)[0]))
+#define CEIL_DIV(a, b)                 ((((a) - 1) / (b)) + 1)
+#define IS_POWER_OF_TWO(a)             (((a) != 0) && ((((a) - 1) & (a)) == 0))
+#define STATIC_ASSERT(expr)            _Static_assert(expr, #expr)
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t * p_encoded_data)
+{
+        p_encoded_data[0] = (uint8_t)(value & 0xFF);
+        p_encoded_data[1] = (uint8_t)(value >> 8);
+        return sizeof(uint16_t);
+}
+
+/** Same curve as the SDK: a CR2032 cell from 3.0 V (100 %) down to 2.1 V (0 %). */
+static inline uint8_t battery_level_in_percent(const uint16_t mvolts)
+{
+        if (mvolts >= 3000)
+        {
+                return 100;
+        }
+        else if (mvolts > 2900)
+        {
+                return 100 - ((3000 - mvolts) * 58) / 100;
+        }
+        else if (mvolts > 2740)
+        {
+                return 42 - ((2900 - mvolts) * 24) / 160;
+        }
+        else if (mvolts > 2440)
+        {
+                return 18 - ((2740 - mvolts) * 12) / 300;
+        }
+        else if (mvolts > 2100)
+        {
+                return 6 - ((2440 - mvolts) * 6) / 340;
+        }
+        return 0;
+}
+
+#endif // APP_UTIL_H__
@@ -0,0 +1,12 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK platform utilities. The tests run the code under test
+ *        from one thread per side, so critical regions are empty.
+ */
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#define CRITICAL_REGION_ENTER()        {
+#define CRITICAL_REGION_EXIT()         }
+
+#endif // APP_UTIL_PLATFORM_H__
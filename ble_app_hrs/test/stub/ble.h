@@ -0,0 +1,212 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SoftDevice BLE API. The tests implement the SVCs they use.
+ */
+#ifndef BLE_H__
+#define BLE_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+#include "ble_err.h"
+#include "ble_gatt.h"
+
+#define BLE_CONN_HANDLE_INVALID        0xFFFF
+#define BLE_GAP_WHITELIST_ADDR_MAX_COUNT  8
+
+#define BLE_EVT_USER_MEM_REQUEST       0x01
+#define BLE_EVT_USER_MEM_RELEASE       0x02
+#define BLE_GATTS_EVT_WRITE            0x50
+#define BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST  0x51
+
+#define BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES  0x01
+
+#define BLE_GATTS_SRVC_TYPE_PRIMARY    0x01
+#define BLE_GATTS_VLOC_USER            0x02
+
+#define BLE_GATTS_AUTHORIZE_TYPE_READ  0x01
+#define BLE_GATTS_AUTHORIZE_TYPE_WRITE 0x02
+
+#define BLE_GATTS_OP_WRITE_REQ         0x01
+#define BLE_GATTS_OP_PREP_WRITE_REQ    0x04
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL  0x05
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_NOW     0x06
+
+#define BLE_STUB_WRITE_DATA_MAX        512                          /**< Data the host write events carry inline, instead of past the end of the event. */
+
+typedef struct
+{
+        uint16_t uuid;
+        uint8_t  type;
+} ble_uuid_t;
+
+typedef struct
+{
+        uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct
+{
+        uint8_t sm : 4;
+        uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+typedef struct
+{
+        uint8_t addr_id_peer : 1;
+        uint8_t addr_type    : 7;
+        uint8_t addr[6];
+} ble_gap_addr_t;
+
+typedef struct
+{
+        uint8_t  * p_mem;
+        uint16_t   len;
+} ble_user_mem_block_t;
+
+typedef struct
+{
+        ble_gap_conn_sec_mode_t read_perm;
+        ble_gap_conn_sec_mode_t write_perm;
+        uint8_t                 vlen    : 1;
+        uint8_t                 vloc    : 2;
+        uint8_t                 rd_auth : 1;
+        uint8_t                 wr_auth : 1;
+} ble_gatts_attr_md_t;
+
+typedef struct
+{
+        ble_uuid_t          const * p_uuid;
+        ble_gatts_attr_md_t const * p_attr_md;
+        uint16_t                    init_len;
+        uint16_t                    init_offs;
+        uint16_t                    max_len;
+        uint8_t                   * p_value;
+} ble_gatts_attr_t;
+
+typedef struct
+{
+        uint8_t broadcast     : 1;
+        uint8_t read          : 1;
+        uint8_t write_wo_resp : 1;
+        uint8_t write         : 1;
+        uint8_t notify        : 1;
+        uint8_t indicate      : 1;
+        uint8_t auth_signed_wr : 1;
+} ble_gatt_char_props_t;
+
+typedef struct
+{
+        ble_gatt_char_props_t       char_props;
+        uint8_t const             * p_char_user_desc;
+        void const                * p_char_pf;
+        ble_gatts_attr_md_t const * p_user_desc_md;
+        ble_gatts_attr_md_t const * p_cccd_md;
+        ble_gatts_attr_md_t const * p_sccd_md;
+} ble_gatts_char_md_t;
+
+typedef struct
+{
+        uint16_t value_handle;
+        uint16_t user_desc_handle;
+        uint16_t cccd_handle;
+        uint16_t sccd_handle;
+} ble_gatts_char_handles_t;
+
+typedef struct
+{
+        uint16_t        handle;
+        uint8_t         type;
+        uint16_t        offset;
+        uint16_t      * p_len;
+        uint8_t const * p_data;
+} ble_gatts_hvx_params_t;
+
+typedef struct
+{
+        uint16_t   handle;
+        ble_uuid_t uuid;
+        uint8_t    op;
+        uint8_t    auth_required;
+        uint16_t   offset;
+        uint16_t   len;
+        uint8_t    data[BLE_STUB_WRITE_DATA_MAX];
+} ble_gatts_evt_write_t;
+
+typedef struct
+{
+        uint8_t type;
+        union
+        {
+                ble_gatts_evt_write_t write;
+        } request;
+} ble_gatts_evt_rw_authorize_request_t;
+
+typedef struct
+{
+        uint8_t type;
+        union
+        {
+                struct
+                {
+                        uint16_t        gatt_status;
+                        uint8_t         update : 1;
+                        uint16_t        offset;
+                        uint16_t        len;
+                        uint8_t const * p_data;
+                } write;
+        } params;
+} ble_gatts_rw_authorize_reply_params_t;
+
+typedef struct
+{
+        uint16_t conn_handle;
+        union
+        {
+                ble_gatts_evt_write_t                write;
+                ble_gatts_evt_rw_authorize_request_t authorize_request;
+        } params;
+} ble_gatts_evt_t;
+
+typedef struct
+{
+        uint16_t conn_handle;
+        union
+        {
+                struct
+                {
+                        uint8_t type;
+                } user_mem_request;
+        } params;
+} ble_common_evt_t;
+
+typedef struct
+{
+        uint16_t conn_handle;
+} ble_gap_evt_t;
+
+typedef struct
+{
+        struct
+        {
+                uint16_t evt_id;
+                uint16_t evt_len;
+        } header;
+        union
+        {
+                ble_common_evt_t common_evt;
+                ble_gap_evt_t    gap_evt;
+                ble_gatts_evt_t  gatts_evt;
+        } evt;
+} ble_evt_t;
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params);
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type);
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t                   service_handle,
+                                         ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const    * p_attr_char_value,
+                                         ble_gatts_char_handles_t  * p_handles);
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const * p_reply);
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, ble_user_mem_block_t const * p_block);
+
+#endif // BLE_H__
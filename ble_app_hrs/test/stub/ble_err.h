@@ -0,0 +1,11 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SoftDevice BLE error codes.
+ */
+#ifndef BLE_ERR_H__
+#define BLE_ERR_H__
+
+#define BLE_ERROR_INVALID_CONN_HANDLE      0x3002
+#define BLE_ERROR_GATTS_SYS_ATTR_MISSING   0x3401
+
+#endif // BLE_ERR_H__
@@ -0,0 +1,16 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SoftDevice GATT definitions.
+ */
+#ifndef BLE_GATT_H__
+#define BLE_GATT_H__
+
+#define BLE_GATT_ATT_MTU_DEFAULT       23
+#define BLE_GATT_HVX_NOTIFICATION      0x01
+
+#define BLE_GATT_STATUS_SUCCESS        0x0000
+#define BLE_GATT_STATUS_ATTERR_INVALID_OFFSET     0x0107
+#define BLE_GATT_STATUS_ATTERR_PREPARE_QUEUE_FULL 0x0109
+#define BLE_GATT_STATUS_ATTERR_APP_BEGIN          0x0180
+
+#endif // BLE_GATT_H__
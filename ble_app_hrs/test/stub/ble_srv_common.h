@@ -0,0 +1,13 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK service helpers.
+ */
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+
+#include <stdint.h>
+#include "ble.h"
+
+typedef void (*ble_srv_error_handler_t)(uint32_t nrf_error);
+
+#endif // BLE_SRV_COMMON_H__
@@ -0,0 +1,11 @@
+/** @file
+ *
+ * @brief Host build stand-in for the device header. The barrier maps to a full compiler and CPU
+ *        barrier, so the ring can be exercised from two host threads.
+ */
+#ifndef NRF_H__
+#define NRF_H__
+
+#define __DMB()                        __sync_synchronize()
+
+#endif // NRF_H__
@@ -0,0 +1,58 @@
+/** @file
+ *
+ * @brief Host build stand-in for the Queued Writes module of the SDK, with the types of SDK 14.2.
+ *        The tests implement the functions they use.
+ */
+#ifndef NRF_BLE_QWR_H__
+#define NRF_BLE_QWR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "ble_srv_common.h"
+
+#define NRF_BLE_QWR_ATTR_LIST_SIZE     10
+#define NRF_BLE_QWR_REJ_REQUEST_ERR_CODE  BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0
+
+typedef enum
+{
+        NRF_BLE_QWR_EVT_EXECUTE_WRITE,
+        NRF_BLE_QWR_EVT_AUTH_REQUEST,
+} nrf_ble_qwr_evt_type_t;
+
+typedef struct
+{
+        nrf_ble_qwr_evt_type_t evt_type;
+        uint16_t               attr_handle;
+} nrf_ble_qwr_evt_t;
+
+typedef struct nrf_ble_qwr_t nrf_ble_qwr_t;
+
+typedef uint16_t (*nrf_ble_qwr_evt_handler_t)(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt);
+
+struct nrf_ble_qwr_t
+{
+        uint8_t                   initialized;
+        uint16_t                  conn_handle;
+        uint16_t                  attr_handles[NRF_BLE_QWR_ATTR_LIST_SIZE];
+        uint8_t                   nb_registered_attr;
+        ble_user_mem_block_t      mem_buffer;
+        ble_srv_error_handler_t   error_handler;
+        bool                      is_user_mem_reply_pending;
+        nrf_ble_qwr_evt_handler_t callback;
+};
+
+typedef struct
+{
+        ble_srv_error_handler_t   error_handler;
+        ble_user_mem_block_t      mem_buffer;
+        nrf_ble_qwr_evt_handler_t callback;
+} nrf_ble_qwr_init_t;
+
+ret_code_t nrf_ble_qwr_init(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_init_t const * p_qwr_init);
+ret_code_t nrf_ble_qwr_attr_register(nrf_ble_qwr_t * p_qwr, uint16_t attr_handle);
+ret_code_t nrf_ble_qwr_conn_handle_assign(nrf_ble_qwr_t * p_qwr, uint16_t conn_handle);
+void       nrf_ble_qwr_on_ble_evt(ble_evt_t const * p_ble_evt, nrf_ble_qwr_t * p_qwr);
+
+#endif // NRF_BLE_QWR_H__
@@ -0,0 +1,13 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SoftDevice handler. The tests pass the BLE events to the
+ *        observers themselves.
+ */
+#ifndef NRF_SDH_BLE_H__
+#define NRF_SDH_BLE_H__
+
+#include "ble.h"
+
+#define NRF_SDH_BLE_OBSERVER(_name, _prio, _handler, _context)
+
+#endif // NRF_SDH_BLE_H__
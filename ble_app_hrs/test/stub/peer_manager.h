@@ -0,0 +1,22 @@
+/** @file
+ *
+ * @brief Host build stand-in for the Peer Manager. The tests implement the functions they use.
+ */
+#ifndef PEER_MANAGER_H__
+#define PEER_MANAGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "peer_manager_types.h"
+
+pm_peer_id_t pm_next_peer_id_get(pm_peer_id_t prev_peer_id);
+ret_code_t   pm_peer_data_load(pm_peer_id_t peer_id, pm_peer_data_id_t data_id, void * p_data, uint32_t * p_len);
+ret_code_t   pm_peer_rank_highest(pm_peer_id_t peer_id);
+ret_code_t   pm_whitelist_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt);
+ret_code_t   pm_device_identities_list_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt);
+uint32_t     pm_peer_count(void);
+ret_code_t   pm_peer_delete(pm_peer_id_t peer_id);
+ret_code_t   pm_conn_secure(uint16_t conn_handle, bool force_repairing);
+
+#endif // PEER_MANAGER_H__
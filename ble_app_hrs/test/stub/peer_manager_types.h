@@ -0,0 +1,20 @@
+/** @file
+ *
+ * @brief Host build stand-in for the Peer Manager types.
+ */
+#ifndef PEER_MANAGER_TYPES_H__
+#define PEER_MANAGER_TYPES_H__
+
+#include <stdint.h>
+
+#define PM_PEER_ID_INVALID             0xFFFF
+
+typedef uint16_t pm_peer_id_t;
+
+typedef enum
+{
+        PM_PEER_DATA_ID_BONDING,
+        PM_PEER_DATA_ID_PEER_RANK,
+} pm_peer_data_id_t;
+
+#endif // PEER_MANAGER_TYPES_H__
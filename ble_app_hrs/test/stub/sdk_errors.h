@@ -0,0 +1,24 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK error codes.
+ */
+#ifndef SDK_ERRORS_H__
+#define SDK_ERRORS_H__
+
+#include <stdint.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS                    0
+#define NRF_ERROR_NO_MEM               4
+#define NRF_ERROR_NOT_FOUND            5
+#define NRF_ERROR_NOT_SUPPORTED        6
+#define NRF_ERROR_INVALID_PARAM        7
+#define NRF_ERROR_INVALID_STATE        8
+#define NRF_ERROR_DATA_SIZE            12
+#define NRF_ERROR_NULL                 14
+#define NRF_ERROR_BUSY                 17
+#define NRF_ERROR_RESOURCES            19
+#define NRF_ERROR_STORAGE_FULL         0x8404
+
+#endif // SDK_ERRORS_H__
@@ -0,0 +1,29 @@
+/** @file
+ *
+ * @brief Host build stand-in for the SDK sensor simulator. The tests implement the functions
+ *        they use.
+ */
+#ifndef SENSORSIM_H__
+#define SENSORSIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+        uint32_t min;
+        uint32_t max;
+        uint32_t incr;
+        bool     start_at_max;
+} sensorsim_cfg_t;
+
+typedef struct
+{
+        uint32_t current_val;
+        bool     is_increasing;
+} sensorsim_state_t;
+
+void     sensorsim_init(sensorsim_state_t * p_state, sensorsim_cfg_t const * p_cfg);
+uint32_t sensorsim_measure(sensorsim_state_t * p_state, sensorsim_cfg_t const * p_cfg);
+
+#endif // SENSORSIM_H__
@@ -0,0 +1,203 @@
+/** @file
+ *
+ * @brief Host test of the battery level filter.
+ *
+ * @details Feeds the filter the battery voltage ramp of the sensor simulator the firmware uses
+ *          with BATTERY_LEVEL_SIMULATED, with and without ADC noise. Every reported level must be
+ *          at least the hysteresis away from the one before, and a level within the band must
+ *          never be reported. The test also walks one hysteresis crossing reading by reading, and
+ *          prints the notifications sent and avoided against the one notification per reading
+ *          the firmware used to send.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "battery_filter.h"
+#include "sensorsim.h"
+#include "app_util.h"
+
+#define TEST_MIN_BATTERY_VOLTAGE       2900                         /**< Minimum simulated battery voltage (in mV), as in the firmware. */
+#define TEST_MAX_BATTERY_VOLTAGE       3000                         /**< Maximum simulated battery voltage (in mV), as in the firmware. */
+#define TEST_BATTERY_VOLTAGE_INCREMENT 2                            /**< Increment between each simulated battery voltage measurement (in mV), as in the firmware. */
+#define TEST_READINGS                  1000                         /**< Readings of the ramp, 2000 s at the measurement interval of the firmware. */
+#define TEST_NOISE_MV                  3                            /**< Largest ADC noise added to the ramp (in mV). */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+static uint32_t m_rand = 1;                                         /**< State of the noise pseudo-random generator. */
+
+
+void sensorsim_init(sensorsim_state_t * p_state, sensorsim_cfg_t const * p_cfg)
+{
+        p_state->current_val   = p_cfg->start_at_max ? p_cfg->max : p_cfg->min;
+        p_state->is_increasing = !p_cfg->start_at_max;
+}
+
+
+uint32_t sensorsim_measure(sensorsim_state_t * p_state, sensorsim_cfg_t const * p_cfg)
+{
+        if (p_state->is_increasing)
+        {
+                if (p_cfg->max - p_state->current_val > p_cfg->incr)
+                {
+                        p_state->current_val += p_cfg->incr;
+                }
+                else
+                {
+                        p_state->current_val   = p_cfg->max;
+                        p_state->is_increasing = false;
+                }
+        }
+        else
+        {
+                if (p_state->current_val - p_cfg->min > p_cfg->incr)
+                {
+                        p_state->current_val -= p_cfg->incr;
+                }
+                else
+                {
+                        p_state->current_val   = p_cfg->min;
+                        p_state->is_increasing = true;
+                }
+        }
+
+        return p_state->current_val;
+}
+
+
+static int32_t noise_next(void)
+{
+        m_rand = (m_rand * 1103515245) + 12345;
+        return (int32_t)((m_rand >> 16) % ((2 * TEST_NOISE_MV) + 1)) - TEST_NOISE_MV;
+}
+
+
+static uint8_t level_diff(uint8_t a, uint8_t b)
+{
+        return (a > b) ? (a - b) : (b - a);
+}
+
+
+/**@brief Feeds one reading and checks the hysteresis.
+ *
+ * @return true if the level was reported.
+ */
+static bool reading_put(battery_filter_t * p_filter, uint16_t battery_mv)
+{
+        uint8_t  reported_was = p_filter->level_reported;
+        uint32_t avoided_was  = p_filter->avoided_cnt;
+        bool     report       = battery_filter_put(p_filter, battery_mv);
+
+        if (report)
+        {
+                CHECK(level_diff(p_filter->level_reported, reported_was) >= BATTERY_FILTER_HYSTERESIS);
+                CHECK(p_filter->level_reported == p_filter->level);
+                CHECK(p_filter->avoided_cnt == avoided_was);
+        }
+        else
+        {
+                CHECK(p_filter->level_reported == reported_was);
+                CHECK(level_diff(p_filter->level, reported_was) < BATTERY_FILTER_HYSTERESIS);
+                CHECK(p_filter->avoided_cnt == avoided_was + (p_filter->level != reported_was));
+        }
+        return report;
+}
+
+
+/**@brief Feeds the simulated ramp, plus noise if asked, and checks the notify and avoided counts. */
+static void test_ramp(bool noisy, uint32_t expected_reported, uint32_t expected_avoided)
+{
+        battery_filter_t  filter;
+        sensorsim_cfg_t   cfg;
+        sensorsim_state_t state;
+        uint32_t          report_cnt = 0;
+
+        cfg.min          = TEST_MIN_BATTERY_VOLTAGE;
+        cfg.max          = TEST_MAX_BATTERY_VOLTAGE;
+        cfg.incr         = TEST_BATTERY_VOLTAGE_INCREMENT;
+        cfg.start_at_max = true;
+        sensorsim_init(&state, &cfg);
+
+        battery_filter_init(&filter, 100);
+
+        for (uint32_t i = 0; i < TEST_READINGS; i++)
+        {
+                int32_t battery_mv = (int32_t)sensorsim_measure(&state, &cfg);
+
+                if (noisy)
+                {
+                        battery_mv += noise_next();
+                }
+                report_cnt += reading_put(&filter, (uint16_t)battery_mv);
+        }
+
+        CHECK(filter.reading_cnt == TEST_READINGS);
+        CHECK(filter.reported_cnt == report_cnt);
+        CHECK(filter.reported_cnt + filter.avoided_cnt <= filter.reading_cnt);
+
+        printf("%s ramp: %u readings, %u notifications, %u avoided\n",
+               noisy ? "noisy" : "clean",
+               (unsigned)filter.reading_cnt,
+               (unsigned)filter.reported_cnt,
+               (unsigned)filter.avoided_cnt);
+
+        CHECK(filter.reported_cnt == expected_reported);
+        CHECK(filter.avoided_cnt == expected_avoided);
+}
+
+
+/**@brief Walks the filter across one hysteresis band.
+ *
+ * @details 2998 mV is 99 %, one step off the 100 % reported: every reading is avoided. 2996 mV is
+ *          98 %: the level is reported once, as soon as the filtered voltage gets there, and noise
+ *          around it is not reported.
+ */
+static void test_hysteresis_crossing(void)
+{
+        battery_filter_t filter;
+        uint32_t         i;
+
+        battery_filter_init(&filter, 100);
+
+        CHECK(!reading_put(&filter, 3000));
+        CHECK(filter.level == 100);
+        CHECK(filter.avoided_cnt == 0);
+
+        for (i = 0; i < 20; i++)
+        {
+                CHECK(!reading_put(&filter, 2998));
+        }
+        CHECK(filter.level == 99);
+        CHECK(filter.avoided_cnt > 0);
+
+        for (i = 0; (i < 20) && !reading_put(&filter, 2996); i++)
+        {
+        }
+        CHECK(i < 20);
+        CHECK(filter.level_reported == 98);
+        CHECK(filter.reported_cnt == 1);
+
+        for (i = 0; i < 100; i++)
+        {
+                CHECK(!reading_put(&filter, (uint16_t)(2996 + (i % 3) - 1)));
+        }
+        CHECK(filter.reported_cnt == 1);
+}
+
+
+int main(void)
+{
+        test_hysteresis_crossing();
+        test_ramp(false, 480, 462);
+        test_ramp(true, 474, 415);
+
+        printf("test_battery: PASS\n");
+        return 0;
+}
@@ -0,0 +1,223 @@
+/** @file
+ *
+ * @brief Host test of the connect to encrypted statistics, with and without the early Security
+ *        Request.
+ *
+ * @details The module is built with BOND_EARLY_SEC_REQ_AB, so every other connection of a bonded
+ *          host is sent the request. Two kinds of bonded host connect in turn: one whose stack
+ *          encrypts a bonded link by itself right after connecting, and one that encrypts only
+ *          when asked, as no attribute of the application needs encryption. The time each link
+ *          takes to encrypt comes from a connection event model of the Security Request and of
+ *          the Link Layer encryption procedure, so the test checks the bookkeeping of the module
+ *          and prints what the model gives. It is not a measurement of real hosts.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bond.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TEST_CONN_INTERVAL_MS          30                           /**< Connection interval the hosts connect with (in ms). */
+#define TEST_HOST_START_EVENTS         1                            /**< Connection events before a host that encrypts by itself starts the encryption. */
+#define TEST_SEC_REQ_EVENTS            2                            /**< Connection events for the Security Request to reach the host and for the host to start the encryption. */
+#define TEST_LL_ENC_EVENTS             3                            /**< Connection events of the Link Layer encryption procedure. */
+#define TEST_LINK_MS                   60000                        /**< Time a link stays up (in ms). */
+#define TEST_ROUNDS                    10                           /**< Connections of each host kind with the request, and without. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+/**@brief Kinds of bonded host. */
+typedef enum
+{
+        TEST_HOST_SELF,                                             /**< Encrypts a bonded link by itself right after connecting. */
+        TEST_HOST_PASSIVE,                                          /**< Encrypts only when asked. */
+} test_host_t;
+
+static uint32_t m_now_ticks;                                        /**< RTC counter value of the simulated clock. */
+static uint32_t m_sec_req_cnt;                                      /**< Number of calls to pm_conn_secure(). */
+static bool     m_sec_req_sent;                                     /**< Whether the current link was sent the request. */
+
+
+uint32_t app_timer_cnt_get(void)
+{
+        return m_now_ticks;
+}
+
+
+ret_code_t pm_conn_secure(uint16_t conn_handle, bool force_repairing)
+{
+        CHECK(!force_repairing);
+
+        m_sec_req_cnt++;
+        m_sec_req_sent = true;
+        return NRF_SUCCESS;
+}
+
+
+// The bonds are not touched by the statistics.
+uint32_t     pm_peer_count(void)                                    { CHECK(false); return 0; }
+pm_peer_id_t pm_next_peer_id_get(pm_peer_id_t prev_peer_id)         { CHECK(false); return PM_PEER_ID_INVALID; }
+ret_code_t   pm_peer_delete(pm_peer_id_t peer_id)                   { CHECK(false); return NRF_SUCCESS; }
+ret_code_t   pm_peer_rank_highest(pm_peer_id_t peer_id)             { CHECK(false); return NRF_SUCCESS; }
+uint32_t     whitelist_rank_count(void)                             { CHECK(false); return 0; }
+pm_peer_id_t whitelist_rank_get(uint32_t pos)                       { CHECK(false); return PM_PEER_ID_INVALID; }
+
+
+/**@brief Function for running one link of a host.
+ *
+ * @param[in] host    Kind of the host.
+ * @param[in] bonded  Whether the host is recognised as bonded at connect.
+ *
+ * @return Time from connect to encrypted the module measured (in ms), 0 if the link was closed
+ *         unencrypted.
+ */
+static uint32_t link_run(test_host_t host, bool bonded)
+{
+        conn_ctx_t ctx;
+        uint32_t   start_events = UINT32_MAX;
+        uint32_t   enc_ms       = 0;
+
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.conn_handle     = 0;
+        ctx.connected_ticks = m_now_ticks;
+        m_sec_req_sent      = false;
+
+        if (bonded)
+        {
+                CHECK(bond_sec_request(&ctx) == NRF_SUCCESS);
+                CHECK(m_sec_req_sent == (ctx.enc_mode == BOND_ENC_EARLY));
+        }
+
+        // The encryption starts with whichever comes first, the host or the request.
+        if (host == TEST_HOST_SELF)
+        {
+                start_events = TEST_HOST_START_EVENTS;
+        }
+        if (m_sec_req_sent)
+        {
+                start_events = MIN(start_events, TEST_SEC_REQ_EVENTS);
+        }
+
+        if (bonded && (start_events != UINT32_MAX))
+        {
+                m_now_ticks += APP_TIMER_TICKS((start_events + TEST_LL_ENC_EVENTS) * TEST_CONN_INTERVAL_MS);
+                CHECK(bond_on_encrypted(&ctx, &enc_ms));
+                CHECK(!bond_on_encrypted(&ctx, &enc_ms));
+                m_now_ticks = ctx.connected_ticks + APP_TIMER_TICKS(TEST_LINK_MS);
+                CHECK(!bond_on_disconnected(&ctx));
+        }
+        else
+        {
+                m_now_ticks += APP_TIMER_TICKS(TEST_LINK_MS);
+                CHECK(bond_on_disconnected(&ctx) == bonded);
+        }
+
+        return enc_ms;
+}
+
+
+/**@brief Function for printing the statistics of the links of one kind.
+ *
+ * @param[in] p_time  Statistics of the links.
+ */
+static void time_print(bond_enc_time_t const * p_time)
+{
+        printf("%2u links encrypted, average %4u ms, %2u closed unencrypted\n",
+               (unsigned)p_time->enc_cnt,
+               (unsigned)((p_time->enc_cnt > 0) ? (p_time->enc_sum_ms / p_time->enc_cnt) : 0),
+               (unsigned)p_time->clear_cnt);
+}
+
+
+/**@brief Function for checking that a measured time is the model time, less the rounding of the
+ *        tick conversion.
+ */
+static bool enc_ms_is(uint32_t enc_ms, uint32_t events)
+{
+        uint32_t model_ms = events * TEST_CONN_INTERVAL_MS;
+
+        return (enc_ms <= model_ms) && (enc_ms + 1 >= model_ms);
+}
+
+
+/**@brief Function for running the links of one host kind, half of them with the request.
+ *
+ * @details The host connects twice in a row, so that it gets the request on one of the two
+ *          links whatever the alternation. The statistics the links add are printed.
+ *
+ * @param[in] host    Kind of the host.
+ * @param[in] p_name  Name of the host kind.
+ */
+static void host_run(test_host_t host, char const * p_name)
+{
+        bond_enc_stats_t before;
+        bond_enc_stats_t after;
+        uint32_t         sec_req_cnt = m_sec_req_cnt;
+
+        bond_enc_stats_get(&before);
+
+        for (uint32_t i = 0; i < 2 * TEST_ROUNDS; i++)
+        {
+                uint32_t cnt    = m_sec_req_cnt;
+                uint32_t enc_ms = link_run(host, true);
+
+                if (m_sec_req_cnt != cnt)
+                {
+                        uint32_t start_events = (host == TEST_HOST_SELF) ?
+                                MIN(TEST_HOST_START_EVENTS, TEST_SEC_REQ_EVENTS) : TEST_SEC_REQ_EVENTS;
+
+                        CHECK(enc_ms_is(enc_ms, start_events + TEST_LL_ENC_EVENTS));
+                }
+                else if (host == TEST_HOST_SELF)
+                {
+                        CHECK(enc_ms_is(enc_ms, TEST_HOST_START_EVENTS + TEST_LL_ENC_EVENTS));
+                }
+                else
+                {
+                        CHECK(enc_ms == 0);
+                }
+
+                // A host that has no bond is not counted.
+                link_run(host, false);
+        }
+
+        bond_enc_stats_get(&after);
+        CHECK(m_sec_req_cnt - sec_req_cnt == TEST_ROUNDS);
+        CHECK(after.early.enc_cnt - before.early.enc_cnt == TEST_ROUNDS);
+        CHECK(after.early.clear_cnt == before.early.clear_cnt);
+        CHECK(after.host.enc_cnt - before.host.enc_cnt == ((host == TEST_HOST_SELF) ? TEST_ROUNDS : 0));
+        CHECK(after.host.clear_cnt - before.host.clear_cnt == ((host == TEST_HOST_SELF) ? 0 : TEST_ROUNDS));
+
+        after.early.enc_cnt    -= before.early.enc_cnt;
+        after.early.enc_sum_ms -= before.early.enc_sum_ms;
+        after.host.enc_cnt     -= before.host.enc_cnt;
+        after.host.enc_sum_ms  -= before.host.enc_sum_ms;
+        after.host.clear_cnt   -= before.host.clear_cnt;
+
+        printf("%-28s early Security Request: ", p_name);
+        time_print(&after.early);
+        printf("%-28s left to the host:       ", p_name);
+        time_print(&after.host);
+}
+
+
+int main(void)
+{
+        printf("connection interval %d ms, request %d + encryption %d events, host start %d event\n",
+               TEST_CONN_INTERVAL_MS, TEST_SEC_REQ_EVENTS, TEST_LL_ENC_EVENTS, TEST_HOST_START_EVENTS);
+
+        host_run(TEST_HOST_SELF, "host that encrypts by itself,");
+        host_run(TEST_HOST_PASSIVE, "host that waits to be asked,");
+
+        printf("test_bond: PASS\n");
+        return 0;
+}
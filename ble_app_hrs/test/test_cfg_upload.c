@@ -0,0 +1,500 @@
+/** @file
+ *
+ * @brief Host test and benchmark of the configuration upload.
+ *
+ * @details A stub SoftDevice plays the ATT server of one link the way S132 does for an attribute
+ *          with write authorization and the value in user memory. Prepare Write Requests are
+ *          stored in the user memory block the application gives on the user memory request, as
+ *          records of handle, offset and length followed by the value, and the Execute Write
+ *          Request applies them to the value. A single Write Request is applied from the
+ *          authorization reply. The stub checks that every authorization request gets exactly
+ *          one reply, so the Configuration Service and the Queued Writes module must not both
+ *          answer the same request.
+ *
+ *          The Queued Writes module of the SDK is not part of this tree. A stand-in below follows
+ *          what nrf_ble_qwr of SDK 14.2 does with the events the stub produces.
+ *
+ *          The peer uploads a 512-byte blob once with queued writes and once in chunks of single
+ *          Write Requests, at the default and the largest ATT MTU. Every ATT request waits for
+ *          its response, so each takes one round trip of a connection interval. The test prints
+ *          the round trips and the upload time at the burst and the idle connection interval.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ble_cfgs.h"
+#include "nrf_ble_qwr.h"
+#include "sdk_config.h"
+#include "app_util.h"
+
+#define TEST_CONN_HANDLE               0                            /**< Link the uploads run on. */
+#define TEST_QWR_MEM_SIZE              1024                         /**< Queued write memory of the link, QWR_MEM_BUFF_SIZE of the application. */
+#define TEST_PREP_HDR_LEN              6                            /**< Handle, offset and length in front of every prepared value in the queued write memory. */
+#define TEST_PREP_WRITE_OVERHEAD       5                            /**< ATT opcode, handle and offset of a Prepare Write Request. */
+#define TEST_WRITE_OVERHEAD            3                            /**< ATT opcode and handle of a Write Request. */
+#define TEST_BURST_INTERVAL_MS         15                           /**< Connection interval of the burst profile a configuration upload requests. */
+#define TEST_IDLE_INTERVAL_MS          400                          /**< Connection interval of the idle profile. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+/**@brief Upload counts of one run. */
+typedef struct
+{
+        uint32_t round_trips;                                       /**< ATT requests the peer sent, each waiting for its response. */
+        uint32_t auth_cnt;                                          /**< Queued Writes authorization events of the configuration. */
+        uint32_t execute_cnt;                                       /**< Queued Writes execute events of the configuration. */
+        uint32_t written_cnt;                                       /**< Configuration Service written events. */
+} upload_t;
+
+static ble_cfgs_t    m_cfgs;                                        /**< Configuration Service under test. */
+static nrf_ble_qwr_t m_qwr;                                         /**< Queued Writes module of the link. */
+static uint8_t       m_qwr_mem[TEST_QWR_MEM_SIZE];                  /**< Queued write memory of the link. */
+static upload_t      m_upload;                                      /**< Counts of the running upload. */
+
+static uint8_t       m_sd_uuid_cnt;                                 /**< Vendor-specific UUIDs the stub SoftDevice gave out. */
+static uint16_t      m_sd_handle_cnt;                               /**< Attribute handles the stub SoftDevice gave out. */
+static uint8_t     * m_sd_value;                                    /**< User memory of the configuration value. */
+static uint16_t      m_sd_value_max_len;                            /**< Maximum length of the configuration value. */
+static uint16_t      m_sd_value_len;                                /**< Length of the configuration value. */
+static ble_user_mem_block_t const * m_sd_user_mem;                  /**< User memory block of the link, NULL until the application gave one. */
+static uint16_t      m_sd_user_mem_used;                            /**< Bytes of prepared writes in the user memory block. */
+static uint32_t      m_sd_reply_cnt;                                /**< Authorization replies to the pending request. */
+static ble_gatts_rw_authorize_reply_params_t m_sd_reply;            /**< Last authorization reply. */
+static ble_evt_t     m_evt;                                         /**< Event passed to the application. */
+
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type)
+{
+        *p_uuid_type = 2 + m_sd_uuid_cnt++;
+        return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle)
+{
+        CHECK(type == BLE_GATTS_SRVC_TYPE_PRIMARY);
+
+        *p_handle = ++m_sd_handle_cnt;
+        return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t                   service_handle,
+                                         ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const    * p_attr_char_value,
+                                         ble_gatts_char_handles_t  * p_handles)
+{
+        ble_gatts_attr_md_t const * p_attr_md = p_attr_char_value->p_attr_md;
+
+        // The value must stay with the application, and writes must be authorized.
+        CHECK(p_attr_md->vloc == BLE_GATTS_VLOC_USER);
+        CHECK(p_attr_md->wr_auth == 1);
+        CHECK(p_attr_md->vlen == 1);
+
+        m_sd_value         = p_attr_char_value->p_value;
+        m_sd_value_max_len = p_attr_char_value->max_len;
+        m_sd_value_len     = p_attr_char_value->init_len;
+
+        memset(p_handles, 0, sizeof(ble_gatts_char_handles_t));
+        m_sd_handle_cnt++;
+        p_handles->value_handle = ++m_sd_handle_cnt;
+        return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const * p_reply)
+{
+        CHECK(conn_handle == TEST_CONN_HANDLE);
+        CHECK(p_reply->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE);
+
+        m_sd_reply = *p_reply;
+        m_sd_reply_cnt++;
+        return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_user_mem_reply(uint16_t conn_handle, ble_user_mem_block_t const * p_block)
+{
+        CHECK(conn_handle == TEST_CONN_HANDLE);
+        CHECK(m_sd_user_mem == NULL);
+
+        m_sd_user_mem      = p_block;
+        m_sd_user_mem_used = 0;
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_ble_qwr_init(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_init_t const * p_qwr_init)
+{
+        memset(p_qwr, 0, sizeof(nrf_ble_qwr_t));
+        p_qwr->initialized   = 1;
+        p_qwr->conn_handle   = BLE_CONN_HANDLE_INVALID;
+        p_qwr->mem_buffer    = p_qwr_init->mem_buffer;
+        p_qwr->error_handler = p_qwr_init->error_handler;
+        p_qwr->callback      = p_qwr_init->callback;
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_ble_qwr_attr_register(nrf_ble_qwr_t * p_qwr, uint16_t attr_handle)
+{
+        if (p_qwr->nb_registered_attr == NRF_BLE_QWR_ATTR_LIST_SIZE)
+        {
+                return NRF_ERROR_NO_MEM;
+        }
+        p_qwr->attr_handles[p_qwr->nb_registered_attr++] = attr_handle;
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_ble_qwr_conn_handle_assign(nrf_ble_qwr_t * p_qwr, uint16_t conn_handle)
+{
+        p_qwr->conn_handle = conn_handle;
+        return NRF_SUCCESS;
+}
+
+
+/**@brief Stand-in of nrf_ble_qwr: replies to the authorization of the prepared and executed
+ *        writes of the registered attributes, and asks the callback on execute. */
+static void qwr_on_rw_authorize_request(nrf_ble_qwr_t * p_qwr, ble_gatts_evt_write_t const * p_write)
+{
+        ble_gatts_rw_authorize_reply_params_t auth_reply;
+        nrf_ble_qwr_evt_t                     evt;
+
+        memset(&auth_reply, 0, sizeof(auth_reply));
+        auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+
+        switch (p_write->op)
+        {
+        case BLE_GATTS_OP_PREP_WRITE_REQ:
+                break;
+
+        case BLE_GATTS_OP_EXEC_WRITE_REQ_NOW:
+                for (uint8_t i = 0; i < p_qwr->nb_registered_attr; i++)
+                {
+                        evt.evt_type    = NRF_BLE_QWR_EVT_AUTH_REQUEST;
+                        evt.attr_handle = p_qwr->attr_handles[i];
+
+                        auth_reply.params.write.gatt_status = p_qwr->callback(p_qwr, &evt);
+                        if (auth_reply.params.write.gatt_status != BLE_GATT_STATUS_SUCCESS)
+                        {
+                                break;
+                        }
+                }
+                auth_reply.params.write.update = (auth_reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+                break;
+
+        case BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL:
+                break;
+
+        default:
+                // Single writes are left to the service.
+                return;
+        }
+
+        (void)sd_ble_gatts_rw_authorize_reply(p_qwr->conn_handle, &auth_reply);
+
+        if ((p_write->op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) &&
+            (auth_reply.params.write.gatt_status == BLE_GATT_STATUS_SUCCESS))
+        {
+                for (uint8_t i = 0; i < p_qwr->nb_registered_attr; i++)
+                {
+                        evt.evt_type    = NRF_BLE_QWR_EVT_EXECUTE_WRITE;
+                        evt.attr_handle = p_qwr->attr_handles[i];
+                        (void)p_qwr->callback(p_qwr, &evt);
+                }
+        }
+}
+
+
+void nrf_ble_qwr_on_ble_evt(ble_evt_t const * p_ble_evt, nrf_ble_qwr_t * p_qwr)
+{
+        switch (p_ble_evt->header.evt_id)
+        {
+        case BLE_EVT_USER_MEM_REQUEST:
+                if (p_ble_evt->evt.common_evt.params.user_mem_request.type == BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES)
+                {
+                        (void)sd_ble_user_mem_reply(p_qwr->conn_handle, &p_qwr->mem_buffer);
+                }
+                break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+                if (p_ble_evt->evt.gatts_evt.params.authorize_request.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+                {
+                        qwr_on_rw_authorize_request(p_qwr, &p_ble_evt->evt.gatts_evt.params.authorize_request.request.write);
+                }
+                break;
+
+        default:
+                break;
+        }
+}
+
+
+/**@brief Queued Writes callback, as the application's qwr_evt_handler(). */
+static uint16_t qwr_evt_handler(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt)
+{
+        if (p_evt->attr_handle != ble_cfgs_value_handle_get(&m_cfgs))
+        {
+                return BLE_GATT_STATUS_ATTERR_APP_BEGIN + 2;
+        }
+
+        if (p_evt->evt_type == NRF_BLE_QWR_EVT_AUTH_REQUEST)
+        {
+                m_upload.auth_cnt++;
+        }
+        else
+        {
+                m_upload.execute_cnt++;
+        }
+        return BLE_GATT_STATUS_SUCCESS;
+}
+
+
+static void qwr_error_handler(uint32_t nrf_error)
+{
+        CHECK(nrf_error == NRF_SUCCESS);
+}
+
+
+static void on_cfgs_evt(ble_cfgs_t * p_cfgs, ble_cfgs_evt_t * p_evt)
+{
+        CHECK(p_evt->evt_type == BLE_CFGS_EVT_CONFIG_WRITTEN);
+        CHECK(p_evt->conn_handle == TEST_CONN_HANDLE);
+
+        m_upload.written_cnt++;
+}
+
+
+/**@brief Passes an event to the BLE observers of the application. */
+static void app_evt_send(void)
+{
+        nrf_ble_qwr_on_ble_evt(&m_evt, &m_qwr);
+        ble_cfgs_on_ble_evt(&m_evt, &m_cfgs);
+}
+
+
+/**@brief Asks the application to authorize a write and returns the reply. */
+static ble_gatts_rw_authorize_reply_params_t const * sd_authorize(uint8_t         op,
+                                                                  uint16_t        offset,
+                                                                  uint8_t const * p_data,
+                                                                  uint16_t        len)
+{
+        ble_gatts_evt_write_t * p_write = &m_evt.evt.gatts_evt.params.authorize_request.request.write;
+
+        memset(&m_evt, 0, sizeof(m_evt));
+        m_evt.header.evt_id                               = BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST;
+        m_evt.evt.gatts_evt.conn_handle                   = TEST_CONN_HANDLE;
+        m_evt.evt.gatts_evt.params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+
+        p_write->handle = (op == BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) ? 0 : ble_cfgs_value_handle_get(&m_cfgs);
+        p_write->op     = op;
+        p_write->offset = offset;
+        p_write->len    = len;
+        memcpy(p_write->data, p_data, len);
+
+        m_sd_reply_cnt = 0;
+        app_evt_send();
+        CHECK(m_sd_reply_cnt == 1);
+
+        return &m_sd_reply;
+}
+
+
+/**@brief Handles a Prepare Write Request of the peer. */
+static void att_prep_write(uint16_t offset, uint8_t const * p_data, uint16_t len)
+{
+        ble_gatts_rw_authorize_reply_params_t const * p_reply;
+        uint8_t                                     * p_record;
+
+        m_upload.round_trips++;
+
+        if (m_sd_user_mem == NULL)
+        {
+                memset(&m_evt, 0, sizeof(m_evt));
+                m_evt.header.evt_id                                    = BLE_EVT_USER_MEM_REQUEST;
+                m_evt.evt.common_evt.conn_handle                       = TEST_CONN_HANDLE;
+                m_evt.evt.common_evt.params.user_mem_request.type      = BLE_USER_MEM_TYPE_GATTS_QUEUED_WRITES;
+                app_evt_send();
+                CHECK(m_sd_user_mem != NULL);
+        }
+
+        p_reply = sd_authorize(BLE_GATTS_OP_PREP_WRITE_REQ, offset, p_data, len);
+        CHECK(p_reply->params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+
+        // The prepare queue lives in the user memory block, it must hold the whole value.
+        CHECK(m_sd_user_mem_used + TEST_PREP_HDR_LEN + len <= m_sd_user_mem->len);
+
+        p_record = &m_sd_user_mem->p_mem[m_sd_user_mem_used];
+        (void)uint16_encode(ble_cfgs_value_handle_get(&m_cfgs), &p_record[0]);
+        (void)uint16_encode(offset, &p_record[2]);
+        (void)uint16_encode(len, &p_record[4]);
+        memcpy(&p_record[TEST_PREP_HDR_LEN], p_data, len);
+        m_sd_user_mem_used += TEST_PREP_HDR_LEN + len;
+}
+
+
+/**@brief Handles an Execute Write Request of the peer: applies the prepared writes if authorized. */
+static void att_exec_write(void)
+{
+        ble_gatts_rw_authorize_reply_params_t const * p_reply;
+        uint16_t                                      pos = 0;
+
+        m_upload.round_trips++;
+
+        p_reply = sd_authorize(BLE_GATTS_OP_EXEC_WRITE_REQ_NOW, 0, NULL, 0);
+        CHECK(p_reply->params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+        CHECK(p_reply->params.write.update == 1);
+
+        while (pos < m_sd_user_mem_used)
+        {
+                uint8_t const * p_record = &m_sd_user_mem->p_mem[pos];
+                uint16_t        offset   = (uint16_t)(p_record[2] | (p_record[3] << 8));
+                uint16_t        len      = (uint16_t)(p_record[4] | (p_record[5] << 8));
+
+                CHECK(offset + len <= m_sd_value_max_len);
+                memcpy(&m_sd_value[offset], &p_record[TEST_PREP_HDR_LEN], len);
+                m_sd_value_len = MAX(m_sd_value_len, offset + len);
+                pos += TEST_PREP_HDR_LEN + len;
+        }
+
+        m_sd_user_mem      = NULL;
+        m_sd_user_mem_used = 0;
+}
+
+
+/**@brief Handles a Write Request of the peer: applies the value if authorized. */
+static void att_write(uint8_t const * p_data, uint16_t len)
+{
+        ble_gatts_rw_authorize_reply_params_t const * p_reply;
+
+        m_upload.round_trips++;
+
+        p_reply = sd_authorize(BLE_GATTS_OP_WRITE_REQ, 0, p_data, len);
+        CHECK(p_reply->params.write.gatt_status == BLE_GATT_STATUS_SUCCESS);
+        CHECK(p_reply->params.write.update == 1);
+        CHECK(p_reply->params.write.len == len);
+
+        memcpy(&m_sd_value[p_reply->params.write.offset], p_reply->params.write.p_data, len);
+        m_sd_value_len = len;
+}
+
+
+/**@brief Prints the round trips of an upload and its time at the burst and idle intervals. */
+static void upload_print(char const * p_name, uint16_t mtu)
+{
+        printf("MTU %3u, %-15s %2u round trips, %5u ms at %u ms, %5u ms at %u ms\n",
+               (unsigned)mtu,
+               p_name,
+               (unsigned)m_upload.round_trips,
+               (unsigned)(m_upload.round_trips * TEST_BURST_INTERVAL_MS),
+               (unsigned)TEST_BURST_INTERVAL_MS,
+               (unsigned)(m_upload.round_trips * TEST_IDLE_INTERVAL_MS),
+               (unsigned)TEST_IDLE_INTERVAL_MS);
+}
+
+
+/**@brief Uploads the blob with one queued write and checks that it arrived whole. */
+static uint32_t test_queued_write(uint8_t const * p_blob, uint16_t mtu)
+{
+        uint16_t chunk = mtu - TEST_PREP_WRITE_OVERHEAD;
+
+        memset(&m_upload, 0, sizeof(m_upload));
+        memset(m_sd_value, 0, m_sd_value_max_len);
+
+        for (uint16_t offset = 0; offset < BLE_CFGS_MAX_LEN; offset += chunk)
+        {
+                att_prep_write(offset, &p_blob[offset], MIN(chunk, BLE_CFGS_MAX_LEN - offset));
+        }
+        att_exec_write();
+
+        CHECK(m_sd_value_len == BLE_CFGS_MAX_LEN);
+        CHECK(memcmp(m_cfgs.config, p_blob, BLE_CFGS_MAX_LEN) == 0);
+        CHECK(m_upload.round_trips == (uint32_t)CEIL_DIV(BLE_CFGS_MAX_LEN, chunk) + 1);
+        CHECK(m_upload.auth_cnt == 1);
+        CHECK(m_upload.execute_cnt == 1);
+        CHECK(m_upload.written_cnt == 0);
+
+        upload_print("queued write:", mtu);
+        return m_upload.round_trips;
+}
+
+
+/**@brief Uploads the blob in chunks of single Write Requests, as hosts did before queued
+ *        writes. Each Write Request replaces the value, so the application would have to put the
+ *        chunks together itself; only the round trips are compared. */
+static uint32_t test_chunked_writes(uint8_t const * p_blob, uint16_t mtu)
+{
+        uint16_t chunk = mtu - TEST_WRITE_OVERHEAD;
+
+        memset(&m_upload, 0, sizeof(m_upload));
+
+        for (uint16_t offset = 0; offset < BLE_CFGS_MAX_LEN; offset += chunk)
+        {
+                uint16_t len = MIN(chunk, BLE_CFGS_MAX_LEN - offset);
+
+                att_write(&p_blob[offset], len);
+                CHECK(memcmp(m_cfgs.config, &p_blob[offset], len) == 0);
+        }
+
+        CHECK(m_upload.round_trips == (uint32_t)CEIL_DIV(BLE_CFGS_MAX_LEN, chunk));
+        CHECK(m_upload.written_cnt == m_upload.round_trips);
+        CHECK(m_upload.auth_cnt == 0);
+
+        upload_print("chunked writes:", mtu);
+        return m_upload.round_trips;
+}
+
+
+int main(void)
+{
+        static const uint16_t mtus[] = {BLE_GATT_ATT_MTU_DEFAULT, NRF_SDH_BLE_GATT_MAX_MTU_SIZE};
+        ble_cfgs_init_t    cfgs_init;
+        nrf_ble_qwr_init_t qwr_init;
+        uint8_t            blob[BLE_CFGS_MAX_LEN];
+
+        for (uint32_t i = 0; i < sizeof(blob); i++)
+        {
+                blob[i] = (uint8_t)((i * 7) + (i >> 8));
+        }
+
+        memset(&cfgs_init, 0, sizeof(cfgs_init));
+        cfgs_init.evt_handler = on_cfgs_evt;
+        CHECK(ble_cfgs_init(&m_cfgs, &cfgs_init) == NRF_SUCCESS);
+        CHECK(m_sd_value == m_cfgs.config);
+        CHECK(m_sd_value_max_len == BLE_CFGS_MAX_LEN);
+
+        memset(&qwr_init, 0, sizeof(qwr_init));
+        qwr_init.error_handler    = qwr_error_handler;
+        qwr_init.mem_buffer.p_mem = m_qwr_mem;
+        qwr_init.mem_buffer.len   = sizeof(m_qwr_mem);
+        qwr_init.callback         = qwr_evt_handler;
+        CHECK(nrf_ble_qwr_init(&m_qwr, &qwr_init) == NRF_SUCCESS);
+        CHECK(nrf_ble_qwr_attr_register(&m_qwr, ble_cfgs_value_handle_get(&m_cfgs)) == NRF_SUCCESS);
+        CHECK(nrf_ble_qwr_conn_handle_assign(&m_qwr, TEST_CONN_HANDLE) == NRF_SUCCESS);
+
+        for (uint32_t i = 0; i < ARRAY_SIZE(mtus); i++)
+        {
+                uint32_t queued  = test_queued_write(blob, mtus[i]);
+                uint32_t chunked = test_chunked_writes(blob, mtus[i]);
+
+                // Prepare writes carry two bytes less than Write Requests and need the Execute
+                // Write Request on top, so queued writes never take fewer round trips.
+                CHECK(queued > chunked);
+                printf("MTU %3u: extra round trips of the queued write: %u\n",
+                       (unsigned)mtus[i],
+                       (unsigned)(queued - chunked));
+        }
+
+        printf("test_cfg_upload: PASS\n");
+        return 0;
+}
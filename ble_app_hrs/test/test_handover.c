@@ -0,0 +1,322 @@
+/** @file
+ *
+ * @brief Host simulation of a stream handover between two centrals.
+ *
+ * @details Host A has been receiving measurements from the start. Host B connects and bonds,
+ *          then enables notifications some seconds later. Measurements are fanned out through the
+ *          real TX queues to every subscribed link, as hrm_fan_out() does. The stub SoftDevice
+ *          transmits what it holds for a link at every connection event of the link, and loses
+ *          it when the link is disconnected.
+ *
+ *          The gapless handover waits for host B's subscription, merges host A's queue into host
+ *          B's and then disconnects host A. The immediate handover disconnects host A when host B
+ *          bonds, as the application did before. The test records every sample that reached
+ *          either host on air and reports the longest run of samples neither host received.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hrm_tx_queue.h"
+#include "ble.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TEST_VALUE_HANDLE              0x0010                       /**< Heart Rate Measurement value handle given to the queues. */
+#define TEST_HOST_A                    0                            /**< Link of host A. */
+#define TEST_HOST_B                    1                            /**< Link of host B. */
+#define TEST_STEP_MS                   250                          /**< Simulation step. */
+#define TEST_SAMPLE_MS                 1000                         /**< Heart rate measurement interval. */
+#define TEST_SAMPLES                   40                           /**< Samples taken per run. */
+#define TEST_B_BONDED_MS               10000                        /**< Time host B bonds. */
+#define TEST_A_BUSY_MS                 17000                        /**< Time host A's link stops taking notifications, e.g. while another stream uses the slots. */
+#define TEST_B_SUBSCRIBED_MS           19500                        /**< Time host B enables notifications. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+/**@brief Link as seen by the stub SoftDevice. */
+typedef struct
+{
+        bool     connected;                                         /**< Whether the link is up. */
+        bool     subscribed;                                        /**< Whether the measurements are fanned out to the link. */
+        bool     busy;                                              /**< Whether the SoftDevice refuses notifications on the link. */
+        uint32_t event_ms;                                          /**< Connection interval of the link. */
+        uint32_t held;                                              /**< Notifications the SoftDevice holds. */
+        uint32_t held_seq[HVN_TX_QUEUE_SIZE];                       /**< Samples of the held notifications, oldest first. */
+        int32_t  last_air_seq;                                      /**< Newest sample transmitted on the link, -1 if none. */
+} link_t;
+
+static link_t m_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];                /**< Simulated links. */
+static bool   m_on_air[TEST_SAMPLES];                               /**< Samples either host received. */
+
+
+static uint32_t seq_to_ticks(uint32_t seq)
+{
+        return APP_TIMER_TICKS(seq * TEST_SAMPLE_MS);
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+        link_t * p_link = &m_links[conn_handle];
+        uint32_t seq;
+
+        CHECK(p_hvx_params->handle == TEST_VALUE_HANDLE);
+
+        if (!p_link->connected)
+        {
+                return BLE_ERROR_INVALID_CONN_HANDLE;
+        }
+        if (p_link->busy || (p_link->held == HVN_TX_QUEUE_SIZE))
+        {
+                return NRF_ERROR_RESOURCES;
+        }
+
+        memcpy(&seq, &p_hvx_params->p_data[1], sizeof(seq));
+        p_link->held_seq[p_link->held++] = seq;
+        return NRF_SUCCESS;
+}
+
+
+/**@brief Follows the measurements on air, checking that each host receives them in order. */
+static void on_air(uint16_t conn_handle, uint32_t sample_ticks)
+{
+        link_t * p_link = &m_links[conn_handle];
+        uint32_t seq    = p_link->held_seq[0];
+
+        CHECK(sample_ticks == seq_to_ticks(seq));
+        CHECK((int32_t)seq > p_link->last_air_seq);
+
+        p_link->last_air_seq = (int32_t)seq;
+        m_on_air[seq]        = true;
+        p_link->held--;
+        memmove(p_link->held_seq, &p_link->held_seq[1], p_link->held * sizeof(uint32_t));
+}
+
+
+static void link_connect(uint16_t conn_handle, uint32_t event_ms)
+{
+        memset(&m_links[conn_handle], 0, sizeof(link_t));
+        m_links[conn_handle].connected    = true;
+        m_links[conn_handle].event_ms     = event_ms;
+        m_links[conn_handle].last_air_seq = -1;
+        hrm_tx_queue_reset(hrm_tx_queue_get(conn_handle), conn_handle);
+}
+
+
+static void link_disconnect(uint16_t conn_handle)
+{
+        // Whatever the SoftDevice still holds for the link is lost.
+        m_links[conn_handle].connected  = false;
+        m_links[conn_handle].subscribed = false;
+        m_links[conn_handle].held       = 0;
+        hrm_tx_queue_reset(hrm_tx_queue_get(conn_handle), BLE_CONN_HANDLE_INVALID);
+}
+
+
+static void packet_make(hrm_packet_t * p_packet, uint32_t seq)
+{
+        memset(p_packet, 0, sizeof(hrm_packet_t));
+        memcpy(&p_packet->data[1], &seq, sizeof(seq));
+        p_packet->len          = 1 + sizeof(seq);
+        p_packet->sample_ticks = seq_to_ticks(seq);
+}
+
+
+/**@brief Returns the longest run of samples neither host received, after the first one received. */
+static uint32_t gap_get(void)
+{
+        uint32_t gap = 0;
+        uint32_t run = 0;
+        uint32_t seq = 0;
+
+        while ((seq < TEST_SAMPLES) && !m_on_air[seq])
+        {
+                seq++;
+        }
+        for (; seq < TEST_SAMPLES; seq++)
+        {
+                run = m_on_air[seq] ? 0 : run + 1;
+                gap = MAX(gap, run);
+        }
+
+        return gap;
+}
+
+
+/**@brief Runs a handover.
+ *
+ * @param[in]  gapless   Whether host A is kept until host B has subscribed.
+ * @param[out] p_merge   Result of merging host A's queue, zero if it was not merged.
+ *
+ * @return Longest run of samples neither host received.
+ */
+static uint32_t run(bool gapless, hrm_tx_queue_merge_result_t * p_merge)
+{
+        hrm_packet_t packet;
+        bool         handed_over = false;
+
+        memset(m_on_air, 0, sizeof(m_on_air));
+        memset(p_merge, 0, sizeof(hrm_tx_queue_merge_result_t));
+
+        link_connect(TEST_HOST_A, 1000);
+        m_links[TEST_HOST_A].subscribed = true;
+
+        for (uint32_t now_ms = 0; now_ms < TEST_SAMPLES * TEST_SAMPLE_MS; now_ms += TEST_STEP_MS)
+        {
+                if (now_ms == TEST_B_BONDED_MS)
+                {
+                        link_connect(TEST_HOST_B, 500);
+                        if (!gapless)
+                        {
+                                link_disconnect(TEST_HOST_A);
+                                handed_over = true;
+                        }
+                }
+                if (now_ms == TEST_A_BUSY_MS)
+                {
+                        m_links[TEST_HOST_A].busy = true;
+                }
+                if (now_ms == TEST_B_SUBSCRIBED_MS)
+                {
+                        m_links[TEST_HOST_B].subscribed = true;
+                        if (!handed_over)
+                        {
+                                // Host A gets nothing more, its queue goes to host B.
+                                m_links[TEST_HOST_A].subscribed = false;
+                                hrm_tx_queue_merge(hrm_tx_queue_get(TEST_HOST_B), hrm_tx_queue_get(TEST_HOST_A), p_merge);
+                                CHECK(hrm_tx_queue_drain(hrm_tx_queue_get(TEST_HOST_B)) == NRF_SUCCESS);
+                                link_disconnect(TEST_HOST_A);
+                                handed_over = true;
+                        }
+                }
+
+                if ((now_ms % TEST_SAMPLE_MS) == 0)
+                {
+                        packet_make(&packet, now_ms / TEST_SAMPLE_MS);
+                        for (uint16_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+                        {
+                                if (m_links[i].subscribed)
+                                {
+                                        CHECK(hrm_tx_queue_put(hrm_tx_queue_get(i), &packet) == NRF_SUCCESS);
+                                }
+                        }
+                }
+
+                for (uint16_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+                {
+                        if (m_links[i].connected && (m_links[i].held > 0) && ((now_ms % m_links[i].event_ms) == 0))
+                        {
+                                CHECK(hrm_tx_queue_on_tx_complete(hrm_tx_queue_get(i),
+                                                                  (uint8_t)m_links[i].held,
+                                                                  APP_TIMER_TICKS(now_ms)) == NRF_SUCCESS);
+                        }
+                }
+        }
+
+        link_disconnect(TEST_HOST_B);
+
+        return gap_get();
+}
+
+
+/**@brief Checks that a merge keeps the other queue in sample order and counts what it drops. */
+static void test_merge(void)
+{
+        hrm_tx_queue_t            * p_dst = hrm_tx_queue_get(TEST_HOST_B);
+        hrm_tx_queue_t            * p_src = hrm_tx_queue_get(TEST_HOST_A);
+        hrm_tx_queue_merge_result_t merge;
+        hrm_packet_t                packet;
+
+        link_connect(TEST_HOST_A, 1000);
+        link_connect(TEST_HOST_B, 1000);
+        m_links[TEST_HOST_A].busy = true;
+        m_links[TEST_HOST_B].busy = true;
+
+        // Host B has every other sample from 4 on, host A has samples 0 to 9.
+        for (uint32_t seq = 0; seq < 10; seq++)
+        {
+                packet_make(&packet, seq);
+                CHECK(hrm_tx_queue_put(p_src, &packet) == NRF_SUCCESS);
+        }
+        for (uint32_t seq = 4; seq < 12; seq += 2)
+        {
+                packet_make(&packet, seq);
+                CHECK(hrm_tx_queue_put(p_dst, &packet) == NRF_SUCCESS);
+        }
+        CHECK(p_src->count == HRM_TX_QUEUE_SIZE);
+        CHECK(p_src->dropped_cnt == 2);
+
+        // Host A's queue holds 2 to 9: 4, 6 and 8 are skipped, 3, 5, 7 and 9 are merged and push
+        // out 2, the oldest, from host B's full queue.
+        hrm_tx_queue_merge(p_dst, p_src, &merge);
+
+        CHECK(p_src->count == 0);
+        CHECK(p_src->handed_over_cnt == HRM_TX_QUEUE_SIZE);
+        CHECK(merge.skipped_cnt == 3);
+        CHECK(merge.moved_cnt == 5);
+        CHECK(merge.dropped_cnt == 1);
+        CHECK(p_dst->count == HRM_TX_QUEUE_SIZE);
+        CHECK(p_dst->queued_cnt == p_dst->sent_cnt + p_dst->dropped_cnt + p_dst->count);
+
+        for (uint8_t i = 0; i < p_dst->count; i++)
+        {
+                uint32_t seq;
+
+                memcpy(&seq, &p_dst->packets[(p_dst->head + i) % HRM_TX_QUEUE_SIZE].data[1], sizeof(seq));
+                CHECK(seq == 3u + i);
+        }
+
+        // What host B was sent already is not merged again.
+        m_links[TEST_HOST_B].busy = false;
+        p_dst->credits            = HVN_TX_QUEUE_SIZE;
+        CHECK(hrm_tx_queue_drain(p_dst) == NRF_SUCCESS);
+        CHECK(p_dst->sent_cnt == HRM_TX_QUEUE_SIZE);
+        for (uint32_t seq = 9; seq < 12; seq++)
+        {
+                packet_make(&packet, seq);
+                CHECK(hrm_tx_queue_put(p_src, &packet) == NRF_SUCCESS);
+        }
+        hrm_tx_queue_merge(p_dst, p_src, &merge);
+        CHECK(merge.skipped_cnt == 2);
+        CHECK(merge.moved_cnt == 1);
+        CHECK(merge.dropped_cnt == 0);
+
+        link_disconnect(TEST_HOST_A);
+        link_disconnect(TEST_HOST_B);
+}
+
+
+int main(void)
+{
+        hrm_tx_queue_merge_result_t merge;
+        uint32_t                    gap;
+
+        hrm_tx_queue_init(TEST_VALUE_HANDLE, on_air);
+
+        test_merge();
+
+        gap = run(false, &merge);
+        printf("immediate handover: %u samples missed\n", (unsigned)gap);
+        CHECK(gap == CEIL_DIV(TEST_B_SUBSCRIBED_MS - TEST_B_BONDED_MS, TEST_SAMPLE_MS));
+
+        gap = run(true, &merge);
+        printf("gapless handover: %u samples missed, %u moved, %u already there, %u dropped\n",
+               (unsigned)gap,
+               (unsigned)merge.moved_cnt,
+               (unsigned)merge.skipped_cnt,
+               (unsigned)merge.dropped_cnt);
+        CHECK(gap == 0);
+        CHECK(merge.moved_cnt == CEIL_DIV(TEST_B_SUBSCRIBED_MS - TEST_A_BUSY_MS, TEST_SAMPLE_MS));
+        CHECK(merge.dropped_cnt == 0);
+
+        printf("test_handover: PASS\n");
+        return 0;
+}
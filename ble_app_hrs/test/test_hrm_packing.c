@@ -0,0 +1,130 @@
+/** @file
+ *
+ * @brief Host benchmark of the Heart Rate Measurement packing.
+ *
+ * @details Feeds RR intervals at a fixed rate into the ring, encodes one measurement per second
+ *          for the ATT payload of the link, as hrm_fan_out() does, and estimates the bytes on air
+ *          with the same model the firmware counts in air_bytes_cnt. Prints bytes on air per RR
+ *          interval and RR intervals lost for the default and the largest ATT MTU and Link Layer
+ *          payload. Link Layer retransmissions and empty PDUs are not modelled.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hrm_tx_queue.h"
+#include "ble.h"
+
+#define TEST_SECONDS                   600                          /**< Simulated time per case. */
+#define TEST_HEART_RATE                72                           /**< Heart rate encoded in every measurement. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+/**@brief Result of one case. */
+typedef struct
+{
+        uint32_t rr_pushed;                                         /**< RR intervals produced. */
+        uint32_t rr_sent;                                           /**< RR intervals packed into measurements. */
+        uint32_t rr_lost;                                           /**< RR intervals dropped because the ring was full. */
+        uint32_t air_bytes;                                         /**< Estimated bytes on air. */
+        uint32_t pdu_cnt;                                           /**< Link Layer PDUs sent. */
+} result_t;
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+        // The benchmark only encodes, it never drains a queue.
+        (void)conn_handle;
+        (void)p_hvx_params;
+        return NRF_ERROR_INVALID_STATE;
+}
+
+
+/**@brief Runs one case.
+ *
+ * @param[in] att_mtu         Effective ATT MTU of the link.
+ * @param[in] ll_payload_len  Link Layer PDU payload length of the link.
+ * @param[in] rr_per_second   RR intervals produced per second.
+ */
+static result_t run(uint16_t att_mtu, uint8_t ll_payload_len, uint32_t rr_per_second)
+{
+        static rr_ring_t ring;
+        hrm_tx_queue_t   link;
+        hrm_packet_t     packet;
+        result_t         result = {0};
+        uint16_t         rr_interval;
+
+        rr_ring_init(&ring);
+        hrm_tx_queue_reset(&link, 0);
+        link.ll_payload_len = ll_payload_len;
+
+        for (uint32_t second = 0; second < TEST_SECONDS; second++)
+        {
+                for (uint32_t i = 0; i < rr_per_second; i++)
+                {
+                        (void)rr_ring_push(&ring, (uint16_t)(1024 * 60 / TEST_HEART_RATE));
+                        result.rr_pushed++;
+                }
+
+                hrm_tx_queue_encode(TEST_HEART_RATE,
+                                    HRM_FLAG_MASK_SENSOR_CONTACT_SUPPORTED,
+                                    &ring,
+                                    att_mtu - 3,
+                                    &packet);
+
+                CHECK(packet.len <= att_mtu - 3);
+                CHECK(packet.len == 2 + 2 * packet.rr_cnt);
+
+                result.rr_sent   += packet.rr_cnt;
+                result.air_bytes += hrm_tx_queue_air_bytes_get(&link, packet.len);
+                result.pdu_cnt   += (packet.len + 7 + ll_payload_len - 1) / ll_payload_len;
+        }
+
+        result.rr_lost = ring.overflow_cnt;
+
+        // Every RR interval was sent, dropped or is still waiting in the ring.
+        uint32_t left = 0;
+        while (rr_ring_pop(&ring, &rr_interval))
+        {
+                left++;
+        }
+        CHECK(result.rr_pushed == result.rr_sent + result.rr_lost + left);
+
+        printf("MTU %3u, LL %3u, %2u RR/s: %6.2f bytes on air per RR, %4.2f PDUs per measurement, %5.1f %% RR lost\n",
+               att_mtu,
+               ll_payload_len,
+               (unsigned)rr_per_second,
+               (double)result.air_bytes / result.rr_sent,
+               (double)result.pdu_cnt / TEST_SECONDS,
+               (100.0 * result.rr_lost) / result.rr_pushed);
+
+        return result;
+}
+
+
+int main(void)
+{
+        static const uint32_t rr_rates[] = {1, 3, 20};
+
+        for (uint32_t i = 0; i < sizeof(rr_rates) / sizeof(rr_rates[0]); i++)
+        {
+                uint32_t rate   = rr_rates[i];
+                result_t legacy = run(BLE_GATT_ATT_MTU_DEFAULT, LL_DEFAULT_PAYLOAD_LEN, rate);
+                result_t mtu    = run(NRF_SDH_BLE_GATT_MAX_MTU_SIZE, LL_DEFAULT_PAYLOAD_LEN, rate);
+                result_t dle    = run(NRF_SDH_BLE_GATT_MAX_MTU_SIZE, NRF_SDH_BLE_GATT_MAX_MTU_SIZE + 4, rate);
+
+                // A larger payload never loses more and never costs more per RR interval.
+                CHECK(mtu.rr_lost <= legacy.rr_lost);
+                CHECK((uint64_t)dle.air_bytes * legacy.rr_sent <= (uint64_t)legacy.air_bytes * dle.rr_sent);
+                CHECK(dle.rr_lost == 0);
+        }
+
+        printf("test_hrm_packing: PASS\n");
+        return 0;
+}
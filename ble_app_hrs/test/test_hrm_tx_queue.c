@@ -0,0 +1,331 @@
+/** @file
+ *
+ * @brief Host test of the Heart Rate Measurement TX queue.
+ *
+ * @details Replays bursts of measurements and TX complete events against a stub SoftDevice that
+ *          holds at most @ref HVN_TX_QUEUE_SIZE notifications per link, the way S132 does with the
+ *          hvn_tx_queue_size the application configures. Other notifications take credits in
+ *          between, as the waveform stream does, or take SoftDevice slots without a credit, as the
+ *          Battery Level does. The stub records every measurement it accepts, so the test checks
+ *          that each one is either transmitted in order or counted as dropped.
+ *
+ *          A first replay stays within the capacity of the queue: the host skips a bounded number
+ *          of connection events, and nothing may be dropped. A second replay overloads the link,
+ *          where the queue deliberately drops its oldest measurements to keep the freshest heart
+ *          rate, and checks that every drop is counted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hrm_tx_queue.h"
+#include "app_util.h"
+#include "ble.h"
+#include "app_timer.h"
+
+#define TEST_VALUE_HANDLE              0x0010                       /**< Heart Rate Measurement value handle given to the queues. */
+#define TEST_CONN_HANDLE               1                            /**< Link the replay runs on. */
+#define TEST_STEPS                     20000                        /**< Number of replay steps. */
+#define TEST_BURST_MAX                 4                            /**< Most measurements queued between two connection events. */
+#define TEST_SKIPPED_EVENTS_MAX        2                            /**< Most connection events in a row the host skips in the replay within capacity. */
+
+STATIC_ASSERT((TEST_SKIPPED_EVENTS_MAX + 1) * (TEST_BURST_MAX + 1) <= HVN_TX_QUEUE_SIZE + HRM_TX_QUEUE_SIZE);
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+static uint32_t m_sd_held;                                          /**< Notifications the stub SoftDevice holds. */
+static uint32_t m_sd_err_code = NRF_SUCCESS;                        /**< Error the stub SoftDevice returns instead of accepting a notification. */
+static uint32_t m_sd_next_seq;                                      /**< Sequence number of the next measurement expected on air. */
+static uint32_t m_sd_hrm_cnt;                                       /**< Number of measurements the stub SoftDevice accepted. */
+static uint32_t m_rand = 1;                                         /**< State of the replay pseudo-random generator. */
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+        uint32_t seq;
+
+        CHECK(conn_handle == TEST_CONN_HANDLE);
+        CHECK(p_hvx_params->handle == TEST_VALUE_HANDLE);
+        CHECK(p_hvx_params->type == BLE_GATT_HVX_NOTIFICATION);
+
+        if (m_sd_err_code != NRF_SUCCESS)
+        {
+                return m_sd_err_code;
+        }
+        if (m_sd_held == HVN_TX_QUEUE_SIZE)
+        {
+                return NRF_ERROR_RESOURCES;
+        }
+
+        // Measurements leave the queue in order, drops only skip sequence numbers.
+        memcpy(&seq, &p_hvx_params->p_data[1], sizeof(seq));
+        CHECK(seq >= m_sd_next_seq);
+        m_sd_next_seq = seq + 1;
+
+        m_sd_held++;
+        m_sd_hrm_cnt++;
+        return NRF_SUCCESS;
+}
+
+
+static uint32_t rand_next(uint32_t range)
+{
+        m_rand = (m_rand * 1103515245) + 12345;
+        return (m_rand >> 16) % range;
+}
+
+
+static void packet_make(hrm_packet_t * p_packet, uint32_t seq)
+{
+        memset(p_packet, 0, sizeof(hrm_packet_t));
+        p_packet->data[0]      = 0;
+        memcpy(&p_packet->data[1], &seq, sizeof(seq));
+        p_packet->len          = 1 + sizeof(seq);
+        p_packet->sample_ticks = seq * APP_TIMER_TICKS(1000);
+}
+
+
+static void queue_check(hrm_tx_queue_t const * p_queue)
+{
+        CHECK(p_queue->queued_cnt == p_queue->sent_cnt + p_queue->dropped_cnt + p_queue->handed_over_cnt + p_queue->count);
+        CHECK(p_queue->sent_cnt == m_sd_hrm_cnt);
+        CHECK(p_queue->credits <= HVN_TX_QUEUE_SIZE);
+        CHECK(p_queue->inflight_cnt <= HVN_TX_QUEUE_SIZE);
+}
+
+
+static void sd_reset(void)
+{
+        m_sd_held     = 0;
+        m_sd_hrm_cnt  = 0;
+        m_sd_next_seq = 0;
+}
+
+
+/**@brief Lets the SoftDevice transmit everything and checks that the queue is empty. */
+static void queue_finish(hrm_tx_queue_t * p_queue, uint32_t seq)
+{
+        while (m_sd_held > 0)
+        {
+                uint8_t count = (uint8_t)m_sd_held;
+
+                m_sd_held = 0;
+                CHECK(hrm_tx_queue_on_tx_complete(p_queue, count, seq * APP_TIMER_TICKS(1000)) == NRF_SUCCESS);
+        }
+        queue_check(p_queue);
+
+        CHECK(p_queue->count == 0);
+        CHECK(p_queue->inflight_cnt == 0);
+        CHECK(p_queue->credits == HVN_TX_QUEUE_SIZE);
+}
+
+
+/**@brief Replays bursty traffic the link can carry and checks that nothing is dropped.
+ *
+ * @details Between two connection events up to @ref TEST_BURST_MAX measurements are queued, and
+ *          a waveform batch or a Battery Level notification may take a slot. The host skips up to
+ *          @ref TEST_SKIPPED_EVENTS_MAX connection events in a row. The event the host attends is
+ *          long enough for everything held and queued.
+ */
+static void test_replay_within_capacity(void)
+{
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(TEST_CONN_HANDLE);
+        hrm_packet_t     packet;
+        uint32_t         seq     = 0;
+        uint32_t         skipped = 0;
+
+        hrm_tx_queue_reset(p_queue, TEST_CONN_HANDLE);
+        sd_reset();
+
+        for (uint32_t step = 0; step < TEST_STEPS; step++)
+        {
+                uint32_t burst = 1 + rand_next(TEST_BURST_MAX);
+                uint32_t other = rand_next(4);
+
+                for (uint32_t i = 0; i < burst; i++)
+                {
+                        packet_make(&packet, seq++);
+                        CHECK(hrm_tx_queue_put(p_queue, &packet) == NRF_SUCCESS);
+                }
+
+                if ((other == 0) && (p_queue->count == 0) && (p_queue->credits > 0) && (m_sd_held < HVN_TX_QUEUE_SIZE))
+                {
+                        p_queue->credits--;
+                        m_sd_held++;
+                        hrm_tx_queue_inflight_push(p_queue, false, 0);
+                }
+                else if ((other == 1) && (m_sd_held < HVN_TX_QUEUE_SIZE))
+                {
+                        m_sd_held++;
+                }
+
+                if ((skipped < TEST_SKIPPED_EVENTS_MAX) && (rand_next(2) == 0))
+                {
+                        skipped++;
+                }
+                else
+                {
+                        skipped = 0;
+                        queue_finish(p_queue, seq);
+                }
+                queue_check(p_queue);
+                CHECK(p_queue->dropped_cnt == 0);
+        }
+        queue_finish(p_queue, seq);
+
+        CHECK(p_queue->dropped_cnt == 0);
+        CHECK(p_queue->sent_cnt == p_queue->queued_cnt);
+        CHECK(p_queue->busy_cnt > 0);
+
+        printf("replay within capacity: %u queued, %u sent, %u dropped, %u busy\n",
+               (unsigned)p_queue->queued_cnt,
+               (unsigned)p_queue->sent_cnt,
+               (unsigned)p_queue->dropped_cnt,
+               (unsigned)p_queue->busy_cnt);
+}
+
+
+/**@brief Replays more traffic than the link can carry and checks that nothing is lost without
+ *        being counted, and that only the oldest measurements are dropped.
+ */
+static void test_replay_overload(void)
+{
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(TEST_CONN_HANDLE);
+        hrm_packet_t     packet;
+        uint32_t         seq = 0;
+        uint32_t         drops_while_room = 0;
+
+        hrm_tx_queue_reset(p_queue, TEST_CONN_HANDLE);
+        sd_reset();
+
+        for (uint32_t step = 0; step < TEST_STEPS; step++)
+        {
+                uint32_t action = rand_next(10);
+
+                if (action < 4)
+                {
+                        // Burst of measurements, e.g. after the host skipped connection events.
+                        uint32_t burst       = 1 + rand_next(TEST_BURST_MAX);
+                        uint32_t dropped_was = p_queue->dropped_cnt;
+                        uint32_t room        = HRM_TX_QUEUE_SIZE - p_queue->count;
+
+                        for (uint32_t i = 0; i < burst; i++)
+                        {
+                                packet_make(&packet, seq++);
+                                CHECK(hrm_tx_queue_put(p_queue, &packet) == NRF_SUCCESS);
+                        }
+                        if ((burst <= room) && (p_queue->dropped_cnt != dropped_was))
+                        {
+                                drops_while_room++;
+                        }
+                }
+                else if (action < 5)
+                {
+                        // A waveform batch takes a credit, like wfs_batch_send() does.
+                        if ((p_queue->count == 0) && (p_queue->credits > 0) && (m_sd_held < HVN_TX_QUEUE_SIZE))
+                        {
+                                p_queue->credits--;
+                                m_sd_held++;
+                                hrm_tx_queue_inflight_push(p_queue, false, 0);
+                        }
+                }
+                else if (action < 6)
+                {
+                        // A Battery Level notification takes a slot behind the queue's back.
+                        if (m_sd_held < HVN_TX_QUEUE_SIZE)
+                        {
+                                m_sd_held++;
+                        }
+                }
+                else if (m_sd_held > 0)
+                {
+                        // Connection event: the SoftDevice transmits some of what it holds.
+                        uint8_t count = (uint8_t)(1 + rand_next(m_sd_held));
+
+                        m_sd_held -= count;
+                        CHECK(hrm_tx_queue_on_tx_complete(p_queue, count, seq * APP_TIMER_TICKS(1000)) == NRF_SUCCESS);
+                }
+                queue_check(p_queue);
+        }
+
+        queue_finish(p_queue, seq);
+
+        CHECK(drops_while_room == 0);
+        CHECK(p_queue->dropped_cnt > 0);
+        CHECK(p_queue->busy_cnt > 0);
+
+        printf("replay overload: %u queued, %u sent, %u dropped, %u busy\n",
+               (unsigned)p_queue->queued_cnt,
+               (unsigned)p_queue->sent_cnt,
+               (unsigned)p_queue->dropped_cnt,
+               (unsigned)p_queue->busy_cnt);
+}
+
+
+/**@brief Checks that a queue is flushed and the error returned when the SoftDevice refuses it.
+ *
+ * @param[in] sd_err_code  Error the stub SoftDevice returns.
+ * @param[in] expected     Error the queue must return.
+ */
+static void test_flush_on(uint32_t sd_err_code, ret_code_t expected)
+{
+        hrm_tx_queue_t * p_queue = hrm_tx_queue_get(TEST_CONN_HANDLE);
+        hrm_packet_t     packet;
+        uint32_t         seq;
+
+        hrm_tx_queue_reset(p_queue, TEST_CONN_HANDLE);
+        m_sd_held     = HVN_TX_QUEUE_SIZE;
+        m_sd_hrm_cnt  = 0;
+        m_sd_next_seq = 0;
+
+        // The SoftDevice is full, so measurements wait in the queue.
+        p_queue->credits = 0;
+        for (seq = 0; seq < 3; seq++)
+        {
+                packet_make(&packet, seq);
+                CHECK(hrm_tx_queue_put(p_queue, &packet) == NRF_SUCCESS);
+        }
+        CHECK(p_queue->count == 3);
+
+        m_sd_err_code = sd_err_code;
+        m_sd_held     = 0;
+        CHECK(hrm_tx_queue_on_tx_complete(p_queue, 1, 0) == expected);
+
+        // Nothing stays queued, nothing was sent, everything is counted.
+        CHECK(p_queue->count == 0);
+        CHECK(p_queue->sent_cnt == 0);
+        CHECK(p_queue->dropped_cnt == 3);
+        CHECK(p_queue->queued_cnt == 3);
+
+        packet_make(&packet, seq);
+        CHECK(hrm_tx_queue_put(p_queue, &packet) == expected);
+        CHECK(p_queue->count == 0);
+        CHECK(p_queue->dropped_cnt == 4);
+
+        m_sd_err_code = NRF_SUCCESS;
+}
+
+
+int main(void)
+{
+        hrm_tx_queue_init(TEST_VALUE_HANDLE, NULL);
+
+        CHECK(hrm_tx_queue_get(NRF_SDH_BLE_TOTAL_LINK_COUNT) == NULL);
+        CHECK(hrm_tx_queue_get(TEST_CONN_HANDLE)->conn_handle == BLE_CONN_HANDLE_INVALID);
+
+        test_replay_within_capacity();
+        test_replay_overload();
+        test_flush_on(NRF_ERROR_INVALID_STATE, NRF_ERROR_INVALID_STATE);
+        test_flush_on(BLE_ERROR_GATTS_SYS_ATTR_MISSING, NRF_ERROR_INVALID_STATE);
+        test_flush_on(BLE_ERROR_INVALID_CONN_HANDLE, BLE_ERROR_INVALID_CONN_HANDLE);
+
+        printf("test_hrm_tx_queue: PASS\n");
+        return 0;
+}
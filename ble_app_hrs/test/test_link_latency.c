@@ -0,0 +1,251 @@
+/** @file
+ *
+ * @brief Host simulation of the Heart Rate Measurement latency as the link count grows.
+ *
+ * @details Every link is a host streaming at STREAMING_MAX_CONN_INTERVAL. Hosts pick their own
+ *          anchor points and run on their own sleep clocks, so the links start at random phases
+ *          and drift against each other. The radio serves one connection event at a time: an
+ *          event reserves the GAP event length, and a link whose anchor falls into the reservation
+ *          of another skips its event. Like the SoftDevice, a link that skipped more events than
+ *          the one holding the radio takes over at its anchor.
+ *
+ *          Once per second a measurement is queued on every link, as hrm_fan_out() does, through
+ *          the real TX queue. A served link sends what the stub SoftDevice holds, as far as the
+ *          notifications fit in the rest of its reservation at 1M PHY, and gets TX complete at
+ *          the end of the event. The queue measures the sample-to-air latency. Link Layer
+ *          retransmissions and other notifications are not modelled.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hrm_tx_queue.h"
+#include "ble.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#define TEST_VALUE_HANDLE              0x0010                       /**< Heart Rate Measurement value handle given to the queues. */
+#define TEST_SECONDS                   300                          /**< Simulated time per case. */
+#define TEST_MIN_LINKS                 2                            /**< Smallest link count simulated. */
+#define TEST_CONN_INTERVAL_US          30000                        /**< Connection interval of every link (STREAMING_MAX_CONN_INTERVAL). */
+#define TEST_SAMPLE_INTERVAL_US        1000000                      /**< Heart rate measurement interval. */
+#define TEST_DRIFT_PPM                 50                           /**< Largest sleep clock drift of a host. */
+#define TEST_EVENT_LENGTH_DEFAULT      3                            /**< BLE_GAP_EVENT_LENGTH_DEFAULT of S132, in 1.25 ms units. */
+#define TEST_US_PER_BYTE               8                            /**< Air time per byte at 1M PHY. */
+#define TEST_US_PER_PDU                380                          /**< Inter frame spaces and the empty PDU acknowledging a PDU at 1M PHY. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+/**@brief State of one simulated link. */
+typedef struct
+{
+        double   anchor_us;                                         /**< Time of the next connection event. */
+        double   interval_us;                                       /**< Connection interval on the clock of the device. */
+        uint32_t skipped_cnt;                                       /**< Connection events skipped in a row. */
+        uint32_t held;                                              /**< Notifications the stub SoftDevice holds. */
+        uint16_t held_len[HVN_TX_QUEUE_SIZE];                       /**< Lengths of the held notifications, oldest first. */
+} link_t;
+
+/**@brief Result of one case. */
+typedef struct
+{
+        uint32_t latency_avg_ms;                                    /**< Average sample-to-air latency of all links. */
+        uint32_t latency_max_ms;                                    /**< Largest sample-to-air latency of any link. */
+        uint32_t dropped_cnt;                                       /**< Measurements dropped by the queues. */
+        uint32_t event_cnt;                                         /**< Connection events served. */
+        uint32_t skipped_cnt;                                       /**< Connection events skipped. */
+} result_t;
+
+static link_t   m_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];              /**< Simulated links. */
+static uint32_t m_rand = 1;                                         /**< State of the pseudo-random generator. */
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+        link_t * p_link = &m_links[conn_handle];
+
+        CHECK(p_hvx_params->handle == TEST_VALUE_HANDLE);
+
+        if (p_link->held == HVN_TX_QUEUE_SIZE)
+        {
+                return NRF_ERROR_RESOURCES;
+        }
+        p_link->held_len[p_link->held++] = *p_hvx_params->p_len;
+        return NRF_SUCCESS;
+}
+
+
+static uint32_t rand_next(uint32_t range)
+{
+        m_rand = (m_rand * 1103515245) + 12345;
+        return (m_rand >> 16) % range;
+}
+
+
+static uint32_t us_to_ticks(double us)
+{
+        return (uint32_t)((uint64_t)(us * APP_TIMER_CLOCK_FREQ / 1000000) & APP_TIMER_MAX_CNT_VAL);
+}
+
+
+/**@brief Serves a connection event of a link.
+ *
+ * @param[in] conn_handle  Link of the event.
+ * @param[in] start_us     Start of the event.
+ * @param[in] end_us       End of the radio time the link may use.
+ */
+static void event_serve(uint16_t conn_handle, double start_us, double end_us)
+{
+        link_t * p_link = &m_links[conn_handle];
+        double   now_us = start_us;
+        uint8_t  sent   = 0;
+
+        while ((sent < p_link->held) &&
+               (now_us + hrm_tx_queue_air_bytes_get(hrm_tx_queue_get(conn_handle), p_link->held_len[sent]) *
+                         TEST_US_PER_BYTE + TEST_US_PER_PDU <= end_us))
+        {
+                now_us += hrm_tx_queue_air_bytes_get(hrm_tx_queue_get(conn_handle), p_link->held_len[sent]) *
+                          TEST_US_PER_BYTE + TEST_US_PER_PDU;
+                sent++;
+        }
+
+        if (sent > 0)
+        {
+                p_link->held -= sent;
+                memmove(p_link->held_len, &p_link->held_len[sent], p_link->held * sizeof(uint16_t));
+                CHECK(hrm_tx_queue_on_tx_complete(hrm_tx_queue_get(conn_handle), sent, us_to_ticks(now_us)) ==
+                      NRF_SUCCESS);
+        }
+}
+
+
+/**@brief Runs one case.
+ *
+ * @param[in] link_cnt      Number of links.
+ * @param[in] event_length  GAP event length of every link, in 1.25 ms units.
+ */
+static result_t run(uint8_t link_cnt, uint16_t event_length)
+{
+        result_t     result       = {0};
+        double       reserved_us  = MIN(event_length * 1250.0, TEST_CONN_INTERVAL_US);
+        double       next_sample  = 0;
+        double       radio_end_us = 0;
+        int          holder       = -1;
+        uint64_t     latency_sum  = 0;
+        uint32_t     latency_cnt  = 0;
+        hrm_packet_t packet;
+
+        for (uint8_t i = 0; i < link_cnt; i++)
+        {
+                int32_t drift_ppm = (int32_t)rand_next(2 * TEST_DRIFT_PPM + 1) - TEST_DRIFT_PPM;
+
+                memset(&m_links[i], 0, sizeof(link_t));
+                m_links[i].anchor_us   = rand_next(TEST_CONN_INTERVAL_US);
+                m_links[i].interval_us = TEST_CONN_INTERVAL_US * (1.0 + drift_ppm / 1000000.0);
+                hrm_tx_queue_reset(hrm_tx_queue_get(i), i);
+        }
+
+        memset(&packet, 0, sizeof(packet));
+        packet.len = 2;
+
+        for (;;)
+        {
+                uint8_t next = 0;
+
+                for (uint8_t i = 1; i < link_cnt; i++)
+                {
+                        if (m_links[i].anchor_us < m_links[next].anchor_us)
+                        {
+                                next = i;
+                        }
+                }
+
+                link_t * p_link = &m_links[next];
+                double   now_us = p_link->anchor_us;
+
+                if (now_us >= TEST_SECONDS * 1000000.0)
+                {
+                        break;
+                }
+
+                while (next_sample <= now_us)
+                {
+                        packet.sample_ticks = us_to_ticks(next_sample);
+                        for (uint8_t i = 0; i < link_cnt; i++)
+                        {
+                                CHECK(hrm_tx_queue_put(hrm_tx_queue_get(i), &packet) == NRF_SUCCESS);
+                        }
+                        next_sample += TEST_SAMPLE_INTERVAL_US;
+                }
+
+                if ((now_us < radio_end_us) && (p_link->skipped_cnt <= m_links[holder].skipped_cnt))
+                {
+                        p_link->skipped_cnt++;
+                        result.skipped_cnt++;
+                }
+                else
+                {
+                        // The link either finds the radio free or takes it over.
+                        p_link->skipped_cnt = 0;
+                        holder              = next;
+                        radio_end_us        = now_us + reserved_us;
+                        result.event_cnt++;
+                        event_serve(next, now_us, radio_end_us);
+                }
+                p_link->anchor_us += p_link->interval_us;
+        }
+
+        for (uint8_t i = 0; i < link_cnt; i++)
+        {
+                hrm_tx_queue_t const * p_queue = hrm_tx_queue_get(i);
+
+                latency_sum          += p_queue->latency_sum_ms;
+                latency_cnt          += p_queue->latency_cnt;
+                result.latency_max_ms = MAX(result.latency_max_ms, p_queue->latency_max_ms);
+                result.dropped_cnt   += p_queue->dropped_cnt;
+        }
+
+        CHECK(latency_cnt > 0);
+        result.latency_avg_ms = (uint32_t)(latency_sum / latency_cnt);
+
+        return result;
+}
+
+
+int main(void)
+{
+        uint16_t const event_lengths[] = {TEST_EVENT_LENGTH_DEFAULT, NRF_SDH_BLE_GAP_EVENT_LENGTH};
+
+        hrm_tx_queue_init(TEST_VALUE_HANDLE, NULL);
+
+        for (uint8_t e = 0; e < ARRAY_SIZE(event_lengths); e++)
+        {
+                for (uint8_t link_cnt = TEST_MIN_LINKS; link_cnt <= NRF_SDH_BLE_TOTAL_LINK_COUNT; link_cnt++)
+                {
+                        result_t result = run(link_cnt, event_lengths[e]);
+
+                        printf("event length %3u, %u links: latency avg %4u ms, max %5u ms, "
+                               "%3u dropped, %5.1f %% events skipped\n",
+                               (unsigned)event_lengths[e],
+                               (unsigned)link_cnt,
+                               (unsigned)result.latency_avg_ms,
+                               (unsigned)result.latency_max_ms,
+                               (unsigned)result.dropped_cnt,
+                               100.0 * result.skipped_cnt / (result.event_cnt + result.skipped_cnt));
+
+                        // Every link keeps getting served, so a measurement waits a few intervals at most.
+                        CHECK(result.latency_max_ms <= link_cnt * (TEST_CONN_INTERVAL_US / 1000) * 2);
+                        CHECK(result.dropped_cnt == 0);
+                }
+        }
+
+        printf("test_link_latency: PASS\n");
+        return 0;
+}
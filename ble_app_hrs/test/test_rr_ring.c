@@ -0,0 +1,132 @@
+/** @file
+ *
+ * @brief Host test of the RR interval ring.
+ *
+ * @details A producer and a consumer thread hammer one ring, as the RR interval timer and the
+ *          Heart Rate Measurement encoder do from different interrupt priorities on the device.
+ *          The producer pushes consecutive values and only moves to the next one once a push
+ *          succeeded, so the consumer must see every value exactly once and in order, and every
+ *          failed push must show up in the overflow counter. Both sides yield when they cannot
+ *          make progress, so the test also interleaves on a single core, where preemption lands
+ *          at arbitrary points of push and pop.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "rr_ring.h"
+
+#define TEST_PUSH_COUNT                2000000                      /**< Number of values the producer pushes. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+static rr_ring_t m_ring;                                            /**< Ring under test. */
+static uint32_t  m_push_fail_cnt;                                   /**< Number of pushes the producer saw fail. */
+
+
+static void * producer(void * p_arg)
+{
+        (void)p_arg;
+
+        for (uint32_t i = 0; i < TEST_PUSH_COUNT; i++)
+        {
+                while (!rr_ring_push(&m_ring, (uint16_t)i))
+                {
+                        m_push_fail_cnt++;
+                        sched_yield();
+                }
+        }
+        return NULL;
+}
+
+
+static void * consumer(void * p_arg)
+{
+        uint16_t value;
+        uint32_t expected = 0;
+
+        (void)p_arg;
+
+        while (expected < TEST_PUSH_COUNT)
+        {
+                if (rr_ring_pop(&m_ring, &value))
+                {
+                        CHECK(value == (uint16_t)expected);
+                        expected++;
+                }
+                else
+                {
+                        sched_yield();
+                }
+        }
+        return NULL;
+}
+
+
+/**@brief Runs producer and consumer on two threads. */
+static void test_two_threads(void)
+{
+        pthread_t producer_thread;
+        pthread_t consumer_thread;
+        uint16_t  value;
+
+        rr_ring_init(&m_ring);
+
+        CHECK(pthread_create(&consumer_thread, NULL, consumer, NULL) == 0);
+        CHECK(pthread_create(&producer_thread, NULL, producer, NULL) == 0);
+        CHECK(pthread_join(producer_thread, NULL) == 0);
+        CHECK(pthread_join(consumer_thread, NULL) == 0);
+
+        CHECK(m_ring.overflow_cnt == m_push_fail_cnt);
+        CHECK(!rr_ring_pop(&m_ring, &value));
+
+        printf("two threads: %u values, %u pushes found the ring full\n",
+               (unsigned)TEST_PUSH_COUNT,
+               (unsigned)m_ring.overflow_cnt);
+}
+
+
+/**@brief Fills and drains the ring across the wrap of its free-running indexes. */
+static void test_index_wrap(void)
+{
+        uint16_t value;
+
+        rr_ring_init(&m_ring);
+        m_ring.head = 0xFFFFFFF0;
+        m_ring.tail = 0xFFFFFFF0;
+
+        for (uint32_t round = 0; round < 4; round++)
+        {
+                for (uint32_t i = 0; i < RR_RING_SIZE; i++)
+                {
+                        CHECK(rr_ring_push(&m_ring, (uint16_t)(round * RR_RING_SIZE + i)));
+                }
+                CHECK(!rr_ring_push(&m_ring, 0xFFFF));
+
+                for (uint32_t i = 0; i < RR_RING_SIZE; i++)
+                {
+                        CHECK(rr_ring_pop(&m_ring, &value));
+                        CHECK(value == (uint16_t)(round * RR_RING_SIZE + i));
+                }
+                CHECK(!rr_ring_pop(&m_ring, &value));
+        }
+        CHECK(m_ring.overflow_cnt == 4);
+}
+
+
+int main(void)
+{
+        test_index_wrap();
+        test_two_threads();
+
+        printf("test_rr_ring: PASS\n");
+        return 0;
+}
@@ -0,0 +1,286 @@
+/** @file
+ *
+ * @brief Host test of the sample stream codec.
+ *
+ * @details Round-trips sample streams through an encoder and a decoder and checks the edges of
+ *          the format: the largest deltas of either sign, keyframe placement including interval 0
+ *          over more samples than the keyframe counter holds, and truncated or malformed input.
+ *          Prints the compression of the simulated waveform the firmware streams, and the time
+ *          and cycles the host takes to encode a sample of it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "sample_codec.h"
+
+#define TEST_BATCH_LEN                 120                          /**< Samples per waveform batch, each batch starts with a keyframe. */
+#define TEST_TIMED_BATCHES             20000                        /**< Waveform batches encoded by the timing benchmark. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+
+/**@brief Encodes and decodes one sample and checks the result.
+ *
+ * @return Encoded length.
+ */
+static uint8_t round_trip(sample_codec_t * p_enc, sample_codec_t * p_dec, uint16_t sample)
+{
+        uint8_t  buf[SAMPLE_CODEC_MAX_LEN];
+        uint16_t decoded;
+        uint8_t  len = sample_codec_encode(p_enc, sample, buf, sizeof(buf));
+
+        CHECK((len >= 1) && (len <= SAMPLE_CODEC_MAX_LEN));
+        CHECK(sample_codec_decode(p_dec, buf, len, &decoded) == len);
+        CHECK(decoded == sample);
+        CHECK(memcmp(p_enc, p_dec, sizeof(sample_codec_t)) == 0);
+
+        return len;
+}
+
+
+/**@brief Largest deltas of either sign, including the jumps across the 16-bit wrap. */
+static void test_zigzag_extremes(void)
+{
+        static const uint16_t samples[] =
+        {
+                0x0000, 0x7FFF, 0x0000, 0x8001, 0x0000, 0x8000, 0xFFFF, 0x0000, 0xFFFF, 0x7FFF, 0xFFFE
+        };
+        sample_codec_t enc;
+        sample_codec_t dec;
+        uint8_t        buf[SAMPLE_CODEC_MAX_LEN];
+
+        sample_codec_init(&enc, 0);
+        sample_codec_init(&dec, 0);
+
+        for (uint32_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+        {
+                (void)round_trip(&enc, &dec, samples[i]);
+        }
+
+        // +32767 and -32767 are the widest deltas and take three bytes, +-1 takes one.
+        sample_codec_init(&enc, 0);
+        (void)sample_codec_encode(&enc, 0, buf, sizeof(buf));
+        CHECK(sample_codec_encode(&enc, 32767, buf, sizeof(buf)) == 3);
+        CHECK(sample_codec_encode(&enc, 0, buf, sizeof(buf)) == 3);
+        CHECK(sample_codec_encode(&enc, 1, buf, sizeof(buf)) == 1);
+        CHECK(sample_codec_encode(&enc, 0, buf, sizeof(buf)) == 1);
+}
+
+
+/**@brief Keyframes come every interval samples and after a reset. */
+static void test_keyframe_interval(void)
+{
+        sample_codec_t enc;
+        sample_codec_t dec;
+
+        sample_codec_init(&enc, 4);
+        sample_codec_init(&dec, 4);
+
+        for (uint32_t i = 0; i < 20; i++)
+        {
+                (void)round_trip(&enc, &dec, (uint16_t)(1000 + i));
+                CHECK(enc.since_keyframe == (i % 4) + 1);
+        }
+
+        sample_codec_reset(&enc);
+        sample_codec_reset(&dec);
+        CHECK(round_trip(&enc, &dec, 1000) == 2);
+        CHECK(enc.since_keyframe == 1);
+}
+
+
+/**@brief Interval 0 writes only the first keyframe, also past the range of the keyframe counter. */
+static void test_keyframe_interval_0(void)
+{
+        sample_codec_t enc;
+        sample_codec_t dec;
+
+        sample_codec_init(&enc, 0);
+        sample_codec_init(&dec, 0);
+
+        // A keyframe of 1000 takes two bytes, the deltas that follow take one.
+        CHECK(round_trip(&enc, &dec, 1000) == 2);
+        for (uint32_t i = 0; i < 3 * (UINT16_MAX + 1); i++)
+        {
+                CHECK(round_trip(&enc, &dec, 1000) == 1);
+        }
+
+        // A decoder joining late resynchronizes on the explicit reset only.
+        sample_codec_reset(&enc);
+        sample_codec_reset(&dec);
+        CHECK(round_trip(&enc, &dec, 1000) == 2);
+}
+
+
+/**@brief Truncated and malformed input is rejected without touching the decoder state. */
+static void test_truncated(void)
+{
+        static const uint8_t truncated_1[] = {0x80};
+        static const uint8_t truncated_2[] = {0xFF, 0xFF};
+        static const uint8_t too_long[]    = {0x80, 0x80, 0x80, 0x00};
+        static const uint8_t too_large[]   = {0xFF, 0xFF, 0x04};
+        sample_codec_t dec;
+        sample_codec_t dec_was;
+        uint16_t       sample = 0x1234;
+        uint8_t        buf[SAMPLE_CODEC_MAX_LEN];
+
+        sample_codec_init(&dec, 0);
+        CHECK(sample_codec_decode(&dec, (uint8_t const *)"\x05", 1, &sample) == 1);
+        CHECK(sample == 5);
+        dec_was = dec;
+
+        CHECK(sample_codec_decode(&dec, truncated_1, sizeof(truncated_1), &sample) == 0);
+        CHECK(sample_codec_decode(&dec, truncated_2, sizeof(truncated_2), &sample) == 0);
+        CHECK(sample_codec_decode(&dec, too_long, sizeof(too_long), &sample) == 0);
+        CHECK(sample_codec_decode(&dec, too_large, sizeof(too_large), &sample) == 0);
+        CHECK(sample_codec_decode(&dec, buf, 0, &sample) == 0);
+        CHECK(sample == 5);
+        CHECK(memcmp(&dec, &dec_was, sizeof(dec)) == 0);
+
+        // An encoder with no room writes nothing and keeps its state.
+        sample_codec_t enc;
+        sample_codec_t enc_was;
+
+        sample_codec_init(&enc, 0);
+        (void)sample_codec_encode(&enc, 0, buf, sizeof(buf));
+        enc_was = enc;
+        CHECK(sample_codec_encode(&enc, 32767, buf, 2) == 0);
+        CHECK(memcmp(&enc, &enc_was, sizeof(enc)) == 0);
+        CHECK(sample_codec_encode(&enc, 32767, buf, 3) == 3);
+}
+
+
+/**@brief Next sample of the simulated waveform: a 12-bit triangle in steps of 20, like the
+ *        waveform sensor simulator. */
+static uint16_t waveform_next(int32_t * p_sample, int32_t * p_step)
+{
+        if ((*p_sample + *p_step > 4095) || (*p_sample + *p_step < 0))
+        {
+                *p_step = -*p_step;
+        }
+        *p_sample += *p_step;
+
+        return (uint16_t)*p_sample;
+}
+
+
+/**@brief Reads a cycle counter, 0 where the host has none. */
+static uint64_t cycles_get(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+}
+
+
+/**@brief Compression of the simulated waveform, in batches that each start with a keyframe. */
+static void test_waveform_ratio(void)
+{
+        sample_codec_t enc;
+        sample_codec_t dec;
+        uint32_t       sample_cnt = 0;
+        uint32_t       coded_len  = 0;
+        int32_t        sample     = 0;
+        int32_t        step       = 20;
+
+        sample_codec_init(&enc, 50);
+        sample_codec_init(&dec, 50);
+
+        for (uint32_t batch = 0; batch < 1000; batch++)
+        {
+                sample_codec_reset(&enc);
+                sample_codec_reset(&dec);
+                for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+                {
+                        coded_len += round_trip(&enc, &dec, waveform_next(&sample, &step));
+                        sample_cnt++;
+                }
+        }
+
+        CHECK(2 * sample_cnt > coded_len);
+        printf("waveform: %u samples in %u bytes, compression %.2f:1\n",
+               (unsigned)sample_cnt,
+               (unsigned)coded_len,
+               (2.0 * sample_cnt) / coded_len);
+}
+
+
+/**@brief Time and cycles per sample to encode the simulated waveform on the host.
+ *
+ * @details The samples are generated up front, so that only the encoder is timed. The figures
+ *          are for the host CPU and only compare versions of the codec; the firmware counts the
+ *          Cortex-M4 cycles it spends encoding with the DWT cycle counter.
+ */
+static void test_encode_time(void)
+{
+        static uint16_t samples[TEST_BATCH_LEN];
+        sample_codec_t  enc;
+        uint8_t         buf[TEST_BATCH_LEN * SAMPLE_CODEC_MAX_LEN];
+        uint32_t        coded_len = 0;
+        uint32_t        sample_cnt;
+        int32_t         sample    = 0;
+        int32_t         step      = 20;
+        struct timespec start;
+        struct timespec end;
+        uint64_t        cycles;
+        double          ns;
+
+        for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+        {
+                samples[i] = waveform_next(&sample, &step);
+        }
+        sample_codec_init(&enc, 50);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        cycles = cycles_get();
+        for (uint32_t batch = 0; batch < TEST_TIMED_BATCHES; batch++)
+        {
+                uint16_t len = 0;
+
+                sample_codec_reset(&enc);
+                for (uint32_t i = 0; i < TEST_BATCH_LEN; i++)
+                {
+                        len += sample_codec_encode(&enc, samples[i], &buf[len], sizeof(buf) - len);
+                }
+                coded_len += len;
+        }
+        cycles = cycles_get() - cycles;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        sample_cnt = TEST_TIMED_BATCHES * TEST_BATCH_LEN;
+        ns         = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+
+        CHECK(coded_len > sample_cnt);
+        printf("encode: %u samples, %.1f ns/sample, %.1f cycles/sample\n",
+               (unsigned)sample_cnt,
+               ns / sample_cnt,
+               (double)cycles / sample_cnt);
+}
+
+
+int main(void)
+{
+        test_zigzag_extremes();
+        test_keyframe_interval();
+        test_keyframe_interval_0();
+        test_truncated();
+        test_waveform_ratio();
+        test_encode_time();
+
+        printf("test_sample_codec: PASS\n");
+        return 0;
+}
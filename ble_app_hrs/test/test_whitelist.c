@@ -0,0 +1,264 @@
+/** @file
+ *
+ * @brief Host test of the whitelist of the bonded hosts.
+ *
+ * @details A stub Peer Manager holds the bonds and their ranks, and records the whitelist it was
+ *          given. With more bonds than whitelist entries, every bonded host must get into the
+ *          whitelist within a few rotations while the most recently used hosts stay in. The test
+ *          also checks the ranking of hosts that come back, and that a whitelist advertising uses
+ *          is given again later instead of being lost.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "whitelist.h"
+#include "app_util.h"
+
+#define TEST_MAX_PEERS                 40                           /**< Most bonds the stub Peer Manager holds. */
+#define TEST_ROTATING_COUNT            (BLE_GAP_WHITELIST_ADDR_MAX_COUNT - WHITELIST_PINNED_COUNT)  /**< Whitelist entries that rotate. */
+
+#define CHECK(cond)                                                                                 \
+        do                                                                                          \
+        {                                                                                           \
+                if (!(cond))                                                                        \
+                {                                                                                   \
+                        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+                        exit(1);                                                                    \
+                }                                                                                   \
+        } while (0)
+
+static uint32_t     m_peer_cnt;                                     /**< Number of bonds. Their peer IDs are 0 to m_peer_cnt - 1. */
+static uint32_t     m_ranks[TEST_MAX_PEERS];                        /**< Rank of each bond in flash, 0 if never ranked. */
+static uint32_t     m_rank_highest_cnt;                             /**< Number of calls to pm_peer_rank_highest(). */
+static bool         m_adv_running;                                  /**< Whether advertising uses the whitelist. */
+static pm_peer_id_t m_pm_whitelist[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];   /**< Whitelist the Peer Manager was given. */
+static uint32_t     m_pm_whitelist_cnt;                             /**< Number of peers in m_pm_whitelist. */
+static uint32_t     m_pm_whitelist_set_cnt;                         /**< Number of whitelists the Peer Manager took. */
+
+
+pm_peer_id_t pm_next_peer_id_get(pm_peer_id_t prev_peer_id)
+{
+        pm_peer_id_t next = (prev_peer_id == PM_PEER_ID_INVALID) ? 0 : prev_peer_id + 1;
+
+        return (next < m_peer_cnt) ? next : PM_PEER_ID_INVALID;
+}
+
+
+ret_code_t pm_peer_data_load(pm_peer_id_t peer_id, pm_peer_data_id_t data_id, void * p_data, uint32_t * p_len)
+{
+        CHECK(data_id == PM_PEER_DATA_ID_PEER_RANK);
+        CHECK(*p_len == sizeof(uint32_t));
+
+        if ((peer_id >= m_peer_cnt) || (m_ranks[peer_id] == 0))
+        {
+                return NRF_ERROR_NOT_FOUND;
+        }
+        memcpy(p_data, &m_ranks[peer_id], sizeof(uint32_t));
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_peer_rank_highest(pm_peer_id_t peer_id)
+{
+        uint32_t rank = 0;
+
+        CHECK(peer_id < m_peer_cnt);
+
+        for (uint32_t i = 0; i < m_peer_cnt; i++)
+        {
+                rank = MAX(rank, m_ranks[i]);
+        }
+        m_ranks[peer_id] = rank + 1;
+        m_rank_highest_cnt++;
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_whitelist_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt)
+{
+        CHECK(peer_cnt <= BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+
+        if (m_adv_running)
+        {
+                return NRF_ERROR_INVALID_STATE;
+        }
+        memcpy(m_pm_whitelist, p_peers, peer_cnt * sizeof(pm_peer_id_t));
+        m_pm_whitelist_cnt = peer_cnt;
+        m_pm_whitelist_set_cnt++;
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_device_identities_list_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt)
+{
+        return NRF_ERROR_NOT_SUPPORTED;
+}
+
+
+static bool pm_whitelist_has(pm_peer_id_t peer_id)
+{
+        for (uint32_t i = 0; i < m_pm_whitelist_cnt; i++)
+        {
+                if (m_pm_whitelist[i] == peer_id)
+                {
+                        return true;
+                }
+        }
+        return false;
+}
+
+
+/**@brief Creates bonds, peer 0 the most recently used, and loads the whitelist from them. */
+static void bonds_load(uint32_t peer_cnt)
+{
+        m_peer_cnt = peer_cnt;
+        for (uint32_t i = 0; i < peer_cnt; i++)
+        {
+                m_ranks[i] = peer_cnt - i;
+        }
+        m_adv_running = false;
+
+        CHECK(whitelist_load() == NRF_SUCCESS);
+}
+
+
+/**@brief Checks that with up to one whitelist of bonds all of them are in it, without rotation. */
+static void test_few_bonds(void)
+{
+        bonds_load(BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+
+        CHECK(!whitelist_is_rotating());
+        CHECK(whitelist_peer_count() == BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+        CHECK(m_pm_whitelist_cnt == BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+        CHECK(!whitelist_rotate());
+}
+
+
+/**@brief Checks that with more bonds than entries every bonded host gets into the whitelist,
+ *        while the most recently used hosts stay in it.
+ */
+static void test_rotation(uint32_t peer_cnt)
+{
+        bool     seen[TEST_MAX_PEERS] = {false};
+        uint32_t seen_cnt             = 0;
+        uint32_t rotations            = CEIL_DIV(peer_cnt - WHITELIST_PINNED_COUNT, TEST_ROTATING_COUNT);
+
+        bonds_load(peer_cnt);
+
+        CHECK(whitelist_is_rotating());
+        CHECK(whitelist_rank_count() == peer_cnt);
+
+        for (uint32_t r = 0; r < rotations; r++)
+        {
+                CHECK(m_pm_whitelist_cnt == BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+                for (pm_peer_id_t peer_id = 0; peer_id < WHITELIST_PINNED_COUNT; peer_id++)
+                {
+                        CHECK(pm_whitelist_has(peer_id));
+                }
+                for (pm_peer_id_t peer_id = 0; peer_id < peer_cnt; peer_id++)
+                {
+                        CHECK(pm_whitelist_has(peer_id) == whitelist_has(peer_id));
+                        if (pm_whitelist_has(peer_id) && !seen[peer_id])
+                        {
+                                seen[peer_id] = true;
+                                seen_cnt++;
+                        }
+                }
+
+                CHECK(whitelist_rotate());
+                CHECK(whitelist_apply() == NRF_SUCCESS);
+        }
+
+        printf("%u bonds: all in the whitelist after %u rotations\n", (unsigned)peer_cnt, (unsigned)(rotations - 1));
+        CHECK(seen_cnt == peer_cnt);
+}
+
+
+/**@brief Checks that only the WHITELIST_RANK_MAX_PEERS most recently used bonds are ranked. */
+static void test_rank_max(void)
+{
+        bonds_load(TEST_MAX_PEERS);
+
+        CHECK(whitelist_rank_count() == WHITELIST_RANK_MAX_PEERS);
+        for (uint32_t i = 0; i < WHITELIST_RANK_MAX_PEERS; i++)
+        {
+                CHECK(whitelist_rank_get(i) == i);
+        }
+        CHECK(whitelist_rank_get(WHITELIST_RANK_MAX_PEERS) == PM_PEER_ID_INVALID);
+}
+
+
+/**@brief Checks the ranking and the statistics of the hosts that come back. */
+static void test_reconnect(void)
+{
+        whitelist_stats_t before;
+        whitelist_stats_t after;
+        pm_peer_id_t      out = WHITELIST_PINNED_COUNT + TEST_ROTATING_COUNT;
+
+        bonds_load(12);
+        whitelist_stats_get(&before);
+        m_rank_highest_cnt = 0;
+
+        // The most recently used host keeps its rank without a flash write.
+        CHECK(whitelist_on_reconnected(0) == NRF_SUCCESS);
+        CHECK(m_rank_highest_cnt == 0);
+        CHECK(whitelist_rank_get(0) == 0);
+
+        // A host out of the whitelist moves to the front and is pinned.
+        CHECK(!whitelist_has(out));
+        CHECK(whitelist_on_reconnected(out) == NRF_SUCCESS);
+        CHECK(m_rank_highest_cnt == 1);
+        CHECK(whitelist_rank_get(0) == out);
+        CHECK(pm_whitelist_has(out));
+
+        whitelist_stats_get(&after);
+        CHECK(after.hit_cnt == before.hit_cnt + 1);
+        CHECK(after.miss_cnt == before.miss_cnt + 1);
+
+        // The rank survives a reset.
+        CHECK(whitelist_load() == NRF_SUCCESS);
+        CHECK(whitelist_rank_get(0) == out);
+}
+
+
+/**@brief Checks that a whitelist advertising uses is given to the Peer Manager later. */
+static void test_in_use(void)
+{
+        uint32_t set_cnt;
+
+        bonds_load(4);
+        set_cnt = m_pm_whitelist_set_cnt;
+
+        m_peer_cnt    = 5;
+        m_adv_running = true;
+        CHECK(whitelist_add(4) == NRF_ERROR_INVALID_STATE);
+        CHECK(whitelist_has(4));
+        CHECK(!pm_whitelist_has(4));
+
+        m_adv_running = false;
+        CHECK(whitelist_apply() == NRF_SUCCESS);
+        CHECK(pm_whitelist_has(4));
+        CHECK(m_pm_whitelist_set_cnt == set_cnt + 1);
+
+        // Nothing changed, nothing is given.
+        CHECK(whitelist_remove(PM_PEER_ID_INVALID) == NRF_SUCCESS);
+        CHECK(m_pm_whitelist_set_cnt == set_cnt + 1);
+
+        CHECK(whitelist_remove(4) == NRF_SUCCESS);
+        CHECK(!pm_whitelist_has(4));
+}
+
+
+int main(void)
+{
+        test_few_bonds();
+        test_rotation(BLE_GAP_WHITELIST_ADDR_MAX_COUNT + 1);
+        test_rotation(12);
+        test_rotation(WHITELIST_RANK_MAX_PEERS);
+        test_rank_max();
+        test_reconnect();
+        test_in_use();
+
+        printf("test_whitelist: PASS\n");
+        return 0;
+}
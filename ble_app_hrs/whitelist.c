@@ -0,0 +1,287 @@
+/** @file
+ *
+ * @brief Whitelist of the bonded hosts module.
+ */
+#include <string.h>
+#include "whitelist.h"
+
+
+static pm_peer_id_t      m_whitelist_peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];   /**< List of peers currently in the whitelist. */
+static uint32_t          m_whitelist_peer_cnt;                      /**< Number of peers currently in the whitelist. */
+static bool              m_whitelist_dirty = true;                  /**< The whitelist differs from the one given to the Peer Manager. */
+static pm_peer_id_t      m_bond_ranked[WHITELIST_RANK_MAX_PEERS];   /**< Bonded peers, most recently used first. */
+static uint32_t          m_bond_ranked_cnt;                         /**< Number of peers in m_bond_ranked. */
+static uint32_t          m_whitelist_rotation;                      /**< Position of the rotating whitelist entries among the less recently used peers. */
+static whitelist_stats_t m_whitelist_stats;                         /**< Whitelist statistics. */
+
+
+/**@brief Function for filling the whitelist from the ranked peers.
+ *
+ * @details The whitelist is only marked as changed if the set of peers differs.
+ */
+static void whitelist_build(void)
+{
+        pm_peer_id_t peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+        uint32_t     peer_cnt = 0;
+        bool         changed;
+
+        if (!whitelist_is_rotating())
+        {
+                for (uint32_t i = 0; i < m_bond_ranked_cnt; i++)
+                {
+                        peers[peer_cnt++] = m_bond_ranked[i];
+                }
+        }
+        else
+        {
+                uint32_t rest_cnt = m_bond_ranked_cnt - WHITELIST_PINNED_COUNT;
+
+                for (uint32_t i = 0; i < WHITELIST_PINNED_COUNT; i++)
+                {
+                        peers[peer_cnt++] = m_bond_ranked[i];
+                }
+                for (uint32_t i = 0; i < BLE_GAP_WHITELIST_ADDR_MAX_COUNT - WHITELIST_PINNED_COUNT; i++)
+                {
+                        peers[peer_cnt++] = m_bond_ranked[WHITELIST_PINNED_COUNT + ((m_whitelist_rotation + i) % rest_cnt)];
+                }
+        }
+
+        changed = (peer_cnt != m_whitelist_peer_cnt);
+        for (uint32_t i = 0; (i < peer_cnt) && !changed; i++)
+        {
+                changed = !whitelist_has(peers[i]);
+        }
+
+        if (changed)
+        {
+                memset(m_whitelist_peers, PM_PEER_ID_INVALID, sizeof(m_whitelist_peers));
+                memcpy(m_whitelist_peers, peers, peer_cnt * sizeof(pm_peer_id_t));
+                m_whitelist_peer_cnt = peer_cnt;
+                m_whitelist_dirty    = true;
+        }
+}
+
+
+/**@brief Function for removing a peer from the ranking.
+ *
+ * @param[in] peer_id  Peer to remove.
+ */
+static void bond_rank_remove(pm_peer_id_t peer_id)
+{
+        for (uint32_t i = 0; i < m_bond_ranked_cnt; i++)
+        {
+                if (m_bond_ranked[i] == peer_id)
+                {
+                        m_bond_ranked_cnt--;
+                        memmove(&m_bond_ranked[i], &m_bond_ranked[i + 1], (m_bond_ranked_cnt - i) * sizeof(pm_peer_id_t));
+                        return;
+                }
+        }
+}
+
+
+/**@brief Function for ranking a peer as the most recently used.
+ *
+ * @param[in] peer_id  Peer.
+ */
+static void bond_rank_front(pm_peer_id_t peer_id)
+{
+        bond_rank_remove(peer_id);
+
+        if (m_bond_ranked_cnt < WHITELIST_RANK_MAX_PEERS)
+        {
+                m_bond_ranked_cnt++;
+        }
+        memmove(&m_bond_ranked[1], &m_bond_ranked[0], (m_bond_ranked_cnt - 1) * sizeof(pm_peer_id_t));
+        m_bond_ranked[0] = peer_id;
+}
+
+
+ret_code_t whitelist_load(void)
+{
+        uint32_t     ranks[WHITELIST_RANK_MAX_PEERS];
+        pm_peer_id_t peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+
+        m_bond_ranked_cnt = 0;
+
+        while (peer_id != PM_PEER_ID_INVALID)
+        {
+                uint32_t rank = 0;
+                uint32_t len  = sizeof(rank);
+                uint32_t pos;
+
+                // Peers never ranked are the least recently used.
+                if (pm_peer_data_load(peer_id, PM_PEER_DATA_ID_PEER_RANK, &rank, &len) != NRF_SUCCESS)
+                {
+                        rank = 0;
+                }
+
+                if (m_bond_ranked_cnt < WHITELIST_RANK_MAX_PEERS)
+                {
+                        pos = m_bond_ranked_cnt++;
+                }
+                else if (rank > ranks[WHITELIST_RANK_MAX_PEERS - 1])
+                {
+                        pos = WHITELIST_RANK_MAX_PEERS - 1;
+                }
+                else
+                {
+                        peer_id = pm_next_peer_id_get(peer_id);
+                        continue;
+                }
+
+                for (; (pos > 0) && (ranks[pos - 1] < rank); pos--)
+                {
+                        ranks[pos]         = ranks[pos - 1];
+                        m_bond_ranked[pos] = m_bond_ranked[pos - 1];
+                }
+                ranks[pos]         = rank;
+                m_bond_ranked[pos] = peer_id;
+
+                peer_id = pm_next_peer_id_get(peer_id);
+        }
+
+        m_whitelist_rotation = 0;
+        whitelist_build();
+
+        m_whitelist_dirty = true;
+        return whitelist_apply();
+}
+
+
+ret_code_t whitelist_apply(void)
+{
+        ret_code_t err_code;
+
+        if (!m_whitelist_dirty)
+        {
+                m_whitelist_stats.avoided_cnt++;
+                return NRF_SUCCESS;
+        }
+
+        err_code = pm_whitelist_set(m_whitelist_peers, m_whitelist_peer_cnt);
+        if (err_code != NRF_SUCCESS)
+        {
+                return err_code;
+        }
+
+        if (m_whitelist_peer_cnt > 0)
+        {
+                // Some SoftDevices do not support the device identities list.
+                err_code = pm_device_identities_list_set(m_whitelist_peers, m_whitelist_peer_cnt);
+                if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_NOT_SUPPORTED))
+                {
+                        return err_code;
+                }
+        }
+
+        m_whitelist_dirty = false;
+        m_whitelist_stats.push_cnt++;
+
+        return NRF_SUCCESS;
+}
+
+
+ret_code_t whitelist_add(pm_peer_id_t peer_id)
+{
+        bond_rank_front(peer_id);
+        whitelist_build();
+        return whitelist_apply();
+}
+
+
+ret_code_t whitelist_remove(pm_peer_id_t peer_id)
+{
+        bond_rank_remove(peer_id);
+        whitelist_build();
+        return whitelist_apply();
+}
+
+
+ret_code_t whitelist_on_reconnected(pm_peer_id_t peer_id)
+{
+        ret_code_t err_code;
+
+        if (whitelist_has(peer_id))
+        {
+                m_whitelist_stats.hit_cnt++;
+        }
+        else
+        {
+                m_whitelist_stats.miss_cnt++;
+        }
+
+        // The same host coming back keeps its rank, without a flash write.
+        if ((m_bond_ranked_cnt > 0) && (m_bond_ranked[0] == peer_id))
+        {
+                return NRF_SUCCESS;
+        }
+
+        err_code = pm_peer_rank_highest(peer_id);
+        if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_BUSY) && (err_code != NRF_ERROR_STORAGE_FULL))
+        {
+                return err_code;
+        }
+
+        bond_rank_front(peer_id);
+        whitelist_build();
+        return whitelist_apply();
+}
+
+
+bool whitelist_rotate(void)
+{
+        if (!whitelist_is_rotating())
+        {
+                return false;
+        }
+
+        m_whitelist_rotation += BLE_GAP_WHITELIST_ADDR_MAX_COUNT - WHITELIST_PINNED_COUNT;
+        whitelist_build();
+
+        return m_whitelist_dirty;
+}
+
+
+bool whitelist_is_rotating(void)
+{
+        return m_bond_ranked_cnt > BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+}
+
+
+bool whitelist_has(pm_peer_id_t peer_id)
+{
+        for (uint32_t i = 0; i < m_whitelist_peer_cnt; i++)
+        {
+                if (m_whitelist_peers[i] == peer_id)
+                {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+
+uint32_t whitelist_peer_count(void)
+{
+        return m_whitelist_peer_cnt;
+}
+
+
+uint32_t whitelist_rank_count(void)
+{
+        return m_bond_ranked_cnt;
+}
+
+
+pm_peer_id_t whitelist_rank_get(uint32_t pos)
+{
+        return (pos < m_bond_ranked_cnt) ? m_bond_ranked[pos] : PM_PEER_ID_INVALID;
+}
+
+
+void whitelist_stats_get(whitelist_stats_t * p_stats)
+{
+        *p_stats = m_whitelist_stats;
+}
@@ -0,0 +1,153 @@
+/** @file
+ *
+ * @defgroup whitelist Whitelist of the bonded hosts
+ * @{
+ * @brief Whitelist filled from the bonded hosts, most recently used first.
+ *
+ * @details The bonded hosts are ranked by the Peer Manager, which keeps the ranks in flash. When
+ *          there are more bonds than whitelist entries, the @ref WHITELIST_PINNED_COUNT most
+ *          recently used hosts stay in the whitelist and the remaining entries take turns among
+ *          the others each time @ref whitelist_rotate is called, so that every bonded host gets
+ *          back in.
+ *
+ *          The whitelist is only given to the Peer Manager when the set of peers changed. It
+ *          cannot be set while advertising uses it; it then stays changed and is given again by
+ *          the next @ref whitelist_apply.
+ *
+ *          The module runs no timer. The application rotates the whitelist periodically while
+ *          @ref whitelist_is_rotating is true.
+ */
+#ifndef WHITELIST_H__
+#define WHITELIST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble.h"
+#include "peer_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WHITELIST_RANK_MAX_PEERS       32                           /**< Most bonded hosts ranked for the whitelist. */
+#define WHITELIST_PINNED_COUNT         (BLE_GAP_WHITELIST_ADDR_MAX_COUNT - 2)  /**< Whitelist entries kept for the most recently used hosts when there are more bonds than entries. The others rotate. */
+
+/**@brief Whitelist statistics. */
+typedef struct
+{
+        uint32_t push_cnt;                                          /**< Number of times the whitelist was given to the Peer Manager. */
+        uint32_t avoided_cnt;                                       /**< Number of whitelist updates that did not change it. */
+        uint32_t hit_cnt;                                           /**< Number of bonded hosts that came back while in the whitelist. */
+        uint32_t miss_cnt;                                          /**< Number of bonded hosts that came back while out of the whitelist. */
+} whitelist_stats_t;
+
+
+/**@brief Function for ranking the bonded peers from flash and applying the whitelist.
+ *
+ * @details Peers never ranked are the least recently used. The rotation starts over.
+ *
+ * @retval NRF_SUCCESS              If the whitelist was applied.
+ * @retval NRF_ERROR_INVALID_STATE  If advertising uses the whitelist. It is applied later.
+ * @return Otherwise the error code of the Peer Manager.
+ */
+ret_code_t whitelist_load(void);
+
+
+/**@brief Function for giving the whitelist and the identity list to the Peer Manager if they
+ *        changed.
+ *
+ * @retval NRF_SUCCESS              If the lists were given, or had not changed.
+ * @retval NRF_ERROR_INVALID_STATE  If advertising uses the whitelist. It stays changed.
+ * @return Otherwise the error code of the Peer Manager.
+ */
+ret_code_t whitelist_apply(void);
+
+
+/**@brief Function for adding a new bond to the whitelist as the most recently used host.
+ *
+ * @param[in] peer_id  Peer to add.
+ *
+ * @return The result of @ref whitelist_apply.
+ */
+ret_code_t whitelist_add(pm_peer_id_t peer_id);
+
+
+/**@brief Function for removing a deleted bond from the whitelist.
+ *
+ * @param[in] peer_id  Peer to remove.
+ *
+ * @return The result of @ref whitelist_apply.
+ */
+ret_code_t whitelist_remove(pm_peer_id_t peer_id);
+
+
+/**@brief Function for ranking a bonded host that came back as the most recently used.
+ *
+ * @details Counts whether the host came back through the whitelist. The most recently used host
+ *          coming back again keeps its rank, without a flash write. A rank the Peer Manager could
+ *          not store is only kept until the next reset.
+ *
+ * @param[in] peer_id  Peer of the host.
+ *
+ * @return The result of @ref whitelist_apply, or the error code of the Peer Manager.
+ */
+ret_code_t whitelist_on_reconnected(pm_peer_id_t peer_id);
+
+
+/**@brief Function for moving the rotating whitelist entries on to the next less recently used
+ *        hosts.
+ *
+ * @details Does nothing unless @ref whitelist_is_rotating. The new whitelist is not applied.
+ *
+ * @return true if the whitelist changed and must be applied.
+ */
+bool whitelist_rotate(void);
+
+
+/**@brief Function for checking whether there are more bonds than whitelist entries, and the
+ *        whitelist is to be rotated.
+ */
+bool whitelist_is_rotating(void);
+
+
+/**@brief Function for checking whether a peer is in the whitelist.
+ *
+ * @param[in] peer_id  Peer.
+ */
+bool whitelist_has(pm_peer_id_t peer_id);
+
+
+/**@brief Function for getting the number of peers in the whitelist.
+ */
+uint32_t whitelist_peer_count(void);
+
+
+/**@brief Function for getting the number of ranked bonded peers.
+ */
+uint32_t whitelist_rank_count(void);
+
+
+/**@brief Function for getting a ranked bonded peer.
+ *
+ * @param[in] pos  Rank, 0 for the most recently used.
+ *
+ * @return The peer, PM_PEER_ID_INVALID if pos is not below @ref whitelist_rank_count.
+ */
+pm_peer_id_t whitelist_rank_get(uint32_t pos);
+
+
+/**@brief Function for getting the whitelist statistics.
+ *
+ * @param[out] p_stats  Statistics.
+ */
+void whitelist_stats_get(whitelist_stats_t * p_stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WHITELIST_H__
+
+/** @} */